@@ -1,20 +1,48 @@
-
 #version 450
 
 layout(binding = 0) uniform UBO {
     mat4x3 transformMat;
 } ubo;
 
-// samplers that samples frame buffer from RYGB pass
-layout(binding = 1) uniform sampler2D canvasRYGB;
+// `AppPainter::TILE_SIZE` and `AppPainter::ATLAS_LAYER_TILES`
+const int TILE_SIZE = 256;
+const uint ATLAS_LAYER_TILES = 4;
+
+layout(push_constant) uniform PushConstants {
+    ivec2 viewOffset; // of the view on the canvas, in pixels
+    uint numTilesX;
+} pushConstants;
+
+// the canvas' tiles, fetched texel by texel
+layout(binding = 1) uniform sampler2DArray tileAtlas;
+
+// atlas slot + 1 of each tile of the canvas, 0 for tiles never painted on
+layout(std430, binding = 2) readonly buffer TileTable {
+    uint tileSlots[];
+};
 
 layout(location = 0) out vec4 outColor;
 
 layout(location = 1) in vec2 fragUV; // outUV from vertex shader
 
 void main() {
+    // the view maps to the canvas pixel for pixel
+    ivec2 pixel = pushConstants.viewOffset + ivec2(gl_FragCoord.xy);
+    ivec2 tile = pixel / TILE_SIZE;
+    uint slot = tileSlots[uint(tile.y) * pushConstants.numTilesX + uint(tile.x)];
+
     // vec4 are single-precision floats already
-    vec4 colorRYGB = texture(canvasRYGB, fragUV);
+    vec4 colorRYGB = vec4(0.0); // tiles never painted on are clear
+    if (slot != 0) {
+        slot -= 1;
+        uint slotInLayer = slot % (ATLAS_LAYER_TILES * ATLAS_LAYER_TILES);
+        ivec2 slotOrigin = ivec2(slotInLayer % ATLAS_LAYER_TILES, slotInLayer / ATLAS_LAYER_TILES);
+        ivec3 texel = ivec3(
+            slotOrigin * TILE_SIZE + pixel % TILE_SIZE,
+            slot / (ATLAS_LAYER_TILES * ATLAS_LAYER_TILES)
+        );
+        colorRYGB = texelFetch(tileAtlas, texel, 0);
+    }
 
     // apply color transform matrix, converting RYGB to RGB/OCV
     vec4 colorViewSpace = vec4(ubo.transformMat * colorRYGB, 1.f);
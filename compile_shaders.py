@@ -7,7 +7,7 @@ shaders_path = os.path.join(os.getcwd(), "shaders")
 print("Compiling all shaders in {}".format(shaders_path))
 for root, dirs, files in os.walk(shaders_path):
     for file in files:
-        if file.endswith(".vert") or file.endswith(".frag"):
+        if file.endswith(".vert") or file.endswith(".frag") or file.endswith(".comp"):
             print("Compiling shader: " + file)
             subprocess.call(["glslc", os.path.join(root, file), "-o", os.path.join(root, file + ".spv")])
 
@@ -16,6 +16,6 @@ shaders_path = os.path.join(os.getcwd(), "assets/apps")
 print("Compiling all shaders in {}".format(shaders_path))
 for root, dirs, files in os.walk(shaders_path):
     for file in files:
-        if file.endswith(".vert") or file.endswith(".frag"):
+        if file.endswith(".vert") or file.endswith(".frag") or file.endswith(".comp"):
             print("Compiling shader: " + file)
             subprocess.call(["glslc", os.path.join(root, file), "-o", os.path.join(root, file + ".spv")])
@@ -0,0 +1,47 @@
+// shared by the LUT post-process shaders, see `Tetrium_LUT.cpp`
+
+layout(location = 1) in vec2 inUV;
+
+layout(location = 0) out vec4 outColor;
+
+// copy of the final frame, in the swapchain's format
+layout(binding = 0) uniform sampler2D frameImage;
+
+layout(push_constant) uniform PushConstants
+{
+    vec4 domainMin; // input range of the LUT, from the .cube file
+    vec4 domainMax;
+    float size;    // number of entries along each axis of the LUT
+    int srgbFrame; // whether the frame has an sRGB format, i.e. reads and writes are linear
+} pc;
+
+// LUTs map display-encoded values
+vec3 linearToSrgb(vec3 c)
+{
+    return mix(12.92 * c, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055, greaterThan(c, vec3(0.0031308)));
+}
+
+vec3 srgbToLinear(vec3 c)
+{
+    return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), greaterThan(c, vec3(0.04045)));
+}
+
+// display-encoded color of the frame at this fragment
+vec4 loadFrame()
+{
+    vec4 color = texelFetch(frameImage, ivec2(gl_FragCoord.xy), 0);
+    return pc.srgbFrame != 0 ? vec4(linearToSrgb(color.rgb), color.a) : color;
+}
+
+// write back a display-encoded color
+void storeFrame(vec3 color, float alpha)
+{
+    outColor = vec4(pc.srgbFrame != 0 ? srgbToLinear(color) : color, alpha);
+}
+
+// texture coordinate of `srgb` in the LUT, where entries sit at texel centers
+vec3 lutCoord(vec3 srgb)
+{
+    vec3 x = clamp((srgb - pc.domainMin.rgb) / (pc.domainMax.rgb - pc.domainMin.rgb), 0.0, 1.0);
+    return (x * (pc.size - 1.0) + 0.5) / pc.size;
+}
@@ -0,0 +1,21 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// applies a per-channel 1D LUT to the final frame
+
+#include "lut.glsl"
+
+// `size` x 1 texels, each channel maps the same channel of the input
+layout(binding = 1) uniform sampler2D lut;
+
+void main()
+{
+    vec4 color = loadFrame();
+    vec3 coord = lutCoord(color.rgb);
+    vec3 mapped = vec3(
+        texture(lut, vec2(coord.r, 0.5)).r,
+        texture(lut, vec2(coord.g, 0.5)).g,
+        texture(lut, vec2(coord.b, 0.5)).b
+    );
+    storeFrame(mapped, color.a);
+}
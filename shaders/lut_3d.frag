@@ -0,0 +1,16 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// applies a 3D LUT to the final frame, trilinearly interpolated
+
+#include "lut.glsl"
+
+// `size`^3 texels indexed by the input's (r, g, b)
+layout(binding = 1) uniform sampler3D lut;
+
+void main()
+{
+    vec4 color = loadFrame();
+    vec3 mapped = texture(lut, lutCoord(color.rgb)).rgb;
+    storeFrame(mapped, color.a);
+}
@@ -14,6 +14,7 @@
 #include "lib/VQBuffer.h"
 #include "lib/VQDevice.h"
 
+#include "lib/DeferredDeletionQueue.h"
 #include "lib/DeletionStack.h"
 
 // structs
@@ -23,9 +24,11 @@
 // Engine Components
 #include "components/Camera.h"
 #include "components/DeltaTimer.h"
+#include "components/GpuProfiler.h"
 #include "components/InputManager.h"
 #include "components/Profiler.h"
 #include "components/TextureManager.h"
+#include "components/TraceCapture.h"
 #include "components/imgui_widgets/ImGuiWidget.h"
 #include "components/SoundManager.h"
 
@@ -43,6 +46,7 @@ class Tetrium
 {
   private:
     static const std::vector<const char*> DEFAULT_INSTANCE_EXTENSIONS;
+    static const std::vector<const char*> HEADLESS_INSTANCE_EXTENSIONS;
     static const std::vector<const char*> DEFAULT_DEVICE_EXTENSIONS;
 
     static const std::vector<const char*> EVEN_ODD_HARDWARE_INSTANCE_EXTENSIONS;
@@ -64,13 +68,29 @@ class Tetrium
     {
         kEvenOddHardwareSync, // use NVIDIA gpu to hardware sync even-odd frames
         kEvenOddSoftwareSync, // use a timer/frame render callback to software sync even-odd frames
-        kDualProjector        // use two projectors and superposition the outputs, not implemented
+        kDualProjector,       // use two projectors and superposition the outputs, not implemented
+        kHeadless // no window or display; render even-odd frames into off-screen images for a
+                  // fixed number of ticks. Runs on software rasterizers such as lavapipe.
+    };
+
+    // Options that only apply under `TetraMode::kHeadless`
+    struct HeadlessOptions
+    {
+        uint32_t numTicks = 1000; // number of ticks `Run()` performs before returning
+        uint32_t width = DEFAULTS::WINDOW_WIDTH;   // resolution of the off-screen images
+        uint32_t height = DEFAULTS::WINDOW_HEIGHT;
+        std::string primaryApp = ""; // name of the app to open on start; main menu if empty
     };
 
     // Initialization options
     struct InitOptions
     {
         TetraMode tetraMode = TetraMode::kEvenOddHardwareSync;
+        HeadlessOptions headless = {};
+        // .cube LUTs applied to the final frame of each color space, indexed by `ColorSpace`;
+        // empty for none
+        std::array<std::string, ColorSpace::ColorSpaceSize> lutPaths
+            = {DEFAULTS::Engine::DISPLAY_CORRECTION_LUT, DEFAULTS::Engine::DISPLAY_CORRECTION_LUT};
     };
 
     // Engine-wide static UBO that gets updated every Tick()
@@ -91,6 +111,34 @@ class Tetrium
 
     void RegisterApp(TetriumApp::App* app, const std::string& appName);
 
+    // make a registered app the primary app, closing the current one
+    void OpenApp(const std::string& appName);
+    // close the primary app and return to the main menu
+    void CloseApp();
+
+    // entries recorded by `PROFILE_SCOPE` during the last `Tick()`
+    std::span<const Profiler::Entry> GetLastProfilerData() const { return _lastProfilerData; }
+    // rolling per-scope statistics over the last `Profiler::STATS_WINDOW` ticks
+    std::span<const Profiler::ScopeStats> GetProfilerStats() const
+    {
+        return _profiler.GetScopeStats();
+    }
+    // scopes recorded by `PROFILE_GPU_SCOPE`, of the last frame whose results were read back
+    std::span<const GpuProfiler::Entry> GetLastGpuProfilerData() const
+    {
+        return _gpuProfiler.GetLastFrame();
+    }
+    // capture the profiler scopes of the next `numFrames` ticks into a chrome://tracing /
+    // Perfetto JSON file; returns false if a capture is already running.
+    bool StartTraceCapture(const std::string& path, uint32_t numFrames)
+    {
+        return _traceCapture.Start(path, numFrames, _profiler.GetNumThreads());
+    }
+
+    // replace the LUT applied to the final frame of `colorSpace` with the .cube file at `path`;
+    // an empty path removes it. Returns false and keeps the current LUT on failure.
+    bool LoadLUT(ColorSpace colorSpace, const std::string& path);
+
   private:
     /* ---------- Packed Structs ---------- */
     // context for a single swapchain;
@@ -106,7 +154,7 @@ class Tetrium
         std::vector<VkFramebuffer> frameBuffer;
         size_t numImages;
         VkImage depthImage;
-        VkDeviceMemory depthImageMemory;
+        VQAllocation depthImageMemory;
         VkImageView depthImageView;
         VkSurfaceKHR surface;
     };
@@ -138,7 +186,7 @@ class Tetrium
         std::vector<VkFramebuffer> frameBuffer;
         std::vector<VkImage> image;
         std::vector<VkImageView> imageView;
-        std::vector<VkDeviceMemory> imageMemory; // memory to hold virtual swap chain
+        std::vector<VQAllocation> imageMemory; // memory to hold virtual swap chain
     };
 
     // Render context for RGV/OCV color space
@@ -223,6 +271,12 @@ class Tetrium
     void createDepthBuffer(SwapChainContext& ctx);
     void createSwapchainFrameBuffers(SwapChainContext& ctx, VkRenderPass rgbOrCnyPass);
 
+    /* ---------- Headless ---------- */
+    // populates `ctx` with device-local images standing in for swapchain images
+    void createOffscreenSwapChain(SwapChainContext& ctx, VkExtent2D extent);
+    void cleanupOffscreenSwapChain(SwapChainContext& ctx);
+    void runHeadless();
+
     /* ---------- FrameBuffers ---------- */
     void recreateVirtualFrameBuffers();
     void createVirtualFrameBuffer(
@@ -251,6 +305,9 @@ class Tetrium
     void bindDefaultInputs();
 
     /* ---------- Render-Time Functions ---------- */
+    // blocks until the GPU finishes the frame last submitted with `frameIdx`, so that
+    // per-frame resources can be re-used for recording.
+    void waitForFrameInFlight(uint8_t frameIdx);
     void drawFrame(ColorSpace colorSpace, uint8_t frameIdx);
     void drawMainMenu(ColorSpace colorSpace);
     void drawImGui(ColorSpace colorSpace, int currentFrameInFlight);
@@ -275,6 +332,18 @@ class Tetrium
         bool skip
     );
 
+    /* ---------- LUT ---------- */
+    void initLUTPass(const std::array<std::string, ColorSpace::ColorSpaceSize>& lutPaths);
+    void cleanupLUTPass();
+    void recreateLUTPassImages(); // re-sizes the frame copies to the swapchain
+    // applies the LUT of `colorSpace` to the swapchain image, after ImGui has been drawn
+    void recordLUTPass(
+        vk::CommandBuffer CB,
+        uint8_t frameIdx,
+        uint32_t swapChainImageIndex,
+        ColorSpace colorSpace
+    );
+
     /* ---------- Even-Odd frame ---------- */
     void initEvenOdd(); // initialize resources for even-odd rendering
     void cleanupEvenOdd();
@@ -302,6 +371,8 @@ class Tetrium
 
     /* ---------- Top-level data ---------- */
     VkInstance _instance;
+    // VK_KHR_get_physical_device_properties2, for the device's memory budget
+    bool _physicalDeviceProperties2Enabled = false;
     VkDebugUtilsMessengerEXT _debugMessenger;
     std::shared_ptr<VQDevice> _device;
 
@@ -309,7 +380,7 @@ class Tetrium
     ImGuiRenderContext _imguiCtx;
 
     /* ---------- Prensentation ---------- */
-    GLFWwindow* _window;
+    GLFWwindow* _window = nullptr; // stays null under `kHeadless`
     DisplayContext _mainProjectorDisplay;
 
     // ctx for rendering onto the RYGB FB.
@@ -370,6 +441,13 @@ class Tetrium
                                       // to evaluate current frame, used for the old counter method
     } _softwareEvenOddCtx;
 
+    // context for headless rendering
+    struct
+    {
+        HeadlessOptions options;
+        std::vector<VQAllocation> imageMemory; // backs `_swapChain.image`
+    } _headlessCtx;
+
     struct
     {
         uint32_t numDroppedFrames = 0;
@@ -378,13 +456,16 @@ class Tetrium
 
     /* ---------- Engine Components ---------- */
     DeletionStack _deletionStack;
+    DeferredDeletionQueue _frameDeletionQueue; // resources released while frames are in flight
     TextureManager _textureManager;
     DeltaTimer _deltaTimer;
     InputManager _inputManager;
     Profiler _profiler;
+    GpuProfiler _gpuProfiler;
+    TraceCapture _traceCapture;
     TaskQueue _taskQueue;
     SoundManager _soundManager;
-    std::unique_ptr<std::vector<Profiler::Entry>> _lastProfilerData = _profiler.NewProfile();
+    std::span<const Profiler::Entry> _lastProfilerData = {}; // entries of the last tick
 
     // ImGui widgets
     friend class ImGuiWidgetDeviceInfo;
@@ -82,7 +82,10 @@ void Tetrium::cursorPosCallback(GLFWwindow* window, double xpos, double ypos)
 void Tetrium::loadEngineTextures()
 {
     for (int i = 0; i < static_cast<int>(EngineTexture::kNumTextures); i++) {
-        uint32_t handle = _textureManager.LoadTexture(ENGINE_TEXTURE_PATHS[i]);
+        // the calibration gradient must keep its exact values, the cursor is decoration
+        TextureManager::LoadOptions options{
+            .lossyCompression = i == static_cast<int>(EngineTexture::kCursor)};
+        uint32_t handle = _textureManager.LoadTexture(ENGINE_TEXTURE_PATHS[i], options);
         _textureManager.LoadImGuiTexture(handle);
         ImGuiTexture imguiTexture = _textureManager.GetImGuiTexture(handle);
         _engineTextures[i] = {handle, imguiTexture};
@@ -126,11 +129,15 @@ void Tetrium::Init(const Tetrium::InitOptions& options)
 #if __APPLE__
     MoltenVKConfig::Setup();
 #endif // __APPLE__
-    _window = initGLFW(false);
-    glfwSetWindowUserPointer(_window, this);
-    SCHEDULE_DELETE(glfwDestroyWindow(_window); glfwTerminate();)
+    if (_tetraMode == TetraMode::kHeadless) {
+        _headlessCtx.options = options.headless;
+    } else {
+        _window = initGLFW(false);
+        glfwSetWindowUserPointer(_window, this);
+        SCHEDULE_DELETE(glfwDestroyWindow(_window); glfwTerminate();)
+    }
 
-    { // Input Handling
+    if (_window) { // Input Handling
         auto keyCallback = [](GLFWwindow* window, int key, int scancode, int action, int mods) {
             Tetrium* pThis = reinterpret_cast<Tetrium*>(glfwGetWindowUserPointer(window));
             pThis->keyCallback(window, key, scancode, action, mods);
@@ -147,8 +154,12 @@ void Tetrium::Init(const Tetrium::InitOptions& options)
     // frame buffer never resizes, so no need for callback
     // glfwSetFramebufferSizeCallback(_window, this->framebufferResizeCallback);
     this->initVulkan();
-    _textureManager.Init(_device);
+    _textureManager.Init(_device, &_frameDeletionQueue);
     this->_deletionStack.push([this]() { _textureManager.Cleanup(); });
+    // device is idle by the time the deletion stack is flushed
+    SCHEDULE_DELETE(_frameDeletionQueue.flushAll();)
+    _gpuProfiler.Init(_device);
+    SCHEDULE_DELETE(_gpuProfiler.Cleanup();)
 
     // create static engine ubo
     {
@@ -166,7 +177,8 @@ void Tetrium::Init(const Tetrium::InitOptions& options)
     }
 
     if (_tetraMode == TetraMode::kEvenOddHardwareSync
-        || _tetraMode == TetraMode::kEvenOddSoftwareSync) {
+        || _tetraMode == TetraMode::kEvenOddSoftwareSync
+        || _tetraMode == TetraMode::kHeadless) {
         initEvenOdd();
     } else {
         NEEDS_IMPLEMENTATION()
@@ -194,6 +206,9 @@ void Tetrium::Init(const Tetrium::InitOptions& options)
     initRYGB2ROCVTransform(&initCtx);
     SCHEDULE_DELETE(cleanupRYGB2ROCVTransform();)
 
+    initLUTPass(options.lutPaths);
+    SCHEDULE_DELETE(cleanupLUTPass();)
+
     initDefaultStates();
 
     _soundManager.LoadAllSounds();
@@ -233,6 +248,9 @@ void Tetrium::Init(const Tetrium::InitOptions& options)
                 this->_textureManager.LoadImGuiTexture(handle);
                 return this->_textureManager.GetImGuiTexture(handle);
             },
+            .DeferDeletion = [this](std::function<void()>&& deleter) {
+                this->_frameDeletionQueue.push(std::move(deleter));
+            },
         },
     };
 
@@ -240,6 +258,11 @@ void Tetrium::Init(const Tetrium::InitOptions& options)
     for (auto& [appName, app] : _appMap) {
         app->Init(appInitCtx);
     }
+
+    // headless mode has no UI to pick an app from
+    if (_tetraMode == TetraMode::kHeadless && !_headlessCtx.options.primaryApp.empty()) {
+        OpenApp(_headlessCtx.options.primaryApp);
+    }
 }
 
 void Tetrium::framebufferResizeCallback(GLFWwindow* window, int width, int height)
@@ -272,18 +295,32 @@ void Tetrium::initVulkan()
     case TetraMode::kEvenOddSoftwareSync:
         mainWindowSurface = createGlfwWindowSurface(_window);
         break;
+    case TetraMode::kHeadless:
+        break; // nothing is presented
     default:
         NEEDS_IMPLEMENTATION();
     };
 
-    ASSERT(mainWindowSurface);
+    ASSERT(mainWindowSurface || _tetraMode == TetraMode::kHeadless);
 
     this->_device->InitQueueFamilyIndices(mainWindowSurface);
-    this->_device->CreateLogicalDeviceAndQueue(getRequiredDeviceExtensions());
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;
+    if (_physicalDeviceProperties2Enabled) {
+        getMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(
+            vkGetInstanceProcAddr(_instance, "vkGetPhysicalDeviceMemoryProperties2KHR")
+        );
+    }
+    this->_device->CreateLogicalDeviceAndQueue(getRequiredDeviceExtensions(), getMemoryProperties2);
     this->_device->CreateGraphicsCommandPool();
     this->_device->CreateGraphicsCommandBuffer(NUM_FRAME_IN_FLIGHT);
 
-    createSwapChain(_swapChain, mainWindowSurface);
+    if (_tetraMode == TetraMode::kHeadless) {
+        createOffscreenSwapChain(
+            _swapChain, {_headlessCtx.options.width, _headlessCtx.options.height}
+        );
+    } else {
+        createSwapChain(_swapChain, mainWindowSurface);
+    }
     createImageViews(_swapChain);
     ASSERT(_swapChain.imageFormat);
     createDepthBuffer(_swapChain);
@@ -400,9 +437,11 @@ VkInstance Tetrium::createInstance()
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
 
-    std::vector<const char*> instanceExtensions = DEFAULT_INSTANCE_EXTENSIONS;
+    std::vector<const char*> instanceExtensions = _tetraMode == TetraMode::kHeadless
+                                                      ? HEADLESS_INSTANCE_EXTENSIONS
+                                                      : DEFAULT_INSTANCE_EXTENSIONS;
     // get glfw Extensions
-    {
+    if (_tetraMode != TetraMode::kHeadless) {
         uint32_t glfwExtensionCount = 0;
         const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
         for (int i = 0; i < glfwExtensionCount; i++) {
@@ -432,6 +471,27 @@ VkInstance Tetrium::createInstance()
         break;
     }
 
+    // optional, lets the device report its memory budget, see `VQDevice::GetHeapBudgets()`
+    {
+        auto isProperties2 = [](const char* extension) {
+            return strcmp(extension, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0;
+        };
+        _physicalDeviceProperties2Enabled
+            = std::any_of(instanceExtensions.begin(), instanceExtensions.end(), isProperties2);
+        uint32_t numAvailable = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &numAvailable, nullptr);
+        std::vector<VkExtensionProperties> available(numAvailable);
+        vkEnumerateInstanceExtensionProperties(nullptr, &numAvailable, available.data());
+        for (const VkExtensionProperties& extension : available) {
+            if (!_physicalDeviceProperties2Enabled && isProperties2(extension.extensionName)) {
+                instanceExtensions.push_back(
+                    VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME
+                );
+                _physicalDeviceProperties2Enabled = true;
+            }
+        }
+    }
+
     INFO("Instance extensions:");
     for (const char* ext : instanceExtensions) {
         INFO("{}", ext);
@@ -572,6 +632,11 @@ bool Tetrium::isDeviceSuitable(VkPhysicalDevice device)
         deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU
         && deviceFeatures.geometryShader && deviceFeatures.multiDrawIndirect;
 #endif // __APPLE__
+    if (_tetraMode == TetraMode::kHeadless) {
+        // any device goes, including CPU implementations on machines without a GPU.
+        // multi-draw is unconditionally enabled on the logical device.
+        platformRequirements = deviceFeatures.multiDrawIndirect;
+    }
 
     // check queue families
     if (platformRequirements) {
@@ -589,6 +654,9 @@ bool Tetrium::isDeviceSuitable(VkPhysicalDevice device)
 const std::vector<const char*> Tetrium::getRequiredDeviceExtensions() const
 {
     std::vector<const char*> extensions = DEFAULT_DEVICE_EXTENSIONS;
+    if (_tetraMode != TetraMode::kHeadless) {
+        extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
     if (_tetraMode == TetraMode::kEvenOddHardwareSync) {
         for (auto extension : EVEN_ODD_HARDWARE_DEVICE_EXTENSIONS) {
             extensions.push_back(extension);
@@ -653,6 +721,10 @@ void Tetrium::createSwapChain(Tetrium::SwapChainContext& ctx, const VkSurfaceKHR
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    // the LUT pass copies the final frame out of the swapchain image
+    if (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) {
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
 
     auto indices = _device->queueFamilyIndices;
     uint32_t queueFamilyIndices[]
@@ -711,7 +783,7 @@ void Tetrium::cleanupSwapChain(SwapChainContext& ctx)
     DEBUG("Cleaning up swap chain...");
     vkDestroyImageView(_device->logicalDevice, ctx.depthImageView, nullptr);
     vkDestroyImage(_device->logicalDevice, ctx.depthImage, nullptr);
-    vkFreeMemory(_device->logicalDevice, ctx.depthImageMemory, nullptr);
+    _device->memoryAllocator.Free(ctx.depthImageMemory);
 
     for (VkFramebuffer framebuffer : ctx.frameBuffer) {
         vkDestroyFramebuffer(this->_device->logicalDevice, framebuffer, nullptr);
@@ -719,7 +791,11 @@ void Tetrium::cleanupSwapChain(SwapChainContext& ctx)
     for (VkImageView imageView : ctx.imageView) {
         vkDestroyImageView(this->_device->logicalDevice, imageView, nullptr);
     }
-    vkDestroySwapchainKHR(this->_device->logicalDevice, ctx.chain, nullptr);
+    if (_tetraMode == TetraMode::kHeadless) {
+        cleanupOffscreenSwapChain(ctx);
+    } else {
+        vkDestroySwapchainKHR(this->_device->logicalDevice, ctx.chain, nullptr);
+    }
 }
 
 void Tetrium::recreateVirtualFrameBuffers()
@@ -728,6 +804,7 @@ void Tetrium::recreateVirtualFrameBuffers()
 
     // imgui's fb are associated with render contexts, so initialize them here
     reinitImGuiFrameBuffers(_imguiCtx);
+    recreateLUTPassImages();
 }
 
 void Tetrium::recreateSwapChain(SwapChainContext& ctx)
@@ -898,6 +975,8 @@ void Tetrium::createSynchronizationObjects(
 void Tetrium::Cleanup()
 {
     INFO("Cleaning up...");
+    // frames may still be in flight
+    VK_CHECK_RESULT(vkDeviceWaitIdle(_device->logicalDevice));
     TetriumApp::CleanupContext appCleanupCtx{
         .device = *_device.get(),
         .api = {
@@ -913,25 +992,6 @@ void Tetrium::Cleanup()
     INFO("Resource cleaned up.");
 }
 
-uint32_t findMemoryType(
-    VkPhysicalDevice physicalDevice,
-    uint32_t typeFilter,
-    VkMemoryPropertyFlags properties
-)
-{
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i))
-            && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-
-    throw std::runtime_error("failed to find suitable memory type!");
-}
-
 void Tetrium::createVirtualFrameBuffer(
     VkRenderPass renderPass,
     const SwapChainContext& swapChain,
@@ -969,26 +1029,11 @@ void Tetrium::createVirtualFrameBuffer(
             FATAL("Failed to create custom image!");
         }
 
-        // Allocate memory for the image
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(_device->logicalDevice, vfb.image[i], &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(
-            _device->physicalDevice,
-            memRequirements.memoryTypeBits,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        // Allocate memory for the image; recreated along with the swapchain
+        vfb.imageMemory[i] = _device->memoryAllocator.AllocateImageMemory(
+            vfb.image[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VQMemoryAllocator::Strategy::kLinear
         );
 
-        if (vkAllocateMemory(_device->logicalDevice, &allocInfo, nullptr, &vfb.imageMemory[i])
-            != VK_SUCCESS) {
-            FATAL("Failed to allocate image memory!");
-        }
-
-        vkBindImageMemory(_device->logicalDevice, vfb.image[i], vfb.imageMemory[i], 0);
-
         // Create image view
         VkImageViewCreateInfo viewInfo{};
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -1038,7 +1083,7 @@ void Tetrium::clearVirtualFrameBuffer(VirtualFrameBuffer& vfb)
         vkDestroyFramebuffer(_device->logicalDevice, vfb.frameBuffer[i], NULL);
         vkDestroyImageView(_device->logicalDevice, vfb.imageView[i], NULL);
         vkDestroyImage(_device->logicalDevice, vfb.image[i], NULL);
-        vkFreeMemory(_device->logicalDevice, vfb.imageMemory[i], NULL);
+        _device->memoryAllocator.Free(vfb.imageMemory[i]);
     }
 }
 
@@ -1085,8 +1130,8 @@ void Tetrium::createDepthBuffer(SwapChainContext& ctx)
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         ctx.depthImage,
         ctx.depthImageMemory,
-        _device->physicalDevice,
-        _device->logicalDevice
+        *_device,
+        VQMemoryAllocator::Strategy::kLinear
     );
     ctx.depthImageView = VulkanUtils::createImageView(
         ctx.depthImage, _device->logicalDevice, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT
@@ -1235,3 +1280,27 @@ void Tetrium::RegisterApp(TetriumApp::App* app, const std::string& name)
     }
     _appMap[name] = app;
 }
+
+void Tetrium::OpenApp(const std::string& appName)
+{
+    auto it = _appMap.find(appName);
+    if (it == _appMap.end()) {
+        FATAL("App {} is not registered", appName);
+    }
+    TetriumApp::App* app = it->second;
+    if (_primaryApp.has_value() && _primaryApp.value() != app) {
+        _primaryApp.value()->OnClose();
+    }
+    _primaryApp = app;
+    app->OnOpen();
+}
+
+void Tetrium::CloseApp()
+{
+    if (!_primaryApp.has_value()) {
+        return;
+    }
+    _primaryApp.value()->OnClose();
+    _primaryApp = std::nullopt;
+    _soundManager.DisableMusic();
+}
@@ -23,8 +23,19 @@ const std::vector<const char*> Tetrium::DEFAULT_INSTANCE_EXTENSIONS = {
 #endif // __APPLE__
 };
 
+// headless mode creates no surface, so no WSI extensions are needed
+const std::vector<const char*> Tetrium::HEADLESS_INSTANCE_EXTENSIONS = {
+#ifndef NDEBUG
+    VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif // NDEBUG
+#if __APPLE__ // molten vk support
+    VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME,
+#endif // __APPLE__
+};
+
+// swapchain extension is added on top for all modes but `kHeadless`,
+// see `Tetrium::getRequiredDeviceExtensions()`
 const std::vector<const char*> Tetrium::DEFAULT_DEVICE_EXTENSIONS = {
-    VK_KHR_SWAPCHAIN_EXTENSION_NAME,
     VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME,
 #if __APPLE__ // molten vk support
     VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME,
@@ -141,6 +141,9 @@ uint64_t Tetrium::getSurfaceCounterValue()
         surfaceCounter = timeSinceStartNanoSeconds / _softwareEvenOddCtx.nanoSecondsPerFrame;
 #endif // ! FAKE_SOFTWARE_FRAME_COUNTER
     } break;
+    case TetraMode::kHeadless: // frames are never presented, every tick is a new "vblank"
+        surfaceCounter = _numTicks;
+        break;
     case TetraMode::kEvenOddHardwareSync:
 #if defined(WIN32)
         NEEDS_IMPLEMENTATION();
@@ -58,10 +58,33 @@ void Tetrium::drawAppsImGui(ColorSpace colorSpace, int currentFrameInFlight)
             .apis = {
                 .PlaySound = [this](Sound sound) { _soundManager.PlaySound(sound); },
                 .LoadTexture = [this](const std::string& path) { return _textureManager.LoadTexture(path); },
+                .LoadTextureAsync = [this](const std::string& path) { return _textureManager.LoadTextureAsync(path); },
+                .LoadEvictableTextureAsync = [this](const std::string& path, ColorSpace plane) {
+                    return _textureManager.LoadTextureAsync(
+                        path,
+                        {.plane = plane, .priority = TextureManager::ResidencyPriority::kNormal}
+                    );
+                },
+                .LoadThumbnailAsync =
+                    [this](const std::string& path, uint32_t maxExtent, ColorSpace plane) {
+                        return _textureManager.LoadTextureAsync(
+                            path,
+                            {.generateMipmaps = false,
+                             .maxExtent = maxExtent,
+                             .plane = plane,
+                             .priority = TextureManager::ResidencyPriority::kLow}
+                        );
+                    },
+                .IsTextureReady = [this](uint32_t textureHandle) { return _textureManager.IsTextureReady(textureHandle); },
+                .IsTextureFailed = [this](uint32_t textureHandle) {
+                    return _textureManager.GetTextureStatus(textureHandle)
+                           == TextureManager::TextureStatus::kFailed;
+                },
                 .InitImGuiTexture = [this](uint32_t textureHandle) {
                     _textureManager.LoadImGuiTexture(textureHandle);
                     return _textureManager.GetImGuiTexture(textureHandle);
                 },
+                .GetImGuiTexture = [this](uint32_t textureHandle) { return _textureManager.GetImGuiTexture(textureHandle); },
                 .UnloadTexture = [this](uint32_t textureHandle) { _textureManager.UnLoadTexture(textureHandle); }
             },
             .controls = {.wantExit = false, .musicOverride = std::nullopt}
@@ -70,9 +93,7 @@ void Tetrium::drawAppsImGui(ColorSpace colorSpace, int currentFrameInFlight)
         app->TickImGui(ctxImGui);
 
         if (ctxImGui.controls.wantExit) {
-            _primaryApp.value()->OnClose();
-            _primaryApp = std::nullopt;
-            _soundManager.DisableMusic();
+            CloseApp();
         } else {
             if (ctxImGui.controls.musicOverride.has_value()) {
                 _soundManager.SetMusic(ctxImGui.controls.musicOverride.value());
@@ -100,11 +121,7 @@ void Tetrium::drawMainMenu(ColorSpace colorSpace)
                 // show all apps
                 for (auto& [appName, app] : _appMap) {
                     if (ImGui::Button(appName.c_str())) {
-                        if (_primaryApp.has_value() && _primaryApp.value() != app) {
-                            _primaryApp.value()->OnClose();
-                        }
-                        _primaryApp = app;
-                        app->OnOpen();
+                        OpenApp(appName);
                     }
                 }
                 ImGui::EndTabItem();
@@ -144,7 +161,17 @@ void Tetrium::drawImGui(ColorSpace colorSpace, int currentFrameInFlight)
     PROFILE_SCOPE(&_profiler, "ImGui Draw");
 
     ImGui_ImplVulkan_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
+    if (_tetraMode == TetraMode::kHeadless) {
+        // no platform backend to feed display size and time
+        ImGuiIO& io = ImGui::GetIO();
+        io.DisplaySize = ImVec2(
+            static_cast<float>(_swapChain.extent.width),
+            static_cast<float>(_swapChain.extent.height)
+        );
+        io.DeltaTime = std::max(static_cast<float>(_deltaTimer.GetDeltaTime()), 1e-6f);
+    } else {
+        ImGui_ImplGlfw_NewFrame();
+    }
     ImGui::NewFrame();
 
     // imgui is associated with the glfw window to handle inputs,
@@ -0,0 +1,65 @@
+// Headless mode implementations, where even-odd frames are rendered off-screen
+#include "lib/VulkanUtils.h"
+
+#include "Tetrium.h"
+
+namespace Tetrium_Headless
+{
+// same format `chooseSwapSurfaceFormat()` prefers, so apps see identical swapchain info
+const VkFormat OFFSCREEN_IMAGE_FORMAT = VK_FORMAT_B8G8R8A8_SRGB;
+} // namespace Tetrium_Headless
+
+void Tetrium::createOffscreenSwapChain(SwapChainContext& ctx, VkExtent2D extent)
+{
+    DEBUG("creating off-screen swapchain...");
+    ASSERT(_device);
+    // each frame in flight renders into its own image; since even-odd alternates every tick,
+    // each image ends up holding either the RGB or the OCV frame.
+    const uint32_t imageCount = NUM_FRAME_IN_FLIGHT;
+
+    ctx.chain = VK_NULL_HANDLE;
+    ctx.surface = VK_NULL_HANDLE;
+    ctx.extent = extent;
+    ctx.imageFormat = Tetrium_Headless::OFFSCREEN_IMAGE_FORMAT;
+    ctx.numImages = imageCount;
+    ctx.image.resize(imageCount);
+    ctx.imageView.resize(imageCount);
+    ctx.frameBuffer.resize(imageCount);
+    _headlessCtx.imageMemory.resize(imageCount);
+
+    for (uint32_t i = 0; i < imageCount; i++) {
+        VulkanUtils::createImage(
+            extent.width,
+            extent.height,
+            ctx.imageFormat,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+                | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            ctx.image[i],
+            _headlessCtx.imageMemory[i],
+            *_device,
+            VQMemoryAllocator::Strategy::kLinear
+        );
+    }
+    DEBUG("Off-screen swapchain created!");
+}
+
+void Tetrium::cleanupOffscreenSwapChain(SwapChainContext& ctx)
+{
+    for (size_t i = 0; i < ctx.image.size(); i++) {
+        vkDestroyImage(_device->logicalDevice, ctx.image[i], nullptr);
+        _device->memoryAllocator.Free(_headlessCtx.imageMemory[i]);
+    }
+    _headlessCtx.imageMemory.clear();
+}
+
+void Tetrium::runHeadless()
+{
+    const uint32_t numTicks = _headlessCtx.options.numTicks;
+    INFO("Starting headless run loop for {} ticks...", numTicks);
+    for (uint32_t i = 0; i < numTicks; i++) {
+        Tick();
+    }
+    INFO("Ending headless run loop.");
+}
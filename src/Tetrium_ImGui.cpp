@@ -300,7 +300,9 @@ void Tetrium::destroyImGuiContext(Tetrium::ImGuiRenderContext& ctx)
     // not a big problem for now since we only shut down at very end, but
     // it leads to ugly validation errors
     ImGui_ImplVulkan_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
+    if (_window) {
+        ImGui_ImplGlfw_Shutdown();
+    }
     ImPlot::DestroyContext();
     ImGui::DestroyContext();
 
@@ -320,6 +322,9 @@ void Tetrium::initImGuiRenderContext(Tetrium::ImGuiRenderContext& ctx)
     // imguiFinalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; // for RYGB conversion pass, if
     // run imgui pass before
     imguiFinalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // if painting to physical fb
+    if (_tetraMode == TetraMode::kHeadless) {
+        imguiFinalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL; // off-screen images for read-back
+    }
 
     ctx.renderPass = createRenderPass(
         _device->Get(),
@@ -364,8 +369,10 @@ void Tetrium::initImGuiRenderContext(Tetrium::ImGuiRenderContext& ctx)
     ImGui::SetCurrentContext(ctx.backendImGuiContext);
     ImPlot::SetCurrentContext(ctx.backendImPlotContext);
 
-    bool installCallbacks = true;
-    ImGui_ImplGlfw_InitForVulkan(_window, installCallbacks);
+    if (_window) { // no platform backend under headless mode
+        bool installCallbacks = true;
+        ImGui_ImplGlfw_InitForVulkan(_window, installCallbacks);
+    }
     ImGui_ImplVulkan_Init(&initInfo);
 
     ImGuiIO& io = ImGui::GetIO();
@@ -0,0 +1,789 @@
+// Handles the LUT post-process pass
+//
+// Once ImGui has drawn the final frame onto the swapchain image, the image is copied into a
+// per-frame image, which a full-screen pass samples and writes back through the LUT of the
+// current color space. The LUT therefore applies to everything on screen, instead of to each
+// texture on load.
+
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+
+#include "glm/gtc/packing.hpp"
+
+#include "Tetrium.h"
+#include "components/ShaderUtils.h"
+#include "lib/VulkanUtils.h"
+
+// internal context of the LUT pass
+namespace Tetrium_LUT
+{
+const char* VERTEX_SHADER_PATH = "../shaders/rygb_to_rocv.vert.spv"; // full-screen triangle
+const char* FRAGMENT_SHADER_PATH_1D = "../shaders/lut_1d.frag.spv";
+const char* FRAGMENT_SHADER_PATH_3D = "../shaders/lut_3d.frag.spv";
+
+const VkFormat LUT_IMAGE_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT; // filterable on all devices
+const uint32_t MAX_LUT_1D_SIZE = 4096; // guaranteed `maxImageDimension2D`
+const uint32_t MAX_LUT_3D_SIZE = 256;  // guaranteed `maxImageDimension3D`
+// per color space, the LUT in use and one replaced during each frame in flight
+const uint32_t MAX_LUTS = ColorSpace::ColorSpaceSize * (NUM_FRAME_IN_FLIGHT + 1);
+
+enum class BindingLocation : unsigned int
+{
+    FRAME_IMAGE = 0,
+    LUT = 1
+};
+
+// matches `PushConstants` in lut.glsl
+struct PushConstants
+{
+    glm::vec4 domainMin;
+    glm::vec4 domainMax;
+    float size;
+    int srgbFrame;
+};
+
+// contents of a .cube file
+struct CubeFile
+{
+    std::string title;
+    bool is3D = false;
+    uint32_t size = 0;
+    glm::vec3 domainMin = glm::vec3(0.f);
+    glm::vec3 domainMax = glm::vec3(1.f);
+    std::vector<glm::vec3> table; // red changes fastest for 3D LUTs
+};
+
+// a loaded LUT and the pipeline applying it
+struct LUT
+{
+    PushConstants pushConstants;
+    VkImage image = VK_NULL_HANDLE;
+    VQAllocation imageMemory;
+    VkImageView imageView = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    std::array<VkDescriptorSet, NUM_FRAME_IN_FLIGHT> descriptorSets; // one per frame copy
+};
+
+struct Context
+{
+    bool enabled = false;
+    VQDevice* device = nullptr;
+    VkFormat frameFormat;
+    VkExtent2D extent;
+    VkImageLayout presentLayout; // layout the ImGui pass leaves swapchain images in
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkSampler frameSampler = VK_NULL_HANDLE;
+    VkSampler lutSampler = VK_NULL_HANDLE;
+    // copies of the final frame, one per frame in flight
+    std::array<VkImage, NUM_FRAME_IN_FLIGHT> frameImage;
+    std::array<VQAllocation, NUM_FRAME_IN_FLIGHT> frameImageMemory;
+    std::array<VkImageView, NUM_FRAME_IN_FLIGHT> frameImageView;
+    std::array<std::optional<LUT>, ColorSpace::ColorSpaceSize> luts;
+} _ctx;
+
+bool isSrgbFormat(VkFormat format)
+{
+    return format == VK_FORMAT_B8G8R8A8_SRGB || format == VK_FORMAT_R8G8B8A8_SRGB
+           || format == VK_FORMAT_A8B8G8R8_SRGB_PACK32;
+}
+
+// parses an Adobe/Resolve .cube file
+bool parseCubeFile(const std::string& path, CubeFile& cube)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        ERROR("Failed to open LUT {}", path);
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream stream(line);
+        std::string keyword;
+        if (!(stream >> keyword) || keyword[0] == '#') {
+            continue;
+        }
+
+        bool valid = true;
+        if (keyword == "TITLE") {
+            std::getline(stream >> std::ws, cube.title);
+        } else if (keyword == "LUT_1D_SIZE" || keyword == "LUT_3D_SIZE") {
+            cube.is3D = keyword == "LUT_3D_SIZE";
+            uint32_t maxSize = cube.is3D ? MAX_LUT_3D_SIZE : MAX_LUT_1D_SIZE;
+            valid = (stream >> cube.size) && cube.size >= 2 && cube.size <= maxSize;
+        } else if (keyword == "DOMAIN_MIN") {
+            valid = bool(stream >> cube.domainMin.r >> cube.domainMin.g >> cube.domainMin.b);
+        } else if (keyword == "DOMAIN_MAX") {
+            valid = bool(stream >> cube.domainMax.r >> cube.domainMax.g >> cube.domainMax.b);
+        } else if (keyword == "LUT_1D_INPUT_RANGE" || keyword == "LUT_3D_INPUT_RANGE") {
+            float min, max;
+            valid = bool(stream >> min >> max);
+            cube.domainMin = glm::vec3(min);
+            cube.domainMax = glm::vec3(max);
+        } else { // table entry
+            glm::vec3 entry;
+            stream.str(line);
+            stream.clear();
+            valid = bool(stream >> entry.r >> entry.g >> entry.b);
+            cube.table.push_back(entry);
+        }
+
+        if (!valid) {
+            ERROR("Malformed LUT {} at line {}: {}", path, lineNumber, line);
+            return false;
+        }
+    }
+
+    if (cube.size == 0) {
+        ERROR("LUT {} is missing LUT_1D_SIZE or LUT_3D_SIZE", path);
+        return false;
+    }
+    size_t expectedEntries = cube.is3D ? cube.size * cube.size * cube.size : cube.size;
+    if (cube.table.size() != expectedEntries) {
+        ERROR("LUT {} has {} entries, expected {}", path, cube.table.size(), expectedEntries);
+        return false;
+    }
+    if (glm::any(glm::greaterThanEqual(cube.domainMin, cube.domainMax))) {
+        ERROR("LUT {} has an empty domain", path);
+        return false;
+    }
+
+    return true;
+}
+
+void createSamplers()
+{
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.maxLod = 0.f;
+
+    // frame is read with texelFetch
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    VK_CHECK_RESULT(
+        vkCreateSampler(_ctx.device->logicalDevice, &samplerInfo, nullptr, &_ctx.frameSampler)
+    );
+
+    // hardware interpolates between LUT entries
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    VK_CHECK_RESULT(
+        vkCreateSampler(_ctx.device->logicalDevice, &samplerInfo, nullptr, &_ctx.lutSampler)
+    );
+}
+
+void createDescriptors()
+{
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = (int)BindingLocation::FRAME_IMAGE;
+    bindings[1].binding = (int)BindingLocation::LUT;
+    for (VkDescriptorSetLayoutBinding& binding : bindings) {
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        binding.descriptorCount = 1;
+        binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = bindings.size();
+    layoutInfo.pBindings = bindings.data();
+    VK_CHECK_RESULT(vkCreateDescriptorSetLayout(
+        _ctx.device->logicalDevice, &layoutInfo, nullptr, &_ctx.descriptorSetLayout
+    ));
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = MAX_LUTS * NUM_FRAME_IN_FLIGHT * bindings.size();
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = MAX_LUTS * NUM_FRAME_IN_FLIGHT;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT; // LUTs can be reloaded
+    VK_CHECK_RESULT(
+        vkCreateDescriptorPool(_ctx.device->logicalDevice, &poolInfo, nullptr, &_ctx.descriptorPool)
+    );
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &_ctx.descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    VK_CHECK_RESULT(vkCreatePipelineLayout(
+        _ctx.device->logicalDevice, &pipelineLayoutInfo, nullptr, &_ctx.pipelineLayout
+    ));
+}
+
+void cleanupDescriptors()
+{
+    VkDevice device = _ctx.device->logicalDevice;
+    vkDestroyPipelineLayout(device, _ctx.pipelineLayout, nullptr);
+    vkDestroyDescriptorPool(device, _ctx.descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(device, _ctx.descriptorSetLayout, nullptr);
+}
+
+VkPipeline createPipeline(const char* fragmentShaderPath)
+{
+    VkDevice device = _ctx.device->logicalDevice;
+    VkShaderModule vertShaderModule
+        = ShaderCreation::createShaderModule(device, VERTEX_SHADER_PATH);
+    VkShaderModule fragShaderModule
+        = ShaderCreation::createShaderModule(device, fragmentShaderPath);
+
+    std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].pName = "main";
+
+    // the full-screen triangle is generated from gl_VertexIndex
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    std::array<VkDynamicState, 2> dynamicStates
+        = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{};
+    dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicStateCreateInfo.dynamicStateCount = dynamicStates.size();
+    dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    // every pixel is overwritten with its mapped color
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+                                          | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = shaderStages.size();
+    pipelineInfo.pStages = shaderStages.data();
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicStateCreateInfo;
+    pipelineInfo.layout = _ctx.pipelineLayout;
+    pipelineInfo.renderPass = _ctx.renderPass;
+    pipelineInfo.subpass = 0;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VK_CHECK_RESULT(
+        vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline)
+    );
+
+    vkDestroyShaderModule(device, fragShaderModule, nullptr);
+    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    return pipeline;
+}
+
+void createFrameImages()
+{
+    for (int i = 0; i < NUM_FRAME_IN_FLIGHT; i++) {
+        VulkanUtils::createImage(
+            _ctx.extent.width,
+            _ctx.extent.height,
+            _ctx.frameFormat,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            _ctx.frameImage[i],
+            _ctx.frameImageMemory[i],
+            *_ctx.device,
+            VQMemoryAllocator::Strategy::kLinear
+        );
+        _ctx.frameImageView[i] = VulkanUtils::createImageView(
+            _ctx.frameImage[i], _ctx.device->logicalDevice, _ctx.frameFormat
+        );
+    }
+}
+
+void cleanupFrameImages()
+{
+    VkDevice device = _ctx.device->logicalDevice;
+    for (int i = 0; i < NUM_FRAME_IN_FLIGHT; i++) {
+        vkDestroyImageView(device, _ctx.frameImageView[i], nullptr);
+        vkDestroyImage(device, _ctx.frameImage[i], nullptr);
+        _ctx.device->memoryAllocator.Free(_ctx.frameImageMemory[i]);
+    }
+}
+
+// points `lut`'s descriptor sets to the current frame copies
+void writeDescriptorSets(const LUT& lut)
+{
+    for (int i = 0; i < NUM_FRAME_IN_FLIGHT; i++) {
+        VkDescriptorImageInfo frameImageInfo{
+            .sampler = _ctx.frameSampler,
+            .imageView = _ctx.frameImageView[i],
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        };
+        VkDescriptorImageInfo lutImageInfo{
+            .sampler = _ctx.lutSampler,
+            .imageView = lut.imageView,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        };
+
+        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+        for (VkWriteDescriptorSet& write : descriptorWrites) {
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = lut.descriptorSets[i];
+            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write.descriptorCount = 1;
+        }
+        descriptorWrites[0].dstBinding = (int)BindingLocation::FRAME_IMAGE;
+        descriptorWrites[0].pImageInfo = &frameImageInfo;
+        descriptorWrites[1].dstBinding = (int)BindingLocation::LUT;
+        descriptorWrites[1].pImageInfo = &lutImageInfo;
+
+        vkUpdateDescriptorSets(
+            _ctx.device->logicalDevice, descriptorWrites.size(), descriptorWrites.data(), 0, nullptr
+        );
+    }
+}
+
+// uploads the table of `cube` into `lut`'s image; 1D LUTs are `size` x 1 2D images, and 3D
+// LUTs are indexed by (r, g, b).
+void uploadLUTImage(const CubeFile& cube, LUT& lut)
+{
+    VQDevice* device = _ctx.device;
+    VkExtent3D extent = cube.is3D ? VkExtent3D{cube.size, cube.size, cube.size}
+                                  : VkExtent3D{cube.size, 1, 1};
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = cube.is3D ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D;
+    imageInfo.extent = extent;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = LUT_IMAGE_FORMAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageInfo, nullptr, &lut.image));
+
+    lut.imageMemory = device->memoryAllocator.AllocateImageMemory(
+        lut.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    );
+
+    std::vector<uint16_t> texels(cube.table.size() * 4);
+    for (size_t i = 0; i < cube.table.size(); i++) {
+        for (int c = 0; c < 3; c++) {
+            texels[i * 4 + c] = glm::packHalf1x16(cube.table[i][c]);
+        }
+        texels[i * 4 + 3] = glm::packHalf1x16(1.f); // unused
+    }
+    VkDeviceSize size = texels.size() * sizeof(uint16_t);
+    VQBuffer stagingBuffer = device->CreateBuffer(
+        size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    );
+    memcpy(stagingBuffer.bufferAddress, texels.data(), size);
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = lut.image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    vk::CommandBuffer CB = device->BeginSingleTimeCommands();
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_NONE;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        CB,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier
+    );
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = extent;
+    vkCmdCopyBufferToImage(
+        CB, stagingBuffer.buffer, lut.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region
+    );
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        CB,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier
+    );
+    device->EndSingleTimeCommands(CB);
+    stagingBuffer.Cleanup();
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = lut.image;
+    viewInfo.viewType = cube.is3D ? VK_IMAGE_VIEW_TYPE_3D : VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = LUT_IMAGE_FORMAT;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewInfo, nullptr, &lut.imageView));
+}
+
+LUT createLUT(const CubeFile& cube)
+{
+    LUT lut{};
+    lut.pushConstants = PushConstants{
+        .domainMin = glm::vec4(cube.domainMin, 0.f),
+        .domainMax = glm::vec4(cube.domainMax, 1.f),
+        .size = static_cast<float>(cube.size),
+        .srgbFrame = isSrgbFormat(_ctx.frameFormat) ? 1 : 0
+    };
+    uploadLUTImage(cube, lut);
+    lut.pipeline = createPipeline(cube.is3D ? FRAGMENT_SHADER_PATH_3D : FRAGMENT_SHADER_PATH_1D);
+
+    std::array<VkDescriptorSetLayout, NUM_FRAME_IN_FLIGHT> layouts;
+    layouts.fill(_ctx.descriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = _ctx.descriptorPool;
+    allocInfo.descriptorSetCount = layouts.size();
+    allocInfo.pSetLayouts = layouts.data();
+    VK_CHECK_RESULT(
+        vkAllocateDescriptorSets(_ctx.device->logicalDevice, &allocInfo, lut.descriptorSets.data())
+    );
+    writeDescriptorSets(lut);
+
+    return lut;
+}
+
+void destroyLUT(const LUT& lut)
+{
+    VkDevice device = _ctx.device->logicalDevice;
+    vkFreeDescriptorSets(
+        device, _ctx.descriptorPool, lut.descriptorSets.size(), lut.descriptorSets.data()
+    );
+    vkDestroyPipeline(device, lut.pipeline, nullptr);
+    vkDestroyImageView(device, lut.imageView, nullptr);
+    vkDestroyImage(device, lut.image, nullptr);
+    _ctx.device->memoryAllocator.Free(lut.imageMemory);
+}
+
+// copies the swapchain image into the frame copy of `frameIdx`, leaving the former ready for
+// the LUT render pass and the latter ready to be sampled.
+void recordFrameCopy(vk::CommandBuffer CB, uint8_t frameIdx, VkImage swapChainImage)
+{
+    std::array<VkImageMemoryBarrier, 2> barriers{};
+    for (VkImageMemoryBarrier& barrier : barriers) {
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    }
+    VkImageMemoryBarrier& swapChainBarrier = barriers[0];
+    swapChainBarrier.image = swapChainImage;
+    swapChainBarrier.oldLayout = _ctx.presentLayout;
+    swapChainBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    swapChainBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    swapChainBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    // previous contents were read by the submission `frameIdx` last waited on
+    VkImageMemoryBarrier& frameImageBarrier = barriers[1];
+    frameImageBarrier.image = _ctx.frameImage[frameIdx];
+    frameImageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    frameImageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    frameImageBarrier.srcAccessMask = VK_ACCESS_NONE;
+    frameImageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(
+        CB,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        barriers.size(),
+        barriers.data()
+    );
+
+    VkImageCopy region{};
+    region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.extent = {_ctx.extent.width, _ctx.extent.height, 1};
+    vkCmdCopyImage(
+        CB,
+        swapChainImage,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        _ctx.frameImage[frameIdx],
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1,
+        &region
+    );
+
+    frameImageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    frameImageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    frameImageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    frameImageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        CB,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &frameImageBarrier
+    );
+}
+
+} // namespace Tetrium_LUT
+
+void Tetrium::initLUTPass(const std::array<std::string, ColorSpace::ColorSpaceSize>& lutPaths)
+{
+    Tetrium_LUT::Context& ctx = Tetrium_LUT::_ctx;
+    INFO("Initializing LUT pass...");
+
+    for (const char* shader :
+         {Tetrium_LUT::VERTEX_SHADER_PATH,
+          Tetrium_LUT::FRAGMENT_SHADER_PATH_1D,
+          Tetrium_LUT::FRAGMENT_SHADER_PATH_3D}) {
+        if (!std::filesystem::exists(shader)) {
+            WARN("{} not found, run compile_shaders.py to build it", shader);
+            WARN("LUT pass disabled");
+            return;
+        }
+    }
+    // the swapchain image is the source of the frame copy
+    if (_tetraMode != TetraMode::kHeadless
+        && !(_device->GetSwapChainSupportForSurface(_swapChain.surface)
+                 .capabilities.supportedUsageFlags
+             & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+        WARN("Swapchain images cannot be copied from, LUT pass disabled");
+        return;
+    }
+
+    ctx.device = _device.get();
+    ctx.frameFormat = _swapChain.imageFormat;
+    ctx.extent = _swapChain.extent;
+    ctx.presentLayout = _tetraMode == TetraMode::kHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                                           : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // every pixel gets overwritten, so the copied-from contents need not be loaded
+    ctx.renderPass = createRenderPass(
+        _device->Get(),
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        ctx.presentLayout,
+        ctx.frameFormat,
+        VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        VK_ATTACHMENT_STORE_OP_STORE,
+        false,
+        VkSubpassDependency{
+            .srcSubpass = VK_SUBPASS_EXTERNAL,
+            .dstSubpass = 0,
+            .srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT, // wait for the frame copy
+            .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .srcAccessMask = VK_ACCESS_NONE,
+            .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+        }
+    );
+    Tetrium_LUT::createSamplers();
+    Tetrium_LUT::createDescriptors();
+    Tetrium_LUT::createFrameImages();
+    ctx.enabled = true;
+
+    for (int colorSpace = 0; colorSpace < ColorSpace::ColorSpaceSize; colorSpace++) {
+        if (!lutPaths[colorSpace].empty()) {
+            LoadLUT(static_cast<ColorSpace>(colorSpace), lutPaths[colorSpace]);
+        }
+    }
+}
+
+void Tetrium::cleanupLUTPass()
+{
+    Tetrium_LUT::Context& ctx = Tetrium_LUT::_ctx;
+    if (!ctx.enabled) {
+        return;
+    }
+    INFO("Cleanup LUT pass");
+    // replaced LUTs are still pending deletion; the device is idle by now
+    _frameDeletionQueue.flushAll();
+    for (std::optional<Tetrium_LUT::LUT>& lut : ctx.luts) {
+        if (lut) {
+            Tetrium_LUT::destroyLUT(*lut);
+            lut.reset();
+        }
+    }
+    Tetrium_LUT::cleanupFrameImages();
+    Tetrium_LUT::cleanupDescriptors();
+    vkDestroySampler(_device->logicalDevice, ctx.frameSampler, nullptr);
+    vkDestroySampler(_device->logicalDevice, ctx.lutSampler, nullptr);
+    vkDestroyRenderPass(_device->logicalDevice, ctx.renderPass, nullptr);
+    ctx.enabled = false;
+}
+
+void Tetrium::recreateLUTPassImages()
+{
+    Tetrium_LUT::Context& ctx = Tetrium_LUT::_ctx;
+    if (!ctx.enabled) {
+        return;
+    }
+    // called after the swapchain is recreated, with the device idle
+    Tetrium_LUT::cleanupFrameImages();
+    ctx.extent = _swapChain.extent;
+    Tetrium_LUT::createFrameImages();
+    for (const std::optional<Tetrium_LUT::LUT>& lut : ctx.luts) {
+        if (lut) {
+            Tetrium_LUT::writeDescriptorSets(*lut);
+        }
+    }
+}
+
+bool Tetrium::LoadLUT(ColorSpace colorSpace, const std::string& path)
+{
+    Tetrium_LUT::Context& ctx = Tetrium_LUT::_ctx;
+    if (!ctx.enabled) {
+        WARN("LUT pass is disabled, ignoring LUT {}", path);
+        return false;
+    }
+
+    std::optional<Tetrium_LUT::LUT> lut = std::nullopt;
+    if (!path.empty()) {
+        Tetrium_LUT::CubeFile cube;
+        if (!Tetrium_LUT::parseCubeFile(path, cube)) {
+            return false;
+        }
+        lut = Tetrium_LUT::createLUT(cube);
+        INFO(
+            "Loaded {} LUT \"{}\" of size {} from {}",
+            cube.is3D ? "3D" : "1D",
+            cube.title,
+            cube.size,
+            path
+        );
+    }
+
+    // frames in flight may still apply the current LUT
+    if (ctx.luts[colorSpace]) {
+        Tetrium_LUT::LUT oldLUT = *ctx.luts[colorSpace];
+        _frameDeletionQueue.push([oldLUT]() { Tetrium_LUT::destroyLUT(oldLUT); });
+    }
+    ctx.luts[colorSpace] = lut;
+
+    return true;
+}
+
+void Tetrium::recordLUTPass(
+    vk::CommandBuffer CB,
+    uint8_t frameIdx,
+    uint32_t swapChainImageIndex,
+    ColorSpace colorSpace
+)
+{
+    Tetrium_LUT::Context& ctx = Tetrium_LUT::_ctx;
+    if (!ctx.enabled || !ctx.luts[colorSpace]) {
+        return;
+    }
+    const Tetrium_LUT::LUT& lut = *ctx.luts[colorSpace];
+
+    Tetrium_LUT::recordFrameCopy(CB, frameIdx, _swapChain.image[swapChainImageIndex]);
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = ctx.renderPass;
+    // compatible with the LUT pass, as both only have a swapchain-format color attachment
+    renderPassInfo.framebuffer = _imguiCtx.frameBuffer[swapChainImageIndex];
+    renderPassInfo.renderArea = {{0, 0}, _swapChain.extent};
+    vkCmdBeginRenderPass(CB, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkViewport viewport{};
+    VkRect2D scissor{};
+    getFullScreenViewportAndScissor(_swapChain, viewport, scissor);
+    vkCmdSetViewport(CB, 0, 1, &viewport);
+    vkCmdSetScissor(CB, 0, 1, &scissor);
+
+    vkCmdBindPipeline(CB, VK_PIPELINE_BIND_POINT_GRAPHICS, lut.pipeline);
+    vkCmdBindDescriptorSets(
+        CB,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        ctx.pipelineLayout,
+        0,
+        1,
+        &lut.descriptorSets[frameIdx],
+        0,
+        nullptr
+    );
+    vkCmdPushConstants(
+        CB,
+        ctx.pipelineLayout,
+        VK_SHADER_STAGE_FRAGMENT_BIT,
+        0,
+        sizeof(Tetrium_LUT::PushConstants),
+        &lut.pushConstants
+    );
+    vkCmdDraw(CB, 3, 1, 0, 0);
+
+    vkCmdEndRenderPass(CB);
+}
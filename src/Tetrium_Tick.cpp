@@ -4,6 +4,10 @@
 
 void Tetrium::Run()
 {
+    if (_tetraMode == TetraMode::kHeadless) {
+        runHeadless();
+        return;
+    }
     DEBUG("Starting run loop...");
     ASSERT(_window);
     glfwShowWindow(_window);
@@ -22,6 +26,8 @@ void Tetrium::Tick()
     }
     _deltaTimer.Tick();
     _soundManager.Tick();
+    Profiler::TimeUnit tickBegin = Profiler::Clock::now();
+    ColorSpace colorSpace;
     {
         {
             PROFILE_SCOPE(&_profiler, "Render Loop");
@@ -29,17 +35,36 @@ void Tetrium::Tick()
             double deltaTime = _deltaTimer.GetDeltaTime();
             _timeSinceStartSeconds += deltaTime;
             _inputManager.Tick(deltaTime);
-            ColorSpace colorSpace = getCurrentColorSpace();
+            colorSpace = getCurrentColorSpace();
+            waitForFrameInFlight(_currentFrame);
+            {
+                PROFILE_SCOPE(&_profiler, "Texture Streaming");
+                _textureManager.PollAsyncLoads();
+            }
             drawImGui(colorSpace, _currentFrame);
+            // textures loaded so far, including by this tick's ImGui, land ahead of the frame
+            _textureManager.FlushUploads();
             drawFrame(colorSpace, _currentFrame);
             _currentFrame = (_currentFrame + 1) % NUM_FRAME_IN_FLIGHT;
         }
-        {
-            PROFILE_SCOPE(&_profiler, "GPU: Wait Idle");
-            vkDeviceWaitIdle(this->_device->logicalDevice);
-        }
+        // no device-wide wait here: the next frame's CPU work overlaps with this frame's
+        // GPU work; `waitForFrameInFlight` only blocks on that frame slot's `fenceInFlight`.
+    }
+    _lastProfilerData = _profiler.NewFrame();
+    if (_traceCapture.IsCapturing()) {
+        _traceCapture.RecordFrame(TraceCapture::FrameData{
+            .frameNumber = _numTicks,
+            .colorSpace = colorSpace,
+            .begin = tickBegin,
+            .end = Profiler::Clock::now(),
+            .cpuEntries = _lastProfilerData,
+            .gpuEntries = _gpuProfiler.GetLastFrame(),
+            .gpuSubmitTime = _gpuProfiler.GetLastFrameSubmitTime(),
+            // GPU scopes read back this tick were recorded the last time the frame slot was used
+            .gpuFrameNumber
+            = _numTicks >= NUM_FRAME_IN_FLIGHT ? _numTicks - NUM_FRAME_IN_FLIGHT : 0,
+        });
     }
-    _lastProfilerData = _profiler.NewProfile();
     _numTicks++;
 }
 
@@ -60,21 +85,32 @@ void Tetrium::getFullScreenViewportAndScissor(
     scissor.extent = extend;
 }
 
-void Tetrium::drawFrame(ColorSpace colorSpace, uint8_t frameIdx)
+void Tetrium::waitForFrameInFlight(uint8_t frameIdx)
 {
     SyncPrimitives& sync = _syncProjector[frameIdx];
-    VkResult result;
-    uint32_t swapchainImageIndex;
-
-    { // wait for previous render
+    {
         PROFILE_SCOPE(&_profiler, "vkWaitForFences: fenceInFlight");
         VK_CHECK_RESULT(
             vkWaitForFences(_device->logicalDevice, 1, &sync.fenceInFlight, VK_TRUE, UINT64_MAX)
         );
         VK_CHECK_RESULT(vkResetFences(this->_device->logicalDevice, 1, &sync.fenceInFlight));
     }
+    // GPU is done with everything submitted the last time this frame slot was used, resources
+    // released since then can be safely destroyed, and its timestamps can be read back.
+    _frameDeletionQueue.beginFrame(frameIdx);
+    _gpuProfiler.BeginFrame(frameIdx);
+}
 
-    { // Asynchronously acquire an image from the swap chain,
+void Tetrium::drawFrame(ColorSpace colorSpace, uint8_t frameIdx)
+{
+    SyncPrimitives& sync = _syncProjector[frameIdx];
+    VkResult result;
+    uint32_t swapchainImageIndex;
+
+    if (_tetraMode == TetraMode::kHeadless) {
+        // each frame slot owns an off-screen image, nothing to acquire
+        swapchainImageIndex = frameIdx;
+    } else { // Asynchronously acquire an image from the swap chain,
         result = vkAcquireNextImageKHR(
             this->_device->logicalDevice,
             _swapChain.chain,
@@ -100,11 +136,14 @@ void Tetrium::drawFrame(ColorSpace colorSpace, uint8_t frameIdx)
         // record app rendering commands
         appCB.reset();
         appCB.begin(vk::CommandBufferBeginInfo());
+        _gpuProfiler.ResetQueries(appCB); // app CB is the first submitted
         if (_primaryApp.has_value()) {
+            PROFILE_GPU_SCOPE(&_gpuProfiler, appCB, "App TickVulkan");
             TetriumApp::TickContextVulkan tickCtx{
                 .currentFrameInFlight = frameIdx,
                 .colorSpace = colorSpace,
                 .commandBuffer = appCB,
+                .gpuProfiler = &_gpuProfiler,
             };
             _primaryApp.value()->TickVulkan(tickCtx);
         }
@@ -114,6 +153,7 @@ void Tetrium::drawFrame(ColorSpace colorSpace, uint8_t frameIdx)
         engineCB.reset();
         engineCB.begin(vk::CommandBufferBeginInfo());
         {
+            PROFILE_GPU_SCOPE(&_gpuProfiler, engineCB, "ImGui Render Pass");
             vk::Extent2D extend = _swapChain.extent;
             vk::Rect2D renderArea(VkOffset2D{0, 0}, extend);
             VkViewport viewport{};
@@ -127,6 +167,10 @@ void Tetrium::drawFrame(ColorSpace colorSpace, uint8_t frameIdx)
                 _imguiCtx, engineCB, extend, swapchainImageIndex, colorSpace
             );
         }
+        {
+            PROFILE_GPU_SCOPE(&_gpuProfiler, engineCB, "LUT Pass");
+            recordLUTPass(engineCB, frameIdx, swapchainImageIndex, colorSpace);
+        }
         engineCB.end();
     }
 
@@ -149,17 +193,22 @@ void Tetrium::drawFrame(ColorSpace colorSpace, uint8_t frameIdx)
         std::array<vk::Semaphore, 1> appSignals = {sync.semaAppVulkanFinished};
         std::array<vk::Semaphore, 1> engineSignals = {sync.semaRenderFinished};
 
+        // headless mode neither acquires nor presents, so it only waits for app rendering
+        bool headless = _tetraMode == TetraMode::kHeadless;
+        uint32_t numEngineWaits = headless ? 1 : engineWaits.size();
+        uint32_t numEngineSignals = headless ? 0 : engineSignals.size();
+
         std::array<vk::SubmitInfo, 2> submitInfos = {
             vk::SubmitInfo(
                 0, nullptr, {}, appCBs.size(), appCBs.data(), appSignals.size(), appSignals.data()
             ),
             vk::SubmitInfo(
-                engineWaits.size(),
+                numEngineWaits,
                 engineWaits.data(),
                 engineWaitStages.data(),
                 engineCBs.size(),
                 engineCBs.data(),
-                engineSignals.size(),
+                numEngineSignals,
                 engineSignals.data()
             ),
         };
@@ -169,6 +218,11 @@ void Tetrium::drawFrame(ColorSpace colorSpace, uint8_t frameIdx)
             queue.submit(submitInfos.size(), submitInfos.data(), sync.fenceInFlight)
         );
         VK_CHECK_RESULT(result);
+        _gpuProfiler.MarkSubmitted();
+    }
+
+    if (_tetraMode == TetraMode::kHeadless) {
+        return;
     }
 
     { // Presented the swapchain, which at this point contains a rendered RGB/OCV image
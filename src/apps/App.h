@@ -1,5 +1,6 @@
 #pragma once
 
+#include "components/GpuProfiler.h"
 #include "lib/VQDevice.h"
 #include "structs/ImGuiTexture.h"
 #include "structs/SharedEngineStructs.h"
@@ -28,6 +29,9 @@ struct InitContext
         std::function<vk::DescriptorImageInfo(uint32_t)> GetTextureDescriptorImageInfo;
         std::function<ImGuiTexture(uint32_t)> InitImGuiTexture;
 
+        // runs the deleter once the GPU is done with every frame recorded so far, for releasing
+        // resources that frames in flight may still use without waiting for the device
+        std::function<void(std::function<void()>&&)> DeferDeletion;
     } api;
 };
 
@@ -50,7 +54,20 @@ struct TickContextImGui
     {
         std::function<void(Sound)> PlaySound;
         std::function<uint32_t(const std::string&)> LoadTexture;
+        // returns at once, the handle shows a placeholder until `IsTextureReady`
+        std::function<uint32_t(const std::string&)> LoadTextureAsync;
+        // may be evicted while it isn't drawn and texture memory is tight, `GetImGuiTexture`
+        // streams it in again; its ImGui texture must be fetched every frame, not kept.
+        // The `ColorSpace` is the plane of `.tetra` images to load, ignored for other files.
+        std::function<uint32_t(const std::string&, ColorSpace)> LoadEvictableTextureAsync;
+        // evictable like above, downscaled to fit `maxExtent` and cached on disk next to the image
+        std::function<uint32_t(const std::string&, uint32_t, ColorSpace)> LoadThumbnailAsync;
+        std::function<bool(uint32_t)> IsTextureReady;
+        // the texture could not be decoded, its handle keeps showing the placeholder
+        std::function<bool(uint32_t)> IsTextureFailed;
         std::function<ImGuiTexture(uint32_t)> InitImGuiTexture;
+        // current ImGui texture of a handle, which changes once an async load completes
+        std::function<ImGuiTexture(uint32_t)> GetImGuiTexture;
         std::function<void(uint32_t)> UnloadTexture;
     } apis;
 
@@ -71,6 +88,7 @@ struct TickContextVulkan
     int currentFrameInFlight;
     ColorSpace colorSpace;
     vk::CommandBuffer commandBuffer;
+    GpuProfiler* gpuProfiler; // for `PROFILE_GPU_SCOPE` on `commandBuffer`
 };
 
 // ImGui-based application interface
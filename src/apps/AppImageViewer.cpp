@@ -2,11 +2,24 @@
 #include <filesystem>
 
 #include "AppImageViewer.h"
+#include "lib/TetraImage.h"
 
 namespace
 {
 const char* TETRA_IMAGE_FOLDER_PATH = "../assets/textures/tetra_images/";
 
+const uint32_t THUMBNAIL_EXTENT = 128; // px, of the longer side
+const float THUMBNAIL_ROW_HEIGHT = 48;
+// thumbnails beyond it are unloaded, least recently drawn first; each holds ImGui descriptor sets
+const uint32_t MAX_LOADED_THUMBNAILS = 128;
+// full resolution images kept loaded on each side of the current one, so that H/L are instant
+const int NUM_PREFETCHED_NEIGHBORS = 1;
+
+// tiled images: zoom factor of a mouse wheel notch or J/K, and how far they zoom in and out
+const float TILED_ZOOM_STEP = 1.25f;
+const float MAX_TILED_SCALE = 16.f;
+const float MIN_TILED_SCALE_TO_FIT = 0.5f; // of the scale that fits the image into the window
+
 ImVec2 calculateFitSize(const ImGuiTexture& texture, const ImVec2& availableSize)
 {
     float aspectRatio = (float)texture.width / (float)texture.height;
@@ -32,7 +45,20 @@ void AppImageViewer::drawTetraImage(
     const TetraImageFile& image
 )
 {
-    ImGuiTexture tex = image.textures[colorSpace];
+    // fetched every frame, which keeps both halves resident, or streams them in again if they
+    // were evicted while other images were shown
+    ImGuiTexture textures[ColorSpaceSize];
+    for (int i = 0; i < ColorSpaceSize; i++) {
+        textures[i] = ctx.apis.GetImGuiTexture(image.textureHandles[i]);
+    }
+    // show both halves of a tetra image together, or neither
+    uint32_t rgbHandle = image.textureHandles[ColorSpace::RGB];
+    uint32_t ocvHandle = image.textureHandles[ColorSpace::OCV];
+    if (!ctx.apis.IsTextureReady(rgbHandle) || !ctx.apis.IsTextureReady(ocvHandle)) {
+        ImGui::Text("Loading %s...", image.name.c_str());
+        return;
+    }
+    ImGuiTexture tex = textures[colorSpace];
 
     ImVec2 size = {(float)tex.width * _zoom, (float)tex.height * _zoom};
 
@@ -43,8 +69,200 @@ void AppImageViewer::drawTetraImage(
     ImGui::Image(tex.id, size);
 }
 
+// Draws the tiled image open in `_virtualTexture` into the rest of the window; dragging pans,
+// the mouse wheel zooms about the cursor.
+void AppImageViewer::drawTiledImage(const TickContextImGui& ctx, ColorSpace colorSpace)
+{
+    if (!_virtualTexture.IsOpen()) {
+        ImGui::Text("Failed to open %s", _tetraImages.at(_tiledImage).tiledFileName.c_str());
+        return;
+    }
+    ImVec2 imageSize(_virtualTexture.GetWidth(), _virtualTexture.GetHeight());
+    if (!_noUI) {
+        VirtualTexture::Stats stats = _virtualTexture.GetStats();
+        ImGui::Text(
+            "%.0f x %.0f, %.0f%%. Tiles: %u/%u resident, %u requested, %llu uploaded",
+            imageSize.x,
+            imageSize.y,
+            _tiledView.scale * 100,
+            stats.numResidentTiles,
+            stats.numSlots,
+            stats.numRequestedTiles,
+            static_cast<unsigned long long>(stats.numUploads)
+        );
+    }
+
+    ImVec2 regionMin = ImGui::GetCursorScreenPos();
+    ImVec2 regionSize = ImGui::GetContentRegionAvail();
+    if (regionSize.x <= 0 || regionSize.y <= 0) {
+        return;
+    }
+    ImVec2 regionCenter = regionMin + regionSize * 0.5f;
+    float fitScale = std::min(regionSize.x / imageSize.x, regionSize.y / imageSize.y);
+    if (_adaptiveImageSize || _tiledView.scale == 0) {
+        _tiledView.center = imageSize * 0.5f;
+        _tiledView.scale = fitScale;
+    }
+
+    ImGui::InvisibleButton("##tiled image", regionSize);
+    ImGuiIO& io = ImGui::GetIO();
+    if (!_adaptiveImageSize && ImGui::IsItemActive()
+        && ImGui::IsMouseDragging(ImGuiMouseButton_Left, 0)) {
+        _tiledView.center -= io.MouseDelta / _tiledView.scale;
+    }
+    float scale = _tiledView.scale;
+    if (!_adaptiveImageSize && ImGui::IsItemHovered() && io.MouseWheel != 0) {
+        scale *= std::pow(TILED_ZOOM_STEP, io.MouseWheel);
+    }
+    scale = std::clamp(scale, fitScale * MIN_TILED_SCALE_TO_FIT, MAX_TILED_SCALE);
+    if (scale != _tiledView.scale) {
+        // keep the texel under the cursor in place, or the one at the center
+        ImVec2 pivot = ImGui::IsItemHovered() ? io.MousePos : regionCenter;
+        ImVec2 texel = _tiledView.center + (pivot - regionCenter) / _tiledView.scale;
+        _tiledView.center = texel - (pivot - regionCenter) / scale;
+        _tiledView.scale = scale;
+    }
+
+    _virtualTexture.Draw(
+        ImGui::GetWindowDrawList(),
+        colorSpace,
+        regionCenter - _tiledView.center * _tiledView.scale,
+        _tiledView.scale,
+        regionMin,
+        regionMin + regionSize,
+        ctx.currentFrameInFlight
+    );
+}
+
+void AppImageViewer::drawThumbnail(
+    const TickContextImGui& ctx,
+    ColorSpace colorSpace,
+    TetraImageFile& image
+)
+{
+    ImVec2 box = {THUMBNAIL_ROW_HEIGHT * 2, THUMBNAIL_ROW_HEIGHT};
+    if (!image.tiledFileName.empty()) { // no downscaled copy to show
+        ImGui::Dummy(box);
+        ImGui::SameLine(box.x + ImGui::GetStyle().ItemSpacing.x);
+        return;
+    }
+    if (image.thumbnailHandles[colorSpace] == 0) {
+        for (int i = 0; i < ColorSpaceSize; i++) {
+            image.thumbnailHandles[i] = ctx.apis.LoadThumbnailAsync(
+                TETRA_IMAGE_FOLDER_PATH + image.fileNames[i],
+                THUMBNAIL_EXTENT,
+                static_cast<ColorSpace>(i)
+            );
+            ctx.apis.InitImGuiTexture(image.thumbnailHandles[i]);
+        }
+        _numLoadedThumbnails++;
+    }
+    image.thumbnailLastDrawn = _frame;
+
+    ImGuiTexture thumbnail = ctx.apis.GetImGuiTexture(image.thumbnailHandles[colorSpace]);
+    ImVec2 size = {THUMBNAIL_ROW_HEIGHT, THUMBNAIL_ROW_HEIGHT}; // for the placeholder
+    if (ctx.apis.IsTextureReady(image.thumbnailHandles[colorSpace])) {
+        size = calculateFitSize(thumbnail, box);
+    }
+    ImGui::Image(thumbnail.id, size);
+    ImGui::SameLine(box.x + ImGui::GetStyle().ItemSpacing.x);
+}
+
+// full resolution textures of the current image and its neighbors; the others are unloaded
+void AppImageViewer::updateLoadedImages(const TickContextImGui& ctx)
+{
+    int numImages = _tetraImages.size();
+    for (int i = 0; i < numImages; i++) {
+        TetraImageFile& image = _tetraImages[i];
+        if (!image.tiledFileName.empty()) {
+            continue;
+        }
+        bool wanted = false;
+        if (_currTetraImage != -1) {
+            int distance = std::abs(i - _currTetraImage);
+            // H/L wrap around
+            wanted = std::min(distance, numImages - distance) <= NUM_PREFETCHED_NEIGHBORS;
+        }
+        bool loaded = image.textureHandles[ColorSpace::RGB] != 0;
+        if (wanted && !loaded) {
+            for (int c = 0; c < ColorSpaceSize; c++) {
+                image.textureHandles[c] = ctx.apis.LoadEvictableTextureAsync(
+                    TETRA_IMAGE_FOLDER_PATH + image.fileNames[c], static_cast<ColorSpace>(c)
+                );
+                ctx.apis.InitImGuiTexture(image.textureHandles[c]);
+            }
+        } else if (!wanted && loaded) {
+            for (int c = 0; c < ColorSpaceSize; c++) {
+                ctx.apis.UnloadTexture(image.textureHandles[c]);
+                image.textureHandles[c] = 0;
+            }
+        }
+    }
+}
+
+// opens the current image in `_virtualTexture` if it is tiled, closes it otherwise
+void AppImageViewer::updateTiledImage()
+{
+    bool tiled = _currTetraImage != -1 && !_tetraImages[_currTetraImage].tiledFileName.empty();
+    int tiledImage = tiled ? _currTetraImage : -1;
+    if (tiledImage == _tiledImage) {
+        return;
+    }
+    _tiledImage = tiledImage;
+    _tiledView.scale = 0; // fit the new image
+    if (tiled) {
+        _virtualTexture.Open(
+            TETRA_IMAGE_FOLDER_PATH + _tetraImages[_currTetraImage].tiledFileName
+        );
+    } else {
+        _virtualTexture.Close();
+    }
+}
+
+void AppImageViewer::trimThumbnails(const TickContextImGui& ctx)
+{
+    if (_numLoadedThumbnails <= MAX_LOADED_THUMBNAILS) {
+        return;
+    }
+    std::vector<TetraImageFile*> loaded;
+    for (TetraImageFile& image : _tetraImages) {
+        if (image.thumbnailHandles[ColorSpace::RGB] != 0) {
+            loaded.push_back(&image);
+        }
+    }
+    std::sort(loaded.begin(), loaded.end(), [](const TetraImageFile* a, const TetraImageFile* b) {
+        return a->thumbnailLastDrawn < b->thumbnailLastDrawn;
+    });
+    for (TetraImageFile* image : loaded) {
+        if (_numLoadedThumbnails <= MAX_LOADED_THUMBNAILS) {
+            break;
+        }
+        for (uint32_t& handle : image->thumbnailHandles) {
+            ctx.apis.UnloadTexture(handle);
+            handle = 0;
+        }
+        _numLoadedThumbnails--;
+    }
+}
+
+void AppImageViewer::unloadTextures(
+    TetraImageFile& image,
+    const std::function<void(uint32_t)>& unloadTexture
+)
+{
+    for (int i = 0; i < ColorSpaceSize; i++) {
+        if (image.textureHandles[i] != 0) {
+            unloadTexture(image.textureHandles[i]);
+        }
+        if (image.thumbnailHandles[i] != 0) {
+            unloadTexture(image.thumbnailHandles[i]);
+        }
+    }
+}
+
 void AppImageViewer::TickImGui(const TetriumApp::TickContextImGui& ctx)
 {
+    _frame++;
     ColorSpace colorSpace = ctx.colorSpace;
     pollControls();
     ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0, 0, 0, 1));
@@ -63,9 +281,14 @@ void AppImageViewer::TickImGui(const TetriumApp::TickContextImGui& ctx)
         if (!_noUI) {
             drawControlPrompts();
             drawTetraImagePicker(ctx, colorSpace);
+            trimThumbnails(ctx);
         }
 
-        if (_currTetraImage != -1) {
+        updateLoadedImages(ctx);
+        updateTiledImage();
+        if (_tiledImage != -1) {
+            drawTiledImage(ctx, colorSpace);
+        } else if (_currTetraImage != -1) {
             drawTetraImage(ctx, colorSpace, _tetraImages.at(_currTetraImage));
         }
     }
@@ -73,15 +296,22 @@ void AppImageViewer::TickImGui(const TetriumApp::TickContextImGui& ctx)
     ImGui::PopStyleColor();
 }
 
-// reload all tetra images through IO
+void AppImageViewer::TickVulkan(TetriumApp::TickContextVulkan& ctx)
+{
+    PROFILE_GPU_SCOPE(ctx.gpuProfiler, ctx.commandBuffer, "Image Viewer: Upload Tiles");
+    _virtualTexture.RecordUploads(ctx.commandBuffer, ctx.currentFrameInFlight);
+}
+
+// lists the tetra images of the folder; their textures are loaded as they are shown
 void AppImageViewer::refreshTetraImagePicker(const TickContextImGui& ctx)
 {
     _currTetraImage = -1;
     for (TetraImageFile& image : _tetraImages) {
-        ctx.apis.UnloadTexture(image.textureHandles[ColorSpace::RGB]);
-        ctx.apis.UnloadTexture(image.textureHandles[ColorSpace::OCV]);
+        unloadTextures(image, ctx.apis.UnloadTexture);
     }
     _tetraImages.clear();
+    _numLoadedThumbnails = 0;
+    updateTiledImage();
 
     std::unordered_set<std::string> images;
     // iterate over all files, each pairs of files that are in xxx_RGB.png and xxx_OCV.png format
@@ -92,6 +322,16 @@ void AppImageViewer::refreshTetraImagePicker(const TickContextImGui& ctx)
             continue;
         }
         std::string fileName = entry.path().filename().string();
+        if (entry.path().extension() == TiledImage::FILE_EXTENSION) {
+            std::string tetraImageName = entry.path().stem().string();
+            _tetraImages.push_back({.name = tetraImageName, .tiledFileName = fileName});
+            continue;
+        }
+        if (entry.path().extension() == TetraImage::FILE_EXTENSION) { // both planes in one file
+            std::string tetraImageName = entry.path().stem().string();
+            _tetraImages.push_back({.name = tetraImageName, .fileNames = {fileName, fileName}});
+            continue;
+        }
         bool isRGB = fileName.ends_with("_RGB.png");
         bool isOCV = fileName.ends_with("_OCV.png");
         if (!isRGB && !isOCV) {
@@ -116,27 +356,17 @@ void AppImageViewer::refreshTetraImagePicker(const TickContextImGui& ctx)
                 rgbFileName.swap(ocvFileName);
             }
             TetraImageFile image{.name = tetraImageName, .fileNames = {rgbFileName, ocvFileName}};
-            std::string rgbFilePath = TETRA_IMAGE_FOLDER_PATH + rgbFileName;
-            std::string ocvFilePath = TETRA_IMAGE_FOLDER_PATH + ocvFileName;
-            image.textureHandles[ColorSpace::RGB] = ctx.apis.LoadTexture(rgbFilePath);
-            image.textureHandles[ColorSpace::OCV] = ctx.apis.LoadTexture(ocvFilePath);
-            image.textures[ColorSpace::RGB]
-                = ctx.apis.InitImGuiTexture(image.textureHandles[ColorSpace::RGB]);
-            image.textures[ColorSpace::OCV]
-                = ctx.apis.InitImGuiTexture(image.textureHandles[ColorSpace::OCV]);
             _tetraImages.emplace_back(image);
         } else {
             images.insert(fileName);
         }
     }
 
-    // sort all tetra images by rgb file name
+    // sort all tetra images by name, tiled ones have no rgb file
     std::sort(
         _tetraImages.begin(),
         _tetraImages.end(),
-        [](const TetraImageFile& a, const TetraImageFile& b) {
-            return a.fileNames[ColorSpace::RGB] < b.fileNames[ColorSpace::RGB];
-        }
+        [](const TetraImageFile& a, const TetraImageFile& b) { return a.name < b.name; }
     );
 }
 
@@ -151,12 +381,24 @@ void AppImageViewer::drawTetraImagePicker(const TickContextImGui& ctx, ColorSpac
     const char* currentTetraImageName
         = _currTetraImage != -1 ? _tetraImages[_currTetraImage].name.c_str() : "Select Tetra Image";
 
-    if (ImGui::BeginCombo("Tetra Images", currentTetraImageName)) {
-        for (int i = 0; i < _tetraImages.size(); i++) {
-            TetraImageFile& image = _tetraImages.at(i);
-            bool imageSelected = _currTetraImage == i;
-            if (ImGui::Selectable(image.name.c_str(), imageSelected)) {
-                _currTetraImage = i;
+    if (ImGui::BeginCombo("Tetra Images", currentTetraImageName, ImGuiComboFlags_HeightLarge)) {
+        // only rows scrolled into view are drawn, and have their thumbnails loaded
+        ImGuiListClipper clipper;
+        clipper.Begin(_tetraImages.size(), THUMBNAIL_ROW_HEIGHT + ImGui::GetStyle().ItemSpacing.y);
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                TetraImageFile& image = _tetraImages.at(i);
+                bool imageSelected = _currTetraImage == i;
+                ImGui::PushID(i);
+                if (ImGui::Selectable(
+                        "##image", imageSelected, 0, ImVec2(0, THUMBNAIL_ROW_HEIGHT)
+                    )) {
+                    _currTetraImage = i;
+                }
+                ImGui::SameLine();
+                drawThumbnail(ctx, colorSpace, image);
+                ImGui::Text("%s", image.name.c_str());
+                ImGui::PopID();
             }
         }
 
@@ -167,17 +409,26 @@ void AppImageViewer::drawTetraImagePicker(const TickContextImGui& ctx, ColorSpac
 void AppImageViewer::drawControlPrompts()
 {
     ImGui::Text("J/K : zoom in/out. H/L: cycle images. B: toggle UI. "
-                "A: Toggle Adaptive Image Sizes");
+                "A: Toggle Adaptive Image Sizes. Tiled images: drag to pan, scroll to zoom.");
 }
 
 void AppImageViewer::pollControls()
 {
 
+    // tiled images zoom in steps of a wheel notch
     if (ImGui::IsKeyPressed(ImGuiKey_K)) {
-        _zoom += 0.1;
+        if (_tiledImage != -1) {
+            _tiledView.scale *= TILED_ZOOM_STEP;
+        } else {
+            _zoom += 0.1;
+        }
     }
     if (ImGui::IsKeyPressed(ImGuiKey_J)) {
-        _zoom -= 0.1;
+        if (_tiledImage != -1) {
+            _tiledView.scale /= TILED_ZOOM_STEP;
+        } else {
+            _zoom -= 0.1;
+        }
     }
     if (ImGui::IsKeyPressed(ImGuiKey_B)) {
         _noUI = !_noUI;
@@ -201,12 +452,13 @@ void AppImageViewer::pollControls()
     }
 }
 
+void AppImageViewer::Init(TetriumApp::InitContext& ctx) { _virtualTexture.Init(ctx.device); }
+
 void AppImageViewer::Cleanup(TetriumApp::CleanupContext& ctx)
 {
+    _virtualTexture.Cleanup();
     for (TetraImageFile& image : _tetraImages) {
-        for (int i = 0; i < ColorSpaceSize; i++) {
-            ctx.api.UnloadTexture(image.textureHandles[i]);
-        }
+        unloadTextures(image, ctx.api.UnloadTexture);
     }
 }
 } // namespace TetriumApp
@@ -1,4 +1,5 @@
 #include "App.h"
+#include "app_components/VirtualTexture.h"
 
 namespace TetriumApp
 {
@@ -6,18 +7,24 @@ namespace TetriumApp
 class AppImageViewer : public App
 {
   public:
-    virtual void Init(TetriumApp::InitContext& ctx) override {};
+    virtual void Init(TetriumApp::InitContext& ctx) override;
     virtual void Cleanup(TetriumApp::CleanupContext& ctx) override;
 
     virtual void TickImGui(const TetriumApp::TickContextImGui& ctx) override;
+    virtual void TickVulkan(TetriumApp::TickContextVulkan& ctx) override;
 
   private:
     struct TetraImageFile
     {
         std::string name;
         std::string fileNames[ColorSpaceSize];
-        uint32_t textureHandles[ColorSpaceSize];
-        ImGuiTexture textures[ColorSpaceSize];
+        // full resolution, 0 unless near the current image, see `updateLoadedImages`
+        uint32_t textureHandles[ColorSpaceSize] = {};
+        // 0 until the image's row in the picker is first drawn, see `drawThumbnail`
+        uint32_t thumbnailHandles[ColorSpaceSize] = {};
+        uint64_t thumbnailLastDrawn = 0; // `_frame` the row was last drawn in
+        // `.ttiles` image, shown through `_virtualTexture` instead of the textures above
+        std::string tiledFileName;
     };
 
     bool _wantReloadImages = true;
@@ -27,6 +34,13 @@ class AppImageViewer : public App
     void drawControlPrompts();
     void drawTetraImagePicker(const TickContextImGui& ctx, ColorSpace colorSpace);
     void drawTetraImage(const TickContextImGui& ctx, ColorSpace colorSpace, const TetraImageFile& image);
+    void drawTiledImage(const TickContextImGui& ctx, ColorSpace colorSpace);
+    void drawThumbnail(const TickContextImGui& ctx, ColorSpace colorSpace, TetraImageFile& image);
+
+    void updateLoadedImages(const TickContextImGui& ctx);
+    void updateTiledImage();
+    void trimThumbnails(const TickContextImGui& ctx);
+    void unloadTextures(TetraImageFile& image, const std::function<void(uint32_t)>& unloadTexture);
 
     void pollControls();
 
@@ -34,6 +48,17 @@ class AppImageViewer : public App
 
     int _currTetraImage = -1;
 
+    uint64_t _frame = 0; // counts `TickImGui()`
+    uint32_t _numLoadedThumbnails = 0; // pairs
+
+    VirtualTexture _virtualTexture;
+    int _tiledImage = -1; // open in `_virtualTexture`
+    struct
+    {
+        ImVec2 center;   // in image texels
+        float scale = 0; // screen pixels per image texel, 0 to fit the image into the window
+    } _tiledView;
+
     inline static const char* TETRA_IMAGE_FOLDER_PATH = "../assets/apps/AppImageViewer/tetra_images/";
 
     // scaling params
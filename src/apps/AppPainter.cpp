@@ -10,109 +10,11 @@ namespace TetriumApp
 
 /* ---------- Init & Cleanup ---------- */
 
-void AppPainter::initPaintSpaceBuffer(TetriumApp::InitContext& ctx)
+vk::Extent2D AppPainter::getViewExtent() const
 {
-    VkDeviceSize bufferSize
-        = _canvasWidth * _canvasHeight * PAINT_SPACE_PIXEL_SIZE;
-    DEBUG("Paint space buffer size: {}", bufferSize);
-    _paintSpaceBuffer = ctx.device.CreateBuffer(
-        bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    return vk::Extent2D(
+        std::min(_canvasWidth, MAX_VIEW_SIZE), std::min(_canvasHeight, MAX_VIEW_SIZE)
     );
-
-    // fill buffer with zeros
-    memset(_paintSpaceBuffer.bufferAddress, 0, bufferSize);
-}
-
-void AppPainter::cleanupPaintSpaceBuffer(TetriumApp::CleanupContext& ctx)
-{
-    _paintSpaceBuffer.Cleanup();
-}
-
-void AppPainter::initPaintSpaceTexture(TetriumApp::InitContext& ctx)
-{
-    // RYGB color space, need 4 bytes per channel to store potentially
-    // negative float values.
-    const VkFormat IMAGE_FORMAT = VK_FORMAT_R32G32B32A32_SFLOAT;
-
-    VkImageViewCreateInfo imageViewCreateInfo{};
-    imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    imageViewCreateInfo.format = IMAGE_FORMAT;
-    imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
-    imageViewCreateInfo.subresourceRange.levelCount = 1;
-    imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
-    imageViewCreateInfo.subresourceRange.layerCount = 1;
-
-    for (PaintSpaceTexture& fb : _paintSpaceTexture) {
-        VkImage image{};
-        VkDeviceMemory memory{};
-        VkImageView imageView{};
-
-        VulkanUtils::createImage(
-            _canvasWidth,
-            _canvasHeight,
-            IMAGE_FORMAT,
-            VK_IMAGE_TILING_OPTIMAL,
-            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            image,
-            memory,
-            ctx.device.physicalDevice,
-            ctx.device.logicalDevice
-        );
-
-        // transition image layout from undefined to general
-        {
-            vk::CommandBuffer cb = ctx.device.BeginSingleTimeCommands();
-            vk::ImageMemoryBarrier barrier(
-                vk::AccessFlags(),
-                vk::AccessFlags(),
-                vk::ImageLayout::eUndefined,
-                vk::ImageLayout::eGeneral,
-                VK_QUEUE_FAMILY_IGNORED,
-                VK_QUEUE_FAMILY_IGNORED,
-                image,
-                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-            );
-
-            cb.pipelineBarrier(
-                vk::PipelineStageFlagBits::eTopOfPipe,
-                vk::PipelineStageFlagBits::eTransfer,
-                vk::DependencyFlags(),
-                nullptr,
-                nullptr,
-                barrier
-            );
-            ctx.device.EndSingleTimeCommands(cb);
-        }
-
-        imageViewCreateInfo.image = image;
-
-        VK_CHECK_RESULT(
-            vkCreateImageView(ctx.device.logicalDevice, &imageViewCreateInfo, nullptr, &imageView)
-        );
-
-        ASSERT(image != VK_NULL_HANDLE);
-        ASSERT(memory != VK_NULL_HANDLE);
-        ASSERT(imageView != VK_NULL_HANDLE);
-        fb.image = image;
-        fb.imageView = imageView;
-        fb.memory = memory;
-        fb.needsUpdate = true;
-    }
-}
-
-void AppPainter::cleanupPaintSpaceTexture(TetriumApp::CleanupContext& ctx)
-{
-    vk::Device device = ctx.device.logicalDevice;
-    for (PaintSpaceTexture& fb : _paintSpaceTexture) {
-        device.destroyImage(fb.image);
-        device.destroyImageView(fb.imageView);
-        device.freeMemory(fb.memory);
-    }
 }
 
 void AppPainter::initViewSpaceFrameBuffer(TetriumApp::InitContext& ctx)
@@ -120,13 +22,13 @@ void AppPainter::initViewSpaceFrameBuffer(TetriumApp::InitContext& ctx)
     ASSERT(
         _paintToViewSpaceContext.renderPass != VK_NULL_HANDLE && "render pass must be initialized"
     );
+    vk::Extent2D viewExtent = getViewExtent();
     for (TextureFrameBuffer& fb : _viewSpaceFrameBuffer) {
         fb.Init(
-            ctx.device.logicalDevice,
-            ctx.device.physicalDevice,
+            ctx.device,
             _paintToViewSpaceContext.renderPass,
-            _canvasWidth,
-            _canvasHeight,
+            viewExtent.width,
+            viewExtent.height,
             VK_FORMAT_R8G8B8A8_SRGB, // RGB / OCV color space
             ctx.device.depthFormat,
             true
@@ -141,6 +43,15 @@ void AppPainter::cleanupViewSpaceFrameBuffer(TetriumApp::CleanupContext& ctx)
     }
 }
 
+void AppPainter::resizeViewSpaceFrameBuffer(uint32_t frameIndex)
+{
+    TextureFrameBuffer& fb = _viewSpaceFrameBuffer[frameIndex];
+    vk::Extent2D viewExtent = getViewExtent();
+    if (fb.GetExtent() != viewExtent) {
+        fb.Resize(viewExtent.width, viewExtent.height);
+    }
+}
+
 void AppPainter::initPaintToViewSpaceContext(TetriumApp::InitContext& ctx)
 {
     vk::Device device = ctx.device.logicalDevice;
@@ -157,10 +68,11 @@ void AppPainter::initPaintToViewSpaceContext(TetriumApp::InitContext& ctx)
 
     /* create samplers */
     {
+        // the tile atlas is fetched texel by texel, never filtered
         VkSamplerCreateInfo samplerCreateInfo = {};
         samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-        samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
-        samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+        samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+        samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
         samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
         samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
         samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
@@ -174,16 +86,17 @@ void AppPainter::initPaintToViewSpaceContext(TetriumApp::InitContext& ctx)
     {
         vk::DescriptorPoolSize poolSizes[]
             = {{vk::DescriptorType::eUniformBuffer, NUM_FRAME_IN_FLIGHT},
-               {vk::DescriptorType::eCombinedImageSampler, NUM_FRAME_IN_FLIGHT}};
+               {vk::DescriptorType::eCombinedImageSampler, NUM_FRAME_IN_FLIGHT},
+               {vk::DescriptorType::eStorageBuffer, NUM_FRAME_IN_FLIGHT}};
 
-        vk::DescriptorPoolCreateInfo poolCreateInfo({}, NUM_FRAME_IN_FLIGHT * 2, 2, poolSizes);
+        vk::DescriptorPoolCreateInfo poolCreateInfo({}, NUM_FRAME_IN_FLIGHT * 3, 3, poolSizes);
 
         _paintToViewSpaceContext.descriptorPool = device.createDescriptorPool(poolCreateInfo);
     }
 
     /* create descriptor set layout */
     {
-        std::array<vk::DescriptorSetLayoutBinding, 2> descriptorSetLayoutBindings
+        std::array<vk::DescriptorSetLayoutBinding, 3> descriptorSetLayoutBindings
             = {// UBO
                vk::DescriptorSetLayoutBinding(
                    (uint32_t)BindingLocation::ubo,
@@ -193,13 +106,21 @@ void AppPainter::initPaintToViewSpaceContext(TetriumApp::InitContext& ctx)
                    nullptr
 
                ),
-               // paint space texture sampler
+               // tile atlas sampler
                vk::DescriptorSetLayoutBinding(
-                   (uint32_t)BindingLocation::sampler,
+                   (uint32_t)BindingLocation::tileAtlas,
                    vk::DescriptorType::eCombinedImageSampler,
                    1,
                    vk::ShaderStageFlagBits::eFragment,
                    nullptr
+               ),
+               // tile table
+               vk::DescriptorSetLayoutBinding(
+                   (uint32_t)BindingLocation::tileTable,
+                   vk::DescriptorType::eStorageBuffer,
+                   1,
+                   vk::ShaderStageFlagBits::eFragment,
+                   nullptr
                )};
         vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo(
             {}, descriptorSetLayoutBindings.size(), descriptorSetLayoutBindings.data()
@@ -227,7 +148,7 @@ void AppPainter::initPaintToViewSpaceContext(TetriumApp::InitContext& ctx)
         }
     }
 
-    /* update descriptor sets */
+    /* update descriptor sets, the tiles are bound by `updateTileDescriptors()` */
     {
         for (int i = 0; i < _paintToViewSpaceContext.descriptorSets.size(); i++) {
             vk::DescriptorSet descriptorSet = _paintToViewSpaceContext.descriptorSets[i];
@@ -236,33 +157,17 @@ void AppPainter::initPaintToViewSpaceContext(TetriumApp::InitContext& ctx)
                 _paintToViewSpaceContext.ubo[i].buffer, 0, sizeof(UBO)
             );
 
-            vk::DescriptorImageInfo imageInfo(
-                _paintToViewSpaceContext.samplers[i],
-                _paintSpaceTexture[0].imageView,
-                vk::ImageLayout::eGeneral
-            );
-
             device.updateDescriptorSets(
-                {vk::WriteDescriptorSet(
-                     descriptorSet,
-                     (uint32_t)BindingLocation::ubo,
-                     0,
-                     1,
-                     vk::DescriptorType::eUniformBuffer,
-                     nullptr,
-                     &bufferInfo,
-                     nullptr
-                 ),
-                 vk::WriteDescriptorSet(
-                     descriptorSet,
-                     (uint32_t)BindingLocation::sampler,
-                     0,
-                     1,
-                     vk::DescriptorType::eCombinedImageSampler,
-                     &imageInfo,
-                     nullptr,
-                     nullptr
-                 )},
+                vk::WriteDescriptorSet(
+                    descriptorSet,
+                    (uint32_t)BindingLocation::ubo,
+                    0,
+                    1,
+                    vk::DescriptorType::eUniformBuffer,
+                    nullptr,
+                    &bufferInfo,
+                    nullptr
+                ),
                 nullptr
             );
         }
@@ -354,16 +259,11 @@ void AppPainter::initPaintToViewSpaceContext(TetriumApp::InitContext& ctx)
             {}, dynamicStates.size(), dynamicStates.data()
         );
 
+        vk::Extent2D viewExtent = getViewExtent();
         vk::Viewport viewport(
-            0.f, 0.f, _canvasWidth, _canvasHeight, 0.f, 1.f
-        );
-        vk::Rect2D scissor(
-            {0, 0},
-            {
-                _canvasWidth,
-                _canvasHeight,
-            }
+            0.f, 0.f, viewExtent.width, viewExtent.height, 0.f, 1.f
         );
+        vk::Rect2D scissor({0, 0}, viewExtent);
         vk::PipelineViewportStateCreateInfo viewportState({}, 1, &viewport, 1, &scissor);
 
         // rasterizer
@@ -412,12 +312,15 @@ void AppPainter::initPaintToViewSpaceContext(TetriumApp::InitContext& ctx)
             {0.0f, 0.0f, 0.0f, 0.0f} // blendConstants
         );
 
+        vk::PushConstantRange pushConstantRange(
+            vk::ShaderStageFlagBits::eFragment, 0, sizeof(PushConstants)
+        );
         vk::PipelineLayoutCreateInfo pipelineLayoutInfo(
             vk::PipelineLayoutCreateFlags(),
             1,
             &_paintToViewSpaceContext.descriptorSetLayout,
-            0,
-            nullptr
+            1,
+            &pushConstantRange
         );
 
         if (device.createPipelineLayout(
@@ -480,10 +383,12 @@ void AppPainter::cleanupPaintToViewSpaceContext(TetriumApp::CleanupContext& ctx)
 
 void AppPainter::Init(TetriumApp::InitContext& ctx)
 {
-    initPaintSpaceBuffer(ctx);
-    initPaintSpaceTexture(ctx);
+    _device = &ctx.device;
+    _deferDeletion = ctx.api.DeferDeletion;
+    initPaintSpaceTiles(ctx);
     initPaintToViewSpaceContext(ctx);
     initViewSpaceFrameBuffer(ctx);
+    initGpuBrushContext(ctx);
 
     _clearValues
         = {vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}),
@@ -496,50 +401,32 @@ void AppPainter::Cleanup(TetriumApp::CleanupContext& ctx)
 {
     _colorPicker.Cleanup();
 
+    cleanupGpuBrushContext(ctx);
     cleanupViewSpaceFrameBuffer(ctx);
     cleanupPaintToViewSpaceContext(ctx);
-    cleanupPaintSpaceTexture(ctx);
-    cleanupPaintSpaceBuffer(ctx);
+    cleanupPaintSpaceTiles(ctx);
 }
 
 /* ---------- Tick ---------- */
 
 void AppPainter::TickVulkan(TetriumApp::TickContextVulkan& ctx)
 {
-    PaintSpaceTexture& canvas = _paintSpaceTexture[ctx.currentFrameInFlight];
     vk::CommandBuffer& cb = ctx.commandBuffer;
+    _currentFrameInFlight = ctx.currentFrameInFlight;
 
-    // update paint space texture if needed
-    if (canvas.needsUpdate) {
-        vk::BufferImageCopy copyRegion(
-            0,
-            0,
-            0,
-            vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
-            vk::Offset3D(0, 0, 0),
-            vk::Extent3D(_canvasWidth, _canvasHeight, 1)
-        );
-        cb.copyBufferToImage(
-            _paintSpaceBuffer.buffer, // src
-            canvas.image,             // dst
-            vk::ImageLayout::eGeneral,
-            1,
-            &copyRegion
-        );
+    // tiles allocated or freed, or the atlas grown, since the frame was last drawn
+    prepareTiles(cb, ctx.currentFrameInFlight);
 
-        // pipeline blocks until paint space texture is updated.
-        cb.pipelineBarrier(
-            vk::PipelineStageFlagBits::eTransfer,
-            vk::PipelineStageFlagBits::eFragmentShader,
-            vk::DependencyFlags(),
-            0,
-            nullptr,
-            0,
-            nullptr,
-            0,
-            nullptr
-        );
-        canvas.needsUpdate = false;
+    // stage the tiles painted on the CPU
+    if (!_dirtyTiles.empty()) {
+        PROFILE_GPU_SCOPE(ctx.gpuProfiler, cb, "Painter: Upload Paint Space");
+        recordPaintSpaceUpload(cb);
+    }
+
+    // GPU brush strokes painted since the last frame
+    if (!_pendingSegments.empty()) {
+        PROFILE_GPU_SCOPE(ctx.gpuProfiler, cb, "Painter: Paint Strokes");
+        recordStrokes(cb, ctx.currentFrameInFlight);
     }
 
     // flush UBO
@@ -550,7 +437,9 @@ void AppPainter::TickVulkan(TetriumApp::TickContextVulkan& ctx)
     pUBO->transformMatrix = _tranformMatrixFromRygb[ctx.colorSpace];
 
     // Transform paint space to view space
-    vk::Extent2D extend(_canvasWidth, _canvasHeight);
+    PROFILE_GPU_SCOPE(ctx.gpuProfiler, cb, "Painter: Paint To View Space");
+    resizeViewSpaceFrameBuffer(ctx.currentFrameInFlight); // if the view wasn't drawn this frame
+    vk::Extent2D extend = getViewExtent();
     vk::Rect2D renderArea(VkOffset2D{0, 0}, extend);
     vk::RenderPassBeginInfo renderPassBeginInfo(
         _paintToViewSpaceContext.renderPass,
@@ -574,6 +463,14 @@ void AppPainter::TickVulkan(TetriumApp::TickContextVulkan& ctx)
         nullptr,
         vk::getDispatchLoaderStatic()
     );
+    PushConstants pushConstants{.viewOffset = _viewOffset, .numTilesX = _numTilesX};
+    cb.pushConstants(
+        _paintToViewSpaceContext.pipelineLayout,
+        vk::ShaderStageFlagBits::eFragment,
+        0,
+        sizeof(pushConstants),
+        &pushConstants
+    );
     // draw a full-screen quad
     cb.draw(3, 1, 0, 0);
     cb.endRenderPass();
@@ -3,6 +3,8 @@
 #include "imgui.h"
 
 #include "lib/DeletionStack.h"
+#include "lib/BrushKernels.h"
+#include "lib/RYGBTransform.h"
 
 #include "App.h"
 #include "app_components/TextureFrameBuffer.h"
@@ -20,25 +22,13 @@ namespace TetriumApp
 // https://github.com/OpenGL-Graphics/imgui-paint
 // TODO::
 // - implement serialization and deserialization of RYGB files
-// - (low priority) implement canvas resizing
 class AppPainter : public App
 {
   private:
     // transformation matrices from RYGB to RGB and OCV color spaces
     // the project renders in RGB and OCV color space.
     std::array<glm::mat4x3, ColorSpace::ColorSpaceSize> _tranformMatrixFromRygb
-        = {// RYGB -> RGB
-           glm::mat4x3{
-               {0.00227389, 0.02027033, 0.84088907},
-               {0.09871685, 0.82513837, 0.08254044},
-               {-0.0825074, 0.09203826, -0.01052114},
-               {0.98151666, -0.02124976, -0.0095099}},
-           // RYGB -> OCV
-           glm::mat4x3{
-               {-0.03549117, 0., 0.},
-               {-0.30406722, 0., 0.},
-               {0.95542715, 0., 0.},
-               {0.06836908, 0., 0.}}};
+        = RYGBTransform::TRANSFORMS_FROM_RYGB;
 
     // Color picker widget that visualizes RYGB color space through slice of
     // tetrachromatic hue sphere.
@@ -92,55 +82,203 @@ class AppPainter : public App
 
     virtual void TickVulkan(TetriumApp::TickContextVulkan& ctx) override;
 
+    struct ScreenRect
+    {
+        ImVec2 min;
+        ImVec2 size;
+    };
+
+    // where the last `TickImGui` drew the view of the canvas, zero-sized before the first one
+    ScreenRect GetViewScreenRect() const { return _viewScreenRect; }
+
   private:
     ColorPicker _colorPicker;
 
     bool _wantDrawColorPicker = false;
 
-    // ---------- Paint space(RYGB) buffers ----------
+    // ---------- Paint space(RYGB) tiles ----------
     //
     // We paint onto buffer RYGB values into RGBA channels, repurposing the alpha channel.
     // so a single pixel is laid out as:
     // | R | Y | G | B | <-- pixel data
     // | R | G | B | A | <-- actual buffer memory
-    // the framebuffer is in `VK_FORMAT_R32G32B32A32_SFLOAT` format,
+    // the tile atlas is in `VK_FORMAT_R32G32B32A32_SFLOAT` format,
     // as colors in RYGB space may be negative.
-    // we write to a CPU-accessible staging buffer; the buffer is flushed to GPU buffer for color
-    // space transformation.
+    //
+    // The canvas is split into square tiles, allocated the first time they are painted on; a tile
+    // that never was is all zeros. A mostly empty canvas only takes the memory of its painted
+    // tiles, and resizing it keeps the tiles it still covers.
+    // Each tile has a CPU-accessible buffer, which the CPU paints on and serializes, and a slot in
+    // the GPU tile atlas, which the GPU brush paints on and the transform pass samples. Regions of
+    // a buffer are staged into its slot as they are painted.
 
-    // CPU-accessible buffer to store paint space data
-    VQBuffer _paintSpaceBuffer;
-    void initPaintSpaceBuffer(TetriumApp::InitContext& ctx);
-    void cleanupPaintSpaceBuffer(TetriumApp::CleanupContext& ctx);
+    // in pixels, along either axis; also in the shaders
+    static constexpr uint32_t TILE_SIZE = 256;
 
-    // GPU-accessible texture to sample from in paint space.
-    struct PaintSpaceTexture
+    struct PaintSpaceTile
+    {
+        VQBuffer buffer; // `TILE_SIZE` x `TILE_SIZE` pixels
+        uint32_t slot;   // in `_tileAtlas`
+        // disjoint regions of `buffer` updated since it was last staged, in tile pixels, see
+        // `flagRegionForUpdate()`
+        std::vector<vk::Rect2D> dirtyRegions;
+        bool stale = false; // painted with the GPU brush since `buffer` was last read back
+    };
+
+    // row-major, `nullptr` for tiles never painted on
+    std::vector<std::unique_ptr<PaintSpaceTile>> _tiles;
+    uint32_t _numTilesX = 0;
+    uint32_t _numTilesY = 0;
+    std::vector<uint32_t> _dirtyTiles; // indices of the tiles with dirty regions
+
+    // part of a canvas region that falls on one tile
+    struct TileRegion
+    {
+        uint32_t tileX;
+        uint32_t tileY;
+        vk::Rect2D region; // in the tile's pixels
+    };
+
+    void initPaintSpaceTiles(TetriumApp::InitContext& ctx);
+    void cleanupPaintSpaceTiles(TetriumApp::CleanupContext& ctx);
+    // allocates the tile and its atlas slot the first time it is touched
+    PaintSpaceTile& touchTile(uint32_t tileX, uint32_t tileY);
+    // the tile goes back to all zeros; its buffer is freed once the frames in flight are done
+    void releaseTile(uint32_t tileIndex);
+    std::vector<TileRegion> splitIntoTiles(const vk::Rect2D& region) const;
+    // the canvas' pixels along `tileY`'s last row and `tileX`'s last column, `TILE_SIZE` if the
+    // tile lies within the canvas
+    vk::Extent2D getTileExtent(uint32_t tileX, uint32_t tileY) const;
+
+    // Tiles on the GPU: slots of `TILE_SIZE` x `TILE_SIZE` pixels in the layers of an image array,
+    // `ATLAS_LAYER_TILES` x `ATLAS_LAYER_TILES` slots to a layer. The atlas doubles its layers
+    // when it runs out of slots; the next command buffer to use the tiles copies the outgrown
+    // atlas into the new one, and retires it.
+    static constexpr uint32_t ATLAS_LAYER_TILES = 4; // also in the shaders
+    struct
     {
         vk::Image image = VK_NULL_HANDLE;
         vk::ImageView imageView = VK_NULL_HANDLE;
-        vk::DeviceMemory memory = VK_NULL_HANDLE;
-        bool needsUpdate = true; // whether the frame buffer needs to be staged, set to `true` when
-                                 // `_paintSpaceBuffer` is updated
+        VQAllocation memory;
+        uint32_t numLayers = 0;
+        std::vector<uint32_t> freeSlots;
+        bool initialized = false; // out of `eUndefined` layout, and holds `previous`' tiles
+
+        // the atlas outgrown since the tiles were last used
+        struct
+        {
+            vk::Image image = VK_NULL_HANDLE;
+            vk::ImageView imageView = VK_NULL_HANDLE;
+            VQAllocation memory;
+            uint32_t numLayers = 0;
+        } previous;
+    } _tileAtlas;
+
+    // for each tile, its slot in `_tileAtlas` + 1, or 0 if it was never painted on; flushed to
+    // the frame's buffer, the shaders look tiles up in it
+    std::vector<uint32_t> _tileTable;
+    std::array<VQBuffer, NUM_FRAME_IN_FLIGHT> _tileTableBuffers = {};
+    // the frame's descriptor sets are bound to an atlas or tile table buffer since replaced;
+    // rebound once the frame is no longer in flight
+    std::array<bool, NUM_FRAME_IN_FLIGHT> _tileDescriptorsOutdated = {};
+
+    // the atlas is initialized by `prepareTiles()`
+    void createTileAtlas(uint32_t numLayers);
+    void destroyTileAtlas();
+    void growTileAtlas();
+    void recordTileAtlasInit(vk::CommandBuffer cb);
+    // the atlas texel of the slot's top-left pixel, `z` being its layer
+    glm::uvec3 getSlotTexel(uint32_t slot) const;
+    void createTileTableBuffers();
+    void cleanupTileTableBuffers();
+    void flushTileTable(uint32_t frameIndex);
+    // binds the atlas and the frame's tile table buffer to its transform pass and GPU brush
+    void updateTileDescriptors(uint32_t frameIndex);
+    // brings the atlas, the frame's descriptors and its tile table up to date, before `cb`
+    // uses the tiles; the frame must no longer be in flight
+    void prepareTiles(vk::CommandBuffer cb, uint32_t frameIndex);
+    void recordPaintSpaceUpload(vk::CommandBuffer cb);
+
+    // a stroke painted with the GPU brush, i.e. one `brush()` call; laid out as `Segment` in
+    // `paint_strokes.comp` (std430)
+    struct StrokeSegment
+    {
+        glm::vec4 color; // RYGB
+        glm::ivec2 begin;
+        glm::ivec2 end;
+        uint32_t brushSize;
+        uint32_t brushType; // `BrushStrokeType`
+        uint32_t firstStamp; // `BrushKernels::Stamps`
+        uint32_t stampSpacing;
+    };
+
+    // ---------- GPU brush ----------
+    //
+    // Strokes are stamped into the tile atlas by a compute shader, batched per frame; the tiles'
+    // buffers fall behind and are only read back when the CPU needs the canvas, i.e. to save it
+    // or to paint on it with the CPU brush.
+
+    enum class StrokeBindingLocation : uint32_t
+    {
+        canvas = 0, // the tile atlas
+        segments = 1,
+        tileTable = 2
     };
 
-    std::array<PaintSpaceTexture, NUM_FRAME_IN_FLIGHT> _paintSpaceTexture;
-    void initPaintSpaceTexture(TetriumApp::InitContext& ctx);
-    void cleanupPaintSpaceTexture(TetriumApp::CleanupContext& ctx);
+    struct
+    {
+        bool supported = false; // the shader is built and the canvas format is storable
+        vk::PipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        vk::Pipeline pipeline = VK_NULL_HANDLE;
+
+        vk::DescriptorPool descriptorPool = VK_NULL_HANDLE;
+        vk::DescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+        std::array<vk::DescriptorSet, NUM_FRAME_IN_FLIGHT> descriptorSets = {};
+
+        // segments of each frame's last dispatch
+        std::array<VQBuffer, NUM_FRAME_IN_FLIGHT> segmentBuffers = {};
+    } _gpuBrushContext;
+
+    // painted with the GPU brush, not stamped into the atlas yet; stamped after staging
+    std::vector<StrokeSegment> _pendingSegments;
+    // strokes were painted on the GPU since the tiles' buffers were last current
+    bool _paintSpaceTilesStale = false;
+    VQDevice* _device = nullptr;
+    std::function<void(std::function<void()>&&)> _deferDeletion;
+    uint32_t _currentFrameInFlight = 0; // of the last tick
+
+    void initGpuBrushContext(TetriumApp::InitContext& ctx);
+    void cleanupGpuBrushContext(TetriumApp::CleanupContext& ctx);
+    // records the pending segments, as many as fit in one dispatch
+    void recordStrokes(vk::CommandBuffer cb, uint32_t frameIndex);
+    // reads the stale tiles back into their buffers, through the current frame's; waits for
+    // the read back, queued after the frames in flight
+    void syncPaintSpaceTiles();
 
     // ---------- View space(RGB+OCV) frame buffers ----------
 
     // Frame buffers are updated by applying the transformation matrices to the RYGB canvas,
     // after which they are sampled by ImGui backend as a texture for rendering.
+    // They view the canvas up to `MAX_VIEW_SIZE` pixels along either axis from `_viewOffset`,
+    // larger canvases are panned.
     std::array<TextureFrameBuffer, NUM_FRAME_IN_FLIGHT> _viewSpaceFrameBuffer;
+    static constexpr uint32_t MAX_VIEW_SIZE = 1024;
+    glm::ivec2 _viewOffset = glm::ivec2(0); // in canvas pixels
+    ScreenRect _viewScreenRect = {};
+    vk::Extent2D getViewExtent() const;
     void initViewSpaceFrameBuffer(TetriumApp::InitContext& ctx);
     void cleanupViewSpaceFrameBuffer(TetriumApp::CleanupContext& ctx);
+    // the frame's frame buffer catches up with a resized canvas; the frame must no longer be in
+    // flight
+    void resizeViewSpaceFrameBuffer(uint32_t frameIndex);
 
     // ---------- Paint to view space transformation context ----------
 
     enum class BindingLocation : uint32_t
     {
         ubo = 0,
-        sampler = 1
+        tileAtlas = 1,
+        tileTable = 2
     };
 
     struct UBO
@@ -149,12 +287,18 @@ class AppPainter : public App
         glm::mat4x3 transformMatrix;
     };
 
+    struct PushConstants
+    {
+        glm::ivec2 viewOffset;
+        uint32_t numTilesX;
+    };
+
     // Render pass that samples from the paint space fb
     // and transforms the colors to RGB and OCV color spaces.
     // the pass relies on a shader that renders onto a full-screen quad.
     //
     // The shader
-    // 1. samples from the paint space frame buffer as a texture
+    // 1. looks up the tile of each pixel of the view, and fetches the pixel from the tile atlas
     // 2. applies 4x4 transformation matrix
     // depending on the color space,
     struct
@@ -183,6 +327,7 @@ class AppPainter : public App
 
     // ---------- ImGui Runtime Logic ----------
 
+    // painted by `BrushKernels` on the CPU, in the same order as `BrushKernels::Shape`
     enum class BrushStrokeType : uint32_t
     {
         Circle = 0,
@@ -192,43 +337,57 @@ class AppPainter : public App
         BrushStrokeCount
     };
 
-    struct BrushStrokeArgs
-    {
-        uint32_t x;
-        uint32_t y;
-        std::array<float, 4> color;
-        uint32_t brushSize;
-        uint32_t canvasWidth;
-        uint32_t canvasHeight;
-        std::function<void(uint32_t, uint32_t, const std::array<float,4>&)> fillPixel;
-        std::function<std::array<float,4>(uint32_t, uint32_t)> getPixel;
-    };
-
-    static const std::array<std::function<void(const BrushStrokeArgs&)>,
-                       static_cast<size_t>(BrushStrokeType::BrushStrokeCount)>
-        brushStrokeArray;
-
     struct
     {
         std::optional<ImVec2> prevCanvasMousePos;
         uint32_t brushSize = 5;
         BrushStrokeType brushType = BrushStrokeType::Circle;
+        bool gpuBrush = true; // if supported, see `_gpuBrushContext`
+        float stampSpacing = 0.25f; // between stamps along a stroke, of the brush's diameter
+        uint32_t nextStamp = 0; // step of the next segment of the stroke its first stamp is on
     } _paintingState;
 
     void clearCanvas();
-
-    void flagTexturesForUpdate();
+    // keeps the tiles still on the canvas, cropped to it
+    void resizeCanvas(uint32_t width, uint32_t height);
+
+    // only `region` of the canvas was updated on the CPU, its tiles stage just that
+    void flagRegionForUpdate(const vk::Rect2D& region);
+    void flagRegionForUpdate(uint32_t tileIndex, const vk::Rect2D& region);
+    // the pixels a stroke can touch, clamped to the canvas
+    vk::Rect2D getStrokeBounds(
+        glm::ivec2 begin,
+        glm::ivec2 end,
+        uint32_t brushSize,
+        BrushStrokeType brushType
+    ) const;
+    // the tiles a stroke's swept width reaches, with the part of each it can touch; unlike
+    // splitting `getStrokeBounds()`, skips the tiles a diagonal stroke's bounds merely span
+    std::vector<TileRegion> splitStrokeIntoTiles(
+        glm::ivec2 begin,
+        glm::ivec2 end,
+        uint32_t brushSize,
+        BrushStrokeType brushType
+    ) const;
 
     // Drawing and brushstrokes
     void canvasInteract(const ImVec2& canvasMousePos);
     void brush(uint32_t xBegin, uint32_t yBegin, uint32_t xEnd, uint32_t yEnd);
-    void fillPixel(uint32_t x, uint32_t y, const std::array<float, 4>& color);
-    std::array<float, 4> getPixel(uint32_t x, uint32_t y) const;
+    // `row` is `_canvasWidth` pixels; tiles never painted on read as zeros, and are only
+    // allocated to write pixels that aren't
+    void readCanvasRow(uint32_t y, float* row) const;
+    void writeCanvasRow(uint32_t y, const float* row);
 
     // ---------- Serialization ----------
     // We serialize and de-serialize the canvas using the TIFF format,
     // the format supports 32-bit floating point values for up to 4 channels.
+    // Files named `.tetra` are `TetraImage`s instead, which the image viewer
+    // also opens; they keep the canvas at float16.
+    // Both are written and read a row at a time, through the tiles; loading resizes the canvas
+    // to the file's.
     void saveCanvasToFile(const std::string& filename);
     void loadCanvasFromFile(const std::string& filename);
+    void saveCanvasToTetraImage(const std::string& filename);
+    void loadCanvasFromTetraImage(const std::string& filename);
 };
 } // namespace TetriumApp
@@ -332,10 +332,30 @@ void AppScreeningTest::transitionSubjectState(
 )
 {
     switch (subject.state) {
-    case SubjectState::kFixation:
+    case SubjectState::kFixation: {
+        // hold the fixation page until the plate has streamed in
+        const uint32_t* plateHandles = subject.prompt.currentIshiharaPlateTextureHandle;
+        for (int i = 0; i < ColorSpace::ColorSpaceSize; i++) {
+            if (ctx.apis.IsTextureFailed(plateHandles[i])) {
+                FATAL(
+                    "Failed to load Ishihara plate {}",
+                    subject.prompt.currentIshiharaPlateTexturePath[i]
+                );
+            }
+        }
+        if (!ctx.apis.IsTextureReady(plateHandles[ColorSpace::RGB])
+            || !ctx.apis.IsTextureReady(plateHandles[ColorSpace::OCV])) {
+            subject.currStateRemainderTime = ImGui::GetIO().DeltaTime;
+            break;
+        }
+        for (int i = 0; i < ColorSpace::ColorSpaceSize; i++) {
+            subject.prompt.currentIshiharaPlateTexture[i]
+                = ctx.apis.GetImGuiTexture(plateHandles[i]);
+        }
         subject.currStateRemainderTime = SETTINGS.STATE_DURATIONS_SECONDS.IDENTIFICATION;
         subject.state = SubjectState::kIdentification;
         break;
+    }
     case SubjectState::kIdentification:
         subject.currStateRemainderTime = SETTINGS.STATE_DURATIONS_SECONDS.ANSWERING;
         subject.state = SubjectState::kAnswer;
@@ -456,17 +476,16 @@ void AppScreeningTest::populatePromptContext(
         ctx.apis.UnloadTexture(_subject.prompt.currentIshiharaPlateTextureHandle[ColorSpace::OCV]);
     }
 
+    // streamed in while the fixation page shows, see `transitionSubjectState`
+    _subject.prompt.currentIshiharaPlateTexturePath[ColorSpace::RGB] = rgbTexturePath;
+    _subject.prompt.currentIshiharaPlateTexturePath[ColorSpace::OCV] = ocvTexturePath;
     _subject.prompt.currentIshiharaPlateTextureHandle[ColorSpace::RGB]
-        = ctx.apis.LoadTexture(rgbTexturePath);
+        = ctx.apis.LoadTextureAsync(rgbTexturePath);
     _subject.prompt.currentIshiharaPlateTextureHandle[ColorSpace::OCV]
-        = ctx.apis.LoadTexture(ocvTexturePath);
+        = ctx.apis.LoadTextureAsync(ocvTexturePath);
 
-    _subject.prompt.currentIshiharaPlateTexture[ColorSpace::RGB] = ctx.apis.InitImGuiTexture(
-        _subject.prompt.currentIshiharaPlateTextureHandle[ColorSpace::RGB]
-    );
-    _subject.prompt.currentIshiharaPlateTexture[ColorSpace::OCV] = ctx.apis.InitImGuiTexture(
-        _subject.prompt.currentIshiharaPlateTextureHandle[ColorSpace::OCV]
-    );
+    ctx.apis.InitImGuiTexture(_subject.prompt.currentIshiharaPlateTextureHandle[ColorSpace::RGB]);
+    ctx.apis.InitImGuiTexture(_subject.prompt.currentIshiharaPlateTextureHandle[ColorSpace::OCV]);
 
     // populate answer textures -- they're pre-generated
     for (int i = 0; i < 4; i++) {
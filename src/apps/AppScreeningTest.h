@@ -54,6 +54,7 @@ class AppScreeningTest : public App
     struct SubjectPromptContext
     {
         uint32_t currentIshiharaPlateTextureHandle[ColorSpace::ColorSpaceSize] = {};
+        std::string currentIshiharaPlateTexturePath[ColorSpace::ColorSpaceSize];
         ImGuiTexture currentIshiharaPlateTexture[ColorSpace::ColorSpaceSize];
         uint32_t currentAnswerTextureHandle[4];
         ImGuiTexture currentAnswerTexture[4];
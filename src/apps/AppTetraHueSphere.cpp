@@ -218,6 +218,7 @@ void AppTetraHueSphere::TickVulkan(TetriumApp::TickContextVulkan& ctx)
     }
 
     auto CB = ctx.commandBuffer;
+    PROFILE_GPU_SCOPE(ctx.gpuProfiler, CB, "Hue Sphere: Rasterization");
     RenderContext& renderCtx = _renderContexts[ctx.currentFrameInFlight];
     // render to the correct framebuffer&texture
 
@@ -298,8 +299,7 @@ void AppTetraHueSphere::cleanupRenderContext(
 void AppTetraHueSphere::initRenderContext(RenderContext& ctx, TetriumApp::InitContext& initCtx)
 {
     ctx.fb.Init(
-        initCtx.device.logicalDevice,
-        initCtx.device.physicalDevice,
+        initCtx.device,
         _renderPass,
         FB_WIDTH,
         FB_HEIGHT,
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "AppImageViewer.h"
+#include "AppPainter.h"
+#include "AppScreeningTest.h"
+#include "AppTetraHueSphere.h"
+
+namespace TetriumApp
+{
+// Apps shipped with the engine, as {app, app name} pairs.
+// Shared by Tetrium and TetriumBench so both run the same set of apps.
+// Caller owns the returned apps.
+inline std::vector<std::pair<App*, const char*>> CreateDefaultApps()
+{
+    return {
+        {new AppScreeningTest(), "Screening Test"},
+        {new AppTetraHueSphere(), "Tetra Hue Sphere"},
+        {new AppImageViewer(), "Image Viewer"},
+        {new AppPainter(), "Painter"},
+    };
+}
+} // namespace TetriumApp
@@ -3,8 +3,7 @@
 #include "lib/VulkanUtils.h"
 
 void TextureFrameBuffer::Init(
-    vk::Device device,
-    vk::PhysicalDevice physicalDevice,
+    VQDevice& vqDevice,
     vk::RenderPass renderPass,
     uint32_t width,
     uint32_t height,
@@ -13,11 +12,13 @@ void TextureFrameBuffer::Init(
     bool createImguiTexture
 )
 {
+    vk::Device device = vqDevice.logicalDevice;
+    _vqDevice = &vqDevice;
     _device = device;
-    _physicalDevice = physicalDevice;
     _renderPass = renderPass;
     _imageFormat = imageFormat;
     _depthFormat = depthFormat;
+    _extent = vk::Extent2D(width, height);
 
     // Create color image & image view
     VulkanUtils::createImage(
@@ -29,8 +30,7 @@ void TextureFrameBuffer::Init(
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         _deviceImage.image,
         _deviceImage.memory,
-        physicalDevice,
-        device
+        vqDevice
     );
     _deviceImage.view = VulkanUtils::createImageView(
         _deviceImage.image, device, imageFormat, VK_IMAGE_ASPECT_COLOR_BIT
@@ -46,8 +46,7 @@ void TextureFrameBuffer::Init(
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         _depthImage.image,
         _depthImage.memory,
-        physicalDevice,
-        device
+        vqDevice
     );
     _depthImage.view = VulkanUtils::createImageView(
         _depthImage.image, device, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT
@@ -98,14 +97,14 @@ void TextureFrameBuffer::Cleanup()
     _device.destroySampler(_sampler);
     _device.destroyImageView(_deviceImage.view);
     _device.destroyImage(_deviceImage.image);
-    _device.freeMemory(_deviceImage.memory);
+    _vqDevice->memoryAllocator.Free(_deviceImage.memory);
     _device.destroyImageView(_depthImage.view);
     _device.destroyImage(_depthImage.image);
-    _device.freeMemory(_depthImage.memory);
+    _vqDevice->memoryAllocator.Free(_depthImage.memory);
 }
 
 void TextureFrameBuffer::Resize(uint32_t width, uint32_t height)
 {
     Cleanup();
-    Init(_device, _physicalDevice, _renderPass, width, height, _imageFormat, _depthFormat);
+    Init(*_vqDevice, _renderPass, width, height, _imageFormat, _depthFormat);
 }
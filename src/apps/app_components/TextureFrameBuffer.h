@@ -9,8 +9,7 @@ class TextureFrameBuffer
 {
   public:
     void Init(
-        vk::Device device,
-        vk::PhysicalDevice physicalDevice,
+        VQDevice& device,
         vk::RenderPass renderPass,
         uint32_t width,
         uint32_t height,
@@ -24,6 +23,8 @@ class TextureFrameBuffer
 
     void* GetImGuiTextureId() const { return _imguiTextureId; }
 
+    vk::Extent2D GetExtent() const { return _extent; }
+
     void Resize(uint32_t width, uint32_t height);
 
   private:
@@ -32,10 +33,11 @@ class TextureFrameBuffer
     VQDeviceImage _deviceImage;
     VQDeviceImage _depthImage;
     void* _imguiTextureId = nullptr;
+    vk::Extent2D _extent;
 
     // context for fb re-creation
+    VQDevice* _vqDevice = nullptr;
     vk::Device _device;
-    vk::PhysicalDevice _physicalDevice;
     vk::RenderPass _renderPass;
     VkFormat _imageFormat;
     VkFormat _depthFormat;
@@ -0,0 +1,536 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+#include "VirtualTexture.h"
+#include "backends/imgui_impl_vulkan.h"
+#include "lib/VulkanUtils.h"
+
+namespace
+{
+using TiledImage::TILE_BORDER;
+using TiledImage::TILE_BYTES;
+using TiledImage::TILE_SIZE;
+using TiledImage::TILE_STRIDE;
+
+// the atlas is at most 8192 x 4096 texels, 128 MiB, or as large as the device allows
+const uint32_t MAX_ATLAS_SLOTS_X = 32;
+const uint32_t MAX_ATLAS_SLOTS_Y = 16;
+// tiles staged per frame; bounds the staging buffers and the time spent copying in `Draw()`
+const uint32_t MAX_UPLOADS_PER_FRAME = 16;
+// tiles read ahead of staging, the worker waits for them to be staged beyond it
+const uint32_t MAX_LOADED_TILES = 2 * MAX_UPLOADS_PER_FRAME;
+
+// tiles of `level` covering [`imageMin`, `imageMax`], given in full resolution texels
+struct TileRange
+{
+    uint32_t x0, y0, x1, y1; // inclusive
+};
+
+ImVec2 getLevelScale(const TiledImage::Layout& layout, uint32_t level)
+{
+    const TiledImage::Level& l = layout.levels[level];
+    return ImVec2(
+        static_cast<float>(l.width) / layout.width, static_cast<float>(l.height) / layout.height
+    );
+}
+
+TileRange getTileRange(
+    const TiledImage::Layout& layout,
+    uint32_t level,
+    ImVec2 imageMin,
+    ImVec2 imageMax
+)
+{
+    const TiledImage::Level& l = layout.levels[level];
+    ImVec2 min = imageMin * getLevelScale(layout, level);
+    ImVec2 max = imageMax * getLevelScale(layout, level);
+    auto lastTile = [](float end, uint32_t numTiles) {
+        uint32_t lastTexel = std::max(1.f, std::ceil(end)) - 1;
+        return std::min(lastTexel / TILE_SIZE, numTiles - 1);
+    };
+    return TileRange{
+        .x0 = std::min(static_cast<uint32_t>(min.x) / TILE_SIZE, l.tilesX - 1),
+        .y0 = std::min(static_cast<uint32_t>(min.y) / TILE_SIZE, l.tilesY - 1),
+        .x1 = lastTile(max.x, l.tilesX),
+        .y1 = lastTile(max.y, l.tilesY)};
+}
+} // namespace
+
+VirtualTexture::TileKey VirtualTexture::makeKey(
+    ColorSpace plane,
+    uint32_t level,
+    uint32_t x,
+    uint32_t y
+)
+{
+    return static_cast<TileKey>(plane) << 56 | static_cast<TileKey>(level) << 48
+           | static_cast<TileKey>(x) << 24 | y;
+}
+
+void VirtualTexture::Init(VQDevice& device)
+{
+    _device = &device;
+
+    uint32_t maxSlots = device.properties.limits.maxImageDimension2D / TILE_STRIDE;
+    _slotsX = std::min(maxSlots, MAX_ATLAS_SLOTS_X);
+    uint32_t slotsY = std::min(maxSlots, MAX_ATLAS_SLOTS_Y);
+    _atlasExtent = vk::Extent2D(_slotsX * TILE_STRIDE, slotsY * TILE_STRIDE);
+    _slots.resize(_slotsX * slotsY);
+
+    VulkanUtils::createImage(
+        _atlasExtent.width,
+        _atlasExtent.height,
+        VK_FORMAT_R8G8B8A8_SRGB,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        _atlas.image,
+        _atlas.memory,
+        device
+    );
+    _atlas.view = VulkanUtils::createImageView(
+        _atlas.image, device.logicalDevice, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT
+    );
+
+    // texels outside of a tile's border are never sampled, filtering stays within slots
+    vk::SamplerCreateInfo samplerInfo(
+        {},
+        vk::Filter::eLinear,
+        vk::Filter::eLinear,
+        vk::SamplerMipmapMode::eNearest,
+        vk::SamplerAddressMode::eClampToEdge,
+        vk::SamplerAddressMode::eClampToEdge,
+        vk::SamplerAddressMode::eClampToEdge
+    );
+    _sampler = vk::Device(device.logicalDevice).createSampler(samplerInfo);
+    _imguiTextureId = ImGui_ImplVulkan_AddTexture(
+        _sampler, _atlas.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    );
+
+    for (VQBuffer& staging : _staging) {
+        device.CreateBufferInPlace(
+            MAX_UPLOADS_PER_FRAME * TILE_BYTES,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            staging
+        );
+    }
+
+    _quit = false;
+    _worker = std::thread(&VirtualTexture::workerLoop, this);
+}
+
+void VirtualTexture::Cleanup()
+{
+    Close();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+    }
+    _cv.notify_all();
+    _worker.join();
+
+    vk::Device device(_device->logicalDevice);
+    ImGui_ImplVulkan_RemoveTexture(reinterpret_cast<VkDescriptorSet>(_imguiTextureId));
+    device.destroySampler(_sampler);
+    device.destroyImageView(_atlas.view);
+    device.destroyImage(_atlas.image);
+    _device->memoryAllocator.Free(_atlas.memory);
+    for (VQBuffer& staging : _staging) {
+        staging.Cleanup();
+    }
+}
+
+bool VirtualTexture::Open(const std::string& path)
+{
+    Close();
+    return _reader.Open(path);
+}
+
+void VirtualTexture::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _generation++;
+        for (std::vector<TileKey>& requests : _requests) {
+            requests.clear();
+        }
+        _loaded.clear();
+        _unreadable.clear();
+    }
+    _reader.Close();
+
+    // slots are overwritten behind barriers, frames in flight keep drawing what they hold
+    _pageTable.clear();
+    for (__Slot& slot : _slots) {
+        slot = __Slot{};
+    }
+    for (std::vector<__Upload>& uploads : _uploads) {
+        uploads.clear();
+    }
+}
+
+void VirtualTexture::Draw(
+    ImDrawList* drawList,
+    ColorSpace plane,
+    ImVec2 origin,
+    float scale,
+    ImVec2 clipMin,
+    ImVec2 clipMax,
+    int frameInFlight
+)
+{
+    if (!IsOpen()) {
+        return;
+    }
+    _frame++;
+    const TiledImage::Layout& layout = _reader.GetLayout();
+
+    // staged by the last use of the staging buffer, whose frame didn't record its uploads
+    for (const __Upload& upload : _uploads[frameInFlight]) {
+        freeSlot(upload.slot);
+    }
+    _uploads[frameInFlight].clear();
+
+    // visible part of the image, in full resolution texels
+    ImVec2 imageMin = (clipMin - origin) / scale;
+    ImVec2 imageMax = (clipMax - origin) / scale;
+    imageMin = ImVec2(std::max(imageMin.x, 0.f), std::max(imageMin.y, 0.f));
+    imageMax = ImVec2(
+        std::min<float>(imageMax.x, layout.width), std::min<float>(imageMax.y, layout.height)
+    );
+    if (imageMin.x >= imageMax.x || imageMin.y >= imageMax.y) {
+        return;
+    }
+
+    // the level whose texels are the closest in size to screen pixels
+    int numLevels = layout.levels.size();
+    uint32_t level = std::clamp<int>(std::lround(std::log2(1.f / scale)), 0, numLevels - 1);
+
+    updateRequests(plane, level, imageMin, imageMax);
+    stageLoadedTiles(frameInFlight);
+
+    TileRange range = getTileRange(layout, level, imageMin, imageMax);
+    drawList->PushClipRect(clipMin, clipMax, true);
+    for (uint32_t y = range.y0; y <= range.y1; y++) {
+        for (uint32_t x = range.x0; x <= range.x1; x++) {
+            drawTile(drawList, plane, level, x, y, origin, scale);
+        }
+    }
+    drawList->PopClipRect();
+}
+
+// feedback pass: wants the tiles in view at `level` and their ancestors, keeps those that have
+// a slot and asks the worker for the others
+void VirtualTexture::updateRequests(
+    ColorSpace plane,
+    uint32_t level,
+    ImVec2 imageMin,
+    ImVec2 imageMax
+)
+{
+    const TiledImage::Layout& layout = _reader.GetLayout();
+    std::vector<TileKey> wanted;
+    // coarsest first, so that every part of the view has something to show soonest
+    for (int l = layout.levels.size() - 1; l >= static_cast<int>(level); l--) {
+        TileRange range = getTileRange(layout, l, imageMin, imageMax);
+        ImVec2 center = (imageMin + imageMax) * 0.5f * getLevelScale(layout, l) / TILE_SIZE;
+        std::vector<std::pair<float, TileKey>> missing; // by distance to the view center
+        for (uint32_t y = range.y0; y <= range.y1; y++) {
+            for (uint32_t x = range.x0; x <= range.x1; x++) {
+                TileKey key = makeKey(plane, l, x, y);
+                auto it = _pageTable.find(key);
+                if (it != _pageTable.end()) {
+                    _slots[it->second].lastUsedFrame = _frame;
+                    continue;
+                }
+                float dx = x + 0.5f - center.x;
+                float dy = y + 0.5f - center.y;
+                missing.emplace_back(dx * dx + dy * dy, key);
+            }
+        }
+        std::sort(missing.begin(), missing.end());
+        for (const auto& [distance, key] : missing) {
+            wanted.push_back(key);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    // the other plane's requests stand until its next frame
+    std::vector<TileKey>& requests = _requests[plane];
+    requests.clear();
+    for (auto it = wanted.rbegin(); it != wanted.rend(); it++) {
+        TileKey key = *it;
+        bool loaded = std::any_of(_loaded.begin(), _loaded.end(), [key](const __LoadedTile& tile) {
+            return tile.key == key;
+        });
+        if (key != _reading && !loaded && !_unreadable.contains(key)) {
+            requests.push_back(key);
+        }
+    }
+    _cv.notify_all();
+}
+
+void VirtualTexture::stageLoadedTiles(int frameInFlight)
+{
+    std::vector<__LoadedTile> loaded;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        size_t numStaged = std::min<size_t>(_loaded.size(), MAX_UPLOADS_PER_FRAME);
+        std::move(_loaded.begin(), _loaded.begin() + numStaged, std::back_inserter(loaded));
+        _loaded.erase(_loaded.begin(), _loaded.begin() + numStaged);
+        _cv.notify_all();
+    }
+
+    std::vector<__Upload>& uploads = _uploads[frameInFlight];
+    uint8_t* staging = static_cast<uint8_t*>(_staging[frameInFlight].bufferAddress);
+    for (__LoadedTile& tile : loaded) {
+        if (_pageTable.contains(tile.key)) {
+            continue;
+        }
+        std::optional<uint32_t> slot = allocateSlot();
+        if (!slot) { // all in view, the rest is asked for again once tiles leave it
+            break;
+        }
+        memcpy(staging + uploads.size() * TILE_BYTES, tile.texels.data(), TILE_BYTES);
+        _slots[*slot] = __Slot{.key = tile.key, .resident = false, .lastUsedFrame = _frame};
+        _pageTable[tile.key] = *slot;
+        uploads.push_back({*slot, tile.key});
+    }
+}
+
+// a free slot, or the slot of the least recently drawn tile
+std::optional<uint32_t> VirtualTexture::allocateSlot()
+{
+    std::optional<uint32_t> victim;
+    for (uint32_t i = 0; i < _slots.size(); i++) {
+        const __Slot& slot = _slots[i];
+        if (slot.key == INVALID_KEY) {
+            return i;
+        }
+        // in view for either color space, whose frames alternate
+        if (!slot.resident || slot.lastUsedFrame + ColorSpace::ColorSpaceSize > _frame) {
+            continue;
+        }
+        if (!victim || slot.lastUsedFrame < _slots[*victim].lastUsedFrame) {
+            victim = i;
+        }
+    }
+    if (victim) {
+        freeSlot(*victim);
+    }
+    return victim;
+}
+
+void VirtualTexture::freeSlot(uint32_t slot)
+{
+    _pageTable.erase(_slots[slot].key);
+    _slots[slot] = __Slot{};
+}
+
+// Draws tile (`x`, `y`) of `level` from the finest level at which both planes have it, so that
+// the two halves of the tetra image always match.
+void VirtualTexture::drawTile(
+    ImDrawList* drawList,
+    ColorSpace plane,
+    uint32_t level,
+    uint32_t x,
+    uint32_t y,
+    ImVec2 origin,
+    float scale
+)
+{
+    const TiledImage::Layout& layout = _reader.GetLayout();
+    const TiledImage::Level& tileLevel = layout.levels[level];
+    ImVec2 levelToImage = ImVec2(1.f, 1.f) / getLevelScale(layout, level);
+    ImVec2 tileMin = ImVec2(x * TILE_SIZE, y * TILE_SIZE) * levelToImage;
+    ImVec2 tileMax = ImVec2(
+                         std::min((x + 1) * TILE_SIZE, tileLevel.width),
+                         std::min((y + 1) * TILE_SIZE, tileLevel.height)
+                     )
+                     * levelToImage;
+
+    for (uint32_t l = level; l < layout.levels.size(); l++) {
+        uint32_t ancestorX = x >> (l - level);
+        uint32_t ancestorY = y >> (l - level);
+        bool resident = true;
+        for (int p = 0; p < ColorSpace::ColorSpaceSize; p++) {
+            auto it = _pageTable.find(makeKey(static_cast<ColorSpace>(p), l, ancestorX, ancestorY));
+            resident &= it != _pageTable.end() && _slots[it->second].resident;
+        }
+        if (!resident) {
+            continue;
+        }
+        uint32_t slot = _pageTable.at(makeKey(plane, l, ancestorX, ancestorY));
+        _slots[slot].lastUsedFrame = _frame;
+
+        // the tile's corners in texels of the ancestor's slot
+        ImVec2 ancestorScale = getLevelScale(layout, l);
+        ImVec2 ancestorOrigin = ImVec2(ancestorX * TILE_SIZE, ancestorY * TILE_SIZE);
+        ImVec2 slotOrigin = ImVec2(
+            (slot % _slotsX) * TILE_STRIDE + TILE_BORDER,
+            (slot / _slotsX) * TILE_STRIDE + TILE_BORDER
+        );
+        ImVec2 texelMin = slotOrigin + tileMin * ancestorScale - ancestorOrigin;
+        ImVec2 texelMax = slotOrigin + tileMax * ancestorScale - ancestorOrigin;
+        ImVec2 atlasSize = ImVec2(_atlasExtent.width, _atlasExtent.height);
+        drawList->AddImage(
+            _imguiTextureId,
+            origin + tileMin * scale,
+            origin + tileMax * scale,
+            texelMin / atlasSize,
+            texelMax / atlasSize
+        );
+        return;
+    }
+}
+
+void VirtualTexture::RecordUploads(vk::CommandBuffer cb, int frameInFlight)
+{
+    std::vector<__Upload>& uploads = _uploads[frameInFlight];
+    if (uploads.empty()) {
+        return;
+    }
+
+    // slots being overwritten may have been drawn by earlier frames still in flight; the
+    // barrier orders the copies after all previously submitted fragment shading
+    vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+    vk::ImageMemoryBarrier toTransfer(
+        {},
+        vk::AccessFlagBits::eTransferWrite,
+        _atlasInitialized ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::eUndefined,
+        vk::ImageLayout::eTransferDstOptimal,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        _atlas.image,
+        range
+    );
+    cb.pipelineBarrier(
+        vk::PipelineStageFlagBits::eFragmentShader,
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::DependencyFlags(),
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &toTransfer
+    );
+
+    std::vector<vk::BufferImageCopy> regions;
+    for (size_t i = 0; i < uploads.size(); i++) {
+        uint32_t slot = uploads[i].slot;
+        regions.emplace_back(
+            i * TILE_BYTES,
+            0,
+            0,
+            vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+            vk::Offset3D((slot % _slotsX) * TILE_STRIDE, (slot / _slotsX) * TILE_STRIDE, 0),
+            vk::Extent3D(TILE_STRIDE, TILE_STRIDE, 1)
+        );
+    }
+    cb.copyBufferToImage(
+        _staging[frameInFlight].buffer,
+        _atlas.image,
+        vk::ImageLayout::eTransferDstOptimal,
+        regions.size(),
+        regions.data()
+    );
+
+    vk::ImageMemoryBarrier toShader(
+        vk::AccessFlagBits::eTransferWrite,
+        vk::AccessFlagBits::eShaderRead,
+        vk::ImageLayout::eTransferDstOptimal,
+        vk::ImageLayout::eShaderReadOnlyOptimal,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        _atlas.image,
+        range
+    );
+    cb.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eFragmentShader,
+        vk::DependencyFlags(),
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &toShader
+    );
+    _atlasInitialized = true;
+
+    for (const __Upload& upload : uploads) {
+        _slots[upload.slot].resident = true;
+    }
+    _numUploads += uploads.size();
+    uploads.clear();
+}
+
+VirtualTexture::Stats VirtualTexture::GetStats()
+{
+    Stats stats{.numSlots = static_cast<uint32_t>(_slots.size()), .numUploads = _numUploads};
+    stats.numResidentTiles = std::count_if(_slots.begin(), _slots.end(), [](const __Slot& slot) {
+        return slot.resident;
+    });
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const std::vector<TileKey>& requests : _requests) {
+        stats.numRequestedTiles += requests.size();
+    }
+    return stats;
+}
+
+void VirtualTexture::workerLoop()
+{
+    auto hasRequests = [this] {
+        return std::any_of(_requests.begin(), _requests.end(), [](const auto& requests) {
+            return !requests.empty();
+        });
+    };
+
+    while (true) {
+        TileKey key;
+        uint64_t generation;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [&] {
+                return _quit || (hasRequests() && _loaded.size() < MAX_LOADED_TILES);
+            });
+            if (_quit) {
+                return;
+            }
+            // alternate between the planes, which are in view on alternating frames
+            while (_requests[_nextPlane].empty()) {
+                _nextPlane = (_nextPlane + 1) % ColorSpace::ColorSpaceSize;
+            }
+            key = _requests[_nextPlane].back();
+            _requests[_nextPlane].pop_back();
+            _nextPlane = (_nextPlane + 1) % ColorSpace::ColorSpaceSize;
+            _reading = key;
+            generation = _generation;
+        }
+
+        std::vector<uint8_t> texels(TILE_BYTES);
+        bool read = _reader.ReadTile(
+            static_cast<ColorSpace>(key >> 56),
+            (key >> 48) & 0xff,
+            (key >> 24) & 0xffffff,
+            key & 0xffffff,
+            texels.data()
+        );
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _reading = INVALID_KEY;
+        if (generation != _generation) { // the image was closed meanwhile
+            continue;
+        }
+        if (!read) {
+            WARN("Failed to read tile {:x} of a tiled image", key);
+            _unreadable.insert(key);
+            continue;
+        }
+        _loaded.push_back({key, std::move(texels)});
+    }
+}
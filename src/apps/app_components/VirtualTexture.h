@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "imgui.h"
+
+#include "lib/TiledImage.h"
+#include "lib/VQBuffer.h"
+#include "lib/VQDeviceImage.h"
+
+// Shows a `TiledImage` of any size through ImGui, by paging in only the tiles it is drawn with.
+//
+// Tiles live in slots of an atlas texture shared by both color spaces' planes, and are drawn as
+// one ImGui quad each. Every `Draw()` is also the feedback pass: the tiles of the visible part at
+// the level matching the zoom, and their coarser ancestors, replace the requests of the previous
+// frame, coarsest first and then nearest to the view center first. A worker thread reads
+// requested tiles from disk, the next `Draw()`s stage them and `RecordUploads()` copies them into
+// the slots of the least recently drawn tiles, to be drawn from the frame after. Tiles that
+// aren't in yet are drawn from the closest resident ancestor, upscaled.
+class VirtualTexture
+{
+  public:
+    struct Stats
+    {
+        uint32_t numSlots;
+        uint32_t numResidentTiles;
+        uint32_t numRequestedTiles; // waiting to be read
+        uint64_t numUploads;
+    };
+
+    void Init(VQDevice& device);
+    void Cleanup();
+
+    // closes the image that is open, if any; false if `path` can't be read
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return _reader.IsOpen(); }
+
+    uint32_t GetWidth() const { return _reader.GetLayout().width; }
+    uint32_t GetHeight() const { return _reader.GetLayout().height; }
+
+    // Draws `plane` onto `drawList` with texel (0, 0) of the image at `origin`, each texel
+    // covering `scale` screen pixels, clipped to [`clipMin`, `clipMax`]. Call once per frame
+    // from `TickImGui()`, before the frame's `RecordUploads()`.
+    void Draw(
+        ImDrawList* drawList,
+        ColorSpace plane,
+        ImVec2 origin,
+        float scale,
+        ImVec2 clipMin,
+        ImVec2 clipMax,
+        int frameInFlight
+    );
+
+    // records the copies of the tiles staged by this frame's `Draw()`, from `TickVulkan()`
+    void RecordUploads(vk::CommandBuffer cb, int frameInFlight);
+
+    Stats GetStats();
+
+  private:
+    using TileKey = uint64_t; // plane, level, x and y of a tile
+    static constexpr TileKey INVALID_KEY = UINT64_MAX;
+
+    struct __Slot
+    {
+        TileKey key = INVALID_KEY;
+        bool resident = false; // copied into the atlas, otherwise staged or free
+        uint64_t lastUsedFrame = 0;
+    };
+
+    struct __Upload
+    {
+        uint32_t slot;
+        TileKey key;
+    };
+
+    struct __LoadedTile
+    {
+        TileKey key;
+        std::vector<uint8_t> texels;
+    };
+
+    static TileKey makeKey(ColorSpace plane, uint32_t level, uint32_t x, uint32_t y);
+
+    void workerLoop();
+
+    void updateRequests(ColorSpace plane, uint32_t level, ImVec2 imageMin, ImVec2 imageMax);
+    void stageLoadedTiles(int frameInFlight);
+    std::optional<uint32_t> allocateSlot();
+    void freeSlot(uint32_t slot);
+    void drawTile(
+        ImDrawList* drawList,
+        ColorSpace plane,
+        uint32_t level,
+        uint32_t x,
+        uint32_t y,
+        ImVec2 origin,
+        float scale
+    );
+
+    VQDevice* _device = nullptr;
+    VQDeviceImage _atlas;
+    vk::Sampler _sampler;
+    void* _imguiTextureId = nullptr;
+    bool _atlasInitialized = false; // has left `VK_IMAGE_LAYOUT_UNDEFINED`
+    vk::Extent2D _atlasExtent;
+    uint32_t _slotsX = 0; // slots per atlas row
+
+    std::vector<__Slot> _slots;
+    std::unordered_map<TileKey, uint32_t> _pageTable; // tiles that have a slot -> their slot
+    uint64_t _frame = 0;                               // counts `Draw()`
+    uint64_t _numUploads = 0;
+
+    std::array<VQBuffer, NUM_FRAME_IN_FLIGHT> _staging;
+    std::array<std::vector<__Upload>, NUM_FRAME_IN_FLIGHT> _uploads; // staged, not yet recorded
+
+    TiledImage::Reader _reader;
+
+    std::thread _worker;
+    std::mutex _mutex; // guards the members below
+    std::condition_variable _cv;
+    // per plane, the next to read last
+    std::array<std::vector<TileKey>, ColorSpace::ColorSpaceSize> _requests;
+    int _nextPlane = 0;             // whose requests the worker reads next
+    TileKey _reading = INVALID_KEY; // by the worker
+    std::unordered_set<TileKey> _unreadable; // not asked for again
+    std::vector<__LoadedTile> _loaded; // waiting to be staged, in the order they were read
+    uint64_t _generation = 0;          // bumped by `Close()`, to discard tiles of other images
+    bool _quit = false;
+};
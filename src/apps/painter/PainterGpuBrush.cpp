@@ -0,0 +1,327 @@
+// GPU brush: stroke segments are batched per frame and stamped into the tile atlas by a compute
+// shader
+
+#include <cstring>
+#include <filesystem>
+
+#include "apps/AppPainter.h"
+#include "components/ShaderUtils.h"
+
+namespace TetriumApp
+{
+namespace
+{
+const char* STROKE_SHADER_PATH = "../assets/apps/AppPainter/shaders/paint_strokes.comp.spv";
+const uint32_t STROKE_GROUP_SIZE = 16; // `local_size_x/y` of the shader
+// segments per dispatch, the rest wait for the next frame
+const uint32_t MAX_STROKE_SEGMENTS_PER_DISPATCH = 1024;
+
+struct StrokePushConstants
+{
+    glm::ivec2 origin; // of the dispatch, in canvas pixels
+    glm::ivec2 canvasSize;
+    uint32_t numSegments;
+    uint32_t numTilesX;
+};
+} // namespace
+
+void AppPainter::initGpuBrushContext(TetriumApp::InitContext& ctx)
+{
+    static_assert(sizeof(StrokeSegment) == 48, "must match the std430 layout of the shader");
+    if (!std::filesystem::exists(STROKE_SHADER_PATH)) {
+        WARN("{} not found, run compile_shaders.py to build it", STROKE_SHADER_PATH);
+        WARN("Painting on the CPU");
+        return;
+    }
+    vk::Device device = ctx.device.logicalDevice;
+
+    for (VQBuffer& segmentBuffer : _gpuBrushContext.segmentBuffers) {
+        ctx.device.CreateBufferInPlace(
+            MAX_STROKE_SEGMENTS_PER_DISPATCH * sizeof(StrokeSegment),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            segmentBuffer
+        );
+    }
+
+    /* create descriptor pool */
+    {
+        vk::DescriptorPoolSize poolSizes[]
+            = {{vk::DescriptorType::eStorageImage, NUM_FRAME_IN_FLIGHT},
+               {vk::DescriptorType::eStorageBuffer, NUM_FRAME_IN_FLIGHT * 2}};
+        vk::DescriptorPoolCreateInfo poolCreateInfo({}, NUM_FRAME_IN_FLIGHT, 2, poolSizes);
+        _gpuBrushContext.descriptorPool = device.createDescriptorPool(poolCreateInfo);
+    }
+
+    /* create descriptor set layout */
+    {
+        std::array<vk::DescriptorSetLayoutBinding, 3> bindings
+            = {vk::DescriptorSetLayoutBinding(
+                   (uint32_t)StrokeBindingLocation::canvas,
+                   vk::DescriptorType::eStorageImage,
+                   1,
+                   vk::ShaderStageFlagBits::eCompute,
+                   nullptr
+               ),
+               vk::DescriptorSetLayoutBinding(
+                   (uint32_t)StrokeBindingLocation::segments,
+                   vk::DescriptorType::eStorageBuffer,
+                   1,
+                   vk::ShaderStageFlagBits::eCompute,
+                   nullptr
+               ),
+               vk::DescriptorSetLayoutBinding(
+                   (uint32_t)StrokeBindingLocation::tileTable,
+                   vk::DescriptorType::eStorageBuffer,
+                   1,
+                   vk::ShaderStageFlagBits::eCompute,
+                   nullptr
+               )};
+        vk::DescriptorSetLayoutCreateInfo createInfo({}, bindings.size(), bindings.data());
+        _gpuBrushContext.descriptorSetLayout = device.createDescriptorSetLayout(createInfo);
+    }
+
+    /* allocate and update descriptor sets, one per frame in flight */
+    {
+        std::vector<vk::DescriptorSetLayout> layouts(
+            NUM_FRAME_IN_FLIGHT, _gpuBrushContext.descriptorSetLayout
+        );
+        vk::DescriptorSetAllocateInfo allocateInfo(
+            _gpuBrushContext.descriptorPool, NUM_FRAME_IN_FLIGHT, layouts.data()
+        );
+        std::vector<vk::DescriptorSet> sets = device.allocateDescriptorSets(allocateInfo);
+        ASSERT(sets.size() == _gpuBrushContext.descriptorSets.size());
+        for (size_t i = 0; i < sets.size(); i++) {
+            _gpuBrushContext.descriptorSets[i] = sets[i];
+
+            // the atlas and the tile table are bound by `updateTileDescriptors()`
+            vk::DescriptorBufferInfo bufferInfo(
+                _gpuBrushContext.segmentBuffers[i].buffer, 0, VK_WHOLE_SIZE
+            );
+            device.updateDescriptorSets(
+                vk::WriteDescriptorSet(
+                    sets[i],
+                    (uint32_t)StrokeBindingLocation::segments,
+                    0,
+                    1,
+                    vk::DescriptorType::eStorageBuffer,
+                    nullptr,
+                    &bufferInfo,
+                    nullptr
+                ),
+                nullptr
+            );
+        }
+    }
+
+    /* create pipeline */
+    {
+        vk::PushConstantRange pushConstantRange(
+            vk::ShaderStageFlagBits::eCompute, 0, sizeof(StrokePushConstants)
+        );
+        vk::PipelineLayoutCreateInfo pipelineLayoutInfo(
+            {}, 1, &_gpuBrushContext.descriptorSetLayout, 1, &pushConstantRange
+        );
+        _gpuBrushContext.pipelineLayout = device.createPipelineLayout(pipelineLayoutInfo);
+
+        vk::ShaderModule shaderModule
+            = ShaderCreation::createShaderModule(ctx.device.logicalDevice, STROKE_SHADER_PATH);
+        vk::ComputePipelineCreateInfo pipelineInfo(
+            {},
+            vk::PipelineShaderStageCreateInfo(
+                {}, vk::ShaderStageFlagBits::eCompute, shaderModule, "main"
+            ),
+            _gpuBrushContext.pipelineLayout
+        );
+        if (device.createComputePipelines(
+                nullptr, 1, &pipelineInfo, nullptr, &_gpuBrushContext.pipeline
+            )
+            != vk::Result::eSuccess) {
+            FATAL("Failed to create compute pipeline!");
+        }
+        device.destroyShaderModule(shaderModule);
+    }
+
+    _gpuBrushContext.supported = true;
+}
+
+void AppPainter::cleanupGpuBrushContext(TetriumApp::CleanupContext& ctx)
+{
+    vk::Device device = ctx.device.logicalDevice;
+
+    for (VQBuffer& segmentBuffer : _gpuBrushContext.segmentBuffers) {
+        segmentBuffer.Cleanup();
+    }
+    device.destroyPipeline(_gpuBrushContext.pipeline);
+    device.destroyPipelineLayout(_gpuBrushContext.pipelineLayout);
+    device.destroyDescriptorSetLayout(_gpuBrushContext.descriptorSetLayout);
+    device.destroyDescriptorPool(_gpuBrushContext.descriptorPool);
+}
+
+void AppPainter::recordStrokes(vk::CommandBuffer cb, uint32_t frameIndex)
+{
+    uint32_t numSegments = static_cast<uint32_t>(
+        std::min<size_t>(_pendingSegments.size(), MAX_STROKE_SEGMENTS_PER_DISPATCH)
+    );
+    memcpy(
+        _gpuBrushContext.segmentBuffers[frameIndex].bufferAddress,
+        _pendingSegments.data(),
+        numSegments * sizeof(StrokeSegment)
+    );
+
+    // only the pixels the segments' stamps can reach are dispatched
+    glm::ivec2 min(INT32_MAX);
+    glm::ivec2 max(INT32_MIN);
+    for (uint32_t i = 0; i < numSegments; i++) {
+        const StrokeSegment& segment = _pendingSegments[i];
+        vk::Rect2D bounds = getStrokeBounds(
+            segment.begin,
+            segment.end,
+            segment.brushSize,
+            static_cast<BrushStrokeType>(segment.brushType)
+        );
+        if (bounds.extent.width != 0 && bounds.extent.height != 0) {
+            glm::ivec2 offset(bounds.offset.x, bounds.offset.y);
+            min = glm::min(min, offset);
+            max = glm::max(max, offset + glm::ivec2(bounds.extent.width, bounds.extent.height));
+        }
+    }
+    _pendingSegments.erase(_pendingSegments.begin(), _pendingSegments.begin() + numSegments);
+    if (glm::any(glm::greaterThanEqual(min, max))) {
+        return;
+    }
+
+    // the atlas may have just been staged, or read by the last transform pass
+    vk::ImageMemoryBarrier barrier(
+        vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite,
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+        vk::ImageLayout::eGeneral,
+        vk::ImageLayout::eGeneral,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        _tileAtlas.image,
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, _tileAtlas.numLayers)
+    );
+    cb.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eFragmentShader
+            | vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eComputeShader,
+        vk::DependencyFlags(),
+        nullptr,
+        nullptr,
+        barrier
+    );
+
+    StrokePushConstants pushConstants{
+        .origin = min,
+        .canvasSize = glm::ivec2(_canvasWidth, _canvasHeight),
+        .numSegments = numSegments,
+        .numTilesX = _numTilesX};
+    cb.bindPipeline(vk::PipelineBindPoint::eCompute, _gpuBrushContext.pipeline);
+    cb.bindDescriptorSets(
+        vk::PipelineBindPoint::eCompute,
+        _gpuBrushContext.pipelineLayout,
+        0,
+        1,
+        &_gpuBrushContext.descriptorSets[frameIndex],
+        0,
+        nullptr
+    );
+    cb.pushConstants(
+        _gpuBrushContext.pipelineLayout,
+        vk::ShaderStageFlagBits::eCompute,
+        0,
+        sizeof(pushConstants),
+        &pushConstants
+    );
+    glm::ivec2 extent = max - min;
+    cb.dispatch(
+        (extent.x + STROKE_GROUP_SIZE - 1) / STROKE_GROUP_SIZE,
+        (extent.y + STROKE_GROUP_SIZE - 1) / STROKE_GROUP_SIZE,
+        1
+    );
+
+    // strokes -> transform pass, or read back
+    barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead
+                            | vk::AccessFlagBits::eTransferWrite;
+    cb.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eTransfer,
+        vk::DependencyFlags(),
+        nullptr,
+        nullptr,
+        barrier
+    );
+}
+
+void AppPainter::syncPaintSpaceTiles()
+{
+    if (!_paintSpaceTilesStale) {
+        return;
+    }
+    // the atlas is brought up to date with the current frame's buffers, no longer in flight, and
+    // the tiles the GPU painted on are copied back; the submissions are queued after the frames
+    // in flight, for their strokes to be read back too
+    const uint32_t FRAME_INDEX = _currentFrameInFlight;
+    while (true) {
+        vk::CommandBuffer cb = _device->BeginSingleTimeCommands();
+        prepareTiles(cb, FRAME_INDEX);
+        if (!_dirtyTiles.empty()) {
+            recordPaintSpaceUpload(cb);
+        }
+        recordStrokes(cb, FRAME_INDEX);
+        bool done = _pendingSegments.empty();
+        if (done) {
+            // the strokes may have been recorded by the frames in flight, which may also still
+            // be staging from the tiles' buffers
+            vk::MemoryBarrier readBarrier(
+                vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite,
+                vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite
+            );
+            cb.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+                vk::PipelineStageFlagBits::eTransfer,
+                vk::DependencyFlags(),
+                readBarrier,
+                nullptr,
+                nullptr
+            );
+            for (std::unique_ptr<PaintSpaceTile>& tile : _tiles) {
+                if (!tile || !tile->stale) {
+                    continue;
+                }
+                glm::uvec3 slotTexel = getSlotTexel(tile->slot);
+                vk::BufferImageCopy copyRegion(
+                    0,
+                    0,
+                    0,
+                    vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, slotTexel.z, 1),
+                    vk::Offset3D(slotTexel.x, slotTexel.y, 0),
+                    vk::Extent3D(TILE_SIZE, TILE_SIZE, 1)
+                );
+                cb.copyImageToBuffer(
+                    _tileAtlas.image, vk::ImageLayout::eGeneral, tile->buffer.buffer, copyRegion
+                );
+                tile->stale = false;
+            }
+            vk::MemoryBarrier barrier(
+                vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead
+            );
+            cb.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTransfer,
+                vk::PipelineStageFlagBits::eHost,
+                vk::DependencyFlags(),
+                barrier,
+                nullptr,
+                nullptr
+            );
+        }
+        _device->EndSingleTimeCommands(cb);
+        if (done) {
+            break;
+        }
+    }
+    _paintSpaceTilesStale = false;
+}
+} // namespace TetriumApp
@@ -13,12 +13,13 @@ void AppPainter::canvasInteract(const ImVec2& canvasMousePos)
         return;
     }
 
-    brush(_paintingState.prevCanvasMousePos->x, _paintingState.prevCanvasMousePos->y, x, y);
+    brush(x, y, x, y); // continues from `prevCanvasMousePos` if any
 }
 
 // TODO: impl
 void AppPainter::TickImGui(const TetriumApp::TickContextImGui& ctx)
 {
+    _currentFrameInFlight = ctx.currentFrameInFlight;
     ImGuiIO& io = ImGui::GetIO();
     ImGui::SetNextWindowPos(ImVec2(0, 0));
     ImGui::SetNextWindowSize(io.DisplaySize);
@@ -44,6 +45,13 @@ void AppPainter::TickImGui(const TetriumApp::TickContextImGui& ctx)
         if (ImGui::Button("load")) {
             loadCanvasFromFile("canvas.tiff");
         }
+        if (ImGui::Button("save .tetra")) {
+            saveCanvasToFile("canvas.tetra");
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("load .tetra")) {
+            loadCanvasFromFile("canvas.tetra");
+        }
 
         int brushSize = _paintingState.brushSize;
         if (ImGui::SliderInt("Brush Size", &brushSize, 1, 100)) {
@@ -57,26 +65,66 @@ void AppPainter::TickImGui(const TetriumApp::TickContextImGui& ctx)
             _paintingState.brushType = static_cast<BrushStrokeType>(currentBrush);
         }
 
+        ImGui::SliderFloat(
+            "Stamp Spacing", &_paintingState.stampSpacing, 0.01f, 1.f, "%.2f of diameter"
+        );
+
+        if (_gpuBrushContext.supported) {
+            ImGui::Checkbox("GPU Brush", &_paintingState.gpuBrush);
+        }
+
+        // canvas size, tiles still on the canvas are kept
+        {
+            static int newCanvasSize[2] = {0, 0};
+            if (newCanvasSize[0] == 0) {
+                newCanvasSize[0] = _canvasWidth;
+                newCanvasSize[1] = _canvasHeight;
+            }
+            ImGui::InputInt2("Canvas Size", newCanvasSize);
+            ImGui::SameLine();
+            if (ImGui::Button("Resize")) {
+                const int MAX_CANVAS_SIZE = 16384;
+                newCanvasSize[0] = std::clamp(newCanvasSize[0], 1, MAX_CANVAS_SIZE);
+                newCanvasSize[1] = std::clamp(newCanvasSize[1], 1, MAX_CANVAS_SIZE);
+                resizeCanvas(newCanvasSize[0], newCanvasSize[1]);
+            }
+        }
+
         // Draw canvas
         //
-        ImVec2 canvasSize = ImVec2(_canvasWidth, _canvasHeight);
+        vk::Extent2D viewExtent = getViewExtent();
+        // canvases larger than the view are panned
+        if (_canvasWidth > viewExtent.width) {
+            ImGui::SliderInt("Pan X", &_viewOffset.x, 0, _canvasWidth - viewExtent.width);
+        }
+        if (_canvasHeight > viewExtent.height) {
+            ImGui::SliderInt("Pan Y", &_viewOffset.y, 0, _canvasHeight - viewExtent.height);
+        }
+        ImVec2 viewSize = ImVec2(viewExtent.width, viewExtent.height);
         {
+            resizeViewSpaceFrameBuffer(ctx.currentFrameInFlight);
             const TextureFrameBuffer& fb = _viewSpaceFrameBuffer[ctx.currentFrameInFlight];
-            ImGui::Image(fb.GetImGuiTextureId(), canvasSize);
+            ImGui::Image(fb.GetImGuiTextureId(), viewSize);
         }
-        ImVec2 canvasPos = ImGui::GetItemRectMin();
+        ImVec2 viewPos = ImGui::GetItemRectMin();
+        _viewScreenRect = ScreenRect{.min = viewPos, .size = viewSize};
         {
-            // check if mouse is within canvas
+            // check if mouse is within the view of the canvas
             ImVec2 mousePos = ImGui::GetMousePos();
-            if (mousePos.x >= canvasPos.x && mousePos.x < canvasPos.x + canvasSize.x
-                && mousePos.y >= canvasPos.y && mousePos.y < canvasPos.y + canvasSize.y) {
-                ImVec2 canvasMousePos = ImVec2(mousePos.x - canvasPos.x, mousePos.y - canvasPos.y);
+            if (mousePos.x >= viewPos.x && mousePos.x < viewPos.x + viewSize.x
+                && mousePos.y >= viewPos.y && mousePos.y < viewPos.y + viewSize.y) {
+                ImVec2 canvasMousePos = ImVec2(
+                    mousePos.x - viewPos.x + _viewOffset.x, mousePos.y - viewPos.y + _viewOffset.y
+                );
                 if (ImGui::IsKeyDown(ImGuiKey_MouseLeft)) {
                     canvasInteract(canvasMousePos);
+                } else {
+                    _paintingState.nextStamp = 0; // the next stroke stamps where it begins
                 }
                 _paintingState.prevCanvasMousePos = canvasMousePos;
             } else {
                 _paintingState.prevCanvasMousePos = std::nullopt;
+                _paintingState.nextStamp = 0;
             }
         }
 
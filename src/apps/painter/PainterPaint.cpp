@@ -1,128 +1,91 @@
 #include "apps/AppPainter.h"
 
 #include "imgui.h"
-#include <unordered_map>
-#include <functional>
+#include <cstring>
 
 namespace TetriumApp
 {
 
-const std::array<std::function<void(const AppPainter::BrushStrokeArgs&)>,
-                 static_cast<size_t>(AppPainter::BrushStrokeType::BrushStrokeCount)>
-    AppPainter::brushStrokeArray = {
-    // Circle
-    [](const BrushStrokeArgs& args) {
-        float radius = static_cast<float>(args.brushSize) / 2.0f;
-        for (int dxOffset = -static_cast<int>(radius); dxOffset <= static_cast<int>(radius);
-             ++dxOffset) {
-            for (int dyOffset = -static_cast<int>(radius);
-                 dyOffset <= static_cast<int>(radius);
-                 ++dyOffset) {
-                if ((dxOffset * dxOffset + dyOffset * dyOffset) <= radius * radius) {
-                    int xToPaint = args.x + dxOffset;
-                    int yToPaint = args.y + dyOffset;
-                    if (xToPaint >= 0 && xToPaint < static_cast<int>(args.canvasWidth)
-                        && yToPaint >= 0 && yToPaint < static_cast<int>(args.canvasHeight)) {
-                        args.fillPixel(xToPaint, yToPaint, args.color);
-                    }
-                }
+void AppPainter::clearCanvas()
+{
+    for (uint32_t tileIndex = 0; tileIndex < _tiles.size(); tileIndex++) {
+        releaseTile(tileIndex);
+    }
+    _dirtyTiles.clear();
+    // GPU strokes not stamped yet are cleared with the rest
+    _pendingSegments.clear();
+    _paintSpaceTilesStale = false;
+}
+
+void AppPainter::resizeCanvas(uint32_t width, uint32_t height)
+{
+    if (width == _canvasWidth && height == _canvasHeight) {
+        return;
+    }
+    INFO("Resizing the canvas to {}x{}", width, height);
+    syncPaintSpaceTiles(); // the tiles kept keep the GPU's strokes
+
+    // the tile grid is anchored at the canvas' top-left corner, tiles still on it stay put
+    uint32_t numTilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    uint32_t numTilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    std::vector<std::unique_ptr<PaintSpaceTile>> tiles(numTilesX * numTilesY);
+    for (uint32_t tileY = 0; tileY < _numTilesY; tileY++) {
+        for (uint32_t tileX = 0; tileX < _numTilesX; tileX++) {
+            uint32_t tileIndex = tileY * _numTilesX + tileX;
+            if (tileX < numTilesX && tileY < numTilesY) {
+                tiles[tileY * numTilesX + tileX] = std::move(_tiles[tileIndex]);
+            } else {
+                releaseTile(tileIndex);
             }
         }
-    },
-    // Square
-    [](const BrushStrokeArgs& args) {
-        for (int dxOffset = -static_cast<int>(args.brushSize);
-             dxOffset <= static_cast<int>(args.brushSize);
-             ++dxOffset) {
-            for (int dyOffset = -static_cast<int>(args.brushSize);
-                 dyOffset <= static_cast<int>(args.brushSize);
-                 ++dyOffset) {
-                int xToPaint = args.x + dxOffset;
-                int yToPaint = args.y + dyOffset;
-                if (xToPaint >= 0 && xToPaint < static_cast<int>(args.canvasWidth)
-                    && yToPaint >= 0 && yToPaint < static_cast<int>(args.canvasHeight)) {
-                    args.fillPixel(xToPaint, yToPaint, args.color);
-                }
-            }
+    }
+    _tiles = std::move(tiles);
+    _numTilesX = numTilesX;
+    _numTilesY = numTilesY;
+    _canvasWidth = width;
+    _canvasHeight = height;
+
+    _tileTable.assign(_tiles.size(), 0);
+    _dirtyTiles.clear();
+    for (uint32_t tileIndex = 0; tileIndex < _tiles.size(); tileIndex++) {
+        PaintSpaceTile* tile = _tiles[tileIndex].get();
+        if (!tile) {
+            continue;
         }
-    },
-    // Diamond
-    [](const BrushStrokeArgs& args) {
-        for (int i = -static_cast<int>(args.brushSize); i <= static_cast<int>(args.brushSize);
-             ++i) {
-            int span = static_cast<int>(args.brushSize) - abs(i);
-            for (int j = -span; j <= span; ++j) {
-                int xToPaint = args.x + j;
-                int yToPaint = args.y + i;
-                if (xToPaint >= 0 && xToPaint < static_cast<int>(args.canvasWidth)
-                    && yToPaint >= 0 && yToPaint < static_cast<int>(args.canvasHeight)) {
-                    args.fillPixel(xToPaint, yToPaint, args.color);
-                }
-            }
+        _tileTable[tileIndex] = tile->slot + 1;
+        if (!tile->dirtyRegions.empty()) {
+            _dirtyTiles.push_back(tileIndex);
         }
-    },
-    // SoftCircle
-    [](const BrushStrokeArgs& args) {
-        float alpha = 0.3f; // example alpha
-        float radius = static_cast<float>(args.brushSize) / 2.0f;
-        for (int dxOffset = -static_cast<int>(radius); dxOffset <= static_cast<int>(radius);
-             ++dxOffset) {
-            for (int dyOffset = -static_cast<int>(radius); dyOffset <= static_cast<int>(radius);
-                 ++dyOffset) {
-                if ((dxOffset * dxOffset + dyOffset * dyOffset) <= radius * radius) {
-                    int xToPaint = args.x + dxOffset;
-                    int yToPaint = args.y + dyOffset;
-                    if (xToPaint >= 0 && xToPaint < static_cast<int>(args.canvasWidth)
-                        && yToPaint >= 0 && yToPaint < static_cast<int>(args.canvasHeight)) {
-                        auto oldColor = args.fillPixel ? std::array<float,4>{}
-                                                    : std::array<float,4>{}; 
-                        // We'll retrieve the existing color from getPixel
-                        oldColor = args.getPixel(xToPaint, yToPaint);
-
-                        // Blend: old*(1-alpha) + new*(alpha)
-                        std::array<float,4> blended = {
-                            oldColor[0]*(1.f-alpha) + args.color[0]*alpha,
-                            oldColor[1]*(1.f-alpha) + args.color[1]*alpha,
-                            oldColor[2]*(1.f-alpha) + args.color[2]*alpha,
-                            // store alpha in 4th channel if needed
-                            oldColor[3]*(1.f-alpha) + args.color[3]*alpha
-                        };
-                        args.fillPixel(xToPaint, yToPaint, blended);
-                    }
-                }
-            }
+        // pixels past the canvas' new edge are cleared, for growing it back not to bring them back
+        vk::Extent2D extent = getTileExtent(tileIndex % _numTilesX, tileIndex / _numTilesX);
+        if (extent.width == TILE_SIZE && extent.height == TILE_SIZE) {
+            continue;
         }
-    }
-};
-
-void AppPainter::clearCanvas()
-{
-    const std::array<float, 4> clearColor = {0.0f, 0.0f, 0.0f, 0.0f};
-    for (uint32_t y = 0; y < _canvasHeight; ++y) {
-        for (uint32_t x = 0; x < _canvasWidth; ++x) {
-            fillPixel(x, y, clearColor);
+        float* pixels = reinterpret_cast<float*>(tile->buffer.bufferAddress);
+        for (uint32_t y = 0; y < TILE_SIZE; y++) {
+            uint32_t xBegin = y < extent.height ? extent.width : 0;
+            memset(
+                pixels + (static_cast<size_t>(y) * TILE_SIZE + xBegin) * 4,
+                0,
+                (TILE_SIZE - xBegin) * PAINT_SPACE_PIXEL_SIZE
+            );
         }
+        flagRegionForUpdate(tileIndex, vk::Rect2D({0, 0}, {TILE_SIZE, TILE_SIZE}));
     }
-    flagTexturesForUpdate();
-}
-
-void AppPainter::fillPixel(uint32_t x, uint32_t y, const std::array<float, 4>& color)
-{
-    ASSERT(x < _canvasWidth && y < _canvasHeight);
-    uint32_t index = y * _canvasWidth + x;
-    char* pBuffer
-        = reinterpret_cast<char*>(_paintSpaceBuffer.bufferAddress); // use char for byte arithmetic
-
-    float* pPixel = reinterpret_cast<float*>(pBuffer + index * PAINT_SPACE_PIXEL_SIZE);
-    memcpy(pPixel, color.data(), PAINT_SPACE_PIXEL_SIZE);
-}
-
-std::array<float, 4> AppPainter::getPixel(uint32_t x, uint32_t y) const
-{
-    uint32_t index = y * _canvasWidth + x;
-    const char* pBuffer = reinterpret_cast<const char*>(_paintSpaceBuffer.bufferAddress);
-    const float* pPixel = reinterpret_cast<const float*>(pBuffer + index * PAINT_SPACE_PIXEL_SIZE);
-    return {pPixel[0], pPixel[1], pPixel[2], pPixel[3]};
+    // frames in flight may still be looking tiles up in the old tile table buffers
+    for (VQBuffer buffer : _tileTableBuffers) {
+        _deferDeletion([buffer]() mutable { buffer.Cleanup(); });
+    }
+    createTileTableBuffers();
+
+    // the view frame buffers are resized by `resizeViewSpaceFrameBuffer()`, a frame at a time
+    vk::Extent2D viewExtent = getViewExtent();
+    _viewOffset = glm::clamp(
+        _viewOffset,
+        glm::ivec2(0),
+        glm::ivec2(_canvasWidth - viewExtent.width, _canvasHeight - viewExtent.height)
+    );
+    _paintingState.prevCanvasMousePos = std::nullopt;
 }
 
 void AppPainter::brush(uint32_t xBegin, uint32_t yBegin, uint32_t xEnd, uint32_t yEnd)
@@ -133,59 +96,155 @@ void AppPainter::brush(uint32_t xBegin, uint32_t yBegin, uint32_t xEnd, uint32_t
         ImVec2 prevCanvasMousePos = _paintingState.prevCanvasMousePos.value();
         xBegin = static_cast<uint32_t>(prevCanvasMousePos.x);
         yBegin = static_cast<uint32_t>(prevCanvasMousePos.y);
-        // DEBUG("Prev canvas interact at ({}, {})", xBegin, yBegin);
     }
 
-    // Handle the brush size from _paintingState
-    uint32_t brushSize = _paintingState.brushSize;
-
-    // Bresenham's line algorithm to fill pixels in the line
-    int dx = abs(static_cast<int>(xEnd) - static_cast<int>(xBegin));
-    int dy = abs(static_cast<int>(yEnd) - static_cast<int>(yBegin));
-    int sx = xBegin < xEnd ? 1 : -1;
-    int sy = yBegin < yEnd ? 1 : -1;
-    int err = (dx > dy ? dx : -dy) / 2;
-    int e2;
-
-    // not the most efficient way to paint -- brushstroke is ideally implemented through a shader.
-    // CPU-based approach is performant enough for now however.
-    while (true) {
-        DEBUG("Painting at ({}, {})", xBegin, yBegin);
-
-        BrushStrokeArgs args{
-            xBegin, yBegin,
-            _colorPicker.GetSelectedColorRYGBData(),
-            _paintingState.brushSize,
-            _canvasWidth, _canvasHeight,
-            [this](uint32_t x, uint32_t y, const std::array<float,4>& c) {
-                fillPixel(x, y, c);
-            },
-            [this](uint32_t x, uint32_t y) {
-                return getPixel(x, y);
-            }
+    // stamps keep their spacing from one segment of the stroke to the next
+    BrushKernels::Shape shape = static_cast<BrushKernels::Shape>(_paintingState.brushType);
+    BrushKernels::Stamps stamps{
+        .first = _paintingState.nextStamp,
+        .spacing = BrushKernels::GetStampSpacing(
+            shape, _paintingState.brushSize, _paintingState.stampSpacing
+        )
+    };
+    uint32_t numSteps = BrushKernels::GetNumSteps(xBegin, yBegin, xEnd, yEnd);
+    _paintingState.nextStamp = BrushKernels::GetNextStamps(stamps, numSteps).first;
+    std::vector<TileRegion> tileRegions = splitStrokeIntoTiles(
+        glm::ivec2(xBegin, yBegin),
+        glm::ivec2(xEnd, yEnd),
+        _paintingState.brushSize,
+        _paintingState.brushType
+    );
+
+    if (_paintingState.gpuBrush && _gpuBrushContext.supported) {
+        // stamped into the atlas on the next frame, see `recordStrokes()`
+        StrokeSegment segment{
+            .color = glm::vec4(color[0], color[1], color[2], color[3]),
+            .begin = glm::ivec2(xBegin, yBegin),
+            .end = glm::ivec2(xEnd, yEnd),
+            .brushSize = _paintingState.brushSize,
+            .brushType = static_cast<uint32_t>(_paintingState.brushType),
+            .firstStamp = stamps.first,
+            .stampSpacing = stamps.spacing};
+        _pendingSegments.push_back(segment);
+        // the shader only paints on allocated tiles
+        for (const TileRegion& tileRegion : tileRegions) {
+            touchTile(tileRegion.tileX, tileRegion.tileY).stale = true;
+        }
+        _paintSpaceTilesStale = true;
+        return;
+    }
+    syncPaintSpaceTiles(); // the CPU brush paints on top of the GPU's strokes
+
+    static_assert(
+        static_cast<uint32_t>(BrushStrokeType::BrushStrokeCount)
+        == static_cast<uint32_t>(BrushKernels::Shape::ShapeCount)
+    );
+    // the stroke is painted on each tile it reaches, clipped to the tile and to the canvas
+    for (const TileRegion& tileRegion : tileRegions) {
+        PaintSpaceTile& tile = touchTile(tileRegion.tileX, tileRegion.tileY);
+        vk::Extent2D extent = getTileExtent(tileRegion.tileX, tileRegion.tileY);
+        BrushKernels::Canvas canvas{
+            reinterpret_cast<float*>(tile.buffer.bufferAddress),
+            extent.width,
+            extent.height,
+            TILE_SIZE
         };
-        auto idx = static_cast<size_t>(_paintingState.brushType);
-        brushStrokeArray[idx](args);
+        int32_t xOrigin = tileRegion.tileX * TILE_SIZE;
+        int32_t yOrigin = tileRegion.tileY * TILE_SIZE;
+        BrushKernels::Stroke(
+            shape,
+            canvas,
+            static_cast<int32_t>(xBegin) - xOrigin,
+            static_cast<int32_t>(yBegin) - yOrigin,
+            static_cast<int32_t>(xEnd) - xOrigin,
+            static_cast<int32_t>(yEnd) - yOrigin,
+            _paintingState.brushSize,
+            color,
+            stamps
+        );
+        flagRegionForUpdate(tileRegion.tileY * _numTilesX + tileRegion.tileX, tileRegion.region);
+    }
+}
 
-        if (xBegin == xEnd && yBegin == yEnd)
-            break;
-        e2 = err;
-        if (e2 > -dx) {
-            err -= dy;
-            xBegin += sx;
-        }
-        if (e2 < dy) {
-            err += dx;
-            yBegin += sy;
-        }
+vk::Rect2D AppPainter::getStrokeBounds(
+    glm::ivec2 begin,
+    glm::ivec2 end,
+    uint32_t brushSize,
+    BrushStrokeType brushType
+) const
+{
+    int32_t reach = BrushKernels::GetReach(static_cast<BrushKernels::Shape>(brushType), brushSize);
+    glm::ivec2 min = glm::max(glm::min(begin, end) - reach, glm::ivec2(0));
+    glm::ivec2 max = glm::min(
+        glm::max(begin, end) + reach, glm::ivec2(_canvasWidth - 1, _canvasHeight - 1)
+    );
+    if (glm::any(glm::greaterThan(min, max))) {
+        return vk::Rect2D({0, 0}, {0, 0});
     }
-    flagTexturesForUpdate();
+    return vk::Rect2D(
+        {min.x, min.y},
+        {static_cast<uint32_t>(max.x - min.x + 1), static_cast<uint32_t>(max.y - min.y + 1)}
+    );
 }
 
-void AppPainter::flagTexturesForUpdate()
+std::vector<AppPainter::TileRegion> AppPainter::splitStrokeIntoTiles(
+    glm::ivec2 begin,
+    glm::ivec2 end,
+    uint32_t brushSize,
+    BrushStrokeType brushType
+) const
 {
-    for (PaintSpaceTexture& texture : _paintSpaceTexture) {
-        texture.needsUpdate = true;
+    // the segment is walked in steps of at most a tile; the stamps between two steps lie within
+    // their bounds grown by the reach, give or take the line's rounding
+    constexpr int32_t ROUNDING_SLACK = 2;
+    glm::ivec2 delta = end - begin;
+    int32_t length = std::max(std::abs(delta.x), std::abs(delta.y));
+    int32_t stepLength = static_cast<int32_t>(TILE_SIZE);
+    int32_t numSteps = std::max(1, (length + stepLength - 1) / stepLength);
+    std::vector<TileRegion> tileRegions;
+    for (int32_t step = 0; step < numSteps; step++) {
+        glm::ivec2 stepBegin = begin + delta * step / numSteps;
+        glm::ivec2 stepEnd = begin + delta * (step + 1) / numSteps;
+        vk::Rect2D bounds = getStrokeBounds(
+            glm::min(stepBegin, stepEnd) - ROUNDING_SLACK,
+            glm::max(stepBegin, stepEnd) + ROUNDING_SLACK,
+            brushSize,
+            brushType
+        );
+        std::vector<TileRegion> stepTileRegions = splitIntoTiles(bounds);
+        tileRegions.insert(tileRegions.end(), stepTileRegions.begin(), stepTileRegions.end());
+    }
+
+    // neighbouring steps share tiles, each is kept once with the bounds of its regions
+    std::sort(
+        tileRegions.begin(),
+        tileRegions.end(),
+        [](const TileRegion& a, const TileRegion& b) {
+            return std::tie(a.tileY, a.tileX) < std::tie(b.tileY, b.tileX);
+        }
+    );
+    std::vector<TileRegion> merged;
+    for (const TileRegion& tileRegion : tileRegions) {
+        if (merged.empty() || merged.back().tileX != tileRegion.tileX
+            || merged.back().tileY != tileRegion.tileY) {
+            merged.push_back(tileRegion);
+            continue;
+        }
+        vk::Rect2D& region = merged.back().region;
+        int32_t xMin = std::min(region.offset.x, tileRegion.region.offset.x);
+        int32_t yMin = std::min(region.offset.y, tileRegion.region.offset.y);
+        int32_t xMax = std::max(
+            region.offset.x + static_cast<int32_t>(region.extent.width),
+            tileRegion.region.offset.x + static_cast<int32_t>(tileRegion.region.extent.width)
+        );
+        int32_t yMax = std::max(
+            region.offset.y + static_cast<int32_t>(region.extent.height),
+            tileRegion.region.offset.y + static_cast<int32_t>(tileRegion.region.extent.height)
+        );
+        region = vk::Rect2D(
+            {xMin, yMin}, {static_cast<uint32_t>(xMax - xMin), static_cast<uint32_t>(yMax - yMin)}
+        );
     }
+    return merged;
 }
 } // namespace TetriumApp
\ No newline at end of file
@@ -1,15 +1,33 @@
 // Serialization implementation of canvases
 
+#include <filesystem>
+
 #include "apps/AppPainter.h"
+#include "lib/TetraImage.h"
 
 #include "tiffio.h"
 
 namespace TetriumApp
 {
+namespace
+{
+bool isTetraImage(const std::string& filename)
+{
+    return std::filesystem::path(filename).extension() == TetraImage::FILE_EXTENSION;
+}
+} // namespace
+
 void AppPainter::saveCanvasToFile(const std::string& filename)
 {
-    // Open the file
-    TIFF* tiff = TIFFOpen(filename.c_str(), "w");
+    syncPaintSpaceTiles();
+    if (isTetraImage(filename)) {
+        saveCanvasToTetraImage(filename);
+        return;
+    }
+    // Open the file, as a BigTIFF if the canvas is past classic TIFF's 4 GB
+    uint64_t canvasSize
+        = static_cast<uint64_t>(_canvasWidth) * _canvasHeight * PAINT_SPACE_PIXEL_SIZE;
+    TIFF* tiff = TIFFOpen(filename.c_str(), canvasSize >= UINT32_MAX ? "w8" : "w");
     if (!tiff) {
         PANIC("Failed to open file {} for writing", filename);
     }
@@ -26,11 +44,12 @@ void AppPainter::saveCanvasToFile(const std::string& filename)
     TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
     TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
 
-    float* pCanvas = reinterpret_cast<float*>(_paintSpaceBuffer.bufferAddress);
+    std::vector<float> scanline(static_cast<size_t>(_canvasWidth) * 4);
 
     // Write each row of pixels to the file
     for (uint32_t row = 0; row < _canvasHeight; ++row) {
-        if (TIFFWriteScanline(tiff, pCanvas + row * _canvasWidth * 4, row, 0) < 0) {
+        readCanvasRow(row, scanline.data());
+        if (TIFFWriteScanline(tiff, scanline.data(), row, 0) < 0) {
             PANIC("Failed to write scanline {} to the file {}", row, filename);
         }
     }
@@ -40,6 +59,10 @@ void AppPainter::saveCanvasToFile(const std::string& filename)
 
 void AppPainter::loadCanvasFromFile(const std::string& filename)
 {
+    if (isTetraImage(filename)) {
+        loadCanvasFromTetraImage(filename);
+        return;
+    }
     TIFF* tiff = TIFFOpen(filename.c_str(), "r");
     if (!tiff) {
         PANIC("Failed to open file {} for reading", filename);
@@ -49,28 +72,53 @@ void AppPainter::loadCanvasFromFile(const std::string& filename)
     TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width);
     TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height);
 
-    // Ensure the loaded image dimensions match the canvas
-    if (width != _canvasWidth || height != _canvasHeight) {
-        PANIC(
-            "Loaded image dimensions {}x{} do not match the canvas size {}x{}",
-            width,
-            height,
-            _canvasWidth,
-            _canvasHeight
-        );
-    }
-
-    float* pCanvas = reinterpret_cast<float*>(_paintSpaceBuffer.bufferAddress);
+    // the canvas takes the image's size, only tiles with paint on them are allocated
+    clearCanvas();
+    resizeCanvas(width, height);
+    std::vector<float> scanline(static_cast<size_t>(_canvasWidth) * 4);
 
-    // Read the image data into the pCanvas array
+    // Read the image data a row at a time into the tiles
     for (uint32_t row = 0; row < _canvasHeight; ++row) {
-        if (TIFFReadScanline(tiff, pCanvas + row * _canvasWidth * 4, row, 0) < 0) {
+        if (TIFFReadScanline(tiff, scanline.data(), row, 0) < 0) {
             PANIC("Failed to read scanline {} from the file {}", row, filename);
         }
+        writeCanvasRow(row, scanline.data());
     }
 
     TIFFClose(tiff);
-    flagTexturesForUpdate();
+}
+
+// the image viewer opens the result as is, with the planes the painter renders
+void AppPainter::saveCanvasToTetraImage(const std::string& filename)
+{
+    TetraImage::Metadata metadata{.transformsFromRygb = _tranformMatrixFromRygb};
+    auto getRow = [this](uint32_t y, float* row) { readCanvasRow(y, row); };
+    if (!TetraImage::Write(filename, _canvasWidth, _canvasHeight, metadata, getRow)) {
+        PANIC("Failed to write the canvas to {}", filename);
+    }
+}
+
+// only the RYGB source is read, the planes are rendered from it again
+void AppPainter::loadCanvasFromTetraImage(const std::string& filename)
+{
+    TetraImage::Reader reader;
+    if (!reader.Open(filename)) {
+        PANIC("Failed to open file {} for reading", filename);
+    }
+    const TetraImage::Layout& layout = reader.GetLayout();
+    clearCanvas();
+    resizeCanvas(layout.width, layout.height);
+
+    const uint16_t* rygb = reader.GetRYGB();
+    size_t rowSize = static_cast<size_t>(_canvasWidth) * 4;
+    std::vector<float> row(rowSize);
+    for (uint32_t y = 0; y < _canvasHeight; y++) {
+        const uint16_t* halfRow = rygb + y * rowSize;
+        for (size_t i = 0; i < rowSize; i++) {
+            row[i] = RYGBTransform::HalfToFloat(halfRow[i]);
+        }
+        writeCanvasRow(y, row.data());
+    }
 }
 
 } // namespace TetriumApp
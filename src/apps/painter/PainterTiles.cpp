@@ -0,0 +1,573 @@
+// Sparse paint space: the canvas' tiles, their slots in the GPU tile atlas, and staging the
+// former into the latter
+
+#include <algorithm>
+#include <cstring>
+
+#include "apps/AppPainter.h"
+
+namespace TetriumApp
+{
+namespace
+{
+// RYGB color space, need 4 bytes per channel to store potentially
+// negative float values.
+const vk::Format TILE_FORMAT = vk::Format::eR32G32B32A32Sfloat;
+
+bool overlaps(const vk::Rect2D& a, const vk::Rect2D& b)
+{
+    return a.offset.x < b.offset.x + static_cast<int32_t>(b.extent.width)
+           && b.offset.x < a.offset.x + static_cast<int32_t>(a.extent.width)
+           && a.offset.y < b.offset.y + static_cast<int32_t>(b.extent.height)
+           && b.offset.y < a.offset.y + static_cast<int32_t>(a.extent.height);
+}
+
+vk::Rect2D unite(const vk::Rect2D& a, const vk::Rect2D& b)
+{
+    int32_t xMin = std::min(a.offset.x, b.offset.x);
+    int32_t yMin = std::min(a.offset.y, b.offset.y);
+    int32_t xMax = std::max(
+        a.offset.x + static_cast<int32_t>(a.extent.width),
+        b.offset.x + static_cast<int32_t>(b.extent.width)
+    );
+    int32_t yMax = std::max(
+        a.offset.y + static_cast<int32_t>(a.extent.height),
+        b.offset.y + static_cast<int32_t>(b.extent.height)
+    );
+    return vk::Rect2D(
+        {xMin, yMin}, {static_cast<uint32_t>(xMax - xMin), static_cast<uint32_t>(yMax - yMin)}
+    );
+}
+} // namespace
+
+/* ---------- Tiles ---------- */
+
+void AppPainter::initPaintSpaceTiles(TetriumApp::InitContext& ctx)
+{
+    _numTilesX = (_canvasWidth + TILE_SIZE - 1) / TILE_SIZE;
+    _numTilesY = (_canvasHeight + TILE_SIZE - 1) / TILE_SIZE;
+    _tiles.resize(_numTilesX * _numTilesY);
+    _tileTable.assign(_tiles.size(), 0);
+    // the atlas starts out with a layer, enough for a canvas of the default size
+    createTileAtlas(1);
+    createTileTableBuffers();
+}
+
+void AppPainter::cleanupPaintSpaceTiles(TetriumApp::CleanupContext& ctx)
+{
+    for (uint32_t tileIndex = 0; tileIndex < _tiles.size(); tileIndex++) {
+        releaseTile(tileIndex);
+    }
+    cleanupTileTableBuffers();
+    destroyTileAtlas();
+}
+
+AppPainter::PaintSpaceTile& AppPainter::touchTile(uint32_t tileX, uint32_t tileY)
+{
+    ASSERT(tileX < _numTilesX && tileY < _numTilesY);
+    uint32_t tileIndex = tileY * _numTilesX + tileX;
+    std::unique_ptr<PaintSpaceTile>& tile = _tiles[tileIndex];
+    if (tile) {
+        return *tile;
+    }
+    if (_tileAtlas.freeSlots.empty()) {
+        growTileAtlas();
+    }
+    VkDeviceSize bufferSize = TILE_SIZE * TILE_SIZE * PAINT_SPACE_PIXEL_SIZE;
+    tile = std::make_unique<PaintSpaceTile>();
+    tile->buffer = _device->CreateBuffer(
+        bufferSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, // dst: GPU brush
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    );
+    memset(tile->buffer.bufferAddress, 0, bufferSize);
+    tile->slot = _tileAtlas.freeSlots.back();
+    _tileAtlas.freeSlots.pop_back();
+    _tileTable[tileIndex] = tile->slot + 1;
+    // the slot still holds the tile that had it last
+    flagRegionForUpdate(tileIndex, vk::Rect2D({0, 0}, {TILE_SIZE, TILE_SIZE}));
+    return *tile;
+}
+
+void AppPainter::releaseTile(uint32_t tileIndex)
+{
+    std::unique_ptr<PaintSpaceTile>& tile = _tiles[tileIndex];
+    if (!tile) {
+        return;
+    }
+    // the frames in flight may still be staging from the buffer
+    VQBuffer buffer = tile->buffer;
+    _deferDeletion([buffer]() mutable { buffer.Cleanup(); });
+    _tileAtlas.freeSlots.push_back(tile->slot);
+    _tileTable[tileIndex] = 0;
+    tile.reset(); // left in `_dirtyTiles`, skipped by the next upload
+}
+
+std::vector<AppPainter::TileRegion> AppPainter::splitIntoTiles(const vk::Rect2D& region) const
+{
+    std::vector<TileRegion> tileRegions;
+    if (region.extent.width == 0 || region.extent.height == 0) {
+        return tileRegions;
+    }
+    uint32_t xMin = region.offset.x;
+    uint32_t yMin = region.offset.y;
+    uint32_t xMax = xMin + region.extent.width; // exclusive
+    uint32_t yMax = yMin + region.extent.height;
+    for (uint32_t tileY = yMin / TILE_SIZE; tileY <= (yMax - 1) / TILE_SIZE; tileY++) {
+        for (uint32_t tileX = xMin / TILE_SIZE; tileX <= (xMax - 1) / TILE_SIZE; tileX++) {
+            uint32_t tileXMin = std::max(xMin, tileX * TILE_SIZE) - tileX * TILE_SIZE;
+            uint32_t tileYMin = std::max(yMin, tileY * TILE_SIZE) - tileY * TILE_SIZE;
+            uint32_t tileXMax = std::min(xMax, (tileX + 1) * TILE_SIZE) - tileX * TILE_SIZE;
+            uint32_t tileYMax = std::min(yMax, (tileY + 1) * TILE_SIZE) - tileY * TILE_SIZE;
+            tileRegions.push_back(
+                {tileX,
+                 tileY,
+                 vk::Rect2D(
+                     {static_cast<int32_t>(tileXMin), static_cast<int32_t>(tileYMin)},
+                     {tileXMax - tileXMin, tileYMax - tileYMin}
+                 )}
+            );
+        }
+    }
+    return tileRegions;
+}
+
+vk::Extent2D AppPainter::getTileExtent(uint32_t tileX, uint32_t tileY) const
+{
+    return vk::Extent2D(
+        std::min(TILE_SIZE, _canvasWidth - tileX * TILE_SIZE),
+        std::min(TILE_SIZE, _canvasHeight - tileY * TILE_SIZE)
+    );
+}
+
+void AppPainter::flagRegionForUpdate(const vk::Rect2D& region)
+{
+    for (const TileRegion& tileRegion : splitIntoTiles(region)) {
+        uint32_t tileIndex = tileRegion.tileY * _numTilesX + tileRegion.tileX;
+        if (_tiles[tileIndex]) { // others are still all zeros
+            flagRegionForUpdate(tileIndex, tileRegion.region);
+        }
+    }
+}
+
+void AppPainter::flagRegionForUpdate(uint32_t tileIndex, const vk::Rect2D& region)
+{
+    // past this many regions, their bounding region is staged instead, trading a few clean
+    // pixels for fewer copies
+    const size_t MAX_DIRTY_REGIONS = 16;
+    if (region.extent.width == 0 || region.extent.height == 0) {
+        return;
+    }
+    std::vector<vk::Rect2D>& regions = _tiles[tileIndex]->dirtyRegions;
+    if (regions.empty()) {
+        _dirtyTiles.push_back(tileIndex);
+    }
+    // copies into an image must not overlap, merge into the regions `region` overlaps
+    vk::Rect2D merged = region;
+    for (size_t i = 0; i < regions.size();) {
+        if (overlaps(regions[i], merged)) {
+            merged = unite(regions[i], merged);
+            regions[i] = regions.back();
+            regions.pop_back();
+            i = 0; // the union may overlap regions checked already
+        } else {
+            i++;
+        }
+    }
+    regions.push_back(merged);
+    if (regions.size() > MAX_DIRTY_REGIONS) {
+        vk::Rect2D bounds = regions.front();
+        for (const vk::Rect2D& r : regions) {
+            bounds = unite(bounds, r);
+        }
+        regions = {bounds};
+    }
+}
+
+void AppPainter::readCanvasRow(uint32_t y, float* row) const
+{
+    uint32_t tileY = y / TILE_SIZE;
+    for (uint32_t tileX = 0; tileX < _numTilesX; tileX++) {
+        float* dst = row + static_cast<size_t>(tileX) * TILE_SIZE * 4;
+        size_t rowSize = getTileExtent(tileX, tileY).width * PAINT_SPACE_PIXEL_SIZE;
+        const PaintSpaceTile* tile = _tiles[tileY * _numTilesX + tileX].get();
+        if (!tile) {
+            memset(dst, 0, rowSize);
+            continue;
+        }
+        const float* src = reinterpret_cast<const float*>(tile->buffer.bufferAddress)
+                           + static_cast<size_t>(y % TILE_SIZE) * TILE_SIZE * 4;
+        memcpy(dst, src, rowSize);
+    }
+}
+
+void AppPainter::writeCanvasRow(uint32_t y, const float* row)
+{
+    uint32_t tileY = y / TILE_SIZE;
+    for (uint32_t tileX = 0; tileX < _numTilesX; tileX++) {
+        const float* src = row + static_cast<size_t>(tileX) * TILE_SIZE * 4;
+        uint32_t width = getTileExtent(tileX, tileY).width;
+        uint32_t tileIndex = tileY * _numTilesX + tileX;
+        bool isClear = std::all_of(src, src + width * 4, [](float v) { return v == 0.f; });
+        if (isClear && !_tiles[tileIndex]) {
+            continue;
+        }
+        PaintSpaceTile& tile = touchTile(tileX, tileY);
+        float* dst = reinterpret_cast<float*>(tile.buffer.bufferAddress)
+                     + static_cast<size_t>(y % TILE_SIZE) * TILE_SIZE * 4;
+        memcpy(dst, src, width * PAINT_SPACE_PIXEL_SIZE);
+        flagRegionForUpdate(
+            tileIndex, vk::Rect2D({0, static_cast<int32_t>(y % TILE_SIZE)}, {width, 1})
+        );
+    }
+}
+
+/* ---------- Tile atlas ---------- */
+
+void AppPainter::createTileAtlas(uint32_t numLayers)
+{
+    vk::Device device = _device->Get();
+    uint32_t layerSize = ATLAS_LAYER_TILES * TILE_SIZE;
+    vk::ImageCreateInfo imageInfo(
+        {},
+        vk::ImageType::e2D,
+        TILE_FORMAT,
+        vk::Extent3D(layerSize, layerSize, 1),
+        1,
+        numLayers,
+        vk::SampleCountFlagBits::e1,
+        vk::ImageTiling::eOptimal,
+        vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled
+            | vk::ImageUsageFlagBits::eStorage // GPU brush
+            | vk::ImageUsageFlagBits::eTransferSrc, // read back, and copied when growing
+        vk::SharingMode::eExclusive
+    );
+    _tileAtlas.image = device.createImage(imageInfo);
+    _tileAtlas.memory = _device->memoryAllocator.AllocateImageMemory(
+        static_cast<VkImage>(_tileAtlas.image), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    );
+    vk::ImageSubresourceRange subresourceRange(
+        vk::ImageAspectFlagBits::eColor, 0, 1, 0, numLayers
+    );
+    vk::ImageViewCreateInfo imageViewInfo(
+        {}, _tileAtlas.image, vk::ImageViewType::e2DArray, TILE_FORMAT, {}, subresourceRange
+    );
+    _tileAtlas.imageView = device.createImageView(imageViewInfo);
+
+    // the new layers' slots, handed out from the first
+    uint32_t slotsPerLayer = ATLAS_LAYER_TILES * ATLAS_LAYER_TILES;
+    uint32_t firstSlot = _tileAtlas.numLayers * slotsPerLayer;
+    for (uint32_t slot = numLayers * slotsPerLayer; slot-- > firstSlot;) {
+        _tileAtlas.freeSlots.push_back(slot);
+    }
+    _tileAtlas.numLayers = numLayers;
+    _tileAtlas.initialized = false;
+    _tileDescriptorsOutdated.fill(true);
+}
+
+void AppPainter::destroyTileAtlas()
+{
+    vk::Device device = _device->Get();
+    if (_tileAtlas.previous.image) {
+        device.destroyImageView(_tileAtlas.previous.imageView);
+        device.destroyImage(_tileAtlas.previous.image);
+        _device->memoryAllocator.Free(_tileAtlas.previous.memory);
+        _tileAtlas.previous = {};
+    }
+    device.destroyImageView(_tileAtlas.imageView);
+    device.destroyImage(_tileAtlas.image);
+    _device->memoryAllocator.Free(_tileAtlas.memory);
+    _tileAtlas.imageView = VK_NULL_HANDLE;
+    _tileAtlas.image = VK_NULL_HANDLE;
+}
+
+void AppPainter::growTileAtlas()
+{
+    uint32_t numLayers = _tileAtlas.numLayers * 2;
+    numLayers = std::min(numLayers, _device->properties.limits.maxImageArrayLayers);
+    if (numLayers == _tileAtlas.numLayers) {
+        PANIC("The tile atlas is out of its {} layers", numLayers);
+    }
+    INFO("Growing the tile atlas to {} layers", numLayers);
+    if (_tileAtlas.previous.image) {
+        // outgrown before it was ever used, its tiles are still all in `previous`
+        vk::Device device = _device->Get();
+        device.destroyImageView(_tileAtlas.imageView);
+        device.destroyImage(_tileAtlas.image);
+        _device->memoryAllocator.Free(_tileAtlas.memory);
+    } else {
+        _tileAtlas.previous.image = _tileAtlas.image;
+        _tileAtlas.previous.imageView = _tileAtlas.imageView;
+        _tileAtlas.previous.memory = _tileAtlas.memory;
+        _tileAtlas.previous.numLayers = _tileAtlas.numLayers;
+    }
+    createTileAtlas(numLayers);
+}
+
+void AppPainter::recordTileAtlasInit(vk::CommandBuffer cb)
+{
+    // transition image layout from undefined to general
+    vk::ImageMemoryBarrier barrier(
+        vk::AccessFlags(),
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+            | vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite,
+        vk::ImageLayout::eUndefined,
+        vk::ImageLayout::eGeneral,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        _tileAtlas.image,
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, _tileAtlas.numLayers)
+    );
+    cb.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTopOfPipe,
+        vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader
+            | vk::PipelineStageFlagBits::eFragmentShader,
+        vk::DependencyFlags(),
+        nullptr,
+        nullptr,
+        barrier
+    );
+    _tileAtlas.initialized = true;
+    if (!_tileAtlas.previous.image) {
+        return;
+    }
+
+    // copy the outgrown atlas' layers over, once the frames in flight are done painting on them
+    vk::Image previous = _tileAtlas.previous.image;
+    uint32_t numLayers = _tileAtlas.previous.numLayers;
+    vk::ImageMemoryBarrier previousBarrier(
+        vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite,
+        vk::AccessFlagBits::eTransferRead,
+        vk::ImageLayout::eGeneral,
+        vk::ImageLayout::eGeneral,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        previous,
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, numLayers)
+    );
+    cb.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::DependencyFlags(),
+        nullptr,
+        nullptr,
+        previousBarrier
+    );
+    uint32_t layerSize = ATLAS_LAYER_TILES * TILE_SIZE;
+    vk::ImageSubresourceLayers layers(vk::ImageAspectFlagBits::eColor, 0, 0, numLayers);
+    cb.copyImage(
+        previous,
+        vk::ImageLayout::eGeneral,
+        _tileAtlas.image,
+        vk::ImageLayout::eGeneral,
+        vk::ImageCopy(layers, {0, 0, 0}, layers, {0, 0, 0}, {layerSize, layerSize, 1})
+    );
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.oldLayout = vk::ImageLayout::eGeneral;
+    cb.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader
+            | vk::PipelineStageFlagBits::eFragmentShader,
+        vk::DependencyFlags(),
+        nullptr,
+        nullptr,
+        barrier
+    );
+
+    VQDevice* device = _device;
+    vk::ImageView previousView = _tileAtlas.previous.imageView;
+    VQAllocation previousMemory = _tileAtlas.previous.memory;
+    _deferDeletion([device, previous, previousView, previousMemory]() {
+        device->Get().destroyImageView(previousView);
+        device->Get().destroyImage(previous);
+        device->memoryAllocator.Free(previousMemory);
+    });
+    _tileAtlas.previous = {};
+}
+
+glm::uvec3 AppPainter::getSlotTexel(uint32_t slot) const
+{
+    uint32_t slotsPerLayer = ATLAS_LAYER_TILES * ATLAS_LAYER_TILES;
+    uint32_t slotInLayer = slot % slotsPerLayer;
+    return glm::uvec3(
+        slotInLayer % ATLAS_LAYER_TILES * TILE_SIZE,
+        slotInLayer / ATLAS_LAYER_TILES * TILE_SIZE,
+        slot / slotsPerLayer
+    );
+}
+
+/* ---------- Tile table ---------- */
+
+void AppPainter::createTileTableBuffers()
+{
+    for (VQBuffer& buffer : _tileTableBuffers) {
+        _device->CreateBufferInPlace(
+            _tileTable.size() * sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            buffer
+        );
+    }
+    _tileDescriptorsOutdated.fill(true);
+}
+
+void AppPainter::cleanupTileTableBuffers()
+{
+    for (VQBuffer& buffer : _tileTableBuffers) {
+        buffer.Cleanup();
+    }
+}
+
+void AppPainter::flushTileTable(uint32_t frameIndex)
+{
+    memcpy(
+        _tileTableBuffers[frameIndex].bufferAddress,
+        _tileTable.data(),
+        _tileTable.size() * sizeof(uint32_t)
+    );
+}
+
+void AppPainter::updateTileDescriptors(uint32_t frameIndex)
+{
+    vk::Device device = _device->Get();
+    vk::DescriptorImageInfo samplerInfo(
+        _paintToViewSpaceContext.samplers[frameIndex],
+        _tileAtlas.imageView,
+        vk::ImageLayout::eGeneral
+    );
+    vk::DescriptorImageInfo storageImageInfo(
+        nullptr, _tileAtlas.imageView, vk::ImageLayout::eGeneral
+    );
+    vk::DescriptorBufferInfo tileTableInfo(_tileTableBuffers[frameIndex].buffer, 0, VK_WHOLE_SIZE);
+
+    std::vector<vk::WriteDescriptorSet> writes
+        = {vk::WriteDescriptorSet(
+               _paintToViewSpaceContext.descriptorSets[frameIndex],
+               (uint32_t)BindingLocation::tileAtlas,
+               0,
+               1,
+               vk::DescriptorType::eCombinedImageSampler,
+               &samplerInfo,
+               nullptr,
+               nullptr
+           ),
+           vk::WriteDescriptorSet(
+               _paintToViewSpaceContext.descriptorSets[frameIndex],
+               (uint32_t)BindingLocation::tileTable,
+               0,
+               1,
+               vk::DescriptorType::eStorageBuffer,
+               nullptr,
+               &tileTableInfo,
+               nullptr
+           )};
+    if (_gpuBrushContext.supported) {
+        writes.push_back(vk::WriteDescriptorSet(
+            _gpuBrushContext.descriptorSets[frameIndex],
+            (uint32_t)StrokeBindingLocation::canvas,
+            0,
+            1,
+            vk::DescriptorType::eStorageImage,
+            &storageImageInfo,
+            nullptr,
+            nullptr
+        ));
+        writes.push_back(vk::WriteDescriptorSet(
+            _gpuBrushContext.descriptorSets[frameIndex],
+            (uint32_t)StrokeBindingLocation::tileTable,
+            0,
+            1,
+            vk::DescriptorType::eStorageBuffer,
+            nullptr,
+            &tileTableInfo,
+            nullptr
+        ));
+    }
+    device.updateDescriptorSets(writes, nullptr);
+    _tileDescriptorsOutdated[frameIndex] = false;
+}
+
+void AppPainter::prepareTiles(vk::CommandBuffer cb, uint32_t frameIndex)
+{
+    if (!_tileAtlas.initialized) {
+        recordTileAtlasInit(cb);
+    }
+    if (_tileDescriptorsOutdated[frameIndex]) {
+        updateTileDescriptors(frameIndex);
+    }
+    flushTileTable(frameIndex);
+}
+
+/* ---------- Staging ---------- */
+
+void AppPainter::recordPaintSpaceUpload(vk::CommandBuffer cb)
+{
+    vk::ImageSubresourceRange subresourceRange(
+        vk::ImageAspectFlagBits::eColor, 0, 1, 0, _tileAtlas.numLayers
+    );
+    // the last frame's strokes and transform pass may still be using the slots
+    vk::ImageMemoryBarrier barrier(
+        vk::AccessFlagBits::eShaderWrite,
+        vk::AccessFlagBits::eTransferWrite,
+        vk::ImageLayout::eGeneral,
+        vk::ImageLayout::eGeneral,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        _tileAtlas.image,
+        subresourceRange
+    );
+    cb.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eFragmentShader,
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::DependencyFlags(),
+        nullptr,
+        nullptr,
+        barrier
+    );
+
+    // a copy per dirty tile, a region per dirty region of the tile
+    std::vector<vk::BufferImageCopy> copyRegions;
+    for (uint32_t tileIndex : _dirtyTiles) {
+        PaintSpaceTile* tile = _tiles[tileIndex].get();
+        if (!tile || tile->dirtyRegions.empty()) {
+            continue; // released since, or listed again after being released and touched
+        }
+        glm::uvec3 slotTexel = getSlotTexel(tile->slot);
+        copyRegions.clear();
+        for (const vk::Rect2D& region : tile->dirtyRegions) {
+            VkDeviceSize offset
+                = (static_cast<VkDeviceSize>(region.offset.y) * TILE_SIZE + region.offset.x)
+                  * PAINT_SPACE_PIXEL_SIZE;
+            copyRegions.emplace_back(
+                offset,
+                TILE_SIZE,
+                TILE_SIZE,
+                vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, slotTexel.z, 1),
+                vk::Offset3D(slotTexel.x + region.offset.x, slotTexel.y + region.offset.y, 0),
+                vk::Extent3D(region.extent.width, region.extent.height, 1)
+            );
+        }
+        cb.copyBufferToImage(
+            tile->buffer.buffer, // src
+            _tileAtlas.image,    // dst
+            vk::ImageLayout::eGeneral,
+            copyRegions
+        );
+        tile->dirtyRegions.clear();
+    }
+    _dirtyTiles.clear();
+
+    // pipeline blocks until the atlas is updated, for the GPU brush to paint on or the
+    // transform pass to sample.
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+    cb.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eFragmentShader,
+        vk::DependencyFlags(),
+        nullptr,
+        nullptr,
+        barrier
+    );
+}
+} // namespace TetriumApp
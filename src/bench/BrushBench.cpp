@@ -0,0 +1,309 @@
+// Brush microbenchmark: times the painter's CPU brush kernels against the per-pixel
+// `std::function` brushes they replaced, on strokes across a canvas, and checks that both paint
+// the same pixels when stamping at every step. Also times the kernels at the painter's default
+// stamp spacing.
+//
+// usage: TetriumBrushBench [num strokes per case]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <random>
+
+#include "lib/BrushKernels.h"
+
+namespace
+{
+const uint32_t DEFAULT_NUM_STROKES = 200;
+const uint32_t CANVAS_SIZE = 1024; // the painter's default
+const uint32_t STROKE_LENGTH = 32; // in pixels, about a fast mouse move between two ticks
+const std::array<uint32_t, 4> BRUSH_SIZES = {5, 20, 50, 100};
+const std::array<const char*, 4> SHAPE_NAMES = {"Circle", "Square", "Diamond", "SoftCircle"};
+const float STAMP_SPACING = 0.25f; // the painter's default
+// the soft brush blends all stamps covering a pixel at once rather than one after the other
+const float SOFT_CIRCLE_TOLERANCE = 1e-5f;
+
+struct StrokeEndpoints
+{
+    int32_t xBegin;
+    int32_t yBegin;
+    int32_t xEnd;
+    int32_t yEnd;
+};
+
+/* ---------- Reference ---------- */
+
+// the brushes as `AppPainter` had them: a bounds check, a `std::function` call and a `memcpy`
+// per pixel
+struct ReferenceArgs
+{
+    uint32_t x;
+    uint32_t y;
+    std::array<float, 4> color;
+    uint32_t brushSize;
+    uint32_t canvasWidth;
+    uint32_t canvasHeight;
+    std::function<void(uint32_t, uint32_t, const std::array<float, 4>&)> fillPixel;
+    std::function<std::array<float, 4>(uint32_t, uint32_t)> getPixel;
+};
+
+void referenceCircle(const ReferenceArgs& args, bool soft)
+{
+    float alpha = BrushKernels::SOFT_CIRCLE_ALPHA;
+    float radius = static_cast<float>(args.brushSize) / 2.0f;
+    int reach = static_cast<int>(radius);
+    for (int dxOffset = -reach; dxOffset <= reach; ++dxOffset) {
+        for (int dyOffset = -reach; dyOffset <= reach; ++dyOffset) {
+            if ((dxOffset * dxOffset + dyOffset * dyOffset) > radius * radius) {
+                continue;
+            }
+            int xToPaint = args.x + dxOffset;
+            int yToPaint = args.y + dyOffset;
+            if (xToPaint < 0 || xToPaint >= static_cast<int>(args.canvasWidth) || yToPaint < 0
+                || yToPaint >= static_cast<int>(args.canvasHeight)) {
+                continue;
+            }
+            if (!soft) {
+                args.fillPixel(xToPaint, yToPaint, args.color);
+                continue;
+            }
+            std::array<float, 4> oldColor = args.getPixel(xToPaint, yToPaint);
+            std::array<float, 4> blended;
+            for (int c = 0; c < 4; c++) {
+                blended[c] = oldColor[c] * (1.f - alpha) + args.color[c] * alpha;
+            }
+            args.fillPixel(xToPaint, yToPaint, blended);
+        }
+    }
+}
+
+void referenceSquare(const ReferenceArgs& args)
+{
+    int reach = static_cast<int>(args.brushSize);
+    for (int dxOffset = -reach; dxOffset <= reach; ++dxOffset) {
+        for (int dyOffset = -reach; dyOffset <= reach; ++dyOffset) {
+            int xToPaint = args.x + dxOffset;
+            int yToPaint = args.y + dyOffset;
+            if (xToPaint >= 0 && xToPaint < static_cast<int>(args.canvasWidth) && yToPaint >= 0
+                && yToPaint < static_cast<int>(args.canvasHeight)) {
+                args.fillPixel(xToPaint, yToPaint, args.color);
+            }
+        }
+    }
+}
+
+void referenceDiamond(const ReferenceArgs& args)
+{
+    int reach = static_cast<int>(args.brushSize);
+    for (int i = -reach; i <= reach; ++i) {
+        int span = reach - abs(i);
+        for (int j = -span; j <= span; ++j) {
+            int xToPaint = args.x + j;
+            int yToPaint = args.y + i;
+            if (xToPaint >= 0 && xToPaint < static_cast<int>(args.canvasWidth) && yToPaint >= 0
+                && yToPaint < static_cast<int>(args.canvasHeight)) {
+                args.fillPixel(xToPaint, yToPaint, args.color);
+            }
+        }
+    }
+}
+
+const std::array<std::function<void(const ReferenceArgs&)>, 4> REFERENCE_BRUSHES = {
+    [](const ReferenceArgs& args) { referenceCircle(args, false); },
+    referenceSquare,
+    referenceDiamond,
+    [](const ReferenceArgs& args) { referenceCircle(args, true); },
+};
+
+void referenceStroke(
+    BrushKernels::Shape shape,
+    const BrushKernels::Canvas& canvas,
+    const StrokeEndpoints& stroke,
+    uint32_t brushSize,
+    const std::array<float, 4>& color
+)
+{
+    auto fillPixel = [&canvas](uint32_t x, uint32_t y, const std::array<float, 4>& c) {
+        memcpy(canvas.pixels + (static_cast<size_t>(y) * canvas.width + x) * 4, c.data(), 16);
+    };
+    auto getPixel = [&canvas](uint32_t x, uint32_t y) {
+        const float* pixel = canvas.pixels + (static_cast<size_t>(y) * canvas.width + x) * 4;
+        return std::array<float, 4>{pixel[0], pixel[1], pixel[2], pixel[3]};
+    };
+
+    int dx = abs(stroke.xEnd - stroke.xBegin);
+    int dy = abs(stroke.yEnd - stroke.yBegin);
+    int sx = stroke.xBegin < stroke.xEnd ? 1 : -1;
+    int sy = stroke.yBegin < stroke.yEnd ? 1 : -1;
+    int err = (dx > dy ? dx : -dy) / 2;
+    int x = stroke.xBegin;
+    int y = stroke.yBegin;
+    while (true) {
+        ReferenceArgs args{
+            static_cast<uint32_t>(x),
+            static_cast<uint32_t>(y),
+            color,
+            brushSize,
+            canvas.width,
+            canvas.height,
+            fillPixel,
+            getPixel
+        };
+        REFERENCE_BRUSHES[static_cast<size_t>(shape)](args);
+        if (x == stroke.xEnd && y == stroke.yEnd) {
+            break;
+        }
+        int e2 = err;
+        if (e2 > -dx) {
+            err -= dy;
+            x += sx;
+        }
+        if (e2 < dy) {
+            err += dx;
+            y += sy;
+        }
+    }
+}
+
+/* ---------- Benchmark ---------- */
+
+bool matches(BrushKernels::Shape shape, const std::vector<float>& a, const std::vector<float>& b)
+{
+    if (shape != BrushKernels::Shape::SoftCircle) {
+        return memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (std::abs(a[i] - b[i]) > SOFT_CIRCLE_TOLERANCE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// strokes of `STROKE_LENGTH` at random places and angles, some hanging off the canvas' edges
+std::vector<StrokeEndpoints> generateStrokes(uint32_t numStrokes)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int32_t> position(0, CANVAS_SIZE - 1);
+    std::uniform_real_distribution<float> angle(0.f, 6.2831853f);
+    std::vector<StrokeEndpoints> strokes;
+    for (uint32_t i = 0; i < numStrokes; i++) {
+        int32_t x = position(rng);
+        int32_t y = position(rng);
+        float a = angle(rng);
+        int32_t xEnd = std::clamp<int32_t>(
+            x + static_cast<int32_t>(STROKE_LENGTH * std::cos(a)), 0, CANVAS_SIZE - 1
+        );
+        int32_t yEnd = std::clamp<int32_t>(
+            y + static_cast<int32_t>(STROKE_LENGTH * std::sin(a)), 0, CANVAS_SIZE - 1
+        );
+        strokes.push_back({x, y, xEnd, yEnd});
+    }
+    return strokes;
+}
+
+// milliseconds to paint all `strokes`
+template <typename PaintFunc>
+double timeStrokes(const std::vector<StrokeEndpoints>& strokes, PaintFunc paint)
+{
+    auto begin = std::chrono::steady_clock::now();
+    for (const StrokeEndpoints& stroke : strokes) {
+        paint(stroke);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    INIT_LOGS();
+
+    uint32_t numStrokes = argc > 1 ? std::stoul(argv[1]) : DEFAULT_NUM_STROKES;
+    std::vector<StrokeEndpoints> strokes = generateStrokes(numStrokes);
+    const std::array<float, 4> color = {0.25f, -0.5f, 0.75f, 1.f};
+
+    size_t numValues = static_cast<size_t>(CANVAS_SIZE) * CANVAS_SIZE * 4;
+    std::vector<float> referencePixels(numValues);
+    std::vector<float> kernelPixels(numValues);
+    std::vector<float> spacedPixels(numValues);
+    BrushKernels::Canvas referenceCanvas{referencePixels.data(), CANVAS_SIZE, CANVAS_SIZE};
+    BrushKernels::Canvas kernelCanvas{kernelPixels.data(), CANVAS_SIZE, CANVAS_SIZE};
+    BrushKernels::Canvas spacedCanvas{spacedPixels.data(), CANVAS_SIZE, CANVAS_SIZE};
+
+    INFO(
+        "{} strokes of {} pixels on a {}x{} canvas",
+        numStrokes,
+        STROKE_LENGTH,
+        CANVAS_SIZE,
+        CANVAS_SIZE
+    );
+    INFO(
+        "{:>10} {:>5} {:>14} {:>14} {:>8} {:>14} {:>8}",
+        "brush",
+        "size",
+        "reference ms",
+        "kernels ms",
+        "speedup",
+        "spaced ms",
+        "speedup"
+    );
+    bool allMatch = true;
+    for (uint32_t s = 0; s < SHAPE_NAMES.size(); s++) {
+        BrushKernels::Shape shape = static_cast<BrushKernels::Shape>(s);
+        for (uint32_t brushSize : BRUSH_SIZES) {
+            std::fill(referencePixels.begin(), referencePixels.end(), 0.f);
+            std::fill(kernelPixels.begin(), kernelPixels.end(), 0.f);
+            double referenceMs = timeStrokes(strokes, [&](const StrokeEndpoints& stroke) {
+                referenceStroke(shape, referenceCanvas, stroke, brushSize, color);
+            });
+            double kernelMs = timeStrokes(strokes, [&](const StrokeEndpoints& stroke) {
+                BrushKernels::Stroke(
+                    shape,
+                    kernelCanvas,
+                    stroke.xBegin,
+                    stroke.yBegin,
+                    stroke.xEnd,
+                    stroke.yEnd,
+                    brushSize,
+                    color
+                );
+            });
+            BrushKernels::Stamps stamps{
+                .spacing = BrushKernels::GetStampSpacing(shape, brushSize, STAMP_SPACING)
+            };
+            double spacedMs = timeStrokes(strokes, [&](const StrokeEndpoints& stroke) {
+                BrushKernels::Stroke(
+                    shape,
+                    spacedCanvas,
+                    stroke.xBegin,
+                    stroke.yBegin,
+                    stroke.xEnd,
+                    stroke.yEnd,
+                    brushSize,
+                    color,
+                    stamps
+                );
+            });
+            bool match = matches(shape, referencePixels, kernelPixels);
+            allMatch &= match;
+            INFO(
+                "{:>10} {:>5} {:>14.2f} {:>14.2f} {:>7.1f}x {:>14.2f} {:>7.1f}x{}",
+                SHAPE_NAMES[s],
+                brushSize,
+                referenceMs,
+                kernelMs,
+                referenceMs / kernelMs,
+                spacedMs,
+                referenceMs / spacedMs,
+                match ? "" : "  MISMATCH"
+            );
+        }
+    }
+    if (!allMatch) {
+        ERROR("The kernels painted different pixels than the reference brushes");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,247 @@
+// Frame-time benchmark: drives the default apps through scripted scenarios under headless mode,
+// and reports per-`PROFILE_SCOPE` CPU time percentiles as JSON.
+//
+// usage: TetriumBench [num ticks per scenario] [output json path]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+
+#include "imgui.h"
+
+#include "Tetrium.h"
+#include "apps/DefaultApps.h"
+
+namespace
+{
+const uint32_t DEFAULT_NUM_TICKS = 600;
+const char* DEFAULT_OUTPUT_PATH = "bench_results.json";
+// ticks to run before sampling, so that one-time loads and pipeline warm-up are excluded
+const uint32_t NUM_WARMUP_TICKS = 30;
+// name of the sample that measures the entirety of `Tetrium::Tick()`
+const char* TICK_SAMPLE_NAME = "Tick";
+
+struct Scenario
+{
+    const char* name;
+    const char* appName; // app to open, main menu if nullptr
+    // injects input before each tick into the opened app, nullptr on the main menu;
+    // `tick` counts from 0 including warm-up ticks
+    std::function<void(uint32_t tick, TetriumApp::App* app)> script = nullptr;
+};
+
+// replays strokes that sweep across the painter canvas, lifting the brush every so often.
+void scriptPainterStrokes(uint32_t tick, TetriumApp::App* app)
+{
+    const uint32_t TICKS_PER_STROKE = 90;
+    const uint32_t TICKS_BRUSH_LIFTED = 5;
+    // stay clear of the view's edges so strokes never leave the canvas
+    const float MARGIN = 0.05f;
+
+    // the view is laid out by the painter's first tick, and may run past the screen
+    TetriumApp::AppPainter::ScreenRect view
+        = static_cast<TetriumApp::AppPainter*>(app)->GetViewScreenRect();
+    ImGuiIO& io = ImGui::GetIO();
+    ImVec2 min = {std::max(view.min.x, 0.f), std::max(view.min.y, 0.f)};
+    ImVec2 max = {
+        std::min(view.min.x + view.size.x, io.DisplaySize.x),
+        std::min(view.min.y + view.size.y, io.DisplaySize.y)
+    };
+    if (min.x >= max.x || min.y >= max.y) {
+        io.AddMouseButtonEvent(ImGuiMouseButton_Left, false);
+        return;
+    }
+
+    uint32_t strokeTick = tick % TICKS_PER_STROKE;
+    float t = static_cast<float>(tick) * 0.05f;
+    float extent = 0.5f - MARGIN;
+    ImVec2 pos = {
+        min.x + (max.x - min.x) * (0.5f + extent * std::sin(t * 1.3f)),
+        min.y + (max.y - min.y) * (0.5f + extent * std::sin(t * 0.7f + 1.f))
+    };
+
+    io.AddMousePosEvent(pos.x, pos.y);
+    io.AddMouseButtonEvent(ImGuiMouseButton_Left, strokeTick >= TICKS_BRUSH_LIFTED);
+}
+
+// cycles through tetra images, exercising texture loads and unloads
+void scriptImageViewerCycle(uint32_t tick, TetriumApp::App* app)
+{
+    const uint32_t TICKS_PER_IMAGE = 30;
+    ImGui::GetIO().AddKeyEvent(ImGuiKey_L, tick % TICKS_PER_IMAGE == 0);
+}
+
+const std::vector<Scenario> SCENARIOS = {
+    {.name = "Main Menu", .appName = nullptr},
+    {.name = "Painter Strokes", .appName = "Painter", .script = scriptPainterStrokes},
+    {.name = "Hue Sphere Spin", .appName = "Tetra Hue Sphere"}, // sphere spins on its own
+    {.name = "Image Viewer Cycle", .appName = "Image Viewer", .script = scriptImageViewerCycle},
+};
+
+struct Percentiles
+{
+    double p50;
+    double p95;
+    double p99;
+    double max;
+};
+
+// nearest-rank percentiles
+Percentiles computePercentiles(std::vector<double>& samples)
+{
+    ASSERT(!samples.empty());
+    std::sort(samples.begin(), samples.end());
+    auto rank = [&samples](double percentile) {
+        size_t idx = static_cast<size_t>(std::ceil(percentile * samples.size()));
+        return samples[std::clamp<size_t>(idx, 1, samples.size()) - 1];
+    };
+    return {rank(0.5), rank(0.95), rank(0.99), samples.back()};
+}
+
+// scope name -> per-tick milliseconds
+using ScenarioSamples = std::map<std::string, std::vector<double>>;
+
+using Apps = std::vector<std::pair<TetriumApp::App*, const char*>>;
+
+ScenarioSamples runScenario(
+    Tetrium* engine,
+    const Apps& apps,
+    const Scenario& scenario,
+    uint32_t numTicks
+)
+{
+    INFO("Running scenario [{}] for {} ticks...", scenario.name, numTicks);
+    TetriumApp::App* app = nullptr;
+    if (scenario.appName) {
+        engine->OpenApp(scenario.appName);
+        auto it = std::find_if(apps.begin(), apps.end(), [&scenario](const auto& namedApp) {
+            return strcmp(namedApp.second, scenario.appName) == 0;
+        });
+        ASSERT(it != apps.end());
+        app = it->first;
+    } else {
+        engine->CloseApp();
+    }
+
+    ScenarioSamples samples;
+    std::map<std::string, double> tickSamples;
+    for (uint32_t tick = 0; tick < NUM_WARMUP_TICKS + numTicks; tick++) {
+        if (scenario.script) {
+            scenario.script(tick, app);
+        }
+        auto tickBegin = std::chrono::steady_clock::now();
+        engine->Tick();
+        auto tickEnd = std::chrono::steady_clock::now();
+
+        if (tick < NUM_WARMUP_TICKS) {
+            continue;
+        }
+        // a scope may be entered multiple times a tick, accumulate them
+        tickSamples.clear();
+        for (const Profiler::Entry& entry : engine->GetLastProfilerData()) {
+            tickSamples[entry.name]
+                += std::chrono::duration<double, std::milli>(entry.end - entry.begin).count();
+        }
+        // GPU scopes lag a few ticks behind, which doesn't matter for their distribution
+        for (const GpuProfiler::Entry& entry : engine->GetLastGpuProfilerData()) {
+            tickSamples[std::string("GPU: ") + entry.name] += entry.endMs - entry.beginMs;
+        }
+        tickSamples[TICK_SAMPLE_NAME]
+            = std::chrono::duration<double, std::milli>(tickEnd - tickBegin).count();
+        for (const auto& [name, ms] : tickSamples) {
+            samples[name].push_back(ms);
+        }
+    }
+    return samples;
+}
+
+std::string escapeJson(const std::string& str)
+{
+    std::string escaped;
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+void writeResults(
+    const std::string& path,
+    uint32_t numTicks,
+    std::vector<std::pair<const Scenario*, ScenarioSamples>>& results
+)
+{
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        FATAL("Failed to open {} for writing", path);
+    }
+    out << "{\n";
+    out << "  \"ticks\": " << numTicks << ",\n";
+    out << "  \"warmupTicks\": " << NUM_WARMUP_TICKS << ",\n";
+    out << "  \"unit\": \"ms\",\n";
+    out << "  \"scenarios\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        auto& [scenario, samples] = results[i];
+        out << "    {\n";
+        out << "      \"name\": \"" << escapeJson(scenario->name) << "\",\n";
+        out << "      \"app\": "
+            << (scenario->appName ? "\"" + escapeJson(scenario->appName) + "\"" : "null") << ",\n";
+        out << "      \"scopes\": {\n";
+        size_t scopeIdx = 0;
+        for (auto& [name, scopeSamples] : samples) {
+            Percentiles p = computePercentiles(scopeSamples);
+            out << "        \"" << escapeJson(name) << "\": {"
+                << "\"samples\": " << scopeSamples.size() << ", \"p50\": " << p.p50
+                << ", \"p95\": " << p.p95 << ", \"p99\": " << p.p99 << ", \"max\": " << p.max
+                << "}" << (++scopeIdx < samples.size() ? "," : "") << "\n";
+        }
+        out << "      }\n";
+        out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    INIT_LOGS();
+
+    uint32_t numTicks = argc > 1 ? std::stoul(argv[1]) : DEFAULT_NUM_TICKS;
+    std::string outputPath = argc > 2 ? argv[2] : DEFAULT_OUTPUT_PATH;
+
+    Apps apps = TetriumApp::CreateDefaultApps();
+
+    Tetrium::InitOptions options{.tetraMode = Tetrium::TetraMode::kHeadless};
+    Tetrium* engine = new Tetrium();
+
+    for (auto& [app, appName] : apps) {
+        engine->RegisterApp(app, appName);
+    }
+
+    engine->Init(options);
+
+    std::vector<std::pair<const Scenario*, ScenarioSamples>> results;
+    for (const Scenario& scenario : SCENARIOS) {
+        results.emplace_back(&scenario, runScenario(engine, apps, scenario, numTicks));
+    }
+    engine->CloseApp();
+
+    writeResults(outputPath, numTicks, results);
+    INFO("Benchmark results written to {}", outputPath);
+
+    engine->Cleanup();
+
+    for (auto& [app, appName] : apps) {
+        delete app;
+    }
+
+    delete engine;
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <algorithm>
+
+#include "GpuProfiler.h"
+
+void GpuProfiler::Init(std::shared_ptr<VQDevice> device)
+{
+    _device = device;
+
+    uint32_t graphicsFamily = _device->queueFamilyIndices.graphicsFamily.value();
+    uint32_t validBits = _device->queueFamilyProperties[graphicsFamily].timestampValidBits;
+    if (validBits == 0) {
+        WARN("Graphics queue does not support timestamps, GPU profiling is disabled");
+        _timestampMask = 0;
+        return;
+    }
+    _timestampMask = validBits == 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+    _nanoSecondsPerTick = _device->properties.limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = MAX_SCOPES_PER_FRAME * 2; // begin & end of each scope
+    for (FrameSlot& slot : _frameSlots) {
+        VK_CHECK_RESULT(
+            vkCreateQueryPool(_device->logicalDevice, &poolInfo, nullptr, &slot.queryPool)
+        );
+        slot.numScopes = 0;
+    }
+    DEBUG("GPU profiler initialized, timestamp period: {} ns", _nanoSecondsPerTick);
+}
+
+void GpuProfiler::Cleanup()
+{
+    for (FrameSlot& slot : _frameSlots) {
+        if (slot.queryPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(_device->logicalDevice, slot.queryPool, nullptr);
+            slot.queryPool = VK_NULL_HANDLE;
+        }
+    }
+}
+
+void GpuProfiler::BeginFrame(uint8_t frameIdx)
+{
+    _currentFrame = frameIdx;
+    _level = 0;
+    FrameSlot& slot = _frameSlots[frameIdx];
+    _numLastFrameEntries = 0;
+    if (!IsSupported() || slot.numScopes == 0) {
+        return;
+    }
+
+    uint32_t numQueries = slot.numScopes * 2;
+    VkResult result = vkGetQueryPoolResults(
+        _device->logicalDevice,
+        slot.queryPool,
+        0,
+        numQueries,
+        numQueries * 2 * sizeof(uint64_t),
+        _queryResults.data(),
+        2 * sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
+    );
+    // VK_NOT_READY only if some queries never executed, those are skipped below
+    if (result != VK_NOT_READY) {
+        VK_CHECK_RESULT(result);
+    }
+
+    auto getTimestamp = [this](uint32_t query, uint64_t& timestamp) -> bool {
+        timestamp = _queryResults[query * 2] & _timestampMask;
+        return _queryResults[query * 2 + 1] != 0; // availability
+    };
+
+    // the first available timestamp is the frame's origin
+    uint64_t frameBegin = UINT64_MAX;
+    for (uint32_t query = 0; query < numQueries; query++) {
+        uint64_t timestamp;
+        if (getTimestamp(query, timestamp)) {
+            frameBegin = std::min(frameBegin, timestamp);
+        }
+    }
+
+    for (uint32_t scope = 0; scope < slot.numScopes; scope++) {
+        uint64_t begin, end;
+        if (!getTimestamp(scope * 2, begin) || !getTimestamp(scope * 2 + 1, end)) {
+            continue;
+        }
+        Entry& entry = _lastFrame[_numLastFrameEntries++];
+        entry.name = slot.names[scope];
+        entry.level = slot.levels[scope];
+        entry.beginMs = (begin - frameBegin) * _nanoSecondsPerTick / 1e6;
+        entry.endMs = (end - frameBegin) * _nanoSecondsPerTick / 1e6;
+    }
+    _lastFrameSubmitTime = slot.submitTime;
+    slot.numScopes = 0;
+}
+
+void GpuProfiler::ResetQueries(VkCommandBuffer commandBuffer)
+{
+    if (!IsSupported()) {
+        return;
+    }
+    FrameSlot& slot = _frameSlots[_currentFrame];
+    ASSERT(slot.numScopes == 0);
+    vkCmdResetQueryPool(commandBuffer, slot.queryPool, 0, MAX_SCOPES_PER_FRAME * 2);
+}
+
+int GpuProfiler::Push(VkCommandBuffer commandBuffer, const char* name)
+{
+    int level = _level++;
+    FrameSlot& slot = _frameSlots[_currentFrame];
+    if (!IsSupported() || slot.numScopes == MAX_SCOPES_PER_FRAME) {
+        return -1;
+    }
+    int scope = slot.numScopes++;
+    slot.names[scope] = name;
+    slot.levels[scope] = level;
+    vkCmdWriteTimestamp(
+        commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, slot.queryPool, scope * 2
+    );
+    return scope;
+}
+
+void GpuProfiler::Pop(VkCommandBuffer commandBuffer, int scope)
+{
+    _level--;
+    if (scope == -1) {
+        return;
+    }
+    FrameSlot& slot = _frameSlots[_currentFrame];
+    vkCmdWriteTimestamp(
+        commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, slot.queryPool, scope * 2 + 1
+    );
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <span>
+
+#include <vulkan/vulkan.h>
+
+#include "Profiler.h" // USE_PROFILER
+#include "lib/VQDevice.h"
+
+// GPU counterpart of `Profiler`, measures the GPU time of command buffer sections.
+//
+// A scope writes a pair of timestamps into the query pool of the frame in flight being recorded.
+// A frame slot's results are read back in `BeginFrame()`, after the slot's `fenceInFlight` has
+// signalled, so the readback never stalls; GPU scopes therefore lag `NUM_FRAME_IN_FLIGHT` ticks
+// behind the CPU scopes.
+class GpuProfiler
+{
+  public:
+    static constexpr uint32_t MAX_SCOPES_PER_FRAME = 64; // scopes past that are dropped
+
+    struct Entry
+    {
+        const char* name;
+        double beginMs; // relative to the frame's first timestamp
+        double endMs;
+        int level;
+    };
+
+    struct Profiling
+    {
+        GpuProfiler* parent;
+        VkCommandBuffer commandBuffer;
+        int scope;
+        Profiling() = delete;
+
+        Profiling(GpuProfiler* parent, VkCommandBuffer commandBuffer, const char* name)
+            : parent(parent), commandBuffer(commandBuffer)
+        {
+            scope = parent->Push(commandBuffer, name);
+        }
+
+        ~Profiling() { parent->Pop(commandBuffer, scope); }
+    };
+
+    void Init(std::shared_ptr<VQDevice> device);
+    void Cleanup();
+
+    // whether the graphics queue supports timestamps; scopes are no-ops otherwise.
+    bool IsSupported() const { return _timestampMask != 0; }
+
+    // Reads back the scopes last recorded into `frameIdx`'s slot and directs subsequent scopes to
+    // that slot. Call right after waiting on the frame's fence.
+    void BeginFrame(uint8_t frameIdx);
+
+    // Resets the current slot's queries. Record into the frame's first submitted command buffer,
+    // outside of any render pass and before any scope.
+    void ResetQueries(VkCommandBuffer commandBuffer);
+
+    // returns the scope's index, -1 if the scope is dropped.
+    int Push(VkCommandBuffer commandBuffer, const char* name);
+    void Pop(VkCommandBuffer commandBuffer, int scope);
+
+    // stamps the CPU time the current slot's command buffers were submitted at, lets the GPU
+    // scopes be laid out on the CPU timeline without calibrated timestamps.
+    void MarkSubmitted() { _frameSlots[_currentFrame].submitTime = Profiler::Clock::now(); }
+
+    // scopes of the last frame read back by `BeginFrame()`, in the order they were pushed
+    std::span<const Entry> GetLastFrame() const
+    {
+        return std::span<const Entry>(_lastFrame.data(), _numLastFrameEntries);
+    }
+
+    Profiler::TimeUnit GetLastFrameSubmitTime() const { return _lastFrameSubmitTime; }
+
+  private:
+    struct FrameSlot
+    {
+        VkQueryPool queryPool = VK_NULL_HANDLE;
+        uint32_t numScopes = 0;
+        std::array<const char*, MAX_SCOPES_PER_FRAME> names;
+        std::array<int, MAX_SCOPES_PER_FRAME> levels;
+        Profiler::TimeUnit submitTime;
+    };
+
+    std::shared_ptr<VQDevice> _device = nullptr;
+    uint64_t _timestampMask = 0; // valid bits of a timestamp, 0 if timestamps are not supported
+    double _nanoSecondsPerTick = 0;
+
+    std::array<FrameSlot, NUM_FRAME_IN_FLIGHT> _frameSlots;
+    uint8_t _currentFrame = 0;
+    int _level = 0;
+
+    // raw query results, pairs of (timestamp, availability)
+    std::array<uint64_t, MAX_SCOPES_PER_FRAME * 2 * 2> _queryResults;
+    std::array<Entry, MAX_SCOPES_PER_FRAME> _lastFrame;
+    size_t _numLastFrameEntries = 0;
+    Profiler::TimeUnit _lastFrameSubmitTime;
+};
+
+// profiler macros
+
+#ifdef USE_PROFILER
+#define PROFILE_GPU_SCOPE(gpuProfiler, commandBuffer, name)                                        \
+    const auto __gpuProfiling = GpuProfiler::Profiling(gpuProfiler, commandBuffer, name);
+#else
+#define PROFILE_GPU_SCOPE(gpuProfiler, commandBuffer, name) (0)
+#endif
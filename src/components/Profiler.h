@@ -1,80 +1,353 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+
 // inspired by cgc profiler
 
-// Scope-based profiler utility that records time and 
+// Scope-based profiler utility that records time and
 // call hierarchy information for subroutines.
+//
+// Every thread that profiles owns a ring of `NUM_RING_FRAMES` frames, each holding up to
+// `MAX_ENTRIES_PER_FRAME` entries. The ring is allocated once on the thread's first `Push()`,
+// recording never allocates afterwards. `NewFrame()` closes the current frame, gathers the entries
+// of every thread's ring and folds them into rolling per-scope statistics over the last
+// `STATS_WINDOW` frames; the window is kept per scope, so the rings only hold the frame being
+// recorded and the one being gathered.
+//
+// Each profiled thread costs a ring of ~10 KB, and `NewFrame()` walks every ring, so both memory
+// and the per-frame gathering scale with the number of threads that profile.
 class Profiler
 {
   public:
-#ifdef __linux__
-    using TimeUnit = std::chrono::time_point<
-    std::chrono::system_clock,
-    std::chrono::duration<long, std::ratio<1, 1000000000>>>;
-#else 
-    using TimeUnit = std::chrono::time_point<
-    std::chrono::steady_clock,
-    std::chrono::duration<long, std::ratio<1, 1000000000>>>;
-#endif
+    // monotonic, unlike system_clock that jumps with NTP adjustments
+    using Clock = std::chrono::steady_clock;
+    using TimeUnit = Clock::time_point;
+
+    static constexpr size_t STATS_WINDOW = 256; // frames the per-scope stats are taken over
+    static constexpr size_t NUM_RING_FRAMES = 2; // the frame being recorded and the closed one
+    static constexpr size_t MAX_ENTRIES_PER_FRAME = 128; // entries past that are dropped
+    static constexpr size_t MAX_THREADS = 16;
+    static constexpr size_t MAX_SCOPES = 64; // distinct scope names tracked by the stats
+
+    static constexpr TimeUnit OPEN = TimeUnit::min();
+
+    struct Entry
+    {
+        const char* name;
+        TimeUnit begin;
+        TimeUnit end; // `OPEN` until the scope is popped
+        int level;
+        uint32_t threadIdx; // index of the recording thread, in order of the threads' first push
+        uint64_t frameNumber; // frame the scope was pushed in
+    };
+
+    // rolling statistics of a scope, over the last `numSamples` frames the scope was entered in.
+    // a scope entered multiple times in one frame counts as the sum of the entries.
+    struct ScopeStats
+    {
+        const char* name = nullptr;
+        double lastMs = 0; // last frame the scope was entered in
+        double meanMs = 0;
+        double p99Ms = 0;
+        double maxMs = 0;
+        uint32_t numSamples = 0;
+    };
 
     struct Profling
     {
         Profiler* parent;
-        int id;
+        Entry* entry;
+        Entry pushed;
         Profling() = delete;
 
-        Profling(Profiler* parent, const char* name) : parent(parent) {
-            id = parent->Push(name);
+        Profling(Profiler* parent, const char* name) : parent(parent)
+        {
+            entry = parent->Push(name, pushed);
         }
 
-        ~Profling() { parent->Pop(id); }
+        ~Profling() { parent->Pop(entry, pushed); }
     };
 
-    struct Entry
+    Profiler() : _instanceId(nextInstanceId()) {}
+
+    // returns nullptr if the entry is dropped, because the frame is full or the profiler ran out
+    // of thread rings. `pushed` receives a copy of the entry, to be handed back to `Pop()`.
+    Entry* Push(const char* name, Entry& pushed)
     {
-        const char* name;
-        TimeUnit begin;
-        TimeUnit end;
-        int level;
-    };
+        ThreadRing* pRing = getThreadRing();
+        if (!pRing) {
+            return nullptr;
+        }
+        ThreadRing& ring = *pRing;
+        int level = ring.level++;
+        std::lock_guard<std::mutex> lock(ring.mutex);
+        Frame& frame = ring.GetFrame(_frameNumber.load(std::memory_order_acquire));
+        if (frame.numEntries == MAX_ENTRIES_PER_FRAME) {
+            frame.numDropped++;
+            return nullptr;
+        }
+        Entry& entry = frame.entries[frame.numEntries++];
+        entry.name = name;
+        entry.level = level;
+        entry.threadIdx = ring.threadIdx;
+        entry.frameNumber = frame.frameNumber;
+        entry.begin = Clock::now();
+        entry.end = OPEN;
+        pushed = entry;
+        return &entry;
+    }
 
-    Profiler() {
-        _currEntryLevel = 0;
-        _profileData = std::make_unique<std::vector<Profiler::Entry>>();
+    void Pop(Entry* entry, const Entry& pushed)
+    {
+        TimeUnit now = Clock::now();
+        ThreadRing* pRing = getThreadRing();
+        if (!pRing) {
+            return;
+        }
+        ThreadRing& ring = *pRing;
+        ring.level--;
+        if (!entry) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(ring.mutex);
+        Frame& frame = ring.GetFrame(_frameNumber.load(std::memory_order_acquire));
+        if (pushed.frameNumber == frame.frameNumber) {
+            entry->end = now;
+            return;
+        }
+        // the scope outlived the frame it was pushed in, which may have been gathered already
+        // with the scope still open; it is reported in the frame it's popped in instead. The
+        // frame's slot may have been recycled since, so the copy taken on push is reported.
+        if (frame.numEntries == MAX_ENTRIES_PER_FRAME) {
+            frame.numDropped++;
+            return;
+        }
+        Entry& closedEntry = frame.entries[frame.numEntries++];
+        closedEntry = pushed;
+        closedEntry.end = now;
     }
 
+    // Closes the current frame and starts a new one, should be called every Tick from the
+    // thread that owns the frame loop. Returns the closed frame's entries of every thread, grouped
+    // by thread in `Entry::threadIdx` order, which stay valid until the next `NewFrame()`.
+    // Scopes still open on other threads are left out, and reported in the frame they end in.
+    std::span<const Entry> NewFrame()
+    {
+        uint64_t frameNumber = _frameNumber.load(std::memory_order_relaxed);
+        // threads push into the next frame from now on, the closed one can be gathered
+        _frameNumber.store(frameNumber + 1, std::memory_order_release);
 
-    int Push(const char* name) {
-        Entry entry;
-        entry.name = name;
-        entry.begin = std::chrono::high_resolution_clock::now();
-        entry.level = _currEntryLevel;
+        uint32_t numThreadRings;
+        {
+            std::lock_guard<std::mutex> lock(_threadRingsMutex);
+            numThreadRings = _numThreadRings;
+        }
+        size_t numDropped = 0;
+        _numFrameEntries = 0;
+        for (uint32_t threadIdx = 0; threadIdx < numThreadRings; threadIdx++) {
+            ThreadRing& ring = *_threadRings[threadIdx];
+            std::lock_guard<std::mutex> lock(ring.mutex);
+            const Frame& frame = ring.frames[frameNumber % NUM_RING_FRAMES];
+            if (frame.frameNumber != frameNumber) { // the thread has not pushed in the frame
+                continue;
+            }
+            numDropped += frame.numDropped;
+            for (size_t i = 0; i < frame.numEntries; i++) {
+                if (frame.entries[i].end != OPEN) {
+                    _frameEntries[_numFrameEntries++] = frame.entries[i];
+                }
+            }
+        }
+        if (numDropped != 0) {
+            WARN("Profiler dropped {} entries in frame {}", numDropped, frameNumber);
+        }
 
-        _profileData->push_back(entry);
+        std::span<const Entry> entries(_frameEntries.data(), _numFrameEntries);
+        updateScopeStats(entries);
+        return entries;
+    }
 
-        int entryId = _profileData->size() - 1;
-        _currEntryLevel++;
-        return entryId;
+    // threads that have profiled so far, the bound of `Entry::threadIdx`
+    uint32_t GetNumThreads()
+    {
+        std::lock_guard<std::mutex> lock(_threadRingsMutex);
+        return _numThreadRings;
     }
 
-    void Pop(int entryId) {
-        Entry& entry = _profileData->at(entryId);
-        entry.end = std::chrono::high_resolution_clock::now();
-        _currEntryLevel--;
+    uint64_t GetFrameNumber() const { return _frameNumber.load(std::memory_order_relaxed); }
+
+    // stats are updated in `NewFrame()`, read them from the same thread.
+    std::span<const ScopeStats> GetScopeStats() const
+    {
+        return std::span<const ScopeStats>(_scopeStats.data(), _numScopes);
     }
 
-    // Clears all entries that has been profiled, 
-    // returns all entries that has been profiled. should be called every Tick
-    std::unique_ptr<std::vector<Profiler::Entry>> NewProfile() {
-        _currEntryLevel = 0;
-        auto lastProfileData = std::move(_profileData);
-        _profileData = std::make_unique<std::vector<Profiler::Entry>>();
-        return lastProfileData;
+    const ScopeStats* FindScopeStats(const char* name) const
+    {
+        int scopeIdx = findScope(name);
+        return scopeIdx == -1 ? nullptr : &_scopeStats[scopeIdx];
     }
 
   private:
-    int _currEntryLevel = 0;
-    std::unique_ptr<std::vector<Profiler::Entry>> _profileData;
+    struct Frame
+    {
+        uint64_t frameNumber = UINT64_MAX;
+        size_t numEntries = 0;
+        size_t numDropped = 0;
+        std::array<Entry, MAX_ENTRIES_PER_FRAME> entries;
+    };
+
+    struct ThreadRing
+    {
+        uint32_t threadIdx;
+        int level = 0; // only touched by the owning thread
+        // guards `frames` against `NewFrame()` gathering them, uncontended otherwise
+        std::mutex mutex;
+        std::array<Frame, NUM_RING_FRAMES> frames;
+
+        // frame slots are recycled lazily, the first time a thread touches a new frame
+        Frame& GetFrame(uint64_t frameNumber)
+        {
+            Frame& frame = frames[frameNumber % NUM_RING_FRAMES];
+            if (frame.frameNumber != frameNumber) {
+                frame.frameNumber = frameNumber;
+                frame.numEntries = 0;
+                frame.numDropped = 0;
+            }
+            return frame;
+        }
+    };
+
+    // per-scope window of per-frame samples backing `ScopeStats`
+    struct ScopeSamples
+    {
+        std::array<float, STATS_WINDOW> ms;
+        size_t head = 0; // next slot to write
+        double sum = 0;
+    };
+
+    static uint64_t nextInstanceId()
+    {
+        static std::atomic<uint64_t> instanceCounter = 0;
+        return instanceCounter++;
+    }
+
+    ThreadRing* getThreadRing()
+    {
+        // cache of the calling thread's ring, tagged with the owning profiler instance
+        thread_local struct
+        {
+            uint64_t instanceId = UINT64_MAX;
+            ThreadRing* ring = nullptr;
+        } cache;
+        if (cache.instanceId != _instanceId) {
+            cache.ring = registerThread();
+            cache.instanceId = _instanceId;
+        }
+        return cache.ring;
+    }
+
+    // rings are never recycled, short-lived threads should not be profiled
+    ThreadRing* registerThread()
+    {
+        std::lock_guard<std::mutex> lock(_threadRingsMutex);
+        if (_numThreadRings == MAX_THREADS) {
+            if (!_warnedOutOfThreadRings) {
+                WARN("Profiler supports up to {} threads, dropping entries", MAX_THREADS);
+                _warnedOutOfThreadRings = true;
+            }
+            return nullptr;
+        }
+        std::unique_ptr<ThreadRing>& ring = _threadRings[_numThreadRings];
+        ring = std::make_unique<ThreadRing>();
+        ring->threadIdx = _numThreadRings++;
+        return ring.get();
+    }
+
+    int findScope(const char* name) const
+    {
+        for (size_t i = 0; i < _numScopes; i++) {
+            // names are mostly string literals, compare pointers before contents
+            if (_scopeStats[i].name == name || strcmp(_scopeStats[i].name, name) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    void updateScopeStats(std::span<const Entry> entries)
+    {
+        std::array<double, MAX_SCOPES> frameMs;
+        std::array<bool, MAX_SCOPES> entered = {};
+        for (const Entry& entry : entries) {
+            int scopeIdx = findScope(entry.name);
+            if (scopeIdx == -1) {
+                if (_numScopes == MAX_SCOPES) {
+                    continue;
+                }
+                scopeIdx = _numScopes++;
+                _scopeStats[scopeIdx] = ScopeStats{.name = entry.name};
+                _scopeSamples[scopeIdx] = ScopeSamples{};
+            }
+            double ms = std::chrono::duration<double, std::milli>(entry.end - entry.begin).count();
+            frameMs[scopeIdx] = entered[scopeIdx] ? frameMs[scopeIdx] + ms : ms;
+            entered[scopeIdx] = true;
+        }
+
+        for (size_t scopeIdx = 0; scopeIdx < _numScopes; scopeIdx++) {
+            if (!entered[scopeIdx]) {
+                continue;
+            }
+            ScopeStats& stats = _scopeStats[scopeIdx];
+            ScopeSamples& samples = _scopeSamples[scopeIdx];
+            float ms = static_cast<float>(frameMs[scopeIdx]);
+
+            if (stats.numSamples == STATS_WINDOW) { // evict the oldest sample
+                samples.sum -= samples.ms[samples.head];
+            } else {
+                stats.numSamples++;
+            }
+            samples.ms[samples.head] = ms;
+            samples.head = (samples.head + 1) % STATS_WINDOW;
+            samples.sum += ms;
+
+            stats.lastMs = ms;
+            stats.meanMs = samples.sum / stats.numSamples;
+
+            // samples are in ring order, sort a copy for the percentile
+            std::copy_n(samples.ms.begin(), stats.numSamples, _scratch.begin());
+            auto end = _scratch.begin() + stats.numSamples;
+            auto p99 = _scratch.begin() + (stats.numSamples - 1) * 99 / 100;
+            std::nth_element(_scratch.begin(), p99, end);
+            stats.p99Ms = *p99;
+            stats.maxMs = *std::max_element(p99, end);
+        }
+    }
+
+    const uint64_t _instanceId;
+    std::atomic<uint64_t> _frameNumber = 0;
+
+    std::mutex _threadRingsMutex;
+    std::array<std::unique_ptr<ThreadRing>, MAX_THREADS> _threadRings;
+    uint32_t _numThreadRings = 0;
+    bool _warnedOutOfThreadRings = false;
+
+    // every thread's entries of the last closed frame
+    std::array<Entry, MAX_THREADS * MAX_ENTRIES_PER_FRAME> _frameEntries;
+    size_t _numFrameEntries = 0;
+
+    size_t _numScopes = 0;
+    std::array<ScopeStats, MAX_SCOPES> _scopeStats;
+    std::array<ScopeSamples, MAX_SCOPES> _scopeSamples;
+    std::array<float, STATS_WINDOW> _scratch;
 };
 
 // profiler macros
@@ -82,7 +355,7 @@ class Profiler
 #define USE_PROFILER
 
 #ifdef USE_PROFILER
-#define PROFILE_SCOPE(profiler, name)                                          \
+#define PROFILE_SCOPE(profiler, name)                                                              \
     const auto __profling = Profiler::Profling(profiler, name);
 #else
 #define PROFILE_SCOPE(profiler) (0)
@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+#include "TextureDiskCache.h"
+#include "lib/BC7Encoder.h"
+#include "lib/SrgbDownsample.h"
+#include "lib/TetraImage.h"
+#include <stb_image.h>
+
+namespace TextureDiskCache
+{
+namespace
+{
+// bump whenever the layout or the content of cache files changes
+const uint32_t CACHE_VERSION = 1;
+const std::array<char, 4> CACHE_MAGIC = {'T', 'T', 'E', 'X'};
+const uint32_t MAX_LEVELS = 32;
+
+struct __CacheHeader
+{
+    std::array<char, 4> magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t numLevels; // followed by as many `TextureData::Level`s, then the texels
+    uint64_t numTexelBytes;
+};
+
+bool readFile(const std::string& path, std::vector<uint8_t>& bytes)
+{
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(path, error);
+    if (error) {
+        return false;
+    }
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    bytes.resize(size);
+    bool ok = fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    fclose(file);
+    return ok;
+}
+
+// FNV-1a; cheap next to decoding, and collisions are further guarded by the size in the name
+uint64_t hashContent(const std::vector<uint8_t>& bytes)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (uint8_t byte : bytes) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string getCachePath(const std::vector<uint8_t>& content, const Options& options)
+{
+    return fmt::format(
+        "{}{:016x}{:x}_{}{}.ttex",
+        DIRECTORIES::TEXTURE_CACHE,
+        hashContent(content),
+        content.size(),
+        options.compressBC7 ? "bc7" : "rgba8",
+        options.generateMipmaps ? "_mips" : ""
+    );
+}
+
+// empty if the image can't be stat'ed
+std::string getThumbnailCachePath(const std::string& path, const Options& options)
+{
+    std::error_code error;
+    std::filesystem::path imagePath(path);
+    uintmax_t size = std::filesystem::file_size(imagePath, error);
+    if (error) {
+        return "";
+    }
+    std::filesystem::file_time_type mtime = std::filesystem::last_write_time(imagePath, error);
+    if (error) {
+        return "";
+    }
+    return fmt::format(
+        "{}{}_{:x}_{:x}_{}_{}{}.ttex",
+        (imagePath.parent_path() / DIRECTORIES::THUMBNAIL_CACHE).string(),
+        imagePath.filename().string(),
+        size,
+        static_cast<uint64_t>(mtime.time_since_epoch().count()),
+        options.maxExtent,
+        options.compressBC7 ? "bc7" : "rgba8",
+        options.generateMipmaps ? "_mips" : ""
+    );
+}
+
+// false on a miss, or if the file is stale or corrupt
+bool readCache(const std::string& cachePath, TextureData& data)
+{
+    FILE* file = fopen(cachePath.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    __CacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && header.magic == CACHE_MAGIC
+              && header.version == CACHE_VERSION && header.numLevels > 0
+              && header.numLevels <= MAX_LEVELS;
+    if (ok) {
+        data.format = static_cast<VkFormat>(header.format);
+        data.width = header.width;
+        data.height = header.height;
+        data.levels.resize(header.numLevels);
+        ok = fread(data.levels.data(), sizeof(TextureData::Level), data.levels.size(), file)
+             == data.levels.size();
+    }
+    for (size_t i = 0; ok && i < data.levels.size(); i++) {
+        const TextureData::Level& level = data.levels[i];
+        ok = level.offset + level.size <= header.numTexelBytes;
+    }
+    if (ok) {
+        data.texels.resize(header.numTexelBytes);
+        ok = fread(data.texels.data(), 1, data.texels.size(), file) == data.texels.size();
+    }
+    fclose(file);
+    if (!ok) {
+        WARN("Discarding invalid texture cache file {}", cachePath);
+    }
+    return ok;
+}
+
+void writeCache(const std::string& cachePath, const TextureData& data)
+{
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+    // written aside and renamed, so that readers never see a partial file
+    std::string tempPath = fmt::format(
+        "{}.{}.tmp", cachePath, std::hash<std::thread::id>{}(std::this_thread::get_id())
+    );
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        WARN("Failed to create texture cache file {}", tempPath);
+        return;
+    }
+    __CacheHeader header{
+        .magic = CACHE_MAGIC,
+        .version = CACHE_VERSION,
+        .format = static_cast<uint32_t>(data.format),
+        .width = data.width,
+        .height = data.height,
+        .numLevels = static_cast<uint32_t>(data.levels.size()),
+        .numTexelBytes = data.texels.size()};
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+              && fwrite(data.levels.data(), sizeof(TextureData::Level), data.levels.size(), file)
+                     == data.levels.size()
+              && fwrite(data.texels.data(), 1, data.texels.size(), file) == data.texels.size();
+    ok = fclose(file) == 0 && ok;
+    if (ok) {
+        std::filesystem::rename(tempPath, cachePath, error);
+        ok = !error;
+    }
+    if (!ok) {
+        WARN("Failed to write texture cache file {}", cachePath);
+        std::filesystem::remove(tempPath, error);
+    }
+}
+
+std::optional<TextureData> transcode(
+    const std::string& path,
+    const std::vector<uint8_t>& content,
+    const Options& options
+)
+{
+    int width, height, channels;
+    stbi_uc* pixels = stbi_load_from_memory(
+        content.data(), content.size(), &width, &height, &channels, STBI_rgb_alpha
+    );
+    if (!pixels) {
+        ERROR("Failed to decode texture {}: {}", path, stbi_failure_reason());
+        return std::nullopt;
+    }
+
+    // halved like mip levels, so that thumbnails are filtered alike
+    uint32_t baseWidth = width;
+    uint32_t baseHeight = height;
+    const uint8_t* base = pixels;
+    std::vector<uint8_t> reduced;
+    while (options.maxExtent != 0 && std::max(baseWidth, baseHeight) > options.maxExtent) {
+        uint32_t halfWidth = std::max(1u, baseWidth / 2);
+        uint32_t halfHeight = std::max(1u, baseHeight / 2);
+        std::vector<uint8_t> half(static_cast<size_t>(halfWidth) * halfHeight * 4);
+        SrgbDownsample::Downsample(base, baseWidth, baseHeight, half.data(), halfWidth, halfHeight);
+        reduced.swap(half);
+        base = reduced.data();
+        baseWidth = halfWidth;
+        baseHeight = halfHeight;
+    }
+
+    // RGBA8 mip chain, levels back to back
+    uint32_t numLevels
+        = options.generateMipmaps ? std::bit_width(std::max(baseWidth, baseHeight)) : 1;
+    std::vector<TextureData::Level> rgbaLevels;
+    VkDeviceSize rgbaSize = 0;
+    for (uint32_t i = 0; i < numLevels; i++) {
+        uint32_t levelWidth = std::max(1u, baseWidth >> i);
+        uint32_t levelHeight = std::max(1u, baseHeight >> i);
+        VkDeviceSize size = static_cast<VkDeviceSize>(levelWidth) * levelHeight * 4;
+        rgbaLevels.push_back({rgbaSize, size, levelWidth, levelHeight});
+        rgbaSize += size;
+    }
+    std::vector<uint8_t> rgba(rgbaSize);
+    memcpy(rgba.data(), base, rgbaLevels[0].size);
+    stbi_image_free(pixels);
+    for (uint32_t i = 1; i < numLevels; i++) {
+        const TextureData::Level& src = rgbaLevels[i - 1];
+        const TextureData::Level& dst = rgbaLevels[i];
+        SrgbDownsample::Downsample(
+            rgba.data() + src.offset,
+            src.width,
+            src.height,
+            rgba.data() + dst.offset,
+            dst.width,
+            dst.height
+        );
+    }
+
+    TextureData data{.format = VK_FORMAT_R8G8B8A8_SRGB, .width = baseWidth, .height = baseHeight};
+    if (!options.compressBC7) {
+        data.levels = std::move(rgbaLevels);
+        data.texels = std::move(rgba);
+        return data;
+    }
+
+    data.format = VK_FORMAT_BC7_SRGB_BLOCK;
+    VkDeviceSize bc7Size = 0;
+    for (const TextureData::Level& level : rgbaLevels) {
+        VkDeviceSize size = BC7Encoder::GetEncodedSize(level.width, level.height);
+        data.levels.push_back({bc7Size, size, level.width, level.height});
+        bc7Size += size;
+    }
+    data.texels.resize(bc7Size);
+    for (uint32_t i = 0; i < numLevels; i++) {
+        BC7Encoder::EncodeImage(
+            rgba.data() + rgbaLevels[i].offset,
+            rgbaLevels[i].width,
+            rgbaLevels[i].height,
+            data.texels.data() + data.levels[i].offset
+        );
+    }
+    return data;
+}
+
+bool isTetraImage(const std::string& path)
+{
+    return std::filesystem::path(path).extension() == TetraImage::FILE_EXTENSION;
+}
+
+// A plane's mip chain is stored as it's uploaded, the texels are left in the mapped file for
+// the upload to copy from. Downscaling picks the first level that fits, which is what halving
+// the full image would make; BC7 isn't worth a transcode of images that are meant to be exact.
+std::optional<TextureData> loadTetraImage(const std::string& path, const Options& options)
+{
+    TetraImage::Reader reader;
+    if (!reader.Open(path)) {
+        return std::nullopt;
+    }
+    const std::vector<TetraImage::Level>& levels = reader.GetLayout().planes[options.plane];
+    size_t baseLevel = 0;
+    while (options.maxExtent != 0 && baseLevel + 1 < levels.size()
+           && std::max(levels[baseLevel].width, levels[baseLevel].height) > options.maxExtent) {
+        baseLevel++;
+    }
+    size_t endLevel = options.generateMipmaps ? levels.size() : baseLevel + 1;
+
+    const TetraImage::Level& base = levels[baseLevel];
+    TextureData data{
+        .format = VK_FORMAT_R8G8B8A8_SRGB,
+        .width = base.width,
+        .height = base.height,
+        .mapping = reader.GetMapping()};
+    for (size_t i = baseLevel; i < endLevel; i++) {
+        data.levels.push_back(
+            {levels[i].offset - base.offset, levels[i].size, levels[i].width, levels[i].height}
+        );
+    }
+    const TextureData::Level& last = data.levels.back();
+    data.mappedTexels = {
+        reader.GetTexels(options.plane, baseLevel), static_cast<size_t>(last.offset + last.size)
+    };
+    return data;
+}
+} // namespace
+
+std::optional<TextureData> Load(const std::string& path, const Options& options)
+{
+    if (isTetraImage(path)) {
+        return loadTetraImage(path, options);
+    }
+    TextureData data;
+    std::string cachePath = options.maxExtent != 0 ? getThumbnailCachePath(path, options) : "";
+    if (!cachePath.empty() && readCache(cachePath, data)) {
+        return data;
+    }
+    std::vector<uint8_t> content;
+    if (!readFile(path, content)) {
+        ERROR("Failed to read texture {}", path);
+        return std::nullopt;
+    }
+    if (options.maxExtent == 0) {
+        cachePath = getCachePath(content, options);
+        if (readCache(cachePath, data)) {
+            return data;
+        }
+    }
+    std::optional<TextureData> transcoded = transcode(path, content, options);
+    if (transcoded.has_value() && !cachePath.empty()) {
+        writeCache(cachePath, transcoded.value());
+    }
+    return transcoded;
+}
+} // namespace TextureDiskCache
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "lib/MappedFile.h"
+#include "structs/ColorSpace.h"
+
+// texels of a 2D texture and its mip chain, ready to be copied into an image
+struct TextureData
+{
+    struct Level
+    {
+        VkDeviceSize offset; // into `GetTexels()`
+        VkDeviceSize size;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
+    std::vector<Level> levels; // largest first
+    std::vector<uint8_t> texels;
+    // for files stored ready to upload, the texels are read from the mapped file in place
+    // instead of `texels`, and keep it mapped
+    std::shared_ptr<const MappedFile> mapping;
+    std::span<const uint8_t> mappedTexels;
+
+    std::span<const uint8_t> GetTexels() const { return mapping ? mappedTexels : texels; }
+};
+
+// Turns image files into `TextureData`: decoded, mip-mapped, and optionally BC7-compressed.
+//
+// Results are written under `DIRECTORIES::TEXTURE_CACHE`, keyed by a hash of the file's content
+// and the options, so later loads of the same image read them back instead of decoding it again.
+// Downscaled images go to `DIRECTORIES::THUMBNAIL_CACHE` next to the image instead, keyed by its
+// name, size and modification time, so that a hit doesn't read the image at all.
+// `.tetra` images are mapped and served from their file instead, which already holds the mips.
+// Thread-safe; concurrent loads of one image may both transcode it, the last write wins.
+namespace TextureDiskCache
+{
+struct Options
+{
+    bool generateMipmaps = true;
+    // lossy; the RGBA8 output is bit-exact with the decoded image
+    bool compressBC7 = false;
+    // halves the image until neither side exceeds it, for thumbnails; 0 keeps the full size
+    uint32_t maxExtent = 0;
+    // the plane of `.tetra` images to load, ignored for other files
+    ColorSpace plane = ColorSpace::RGB;
+};
+
+// `std::nullopt` if the file can't be read or decoded
+std::optional<TextureData> Load(const std::string& path, const Options& options);
+} // namespace TextureDiskCache
@@ -1,109 +1,171 @@
+#include <algorithm>
+#include <filesystem>
+#include <tuple>
+
 #include "backends/imgui_impl_vulkan.h"
 
+#include "ShaderUtils.h"
 #include "TextureManager.h"
 #include "lib/VQBuffer.h"
 #include "lib/VulkanUtils.h"
-#include <stb_image.h>
 #include <vulkan/vulkan_core.h>
 
 namespace
 {
-uint32_t findMemoryType(
-    VkPhysicalDevice physicalDevice,
-    uint32_t typeFilter,
-    VkMemoryPropertyFlags properties
+// textures smaller than this are staged through the ring, larger ones get a buffer of their own
+const VkDeviceSize STAGING_RING_SIZE = 64 * 1024 * 1024;
+const uint32_t MAX_DECODE_WORKERS = 4;
+// bound while an async texture loads; mid-grey reads as neutral in both color spaces
+const std::array<uint8_t, 4> PLACEHOLDER_PIXEL = {128, 128, 128, 255};
+const char* EQUIRECTANGULAR_SHADER_PATH = "../shaders/equirect_to_cubemap.comp.spv";
+const uint32_t EQUIRECTANGULAR_GROUP_SIZE = 8; // `local_size_x/y` of the shader
+
+// image for a streamed texture; shared between the transfer and graphics families if they
+// differ, so that no ownership transfer is needed once the upload finishes.
+void createStreamedImage(
+    std::shared_ptr<VQDevice> device,
+    const TextureData& data,
+    VkImage& image,
+    VQAllocation& imageMemory
 )
 {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i))
-            && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
+    const QueueFamilyIndices& indices = device->queueFamilyIndices;
+    std::array<uint32_t, 2> queueFamilies
+        = {indices.graphicsFamily.value(), indices.transferFamily.value()};
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {data.width, data.height, 1};
+    imageInfo.mipLevels = data.levels.size();
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = data.format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    if (queueFamilies[0] != queueFamilies[1]) {
+        imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = queueFamilies.size();
+        imageInfo.pQueueFamilyIndices = queueFamilies.data();
+    } else {
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     }
-    PANIC("Failed to find suitable memory type!");
+    VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageInfo, nullptr, &image));
+
+    imageMemory
+        = device->memoryAllocator.AllocateImageMemory(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 }
 } // namespace
 
-// temporary LUT utilities
-// TODO: this slows down image loading and doens't work for raster, should implement a LUT
-// post-processing pass
-namespace LUT
-{
-using LUTChannel = std::array<uint8_t, 256>;
-
-constexpr LUTChannel GetIdLUTChannel()
+TextureManager::~TextureManager()
 {
-    LUTChannel idChannel;
-    for (int i = 0; i < idChannel.size(); i++) {
-        idChannel.at(i) = i;
+    if (!_textures.empty()) {
+        PANIC("Textures must be cleaned up before ending texture manager!");
     }
-
-    return idChannel;
 }
 
-const LUTChannel LUT_CHANNELS_RGBA[4] = {
-    // RED
-    {0,   2,   3,   4,   5,   6,   7,   8,   9,   9,   10,  12,  12,  13,  15,  16,  17,  17,  19,
-     20,  21,  22,  23,  24,  24,  25,  26,  27,  28,  29,  30,  31,  32,  34,  35,  36,  37,  38,
-     39,  40,  41,  41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51,  52,  53,  54,  55,  56,
-     57,  58,  59,  60,  61,  62,  63,  65,  66,  67,  68,  69,  70,  71,  72,  73,  74,  75,  76,
-     77,  78,  79,  80,  81,  82,  83,  84,  85,  86,  87,  88,  88,  89,  90,  91,  92,  93,  94,
-     95,  97,  98,  99,  100, 101, 102, 103, 104, 105, 105, 106, 107, 108, 109, 110, 111, 112, 113,
-     114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125, 126, 127, 128, 131, 132, 133, 134,
-     135, 136, 136, 137, 138, 139, 140, 141, 142, 143, 144, 145, 146, 147, 148, 149, 150, 151, 152,
-     153, 154, 155, 156, 157, 158, 159, 160, 161, 162, 163, 164, 165, 166, 167, 168, 169, 170, 171,
-     172, 173, 174, 175, 176, 177, 178, 179, 180, 181, 182, 183, 184, 185, 185, 186, 187, 188, 189,
-     190, 193, 192, 195, 196, 197, 198, 199, 200, 200, 201, 202, 203, 204, 205, 206, 207, 208, 209,
-     210, 211, 212, 213, 214, 215, 216, 217, 218, 219, 220, 221, 222, 223, 224, 225, 226, 227, 228,
-     229, 230, 231, 232, 233, 234, 235, 236, 237, 238, 239, 240, 241, 242, 243, 244, 245, 246, 247,
-     248, 249, 249, 250, 251, 252, 253, 254, 255},
-    GetIdLUTChannel(),
-    GetIdLUTChannel(),
-    GetIdLUTChannel()};
-
-// Perform LUT mapping on a stbi-loaded texture
-void LUTTexture(stbi_uc* pixels, int width, int height, int channels)
+void TextureManager::Cleanup()
 {
-    ASSERT(channels == STBI_rgb_alpha);
-
-    for (int i = 0; i < width * height * channels; i++) {
-        ASSERT(pixels[i] >= 0 && pixels[i] <= 255 && "Bad pixel color value");
-        int channelIdx = i % 4;
-        const LUTChannel* channel = &LUT_CHANNELS_RGBA[channelIdx];
+    {
+        std::lock_guard<std::mutex> lock(_decodeMutex);
+        _stopDecodeWorkers = true;
+    }
+    _decodeCV.notify_all();
+    for (std::thread& worker : _decodeWorkers) {
+        worker.join();
+    }
+    _decodeWorkers.clear();
 
-        pixels[i] = channel->at(pixels[i]);
+    submitUploadBatch();
+    for (__UploadBatch& batch : _uploadBatches) {
+        VK_CHECK_RESULT(
+            vkWaitForFences(_device->logicalDevice, 1, &batch.fence, VK_TRUE, UINT64_MAX)
+        );
+    }
+    retireUploadBatches();
+    ASSERT(_uploadBatches.empty());
+    _stagingRing.Cleanup();
+    vkDestroyCommandPool(_device->logicalDevice, _uploadCommandPool, nullptr);
+    _uploadCommandPool = VK_NULL_HANDLE;
+    if (_equirectangularPipeline.pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(_device->logicalDevice, _equirectangularPipeline.pipeline, nullptr);
+        vkDestroyPipelineLayout(
+            _device->logicalDevice, _equirectangularPipeline.pipelineLayout, nullptr
+        );
+        vkDestroyDescriptorSetLayout(
+            _device->logicalDevice, _equirectangularPipeline.descriptorSetLayout, nullptr
+        );
+        _equirectangularPipeline = {};
     }
-}
-} // namespace LUT
 
-TextureManager::~TextureManager()
-{
-    if (!_textures.empty()) {
-        PANIC("Textures must be cleaned up before ending texture manager!");
+    for (__UploadBatch& batch : _streamingBatches) {
+        VK_CHECK_RESULT(
+            vkWaitForFences(_device->logicalDevice, 1, &batch.fence, VK_TRUE, UINT64_MAX)
+        );
+        for (auto& [handle, texture] : batch.textures) {
+            vkDestroyImageView(_device->logicalDevice, texture.textureImageView, nullptr);
+            vkDestroyImage(_device->logicalDevice, texture.textureImage, nullptr);
+            _device->memoryAllocator.Free(texture.textureImageMemory);
+        }
+        for (VQBuffer& stagingBuffer : batch.stagingBuffers) {
+            stagingBuffer.Cleanup();
+        }
+        vkDestroyFence(_device->logicalDevice, batch.fence, nullptr);
+    }
+    _streamingBatches.clear();
+    for (__DecodedTexture& decoded : _decodedTextures) {
+        decoded.stagingBuffer.Cleanup();
+    }
+    _decodedTextures.clear();
+    _decodeQueue.clear();
+    _pendingTextures.clear();
+    if (_transferCommandPool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(_device->logicalDevice, _transferCommandPool, nullptr);
+        _transferCommandPool = VK_NULL_HANDLE;
     }
-}
 
-void TextureManager::Cleanup()
-{
     for (auto& elem : _textures) {
-        __TextureInternal& texture = elem.second;
-        vkDestroyImageView(_device->logicalDevice, texture.textureImageView, nullptr);
-        vkDestroyImage(_device->logicalDevice, texture.textureImage, nullptr);
-        vkDestroySampler(_device->logicalDevice, texture.textureSampler, nullptr);
-        vkFreeMemory(_device->logicalDevice, texture.textureImageMemory, nullptr);
+        destroyTexture(elem.second);
     }
     _textures.clear();
+    _textureCache.clear();
+    _textureRefs.clear();
+    _residency.clear();
 }
 
-void TextureManager::GetDescriptorImageInfo(uint32_t handle, VkDescriptorImageInfo& imageInfo)
+TextureManager::__TextureInternal& TextureManager::getTexture(uint32_t handle)
 {
-    if (_textures.find(handle) == _textures.end()) {
+    auto residency = _residency.find(handle);
+    if (residency != _residency.end()) {
+        residency->second.lastUsedTick = _tick;
+    }
+    auto it = _textures.find(handle);
+    if (it != _textures.end()) {
+        return it->second;
+    }
+    auto pending = _pendingTextures.find(handle);
+    if (pending == _pendingTextures.end() || pending->second.unloaded) {
         FATAL("Texture not loaded: {}", handle);
     }
-    __TextureInternal& texture = _textures.at(handle);
+    if (pending->second.status == TextureStatus::kEvicted) {
+        ASSERT(residency != _residency.end());
+        pending->second.status = TextureStatus::kLoading;
+        _numReloads++;
+        {
+            std::lock_guard<std::mutex> lock(_decodeMutex);
+            _decodeQueue.push_back(__DecodeJob{
+                .handle = handle, .path = pending->second.path, .options = residency->second.options
+            });
+        }
+        _decodeCV.notify_one();
+    }
+    return _textures.at(_placeholderHandle);
+}
+
+void TextureManager::GetDescriptorImageInfo(uint32_t handle, VkDescriptorImageInfo& imageInfo)
+{
+    __TextureInternal& texture = getTexture(handle);
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     imageInfo.imageView = texture.textureImageView;
     imageInfo.sampler = texture.textureSampler;
@@ -111,147 +173,381 @@ void TextureManager::GetDescriptorImageInfo(uint32_t handle, VkDescriptorImageIn
 
 uint32_t TextureManager::LoadCubemapTexture(const std::string& imagePath)
 {
-    const auto imageFormat = VK_FORMAT_R8G8B8A8_SRGB;
-    // Load the single image
-    int width, height, channels;
-    stbi_uc* pixels = stbi_load(imagePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
-    if (!pixels) {
-        PANIC("Failed to load texture image: {}")
-    }
-
-    // Assuming the image is a vertical cross layout (3x4 grid)
-    int faceWidth = width / 4;
-    int faceHeight = height / 3;
-    VkDeviceSize faceSize = faceWidth * faceHeight * 4;
-
-    // Create staging buffer
-    VQBuffer stagingBuffer{};
-    _device->CreateBufferInPlace(
-        faceSize * 6,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        stagingBuffer
-    );
-
-    // Copy pixel data to staging buffer
-
-    // Extract faces from the vertical cross layout
-    auto copyFace = [&](int srcX, int srcY, int faceIndex) {
-        // DEBUG("Copying face {} from ({}, {}) to {}", faceIndex, srcX, srcY, faceIndex);
-        for (int y = 0; y < faceHeight; ++y) {
-            for (int x = 0; x < faceWidth; ++x) {
-                int srcIndex = ((srcY * faceHeight + y) * width + (srcX * faceWidth + x)) * 4;
-                int dstOffset = (faceIndex * faceSize) + (y * faceWidth + x) * 4;
-                // DEBUG("Copying pixel at ({}, {}) to {}", x, y, dstOffset);
-                memcpy(
-                    static_cast<char*>(stagingBuffer.bufferAddress) + dstOffset,
-                    pixels + srcIndex,
-                    4
-                );
-            }
+    const std::string cacheKey = getCacheKey(imagePath, "cubemap");
+    if (uint32_t cached = acquireCachedTexture(cacheKey, true)) {
+        return cached;
+    }
+
+    std::optional<TextureData> data
+        = TextureDiskCache::Load(imagePath, TextureDiskCache::Options{.generateMipmaps = false});
+    if (!data.has_value()) {
+        FATAL("Failed to load cubemap {}", imagePath);
+    }
+
+    uint32_t handle;
+    if (data->width * 3 == data->height * 4) {
+        handle = loadCrossCubemap(data.value());
+    } else if (data->width == data->height * 2) {
+        handle = convertEquirectangular(data.value());
+    } else {
+        FATAL(
+            "Cubemap {} is neither a 4x3 cross nor equirectangular: {}x{}",
+            imagePath,
+            data->width,
+            data->height
+        );
+    }
+    addTextureRef(cacheKey, handle);
+    return handle;
+}
+
+uint32_t TextureManager::LoadCubemapTexture(const std::array<std::string, 6>& facePaths)
+{
+    // cached only if all of the faces can be identified
+    std::string cacheKey;
+    for (const std::string& path : facePaths) {
+        std::string faceKey = getCacheKey(path, "cubemap-face");
+        if (faceKey.empty()) {
+            cacheKey.clear();
+            break;
         }
-    };
+        cacheKey += faceKey + ";";
+    }
+    if (uint32_t cached = acquireCachedTexture(cacheKey, true)) {
+        return cached;
+    }
+
+    std::array<TextureData, 6> faces;
+    for (size_t i = 0; i < faces.size(); i++) {
+        std::optional<TextureData> face = TextureDiskCache::Load(
+            facePaths[i], TextureDiskCache::Options{.generateMipmaps = false}
+        );
+        if (!face.has_value()) {
+            FATAL("Failed to load cubemap face {}", facePaths[i]);
+        }
+        if (face->width != face->height || (i > 0 && face->width != faces[0].width)) {
+            FATAL("Cubemap faces must be square and of the same size: {}", facePaths[i]);
+        }
+        faces[i] = std::move(face.value());
+    }
 
-    // Order: +X, -X, +Y, -Y, +Z, -Z
-    copyFace(2, 1, 0); // +X
-    copyFace(0, 1, 1); // -X
-    copyFace(1, 0, 2); // +Y
-    copyFace(1, 2, 3); // -Y
-    copyFace(1, 1, 4); // +Z
-    copyFace(3, 1, 5); // -Z
+    uint32_t faceSize = faces[0].width;
+    VkDeviceSize faceBytes = faces[0].GetTexels().size();
+    __StagingAllocation staging = allocateStaging(faceBytes * faces.size());
+    std::array<VkBufferImageCopy, 6> regions{};
+    for (uint32_t i = 0; i < faces.size(); i++) {
+        memcpy(
+            static_cast<char*>(staging.data) + faceBytes * i, faces[i].GetTexels().data(), faceBytes
+        );
+        regions[i].bufferOffset = staging.offset + faceBytes * i;
+        regions[i].imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, i, 1};
+        regions[i].imageExtent = {faceSize, faceSize, 1};
+    }
 
-    // Free the pixel data
-    stbi_image_free(pixels);
+    uint32_t handle = uploadCubemap(staging, regions, faceSize);
+    addTextureRef(cacheKey, handle);
+    return handle;
+}
 
-    // Create cubemap image
+uint32_t TextureManager::loadCrossCubemap(const TextureData& data)
+{
+    // cell of each face in the cross, ordered +X, -X, +Y, -Y, +Z, -Z
+    const std::array<std::pair<uint32_t, uint32_t>, 6> FACE_CELLS
+        = {{{2, 1}, {0, 1}, {1, 0}, {1, 2}, {1, 1}, {3, 1}}};
+
+    // the decoded cross is staged as is, each face is copied out of it with the row pitch of the
+    // whole image
+    uint32_t faceSize = data.width / 4;
+    std::span<const uint8_t> texels = data.GetTexels();
+    __StagingAllocation staging = allocateStaging(texels.size());
+    memcpy(staging.data, texels.data(), texels.size());
+
+    std::array<VkBufferImageCopy, 6> regions{};
+    for (uint32_t i = 0; i < regions.size(); i++) {
+        auto [column, row] = FACE_CELLS[i];
+        VkDeviceSize firstTexel
+            = static_cast<VkDeviceSize>(row) * faceSize * data.width + column * faceSize;
+        regions[i].bufferOffset = staging.offset + firstTexel * 4;
+        regions[i].bufferRowLength = data.width;
+        regions[i].bufferImageHeight = faceSize;
+        regions[i].imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, i, 1};
+        regions[i].imageExtent = {faceSize, faceSize, 1};
+    }
+    return uploadCubemap(staging, regions, faceSize);
+}
+
+uint32_t TextureManager::uploadCubemap(
+    const __StagingAllocation& staging,
+    const std::array<VkBufferImageCopy, 6>& regions,
+    uint32_t faceSize
+)
+{
+    const VkFormat imageFormat = VK_FORMAT_R8G8B8A8_SRGB;
     VkImage cubemapImage;
-    VkDeviceMemory cubemapImageMemory;
+    VQAllocation cubemapImageMemory;
+    createCubemapImage(
+        faceSize,
+        imageFormat,
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        0,
+        cubemapImage,
+        cubemapImageMemory
+    );
 
+    VkCommandBuffer commandBuffer = getUploadBatch().commandBuffer;
+    // all six faces go through one barrier and one copy
+    transitionImageLayout(
+        commandBuffer,
+        cubemapImage,
+        imageFormat,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        0,
+        6
+    );
+    vkCmdCopyBufferToImage(
+        commandBuffer,
+        staging.buffer,
+        cubemapImage,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        regions.size(),
+        regions.data()
+    );
+    transitionImageLayout(
+        commandBuffer,
+        cubemapImage,
+        imageFormat,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        0,
+        6
+    );
+
+    return createCubemapTexture(cubemapImage, cubemapImageMemory, faceSize);
+}
+
+uint32_t TextureManager::convertEquirectangular(const TextureData& data)
+{
+    if (_equirectangularPipeline.pipeline == VK_NULL_HANDLE && !createEquirectangularPipeline()) {
+        // mid-grey faces stand in for the projection
+        std::vector<uint8_t> texels;
+        for (uint32_t i = 0; i < 4 * 3; i++) {
+            texels.insert(texels.end(), PLACEHOLDER_PIXEL.begin(), PLACEHOLDER_PIXEL.end());
+        }
+        return loadCrossCubemap(TextureData{
+            .format = VK_FORMAT_R8G8B8A8_SRGB,
+            .width = 4,
+            .height = 3,
+            .levels = {{.offset = 0, .size = texels.size(), .width = 4, .height = 3}},
+            .texels = std::move(texels)});
+    }
+    uint32_t faceSize = data.width / 4;
+
+    // the source is only sampled by the conversion
+    __TextureInternal source = recordTextureUpload(data);
+
+    // storage writes go through a UNORM view, as sRGB formats rarely support them
+    VkImage cubemapImage;
+    VQAllocation cubemapImageMemory;
+    createCubemapImage(
+        faceSize,
+        VK_FORMAT_R8G8B8A8_UNORM,
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+        VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT,
+        cubemapImage,
+        cubemapImageMemory
+    );
+    VkImageViewCreateInfo storageViewInfo{};
+    storageViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    storageViewInfo.image = cubemapImage;
+    storageViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    storageViewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    storageViewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 6};
+    VkImageView storageView;
+    VK_CHECK_RESULT(
+        vkCreateImageView(_device->logicalDevice, &storageViewInfo, nullptr, &storageView)
+    );
+
+    // descriptors live as long as the upload batch, in a pool of their own
+    std::array<VkDescriptorPoolSize, 2> poolSizes
+        = {{{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1}, {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1}}};
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = poolSizes.size();
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 1;
+    VkDescriptorPool descriptorPool;
+    VK_CHECK_RESULT(
+        vkCreateDescriptorPool(_device->logicalDevice, &poolInfo, nullptr, &descriptorPool)
+    );
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &_equirectangularPipeline.descriptorSetLayout;
+    VkDescriptorSet descriptorSet;
+    VK_CHECK_RESULT(vkAllocateDescriptorSets(_device->logicalDevice, &allocInfo, &descriptorSet));
+
+    std::array<VkDescriptorImageInfo, 2> imageInfos = {{
+        {source.textureSampler, source.textureImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        {VK_NULL_HANDLE, storageView, VK_IMAGE_LAYOUT_GENERAL},
+    }};
+    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = descriptorSet;
+        descriptorWrites[i].dstBinding = i;
+        descriptorWrites[i].descriptorType = poolSizes[i].type;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].pImageInfo = &imageInfos[i];
+    }
+    vkUpdateDescriptorSets(
+        _device->logicalDevice, descriptorWrites.size(), descriptorWrites.data(), 0, nullptr
+    );
+
+    __UploadBatch& batch = getUploadBatch();
+    transitionImageLayout(
+        batch.commandBuffer,
+        cubemapImage,
+        VK_FORMAT_R8G8B8A8_UNORM,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_GENERAL,
+        0,
+        6
+    );
+    vkCmdBindPipeline(
+        batch.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _equirectangularPipeline.pipeline
+    );
+    vkCmdBindDescriptorSets(
+        batch.commandBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        _equirectangularPipeline.pipelineLayout,
+        0,
+        1,
+        &descriptorSet,
+        0,
+        nullptr
+    );
+    uint32_t numGroups = (faceSize + EQUIRECTANGULAR_GROUP_SIZE - 1) / EQUIRECTANGULAR_GROUP_SIZE;
+    vkCmdDispatch(batch.commandBuffer, numGroups, numGroups, 6);
+    transitionImageLayout(
+        batch.commandBuffer,
+        cubemapImage,
+        VK_FORMAT_R8G8B8A8_UNORM,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        0,
+        6
+    );
+    batch.completionCallbacks.push_back([this, source, storageView, descriptorPool]() {
+        destroyTexture(source);
+        vkDestroyImageView(_device->logicalDevice, storageView, nullptr);
+        vkDestroyDescriptorPool(_device->logicalDevice, descriptorPool, nullptr);
+    });
+
+    return createCubemapTexture(cubemapImage, cubemapImageMemory, faceSize);
+}
+
+bool TextureManager::createEquirectangularPipeline()
+{
+    if (!std::filesystem::exists(EQUIRECTANGULAR_SHADER_PATH)) {
+        ERROR(
+            "{} not found, equirectangular cubemaps can't be projected",
+            EQUIRECTANGULAR_SHADER_PATH
+        );
+        return false;
+    }
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    for (VkDescriptorSetLayoutBinding& binding : bindings) {
+        binding.descriptorCount = 1;
+        binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = bindings.size();
+    layoutInfo.pBindings = bindings.data();
+    VK_CHECK_RESULT(vkCreateDescriptorSetLayout(
+        _device->logicalDevice, &layoutInfo, nullptr, &_equirectangularPipeline.descriptorSetLayout
+    ));
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &_equirectangularPipeline.descriptorSetLayout;
+    VK_CHECK_RESULT(vkCreatePipelineLayout(
+        _device->logicalDevice,
+        &pipelineLayoutInfo,
+        nullptr,
+        &_equirectangularPipeline.pipelineLayout
+    ));
+
+    VkShaderModule shaderModule = ShaderCreation::createShaderModule(
+        _device->logicalDevice, EQUIRECTANGULAR_SHADER_PATH
+    );
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = _equirectangularPipeline.pipelineLayout;
+    VK_CHECK_RESULT(vkCreateComputePipelines(
+        _device->logicalDevice,
+        VK_NULL_HANDLE,
+        1,
+        &pipelineInfo,
+        nullptr,
+        &_equirectangularPipeline.pipeline
+    ));
+    vkDestroyShaderModule(_device->logicalDevice, shaderModule, nullptr);
+    return true;
+}
+
+void TextureManager::createCubemapImage(
+    uint32_t faceSize,
+    VkFormat format,
+    VkImageUsageFlags usage,
+    VkImageCreateFlags flags,
+    VkImage& image,
+    VQAllocation& imageMemory
+)
+{
     VkImageCreateInfo imageCreateInfo = {};
     imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageCreateInfo.format = imageFormat;
-    imageCreateInfo.extent.width = faceWidth;
-    imageCreateInfo.extent.height = faceHeight;
+    imageCreateInfo.format = format;
+    imageCreateInfo.extent.width = faceSize;
+    imageCreateInfo.extent.height = faceSize;
     imageCreateInfo.extent.depth = 1;
     imageCreateInfo.mipLevels = 1;
     imageCreateInfo.arrayLayers = 6;
     imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-    imageCreateInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+    imageCreateInfo.usage = usage;
+    imageCreateInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT | flags;
     imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    vkCreateImage(_device->logicalDevice, &imageCreateInfo, nullptr, &cubemapImage);
-
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(_device->logicalDevice, cubemapImage, &memRequirements);
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(
-        _device->physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-    );
-    vkAllocateMemory(_device->logicalDevice, &allocInfo, nullptr, &cubemapImageMemory);
-    vkBindImageMemory(_device->logicalDevice, cubemapImage, cubemapImageMemory, 0);
-
-
-    // Transition image layout and copy data
-    for (int i = 0; i < 6; i++) {
-        transitionImageLayout(
-            cubemapImage,
-            imageFormat,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            i,
-            1
-        );
-    }
-
-    VkBufferImageCopy regions[6];
-    uint32_t uWidth = static_cast<uint32_t>(faceWidth);
-    uint32_t uHeight = static_cast<uint32_t>(faceHeight);
-    for (int i = 0; i < 6; ++i) {
-        regions[i].bufferOffset = faceSize * i;
-        regions[i].bufferRowLength = 0;
-        regions[i].bufferImageHeight = 0;
-        regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        regions[i].imageSubresource.mipLevel = 0;
-        regions[i].imageSubresource.baseArrayLayer = i;
-        regions[i].imageSubresource.layerCount = 1;
-        regions[i].imageOffset = {0, 0, 0};
-        regions[i].imageExtent = {uWidth, uHeight, 1};
-    }
-
-    {
-        VulkanUtils::QuickCommandBuffer commandBuffer(_device);
-
-        vkCmdCopyBufferToImage(
-            commandBuffer.cmdBuffer,
-            stagingBuffer.buffer,
-            cubemapImage,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            6,
-            regions
-        );
-    }
+    VK_CHECK_RESULT(vkCreateImage(_device->logicalDevice, &imageCreateInfo, nullptr, &image));
 
-    for (int i = 0; i < 6; i++) {
-        transitionImageLayout(
-            cubemapImage,
-            imageFormat,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-            i,
-            1
-        );
-    }
+    imageMemory
+        = _device->memoryAllocator.AllocateImageMemory(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
 
+uint32_t TextureManager::createCubemapTexture(
+    VkImage image,
+    const VQAllocation& imageMemory,
+    uint32_t faceSize
+)
+{
     // Create image view
     VkImageViewCreateInfo viewCreateInfo = {};
     viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewCreateInfo.image = cubemapImage;
+    viewCreateInfo.image = image;
     viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_CUBE;
-    viewCreateInfo.format = imageFormat;
+    viewCreateInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
     viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     viewCreateInfo.subresourceRange.baseMipLevel = 0;
     viewCreateInfo.subresourceRange.levelCount = 1;
@@ -284,20 +580,17 @@ uint32_t TextureManager::LoadCubemapTexture(const std::string& imagePath)
     // Store the cubemap texture
     uint32_t handle = _nextHandle++;
     _textures[handle] = __TextureInternal{
-        .textureImage = cubemapImage,
+        .textureImage = image,
         .textureImageView = cubemapImageView,
-        .textureImageMemory = cubemapImageMemory,
+        .textureImageMemory = imageMemory,
         .textureSampler = cubemapSampler,
-        .width = faceWidth,
-        .height = faceHeight};
-
-    // Cleanup staging buffer
-    stagingBuffer.Cleanup();
+        .width = static_cast<int>(faceSize),
+        .height = static_cast<int>(faceSize)};
 
     return handle;
 }
 
-uint32_t TextureManager::LoadTexture(const std::string& texturePath)
+uint32_t TextureManager::LoadTexture(const std::string& texturePath, const LoadOptions& options)
 {
     if (texturePath.empty()) {
         FATAL("Empty texture path!");
@@ -305,64 +598,95 @@ uint32_t TextureManager::LoadTexture(const std::string& texturePath)
     if (_device == VK_NULL_HANDLE) {
         FATAL("Texture manager hasn't been initialized!");
     }
-    int width, height, channels;
-    stbi_uc* pixels = stbi_load(texturePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
-    LUT::LUTTexture(pixels, width, height, STBI_rgb_alpha);
-
-    VkDeviceSize vkTextureSize = width * height * 4;
+    TextureDiskCache::Options diskCacheOptions = getDiskCacheOptions(options);
+    // an async load of the same file that's still in flight can't be shared, it isn't usable yet
+    const std::string cacheKey = getCacheKey(texturePath, getTextureKind(diskCacheOptions));
+    if (uint32_t cached = acquireCachedTexture(cacheKey, true)) {
+        raiseResidencyPriority(cached, ResidencyPriority::kPinned);
+        return cached;
+    }
 
-    if (pixels == nullptr) {
+    std::optional<TextureData> data = TextureDiskCache::Load(texturePath, diskCacheOptions);
+    if (!data.has_value()) {
         FATAL("Failed to load texture {}", texturePath);
     }
 
-    VQBuffer stagingBuffer = this->_device->CreateBuffer(
-        vkTextureSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-    );
+    uint32_t handle = uploadTexture(data.value());
+    addTextureRef(cacheKey, handle);
+    DEBUG("Texture {} loaded: {}", texturePath, handle);
+    return handle;
+}
 
-    memcpy(stagingBuffer.bufferAddress, pixels, static_cast<size_t>(vkTextureSize));
-    stbi_image_free(pixels);
+uint32_t TextureManager::uploadTexture(const TextureData& data)
+{
+    uint32_t handle = _nextHandle++;
+    _textures.emplace(handle, recordTextureUpload(data));
+    return handle;
+}
+
+TextureManager::__TextureInternal TextureManager::recordTextureUpload(const TextureData& data)
+{
+    std::span<const uint8_t> texels = data.GetTexels();
+    __StagingAllocation staging = allocateStaging(texels.size());
+    memcpy(staging.data, texels.data(), texels.size());
+    uint32_t mipLevels = data.levels.size();
 
     VkImage textureImage = VK_NULL_HANDLE;
     VkImageView textureImageView = VK_NULL_HANDLE;
-    VkDeviceMemory textureImageMemory = VK_NULL_HANDLE;
-    VkSampler textureSampler = VK_NULL_HANDLE;
+    VQAllocation textureImageMemory;
 
     VulkanUtils::createImage(
-        width,
-        height,
-        VK_FORMAT_R8G8B8A8_SRGB,
+        data.width,
+        data.height,
+        data.format,
         VK_IMAGE_TILING_OPTIMAL,
         VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         textureImage,
         textureImageMemory,
-        _device->physicalDevice,
-        _device->logicalDevice
+        *_device,
+        VQMemoryAllocator::Strategy::kBuddy,
+        mipLevels
     );
 
+    VkCommandBuffer commandBuffer = getUploadBatch().commandBuffer;
     transitionImageLayout(
+        commandBuffer,
         textureImage,
-        VK_FORMAT_R8G8B8A8_SRGB,
+        data.format,
         VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    );
-    copyBufferToImage(
-        stagingBuffer.buffer,
-        textureImage,
-        static_cast<uint32_t>(width),
-        static_cast<uint32_t>(height)
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        0,
+        1,
+        mipLevels
     );
+    copyBufferToImage(commandBuffer, staging, textureImage, data.levels);
     transitionImageLayout(
+        commandBuffer,
         textureImage,
-        VK_FORMAT_R8G8B8A8_SRGB,
+        data.format,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        0,
+        1,
+        mipLevels
     );
 
-    textureImageView = VulkanUtils::createImageView(textureImage, _device->logicalDevice);
+    textureImageView = VulkanUtils::createImageView(
+        textureImage, _device->logicalDevice, data.format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels
+    );
 
+    return __TextureInternal{
+        textureImage,
+        textureImageView,
+        textureImageMemory,
+        createSampler(),
+        static_cast<int>(data.width),
+        static_cast<int>(data.height)};
+}
+
+VkSampler TextureManager::createSampler()
+{
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -379,54 +703,504 @@ uint32_t TextureManager::LoadTexture(const std::string& texturePath)
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.mipLodBias = 0.0f;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // all levels of the image view
 
+    VkSampler textureSampler = VK_NULL_HANDLE;
     if (vkCreateSampler(_device->logicalDevice, &samplerInfo, nullptr, &textureSampler)
         != VK_SUCCESS) {
         FATAL("Failed to create texture sampler!");
     }
+    return textureSampler;
+}
+
+void TextureManager::destroyTexture(const __TextureInternal& texture)
+{
+    vkDestroyImageView(_device->logicalDevice, texture.textureImageView, nullptr);
+    vkDestroyImage(_device->logicalDevice, texture.textureImage, nullptr);
+    vkDestroySampler(_device->logicalDevice, texture.textureSampler, nullptr);
+    _device->memoryAllocator.Free(texture.textureImageMemory);
+}
+
+void TextureManager::releaseTexture(const __TextureInternal& texture)
+{
+    _deletionQueue->push([device = _device, texture]() {
+        if (texture.imguiTextureId.has_value()) {
+            ImGui_ImplVulkan_RemoveTexture(
+                static_cast<VkDescriptorSet>(texture.imguiTextureId.value())
+            );
+        }
+        vkDestroyImageView(device->logicalDevice, texture.textureImageView, nullptr);
+        vkDestroyImage(device->logicalDevice, texture.textureImage, nullptr);
+        vkDestroySampler(device->logicalDevice, texture.textureSampler, nullptr);
+        device->memoryAllocator.Free(texture.textureImageMemory);
+    });
+}
+
+uint32_t TextureManager::LoadTextureAsync(
+    const std::string& texturePath,
+    const LoadOptions& options
+)
+{
+    if (texturePath.empty()) {
+        FATAL("Empty texture path!");
+    }
+    if (_device == VK_NULL_HANDLE) {
+        FATAL("Texture manager hasn't been initialized!");
+    }
+    TextureDiskCache::Options diskCacheOptions = getDiskCacheOptions(options);
+    const std::string cacheKey = getCacheKey(texturePath, getTextureKind(diskCacheOptions));
+    if (uint32_t cached = acquireCachedTexture(cacheKey, false)) {
+        raiseResidencyPriority(cached, options.priority);
+        return cached;
+    }
 
     uint32_t handle = _nextHandle++;
-    _textures.emplace(
+    _pendingTextures.emplace(handle, __PendingTexture{.path = texturePath});
+    addTextureRef(cacheKey, handle);
+    if (options.priority != ResidencyPriority::kPinned) {
+        _residency.emplace(
+            handle,
+            __Residency{
+                .path = texturePath,
+                .options = diskCacheOptions,
+                .priority = options.priority,
+                .lastUsedTick = _tick}
+        );
+    }
+    {
+        std::lock_guard<std::mutex> lock(_decodeMutex);
+        _decodeQueue.push_back(
+            __DecodeJob{.handle = handle, .path = texturePath, .options = diskCacheOptions}
+        );
+    }
+    _decodeCV.notify_one();
+    return handle;
+}
+
+std::string TextureManager::getCacheKey(const std::string& path, const std::string& kind)
+{
+    std::error_code error;
+    std::filesystem::path canonicalPath = std::filesystem::canonical(path, error);
+    if (error) {
+        return "";
+    }
+    uintmax_t size = std::filesystem::file_size(canonicalPath, error);
+    if (error) {
+        return "";
+    }
+    std::filesystem::file_time_type mtime = std::filesystem::last_write_time(canonicalPath, error);
+    if (error) {
+        return "";
+    }
+    return fmt::format(
+        "{}|{}|{}|{}", kind, canonicalPath.string(), size, mtime.time_since_epoch().count()
+    );
+}
+
+// the same file loaded with different options is a different texture
+std::string TextureManager::getTextureKind(const TextureDiskCache::Options& options)
+{
+    return fmt::format(
+        "2d{}{}{}{}",
+        options.generateMipmaps ? "+mips" : "",
+        options.compressBC7 ? "+bc7" : "",
+        options.maxExtent != 0 ? fmt::format("+max{}", options.maxExtent) : "",
+        options.plane == ColorSpace::OCV ? "+ocv" : ""
+    );
+}
+
+TextureDiskCache::Options TextureManager::getDiskCacheOptions(const LoadOptions& options) const
+{
+    return TextureDiskCache::Options{
+        .generateMipmaps = options.generateMipmaps,
+        .compressBC7 = options.lossyCompression && _bc7Supported,
+        .maxExtent = options.maxExtent,
+        .plane = options.plane};
+}
+
+uint32_t TextureManager::acquireCachedTexture(const std::string& key, bool requireReady)
+{
+    auto cached = key.empty() ? _textureCache.end() : _textureCache.find(key);
+    if (cached == _textureCache.end()
+        || (requireReady && _pendingTextures.contains(cached->second))) {
+        _cacheStats.misses++;
+        return 0;
+    }
+    _cacheStats.hits++;
+    _textureRefs.at(cached->second).refCount++;
+    return cached->second;
+}
+
+void TextureManager::addTextureRef(const std::string& key, uint32_t handle)
+{
+    // a file already cached under a handle that couldn't be shared keeps that handle
+    bool cached = !key.empty() && _textureCache.try_emplace(key, handle).second;
+    _textureRefs.emplace(handle, __TextureRef{.cacheKey = cached ? key : ""});
+}
+
+TextureManager::CacheStats TextureManager::GetCacheStats() const
+{
+    CacheStats stats = _cacheStats;
+    stats.cachedTextures = _textureCache.size();
+    return stats;
+}
+
+TextureManager::ResidencyStats TextureManager::GetResidencyStats() const
+{
+    ResidencyStats stats{
+        .budget = _residencyBudget, .evictions = _numEvictions, .reloads = _numReloads};
+    for (const auto& [handle, texture] : _textures) {
+        stats.residentBytes += texture.textureImageMemory.size;
+        if (_residency.contains(handle)) {
+            stats.evictableBytes += texture.textureImageMemory.size;
+        }
+    }
+    for (const auto& [handle, pending] : _pendingTextures) {
+        if (pending.status == TextureStatus::kEvicted) {
+            stats.evictedTextures++;
+        }
+    }
+    return stats;
+}
+
+void TextureManager::raiseResidencyPriority(uint32_t handle, ResidencyPriority priority)
+{
+    auto residency = _residency.find(handle);
+    if (residency == _residency.end()) { // already pinned
+        return;
+    }
+    if (priority == ResidencyPriority::kPinned) {
+        getTexture(handle); // streams it back in if it was evicted
+        _residency.erase(handle);
+        return;
+    }
+    residency->second.priority = std::max(residency->second.priority, priority);
+}
+
+void TextureManager::enforceResidencyBudget()
+{
+    VkDeviceSize residentBytes = 0;
+    for (const auto& [handle, texture] : _textures) {
+        residentBytes += texture.textureImageMemory.size;
+    }
+    if (residentBytes <= _residencyBudget) {
+        return;
+    }
+
+    // textures not used during the last tick, lowest priority and least recently used first
+    std::vector<std::pair<const __Residency*, uint32_t>> idleTextures;
+    for (const auto& [handle, residency] : _residency) {
+        if (residency.lastUsedTick + 1 < _tick && _textures.contains(handle)) {
+            idleTextures.emplace_back(&residency, handle);
+        }
+    }
+    std::sort(idleTextures.begin(), idleTextures.end(), [](const auto& a, const auto& b) {
+        return std::tie(a.first->priority, a.first->lastUsedTick)
+               < std::tie(b.first->priority, b.first->lastUsedTick);
+    });
+    for (const auto& [residency, handle] : idleTextures) {
+        if (residentBytes <= _residencyBudget) {
+            break;
+        }
+        residentBytes -= _textures.at(handle).textureImageMemory.size;
+        evictTexture(handle);
+    }
+}
+
+void TextureManager::evictTexture(uint32_t handle)
+{
+    auto elem = _textures.find(handle);
+    bool hadImGuiTexture = elem->second.imguiTextureId.has_value();
+    if (hadImGuiTexture) { // stands in until the texture is streamed in again
+        createPlaceholderImGuiTexture();
+    }
+    releaseTexture(elem->second);
+    _textures.erase(elem);
+    const std::string& path = _residency.at(handle).path;
+    _pendingTextures.emplace(
         handle,
-        __TextureInternal{
-            textureImage, textureImageView, textureImageMemory, textureSampler, width, height}
+        __PendingTexture{
+            .path = path, .status = TextureStatus::kEvicted, .wantImGuiTexture = hadImGuiTexture}
     );
+    _numEvictions++;
+    DEBUG("Texture {} evicted: {}", path, handle);
+}
 
-    stagingBuffer.Cleanup();
-    DEBUG("Texture {} loaded: {}", texturePath, handle);
-    return handle;
+TextureManager::TextureStatus TextureManager::GetTextureStatus(uint32_t handle) const
+{
+    if (_textures.contains(handle)) {
+        return TextureStatus::kReady;
+    }
+    auto it = _pendingTextures.find(handle);
+    if (it == _pendingTextures.end() || it->second.unloaded) {
+        FATAL("Texture not loaded: {}", handle);
+    }
+    return it->second.status;
+}
+
+// decodes straight into a staging buffer, so that the render thread only has to record the copy
+void TextureManager::decodeWorker()
+{
+    while (true) {
+        __DecodeJob job;
+        {
+            std::unique_lock<std::mutex> lock(_decodeMutex);
+            _decodeCV.wait(lock, [this] { return _stopDecodeWorkers || !_decodeQueue.empty(); });
+            if (_stopDecodeWorkers) {
+                return;
+            }
+            job = std::move(_decodeQueue.front());
+            _decodeQueue.pop_front();
+        }
+
+        __DecodedTexture decoded{.handle = job.handle};
+        std::optional<TextureData> data = TextureDiskCache::Load(job.path, job.options);
+        if (data.has_value()) {
+            std::span<const uint8_t> texels = data->GetTexels();
+            decoded.stagingBuffer = _device->CreateBuffer(
+                texels.size(),
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            );
+            memcpy(decoded.stagingBuffer.bufferAddress, texels.data(), texels.size());
+            decoded.data = std::move(data.value());
+            decoded.data.texels = {};
+            decoded.data.mapping.reset();
+            decoded.data.mappedTexels = {};
+        }
+
+        std::lock_guard<std::mutex> lock(_decodeMutex);
+        _decodedTextures.push_back(decoded);
+    }
+}
+
+void TextureManager::PollAsyncLoads()
+{
+    _tick++;
+    // swap in textures whose upload has finished
+    for (auto it = _streamingBatches.begin(); it != _streamingBatches.end();) {
+        if (vkGetFenceStatus(_device->logicalDevice, it->fence) != VK_SUCCESS) {
+            it++;
+            continue;
+        }
+        for (auto& [handle, texture] : it->textures) {
+            finishAsyncLoad(handle, texture);
+        }
+        for (VQBuffer& stagingBuffer : it->stagingBuffers) {
+            stagingBuffer.Cleanup();
+        }
+        vkFreeCommandBuffers(_device->logicalDevice, _transferCommandPool, 1, &it->commandBuffer);
+        vkDestroyFence(_device->logicalDevice, it->fence, nullptr);
+        it = _streamingBatches.erase(it);
+    }
+    enforceResidencyBudget();
+
+    std::vector<__DecodedTexture> decodedTextures;
+    {
+        std::lock_guard<std::mutex> lock(_decodeMutex);
+        decodedTextures.swap(_decodedTextures);
+    }
+    if (decodedTextures.empty()) {
+        return;
+    }
+
+    // submit everything decoded since the last poll as one batch
+    __UploadBatch batch{};
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = _transferCommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    VK_CHECK_RESULT(
+        vkAllocateCommandBuffers(_device->logicalDevice, &allocInfo, &batch.commandBuffer)
+    );
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK_RESULT(vkBeginCommandBuffer(batch.commandBuffer, &beginInfo));
+
+    for (__DecodedTexture& decoded : decodedTextures) {
+        auto pending = _pendingTextures.find(decoded.handle);
+        ASSERT(pending != _pendingTextures.end());
+        if (pending->second.unloaded) {
+            decoded.stagingBuffer.Cleanup();
+            _pendingTextures.erase(pending);
+            continue;
+        }
+        if (decoded.stagingBuffer.buffer == VK_NULL_HANDLE) {
+            pending->second.status = TextureStatus::kFailed;
+            continue;
+        }
+
+        __TextureInternal texture{
+            .width = static_cast<int>(decoded.data.width),
+            .height = static_cast<int>(decoded.data.height)};
+        createStreamedImage(
+            _device, decoded.data, texture.textureImage, texture.textureImageMemory
+        );
+        texture.textureImageView = VulkanUtils::createImageView(
+            texture.textureImage,
+            _device->logicalDevice,
+            decoded.data.format,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            decoded.data.levels.size()
+        );
+        recordAsyncUpload(batch.commandBuffer, decoded, texture.textureImage);
+        batch.textures.emplace_back(decoded.handle, texture);
+        batch.stagingBuffers.push_back(decoded.stagingBuffer);
+    }
+
+    VK_CHECK_RESULT(vkEndCommandBuffer(batch.commandBuffer));
+    if (batch.textures.empty()) {
+        vkFreeCommandBuffers(_device->logicalDevice, _transferCommandPool, 1, &batch.commandBuffer);
+        return;
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VK_CHECK_RESULT(vkCreateFence(_device->logicalDevice, &fenceInfo, nullptr, &batch.fence));
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+    VK_CHECK_RESULT(vkQueueSubmit(_device->transferQueue, 1, &submitInfo, batch.fence));
+
+    _streamingBatches.push_back(std::move(batch));
+}
+
+void TextureManager::recordAsyncUpload(
+    VkCommandBuffer cb,
+    const __DecodedTexture& decoded,
+    VkImage image
+)
+{
+    bool dedicatedTransferQueue = _device->queueFamilyIndices.transferFamily
+                                  != _device->queueFamilyIndices.graphicsFamily;
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    uint32_t mipLevels = decoded.data.levels.size();
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1};
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        cb,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier
+    );
+
+    copyBufferToImage(
+        cb,
+        __StagingAllocation{decoded.stagingBuffer.buffer, 0, decoded.stagingBuffer.bufferAddress},
+        image,
+        decoded.data.levels
+    );
+
+    // a transfer-only queue has no fragment stage; the graphics queue only samples the image
+    // after the host has seen the batch's fence signal.
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = dedicatedTransferQueue ? 0 : VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        cb,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        dedicatedTransferQueue ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT
+                               : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier
+    );
+}
+
+void TextureManager::finishAsyncLoad(uint32_t handle, __TextureInternal& texture)
+{
+    auto pending = _pendingTextures.find(handle);
+    ASSERT(pending != _pendingTextures.end());
+    if (pending->second.unloaded) { // never bound, no frame can be using it
+        vkDestroyImageView(_device->logicalDevice, texture.textureImageView, nullptr);
+        vkDestroyImage(_device->logicalDevice, texture.textureImage, nullptr);
+        _device->memoryAllocator.Free(texture.textureImageMemory);
+        _pendingTextures.erase(pending);
+        return;
+    }
+
+    texture.textureSampler = createSampler();
+    if (pending->second.wantImGuiTexture) {
+        texture.imguiTextureId = ImGui_ImplVulkan_AddTexture(
+            texture.textureSampler,
+            texture.textureImageView,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        );
+    }
+    DEBUG("Texture {} streamed in: {}", pending->second.path, handle);
+    _textures.emplace(handle, texture);
+    _pendingTextures.erase(pending);
 }
 
 void TextureManager::UnLoadTexture(uint32_t handle)
 {
+    auto ref = _textureRefs.find(handle);
+    if (ref != _textureRefs.end()) {
+        if (--ref->second.refCount > 0) {
+            return;
+        }
+        if (!ref->second.cacheKey.empty()) {
+            _textureCache.erase(ref->second.cacheKey);
+        }
+        _textureRefs.erase(ref);
+    }
+    _residency.erase(handle);
+
+    auto pending = _pendingTextures.find(handle);
+    if (pending != _pendingTextures.end() && !pending->second.unloaded) {
+        // still bound to the placeholder; in-progress work is dropped once it comes back
+        if (pending->second.status == TextureStatus::kFailed
+            || pending->second.status == TextureStatus::kEvicted) {
+            _pendingTextures.erase(pending);
+        } else {
+            pending->second.unloaded = true;
+        }
+        return;
+    }
+
     auto elem = _textures.find(handle);
     if (elem == _textures.end()) {
         PANIC("Attemping to delete non-existing texture handle with id {}", handle);
     }
-    __TextureInternal& texture = elem->second;
-    if (texture.imguiTextureId.has_value()) {
-        ImGui_ImplVulkan_RemoveTexture(static_cast<VkDescriptorSet>(texture.imguiTextureId.value())
-        );
-    }
-    vkDestroyImageView(_device->logicalDevice, texture.textureImageView, nullptr);
-    vkDestroyImage(_device->logicalDevice, texture.textureImage, nullptr);
-    vkDestroySampler(_device->logicalDevice, texture.textureSampler, nullptr);
-    vkFreeMemory(_device->logicalDevice, texture.textureImageMemory, nullptr);
+    // frames in flight may still sample from the texture
+    releaseTexture(elem->second);
     _textures.erase(handle);
 }
 
 void TextureManager::transitionImageLayout(
+    VkCommandBuffer commandBuffer,
     VkImage image,
     VkFormat format,
     VkImageLayout oldLayout,
     VkImageLayout newLayout,
     uint32_t baseArrayLayer,
-    uint32_t layerCount
+    uint32_t layerCount,
+    uint32_t levelCount
 )
 {
-    VulkanUtils::QuickCommandBuffer commandBuffer(this->_device);
-
     // create a barrier to transition layout
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -441,7 +1215,7 @@ void TextureManager::transitionImageLayout(
     barrier.image = image;
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.levelCount = levelCount;
     barrier.subresourceRange.baseArrayLayer = baseArrayLayer;
     barrier.subresourceRange.layerCount = layerCount;
 
@@ -461,13 +1235,29 @@ void TextureManager::transitionImageLayout(
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
         sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        // fragment shaders of frames, or the compute shader converting equirectangular cubemaps
+        destinationStage
+            = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    } else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_GENERAL) {
+        // before being written by a compute shader
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+
+        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        destinationStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    } else if (oldLayout == VK_IMAGE_LAYOUT_GENERAL
+               && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        sourceStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
         destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
     } else {
         FATAL("Unsupported texture layout transition!");
     }
 
     vkCmdPipelineBarrier(
-        commandBuffer.cmdBuffer,
+        commandBuffer,
         sourceStage,
         destinationStage,
         0,
@@ -481,42 +1271,188 @@ void TextureManager::transitionImageLayout(
 }
 
 void TextureManager::copyBufferToImage(
-    VkBuffer buffer,
+    VkCommandBuffer commandBuffer,
+    const __StagingAllocation& staging,
     VkImage image,
-    uint32_t width,
-    uint32_t height
+    const std::vector<TextureData::Level>& levels
 )
 {
-    VulkanUtils::QuickCommandBuffer commandBuffer(this->_device);
+    std::vector<VkBufferImageCopy> regions(levels.size());
+    for (size_t i = 0; i < levels.size(); i++) {
+        VkBufferImageCopy& region = regions[i];
+        region.bufferOffset = staging.offset + levels[i].offset;
+        // in some cases the pixels aren't tightly packed, specify them.
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = i;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {levels[i].width, levels[i].height, 1};
+    }
 
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    // in some cases the pixels aren't tightly packed, specify them.
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
+    vkCmdCopyBufferToImage(
+        commandBuffer,
+        staging.buffer,
+        image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        regions.size(),
+        regions.data()
+    );
+}
 
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
+TextureManager::__StagingAllocation TextureManager::allocateStaging(VkDeviceSize size)
+{
+    if (size > _stagingRing.GetCapacity()) {
+        VQBuffer stagingBuffer = _device->CreateBuffer(
+            size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        getUploadBatch().stagingBuffers.push_back(stagingBuffer);
+        return __StagingAllocation{stagingBuffer.buffer, 0, stagingBuffer.bufferAddress};
+    }
 
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {width, height, 1};
+    // texel blocks are 4 bytes for RGBA8 and 16 for BC7
+    VkDeviceSize alignment = std::max<VkDeviceSize>(
+        16, _device->properties.limits.optimalBufferCopyOffsetAlignment
+    );
+    std::optional<StagingRing::Allocation> allocation;
+    while (!(allocation = _stagingRing.Allocate(size, alignment))) {
+        // ring is full, block on the oldest batch still reading from it
+        if (_uploadBatches.empty()) {
+            submitUploadBatch();
+        }
+        if (_uploadBatches.empty()) {
+            FATAL("Staging ring exhausted with no upload in flight!");
+        }
+        VK_CHECK_RESULT(vkWaitForFences(
+            _device->logicalDevice, 1, &_uploadBatches.front().fence, VK_TRUE, UINT64_MAX
+        ));
+        retireUploadBatches();
+    }
+    return __StagingAllocation{_stagingRing.GetBuffer(), allocation->offset, allocation->data};
+}
 
-    vkCmdCopyBufferToImage(
-        commandBuffer.cmdBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region
+TextureManager::__UploadBatch& TextureManager::getUploadBatch()
+{
+    if (_recordingBatch.has_value()) {
+        return _recordingBatch.value();
+    }
+    __UploadBatch& batch = _recordingBatch.emplace();
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = _uploadCommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    VK_CHECK_RESULT(
+        vkAllocateCommandBuffers(_device->logicalDevice, &allocInfo, &batch.commandBuffer)
     );
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK_RESULT(vkBeginCommandBuffer(batch.commandBuffer, &beginInfo));
+    return batch;
 }
 
-void TextureManager::Init(std::shared_ptr<VQDevice> device) { this->_device = device; }
+void TextureManager::submitUploadBatch()
+{
+    if (!_recordingBatch.has_value()) {
+        return;
+    }
+    __UploadBatch& batch = _recordingBatch.value();
+    VK_CHECK_RESULT(vkEndCommandBuffer(batch.commandBuffer));
+    batch.stagingRingHead = _stagingRing.GetHead();
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VK_CHECK_RESULT(vkCreateFence(_device->logicalDevice, &fenceInfo, nullptr, &batch.fence));
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+    // same queue as the frames, so any frame submitted afterwards sees the uploads
+    VK_CHECK_RESULT(vkQueueSubmit(_device->graphicsQueue, 1, &submitInfo, batch.fence));
+
+    _uploadBatches.push_back(std::move(batch));
+    _recordingBatch.reset();
+}
 
-TextureManager::Texture TextureManager::GetTexture(uint32_t handle)
+void TextureManager::retireUploadBatches()
 {
-    auto it = _textures.find(handle);
-    if (it == _textures.end()) {
-        FATAL("Texture not loaded: {}", handle);
+    while (!_uploadBatches.empty()) {
+        __UploadBatch& batch = _uploadBatches.front();
+        if (vkGetFenceStatus(_device->logicalDevice, batch.fence) != VK_SUCCESS) {
+            break;
+        }
+        _stagingRing.Release(batch.stagingRingHead);
+        for (VQBuffer& stagingBuffer : batch.stagingBuffers) {
+            stagingBuffer.Cleanup();
+        }
+        for (std::function<void()>& callback : batch.completionCallbacks) {
+            callback();
+        }
+        vkFreeCommandBuffers(_device->logicalDevice, _uploadCommandPool, 1, &batch.commandBuffer);
+        vkDestroyFence(_device->logicalDevice, batch.fence, nullptr);
+        _uploadBatches.pop_front();
     }
-    __TextureInternal& tex = it->second;
+}
+
+void TextureManager::FlushUploads()
+{
+    retireUploadBatches();
+    submitUploadBatch();
+}
+
+void TextureManager::Init(std::shared_ptr<VQDevice> device, DeferredDeletionQueue* deletionQueue)
+{
+    this->_device = device;
+    this->_deletionQueue = deletionQueue;
+
+    _stagingRing.Init(_device.get(), STAGING_RING_SIZE);
+    VulkanUtils::createCommandPool(
+        &_uploadCommandPool,
+        VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        _device->queueFamilyIndices.graphicsFamily.value(),
+        _device->logicalDevice
+    );
+    VkFormatProperties bc7Properties;
+    vkGetPhysicalDeviceFormatProperties(
+        _device->physicalDevice, VK_FORMAT_BC7_SRGB_BLOCK, &bc7Properties
+    );
+    _bc7Supported = _device->enabledFeatures.textureCompressionBC
+                    && (bc7Properties.optimalTilingFeatures
+                        & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+
+    _placeholderHandle = uploadTexture(TextureData{
+        .format = VK_FORMAT_R8G8B8A8_SRGB,
+        .width = 1,
+        .height = 1,
+        .levels = {{.offset = 0, .size = PLACEHOLDER_PIXEL.size(), .width = 1, .height = 1}},
+        .texels = {PLACEHOLDER_PIXEL.begin(), PLACEHOLDER_PIXEL.end()}});
+
+    VulkanUtils::createCommandPool(
+        &_transferCommandPool,
+        VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        _device->queueFamilyIndices.transferFamily.value(),
+        _device->logicalDevice
+    );
+    _stopDecodeWorkers = false;
+    uint32_t numWorkers
+        = std::clamp(std::thread::hardware_concurrency() / 2, 1u, MAX_DECODE_WORKERS);
+    for (uint32_t i = 0; i < numWorkers; i++) {
+        _decodeWorkers.emplace_back(&TextureManager::decodeWorker, this);
+    }
+}
+
+TextureManager::Texture TextureManager::GetTexture(uint32_t handle)
+{
+    __TextureInternal& tex = getTexture(handle);
     return Texture{
         .sampler = tex.textureSampler,
         .imageView = tex.textureImageView,
@@ -526,11 +1462,11 @@ TextureManager::Texture TextureManager::GetTexture(uint32_t handle)
 
 ImGuiTexture TextureManager::GetImGuiTexture(uint32_t handle)
 {
-    auto it = _textures.find(handle);
-    if (it == _textures.end()) {
-        FATAL("Texture not loaded: {}", handle);
+    auto pending = _pendingTextures.find(handle);
+    if (pending != _pendingTextures.end() && !pending->second.wantImGuiTexture) {
+        FATAL("Texture {} is not loaded as ImGui texture!", handle);
     }
-    __TextureInternal& tex = it->second;
+    __TextureInternal& tex = getTexture(handle);
     if (!tex.imguiTextureId.has_value()) {
         FATAL("Texture {} is not loaded as ImGui texture!", handle);
     }
@@ -539,16 +1475,39 @@ ImGuiTexture TextureManager::GetImGuiTexture(uint32_t handle)
 
 void TextureManager::LoadImGuiTexture(uint32_t handle)
 {
+    auto pending = _pendingTextures.find(handle);
+    if (pending != _pendingTextures.end() && !pending->second.unloaded) {
+        if (pending->second.wantImGuiTexture) { // shared handle, loaded by another user
+            return;
+        }
+        // created along with the real texture; the placeholder's is shared meanwhile
+        pending->second.wantImGuiTexture = true;
+        createPlaceholderImGuiTexture();
+        return;
+    }
+
     auto it = _textures.find(handle);
     if (it == _textures.end()) {
         FATAL("Texture not loaded: {}", handle);
     }
     __TextureInternal& tex = it->second;
-    if (tex.imguiTextureId.has_value()) {
-        FATAL("Texture {} has its imgui texture loaded already!", handle);
+    if (tex.imguiTextureId.has_value()) { // shared handle, loaded by another user
+        return;
     }
 
     tex.imguiTextureId = ImGui_ImplVulkan_AddTexture(
         tex.textureSampler, tex.textureImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
     );
 }
+
+void TextureManager::createPlaceholderImGuiTexture()
+{
+    __TextureInternal& placeholder = _textures.at(_placeholderHandle);
+    if (!placeholder.imguiTextureId.has_value()) {
+        placeholder.imguiTextureId = ImGui_ImplVulkan_AddTexture(
+            placeholder.textureSampler,
+            placeholder.textureImageView,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        );
+    }
+}
@@ -1,12 +1,25 @@
 #pragma once
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "TextureDiskCache.h"
+#include "lib/DeferredDeletionQueue.h"
+#include "lib/StagingRing.h"
 #include "lib/VQDevice.h"
 #include "structs/ImGuiTexture.h"
 #include <vulkan/vulkan_core.h>
 
 class VQDevice;
 
-// TODO: use a single command buffe for higher throughput; may implement our own command buffer
-// "buffer".
+// Owns all textures of the engine and apps.
+// Uploads are staged through a persistent ring buffer and recorded into a single command
+// buffer, which `FlushUploads()` submits once per tick.
+// 2D textures are transcoded through `TextureDiskCache`, which keeps their mip chains on disk.
+// Async textures may opt into eviction, see `LoadOptions::priority`.
 class TextureManager
 {
 
@@ -19,52 +32,304 @@ class TextureManager
         int height;
     };
 
+    enum class TextureStatus
+    {
+        kLoading, // being decoded or uploaded, the placeholder is bound
+        kReady,
+        kFailed, // could not be decoded, the placeholder stays bound
+        kEvicted // released over the residency budget, streamed in again on its next use
+    };
+
+    // which evictable textures go first when over the residency budget; among equal priorities
+    // the least recently used does.
+    enum class ResidencyPriority
+    {
+        kLow,
+        kNormal,
+        kHigh,
+        kPinned // never evicted
+    };
+
+    struct LoadOptions
+    {
+        bool generateMipmaps = true;
+        // store the texture as BC7 where supported, a quarter of the memory of RGBA8 but lossy;
+        // only for textures whose exact values don't matter, never for stimuli.
+        bool lossyCompression = false;
+        // downscales the image to fit, for thumbnails; 0 keeps the full size
+        uint32_t maxExtent = 0;
+        // the plane of `.tetra` images to load, ignored for other files
+        ColorSpace plane = ColorSpace::RGB;
+        // for `LoadTextureAsync()`. Unpinned textures are evicted once idle, i.e. not fetched
+        // through `GetTexture()` & co. during the last tick, while textures are over the
+        // residency budget; their users must fetch them again on every tick they use them.
+        ResidencyPriority priority = ResidencyPriority::kPinned;
+    };
+
+    struct CacheStats
+    {
+        uint32_t hits = 0;   // loads served by a texture already loaded from the same file
+        uint32_t misses = 0; // loads that decoded and uploaded
+        uint32_t cachedTextures = 0;
+    };
+
+    struct ResidencyStats
+    {
+        VkDeviceSize budget = 0;
+        VkDeviceSize residentBytes = 0;  // all textures' device memory
+        VkDeviceSize evictableBytes = 0; // of which unpinned textures'
+        uint32_t evictedTextures = 0;    // currently evicted
+        uint32_t evictions = 0;
+        uint32_t reloads = 0; // evicted textures used again
+    };
+
     TextureManager() { _device = nullptr; };
 
     ~TextureManager();
 
-    void Init(std::shared_ptr<VQDevice> device);
+    // `deletionQueue` defers destruction of unloaded textures until in-flight frames
+    // referencing them have finished.
+    void Init(std::shared_ptr<VQDevice> device, DeferredDeletionQueue* deletionQueue);
     // clean up and deallocate everything.
     // suggested to call before cleaning up swapchain.
     void Cleanup();
 
     void GetDescriptorImageInfo(uint32_t handle, VkDescriptorImageInfo& imageInfo);
 
-    uint32_t LoadTexture(const std::string& texturePath);
-    
+    // Loads of the same file, i.e. same canonical path, size and modification time, share one
+    // handle; every load must be paired with an `UnLoadTexture()`.
+
+    // the texture is usable by work submitted after the next `FlushUploads()`
+    uint32_t LoadTexture(const std::string& texturePath, const LoadOptions& options = {});
+
+    // returns immediately; the texture is decoded on a worker thread and uploaded on the transfer
+    // queue by `PollAsyncLoads()`. Until it is ready the handle resolves to a placeholder texture,
+    // so descriptors and ImGui textures fetched while loading must be fetched again afterwards.
+    uint32_t LoadTextureAsync(const std::string& texturePath, const LoadOptions& options = {});
+    TextureStatus GetTextureStatus(uint32_t handle) const;
+    bool IsTextureReady(uint32_t handle) const
+    {
+        return GetTextureStatus(handle) == TextureStatus::kReady;
+    }
+    // submits decoded textures for upload and swaps in those whose upload has finished;
+    // never blocks. Call once per tick from the render thread.
+    // also evicts idle textures while over the residency budget.
+    void PollAsyncLoads();
+    // submits the uploads recorded since the last call with a single fence; call once per tick
+    // before submitting the frame.
+    void FlushUploads();
+
+    // a 4x3 cross or a 2:1 equirectangular image, told apart by their aspect ratio;
+    // equirectangular images are projected onto the faces on the GPU.
     uint32_t LoadCubemapTexture(const std::string& imagePath);
+    // one square image per face, ordered +X, -X, +Y, -Y, +Z, -Z
+    uint32_t LoadCubemapTexture(const std::array<std::string, 6>& facePaths);
     
+    // drops one reference to the handle. On the last one the handle becomes invalid immediately,
+    // and the texture's GPU resources are released once frames in flight no longer use them.
     void UnLoadTexture(uint32_t handle);
     Texture GetTexture(uint32_t handle);
 
     void LoadImGuiTexture(uint32_t handle);
     ImGuiTexture GetImGuiTexture(uint32_t handle);
 
+    CacheStats GetCacheStats() const;
+
+    // device memory that textures may take before unpinned ones are evicted; pinned textures
+    // alone may exceed it.
+    void SetResidencyBudget(VkDeviceSize budget) { _residencyBudget = budget; }
+    ResidencyStats GetResidencyStats() const;
+
   private:
     struct __TextureInternal
     {
         VkImage textureImage;
         VkImageView textureImageView;
-        VkDeviceMemory textureImageMemory; // gpu memory that holds the image.
+        VQAllocation textureImageMemory; // gpu memory that holds the image.
         VkSampler textureSampler;          // sampler for shaders
         int width;
         int height;
         std::optional<void*> imguiTextureId = std::nullopt;
     };
 
+    // a texture loaded through `LoadTextureAsync()` that isn't ready yet
+    struct __PendingTexture
+    {
+        std::string path;
+        TextureStatus status = TextureStatus::kLoading;
+        bool wantImGuiTexture = false; // `LoadImGuiTexture()` was called while loading
+        bool unloaded = false;         // `UnLoadTexture()` was called while loading
+    };
+
+    struct __DecodeJob
+    {
+        uint32_t handle;
+        std::string path;
+        TextureDiskCache::Options options;
+    };
+
+    // output of a decode worker
+    struct __DecodedTexture
+    {
+        uint32_t handle;
+        VQBuffer stagingBuffer; // texels of `data`, empty if decoding failed
+        TextureData data;       // without its texels
+    };
+
+    // uploads recorded into one command buffer and submitted with one fence
+    struct __UploadBatch
+    {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        std::vector<std::pair<uint32_t, __TextureInternal>> textures; // streamed in on completion
+        std::vector<VQBuffer> stagingBuffers; // freed on completion
+        VkDeviceSize stagingRingHead = 0;     // released on completion
+        std::vector<std::function<void()>> completionCallbacks; // free transient resources
+    };
+
+    // an unpinned texture, kept from the load to stream it in again after an eviction
+    struct __Residency
+    {
+        std::string path;
+        TextureDiskCache::Options options;
+        ResidencyPriority priority;
+        uint64_t lastUsedTick;
+    };
+
+    struct __TextureRef
+    {
+        std::string cacheKey; // empty if the texture isn't cached
+        uint32_t refCount = 1;
+    };
+
+    // staging memory for an upload, from the ring or a buffer of its own
+    struct __StagingAllocation
+    {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        void* data;
+    };
+
+    // identifies the content of the file at `path`; empty if the file can't be stat'ed
+    static std::string getCacheKey(const std::string& path, const std::string& kind);
+    static std::string getTextureKind(const TextureDiskCache::Options& options);
+    TextureDiskCache::Options getDiskCacheOptions(const LoadOptions& options) const;
+    // bumps and returns the handle cached under `key`, 0 on a miss
+    uint32_t acquireCachedTexture(const std::string& key, bool requireReady);
+    void addTextureRef(const std::string& key, uint32_t handle);
+
+    // texture `handle` resolves to, the placeholder if it is still loading; marks it as used,
+    // streaming it in again if it was evicted.
+    __TextureInternal& getTexture(uint32_t handle);
+    uint32_t uploadTexture(const TextureData& data);
+    // records the upload into the upload batch, without registering a handle
+    __TextureInternal recordTextureUpload(const TextureData& data);
+    VkSampler createSampler();
+    void destroyTexture(const __TextureInternal& texture);
+    // destroys the texture once frames in flight no longer use it
+    void releaseTexture(const __TextureInternal& texture);
+    void createPlaceholderImGuiTexture();
+
+    uint32_t loadCrossCubemap(const TextureData& data);
+    uint32_t uploadCubemap(
+        const __StagingAllocation& staging,
+        const std::array<VkBufferImageCopy, 6>& regions,
+        uint32_t faceSize
+    );
+    uint32_t convertEquirectangular(const TextureData& data);
+    // false if the shader is missing, nothing is created then
+    bool createEquirectangularPipeline();
+    void createCubemapImage(
+        uint32_t faceSize,
+        VkFormat format,
+        VkImageUsageFlags usage,
+        VkImageCreateFlags flags,
+        VkImage& image,
+        VQAllocation& imageMemory
+    );
+    // creates the cube view and sampler of `image`, and registers the handle
+    uint32_t createCubemapTexture(
+        VkImage image,
+        const VQAllocation& imageMemory,
+        uint32_t faceSize
+    );
+
+    void decodeWorker();
+    void recordAsyncUpload(VkCommandBuffer cb, const __DecodedTexture& decoded, VkImage image);
+    void finishAsyncLoad(uint32_t handle, __TextureInternal& texture);
+
+    void enforceResidencyBudget();
+    void evictTexture(uint32_t handle);
+    // the texture must be loaded with at least `priority`
+    void raiseResidencyPriority(uint32_t handle, ResidencyPriority priority);
+
+    __StagingAllocation allocateStaging(VkDeviceSize size);
+    // batch that `LoadTexture()` & co. record into, begun on demand
+    __UploadBatch& getUploadBatch();
+    void submitUploadBatch();
+    void retireUploadBatches(); // frees the resources of completed batches
+
     void transitionImageLayout(
+        VkCommandBuffer commandBuffer,
         VkImage image,
         VkFormat format,
         VkImageLayout oldLayout,
         VkImageLayout newLayout,
         uint32_t baseArrayLayer = 0,
-        uint32_t layerCount = 1
+        uint32_t layerCount = 1,
+        uint32_t levelCount = 1
     );
 
-    // copy over content  in the staging buffer to the actual image
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+    // copy over the levels in the staging buffer to the actual image
+    void copyBufferToImage(
+        VkCommandBuffer commandBuffer,
+        const __StagingAllocation& staging,
+        VkImage image,
+        const std::vector<TextureData::Level>& levels
+    );
 
     uint32_t _nextHandle = 1;
     std::unordered_map<uint32_t, __TextureInternal> _textures; // handle -> texture obj
     std::shared_ptr<VQDevice> _device;
+    DeferredDeletionQueue* _deletionQueue = nullptr;
+    bool _bc7Supported = false; // sampling BC7 textures, for `LoadOptions::lossyCompression`
+
+    /* ---------- Cache ---------- */
+    std::unordered_map<std::string, uint32_t> _textureCache; // content key -> handle
+    std::unordered_map<uint32_t, __TextureRef> _textureRefs; // handle -> references
+    CacheStats _cacheStats;
+
+    /* ---------- Uploads ---------- */
+    StagingRing _stagingRing;
+    VkCommandPool _uploadCommandPool = VK_NULL_HANDLE;
+    std::optional<__UploadBatch> _recordingBatch;
+    std::deque<__UploadBatch> _uploadBatches; // submitted to the graphics queue, oldest first
+
+    /* ---------- Residency ---------- */
+    std::unordered_map<uint32_t, __Residency> _residency; // handle -> unpinned texture
+    VkDeviceSize _residencyBudget = DEFAULTS::TEXTURE_RESIDENCY_BUDGET;
+    uint64_t _tick = 0; // counts `PollAsyncLoads()`
+    uint32_t _numEvictions = 0;
+    uint32_t _numReloads = 0;
+
+    /* ---------- Cubemaps ---------- */
+    struct
+    {
+        VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+    } _equirectangularPipeline; // created on the first equirectangular load
+
+    /* ---------- Async Loading ---------- */
+    uint32_t _placeholderHandle = 0;
+    std::unordered_map<uint32_t, __PendingTexture> _pendingTextures;
+    VkCommandPool _transferCommandPool = VK_NULL_HANDLE;
+    std::vector<__UploadBatch> _streamingBatches; // submitted to the transfer queue
+
+    std::vector<std::thread> _decodeWorkers;
+    std::mutex _decodeMutex; // guards the members below, shared with the workers
+    std::condition_variable _decodeCV;
+    std::deque<__DecodeJob> _decodeQueue;
+    std::vector<__DecodedTexture> _decodedTextures;
+    bool _stopDecodeWorkers = false;
 };
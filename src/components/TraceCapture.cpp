@@ -0,0 +1,201 @@
+#include "TraceCapture.h"
+
+TraceCapture::~TraceCapture()
+{
+    if (IsCapturing()) { // flush what has been captured so far
+        std::lock_guard<std::mutex> lock(_mutex);
+        _numEvents = _numEventsRecorded;
+        _finished = true;
+        _numFramesLeft = 0;
+    }
+    _cv.notify_one();
+    joinWriter();
+}
+
+bool TraceCapture::Start(const std::string& path, uint32_t numFrames, uint32_t numThreads)
+{
+    if (IsCapturing() || numFrames == 0) {
+        return false;
+    }
+    joinWriter(); // the last capture may still be being written
+
+    _file = fopen(path.c_str(), "w");
+    if (!_file) {
+        ERROR("Failed to open trace capture file {}", path);
+        return false;
+    }
+    INFO("Capturing {} frames into {}...", numFrames, path);
+
+    // a frame event, and every scope of the frame; threads that start profiling during the
+    // capture share the room of the others
+    numThreads = std::clamp(numThreads, 1u, static_cast<uint32_t>(Profiler::MAX_THREADS));
+    size_t maxEventsPerFrame = 1 + numThreads * Profiler::MAX_ENTRIES_PER_FRAME
+                               + GpuProfiler::MAX_SCOPES_PER_FRAME;
+    _events.resize(numFrames * maxEventsPerFrame);
+    _numEventsRecorded = 0;
+    _numEventsDropped = 0;
+    _numEvents = 0;
+    _finished = false;
+    _threadNamed.fill(false);
+    _numFramesLeft = numFrames;
+    _captureBegin = Profiler::Clock::now();
+
+    _writing.store(true, std::memory_order_release);
+    _writer = std::thread(&TraceCapture::writerLoop, this);
+    return true;
+}
+
+void TraceCapture::RecordFrame(const FrameData& frame)
+{
+    if (!IsCapturing()) {
+        return;
+    }
+    pushEvent(Event{
+        .type = Event::Type::kFrame,
+        .colorSpace = frame.colorSpace,
+        .threadIdx = 0,
+        .name = "Frame",
+        .frameNumber = frame.frameNumber,
+        .beginNs = toCaptureTimeNs(frame.begin),
+        .durationNs = toCaptureTimeNs(frame.end) - toCaptureTimeNs(frame.begin),
+    });
+    for (const Profiler::Entry& entry : frame.cpuEntries) {
+        pushEvent(Event{
+            .type = Event::Type::kCpuScope,
+            .colorSpace = frame.colorSpace,
+            .threadIdx = entry.threadIdx,
+            .name = entry.name,
+            .frameNumber = frame.frameNumber,
+            .beginNs = toCaptureTimeNs(entry.begin),
+            .durationNs = toCaptureTimeNs(entry.end) - toCaptureTimeNs(entry.begin),
+        });
+    }
+    int64_t gpuSubmitNs = toCaptureTimeNs(frame.gpuSubmitTime);
+    for (const GpuProfiler::Entry& entry : frame.gpuEntries) {
+        int64_t beginNs = gpuSubmitNs + static_cast<int64_t>(entry.beginMs * 1e6);
+        if (beginNs < 0) { // submitted before the capture started
+            continue;
+        }
+        pushEvent(Event{
+            .type = Event::Type::kGpuScope,
+            .colorSpace = frame.colorSpace,
+            .threadIdx = 0,
+            .name = entry.name,
+            .frameNumber = frame.gpuFrameNumber,
+            .beginNs = beginNs,
+            .durationNs = static_cast<int64_t>((entry.endMs - entry.beginMs) * 1e6),
+        });
+    }
+
+    _numFramesLeft--;
+    if (_numFramesLeft == 0 && _numEventsDropped != 0) {
+        WARN("Trace capture ran out of room, dropped {} events", _numEventsDropped);
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _numEvents = _numEventsRecorded;
+        _finished = _numFramesLeft == 0;
+    }
+    _cv.notify_one();
+}
+
+void TraceCapture::joinWriter()
+{
+    if (_writer.joinable()) {
+        _writer.join();
+    }
+}
+
+void TraceCapture::writerLoop()
+{
+    fprintf(_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(_file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,");
+    fprintf(_file, "\"args\":{\"name\":\"Tetrium\"}},\n");
+    fprintf(_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,", FRAME_TID);
+    fprintf(_file, "\"args\":{\"name\":\"Frames\"}},\n");
+    fprintf(_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,", GPU_TID);
+    fprintf(_file, "\"args\":{\"name\":\"GPU\"}}");
+
+    size_t numWritten = 0;
+    while (true) {
+        size_t numEvents;
+        bool finished;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [&] { return _numEvents != numWritten || _finished; });
+            numEvents = _numEvents;
+            finished = _finished;
+        }
+        // events below `numEvents` are never touched by the producer again
+        for (; numWritten < numEvents; numWritten++) {
+            writeEvent(_events[numWritten]);
+        }
+        if (finished) {
+            break;
+        }
+    }
+
+    fprintf(_file, "\n]}\n");
+    fclose(_file);
+    _file = nullptr;
+    INFO("Trace capture written, {} events", numWritten);
+    _writing.store(false, std::memory_order_release);
+}
+
+void TraceCapture::writeEvent(const Event& event)
+{
+    fprintf(_file, ",\n"); // metadata events always come first
+
+    uint32_t tid = FRAME_TID;
+    switch (event.type) {
+    case Event::Type::kFrame:
+        tid = FRAME_TID;
+        break;
+    case Event::Type::kCpuScope:
+        tid = event.threadIdx + 1;
+        if (event.threadIdx < _threadNamed.size() && !_threadNamed[event.threadIdx]) {
+            _threadNamed[event.threadIdx] = true;
+            fprintf(
+                _file,
+                "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":"
+                "\"CPU Thread %u\"}},\n",
+                tid,
+                event.threadIdx
+            );
+        }
+        break;
+    case Event::Type::kGpuScope:
+        tid = GPU_TID;
+        break;
+    }
+
+    // trace-event timestamps are in microseconds
+    fprintf(_file, "{\"name\":");
+    writeString(event.name);
+    fprintf(
+        _file,
+        ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu",
+        tid,
+        event.beginNs / 1e3,
+        event.durationNs / 1e3,
+        static_cast<unsigned long long>(event.frameNumber)
+    );
+    if (event.type == Event::Type::kFrame) {
+        fprintf(
+            _file, ",\"colorSpace\":\"%s\"", event.colorSpace == ColorSpace::RGB ? "RGB" : "OCV"
+        );
+    }
+    fprintf(_file, "}}");
+}
+
+void TraceCapture::writeString(const char* str)
+{
+    fputc('"', _file);
+    for (const char* c = str; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', _file);
+        }
+        fputc(*c, _file);
+    }
+    fputc('"', _file);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#include "GpuProfiler.h"
+#include "Profiler.h"
+#include "structs/ColorSpace.h"
+
+// Captures consecutive frames of profiler scopes into a trace-event JSON file, which opens in
+// chrome://tracing and Perfetto.
+//
+// All events of a capture go into a buffer allocated in `Start()`. A background thread
+// serializes the events while the capture runs, so recording a frame only copies its scopes
+// into the buffer. Frames carry the scopes of every profiled thread.
+class TraceCapture
+{
+  public:
+    // everything recorded about a single frame
+    struct FrameData
+    {
+        uint64_t frameNumber;
+        ColorSpace colorSpace;
+        Profiler::TimeUnit begin;
+        Profiler::TimeUnit end;
+        std::span<const Profiler::Entry> cpuEntries;
+        // GPU scopes are placed relative to the submit time of the frame they were read back from
+        std::span<const GpuProfiler::Entry> gpuEntries;
+        Profiler::TimeUnit gpuSubmitTime;
+        uint64_t gpuFrameNumber; // frame the GPU scopes were recorded in
+    };
+
+    ~TraceCapture();
+
+    // Starts capturing the next `numFrames` frames into `path`, with room for the scopes of
+    // `numThreads` profiled threads per frame. Returns false if a capture is already running or
+    // the file cannot be opened.
+    bool Start(const std::string& path, uint32_t numFrames, uint32_t numThreads);
+
+    bool IsCapturing() const { return _numFramesLeft != 0; }
+
+    // whether the writer thread is still serializing a capture
+    bool IsWriting() const { return _writing.load(std::memory_order_acquire); }
+
+    uint32_t GetNumFramesLeft() const { return _numFramesLeft; }
+
+    // record a frame if capturing, call from the thread that owns the frame loop.
+    void RecordFrame(const FrameData& frame);
+
+  private:
+    struct Event
+    {
+        enum class Type : uint8_t
+        {
+            kFrame,
+            kCpuScope,
+            kGpuScope
+        };
+
+        Type type;
+        ColorSpace colorSpace; // only for `kFrame`
+        uint32_t threadIdx;    // only for `kCpuScope`
+        const char* name;
+        uint64_t frameNumber;
+        int64_t beginNs; // since the capture started
+        int64_t durationNs;
+    };
+
+    // trace-event thread ids; CPU threads follow `FRAME_TID`, in `Profiler::Entry::threadIdx` order
+    static constexpr uint32_t FRAME_TID = 0;
+    static constexpr uint32_t GPU_TID = Profiler::MAX_THREADS + 1;
+
+    void pushEvent(const Event& event)
+    {
+        if (_numEventsRecorded < _events.size()) {
+            _events[_numEventsRecorded++] = event;
+        } else {
+            _numEventsDropped++;
+        }
+    }
+
+    int64_t toCaptureTimeNs(Profiler::TimeUnit time) const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time - _captureBegin).count();
+    }
+
+    void joinWriter();
+    void writerLoop();
+    void writeEvent(const Event& event);
+    void writeString(const char* str);
+
+    std::vector<Event> _events;
+    size_t _numEventsRecorded = 0; // producer-side count, published to `_numEvents` every frame
+    size_t _numEventsDropped = 0;  // past the end of `_events`
+    uint32_t _numFramesLeft = 0;
+    Profiler::TimeUnit _captureBegin;
+
+    // writer thread
+    std::thread _writer;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    size_t _numEvents = 0;      // events published to the writer, guarded by `_mutex`
+    bool _finished = false;     // no more events will be published, guarded by `_mutex`
+    std::atomic<bool> _writing = false;
+    FILE* _file = nullptr;
+    std::array<bool, Profiler::MAX_THREADS> _threadNamed = {};
+};
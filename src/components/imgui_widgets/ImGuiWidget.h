@@ -47,7 +47,22 @@ class ImGuiWidgetPerfPlot : public ImGuiWidget
         bool Empty() { return Data.empty(); }
     };
 
+    // add the point to the scope's scrolling buffer if `addPoint`, and plot the buffer
+    void plotScope(
+        std::map<const char*, ScrollingBuffer>& scrollingBuffers,
+        const char* name,
+        const char* label,
+        float time,
+        float ms,
+        bool addPoint
+    );
+
     std::map<const char*, ScrollingBuffer> _scrollingBuffers;
+    std::map<const char*, ScrollingBuffer> _gpuScrollingBuffers;
+
+    // open with chrome://tracing or https://ui.perfetto.dev
+    static constexpr const char* TRACE_CAPTURE_PATH = "tetrium_trace.json";
+    int _numTraceCaptureFrames = 300;
 
     // shows the profiler plot; note on
     // lower-end systems the profiler plot itself consumes
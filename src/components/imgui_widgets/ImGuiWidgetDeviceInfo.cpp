@@ -6,6 +6,7 @@
 void ImGuiWidgetDeviceInfo::Draw(Tetrium* engine, ColorSpace colorSpace)
 {
     const int INDENT = 20;
+    const float MIB = 1024.f * 1024.f;
     { // GPU
         ImGui::SeparatorText("GPU");
         VQDevice* device = engine->_device.get();
@@ -18,6 +19,86 @@ void ImGuiWidgetDeviceInfo::Draw(Tetrium* engine, ColorSpace colorSpace)
         }
         ImGui::Indent(-INDENT);
     }
+    { // Memory
+        ImGui::SeparatorText("Memory");
+        VQMemoryAllocator::Report report = engine->_device->memoryAllocator.GetReport();
+        ImGui::Text("Device Memory Objects: %u", report.numDeviceMemoryObjects);
+        ImGui::Text(
+            "Dedicated: %u allocations, %.1f MiB",
+            report.numDedicatedAllocations,
+            report.dedicatedBytes / MIB
+        );
+        const std::array<const char*, 6> COLUMNS
+            = {"Type", "Strategy", "Blocks", "Allocations", "Used / Size (MiB)", "Fragmentation"};
+        if (ImGui::BeginTable("Memory Pools", COLUMNS.size(), ImGuiTableFlags_RowBg)) {
+            for (const char* column : COLUMNS) {
+                ImGui::TableSetupColumn(column);
+            }
+            ImGui::TableHeadersRow();
+            for (const VQMemoryAllocator::PoolReport& pool : report.pools) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", pool.memoryTypeIndex);
+                ImGui::TableNextColumn();
+                ImGui::Text(
+                    "%s", pool.strategy == VQMemoryAllocator::Strategy::kBuddy ? "Buddy" : "Linear"
+                );
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", pool.numBlocks);
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", pool.numAllocations);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f / %.1f", pool.usedBytes / MIB, pool.blockBytes / MIB);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.0f%%", pool.fragmentation * 100.f);
+            }
+            ImGui::EndTable();
+        }
+        std::vector<VQDevice::HeapBudget> heapBudgets = engine->_device->GetHeapBudgets();
+        if (heapBudgets.empty()) {
+            ImGui::Text("Heap budgets unavailable, VK_EXT_memory_budget is not supported.");
+        }
+        for (uint32_t i = 0; i < heapBudgets.size(); i++) {
+            bool deviceLocal = engine->_device->memoryProperties.memoryHeaps[i].flags
+                               & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+            ImGui::Text(
+                "Heap %u (%s): %.1f / %.1f MiB",
+                i,
+                deviceLocal ? "device local" : "host",
+                heapBudgets[i].usage / MIB,
+                heapBudgets[i].budget / MIB
+            );
+        }
+    }
+    { // Textures
+        ImGui::SeparatorText("Textures");
+        TextureManager::CacheStats stats = engine->_textureManager.GetCacheStats();
+        uint32_t loads = stats.hits + stats.misses;
+        ImGui::Text("Cached: %u", stats.cachedTextures);
+        ImGui::Text(
+            "Cache Hits: %u / %u (%.1f%%)",
+            stats.hits,
+            loads,
+            loads == 0 ? 0.f : 100.f * stats.hits / loads
+        );
+        TextureManager::ResidencyStats residency = engine->_textureManager.GetResidencyStats();
+        ImGui::Text(
+            "Resident: %.1f / %.1f MiB, %.1f MiB evictable",
+            residency.residentBytes / MIB,
+            residency.budget / MIB,
+            residency.evictableBytes / MIB
+        );
+        ImGui::Text(
+            "Evicted: %u, Evictions: %u, Reloads: %u",
+            residency.evictedTextures,
+            residency.evictions,
+            residency.reloads
+        );
+        int budgetMiB = static_cast<int>(residency.budget / MIB);
+        if (ImGui::SliderInt("Budget (MiB)", &budgetMiB, 64, 8192)) {
+            engine->_textureManager.SetResidencyBudget(static_cast<VkDeviceSize>(budgetMiB * MIB));
+        }
+    }
     { // Display
         ImGui::SeparatorText("Display");
         if (engine->_tetraMode == Tetrium::TetraMode::kEvenOddHardwareSync) {
@@ -27,6 +108,10 @@ void ImGuiWidgetDeviceInfo::Draw(Tetrium* engine, ColorSpace colorSpace)
             ImGui::Text("Size: %i x %i", display.extent.width, display.extent.height);
             ImGui::Text("Refresh Rate: %i hz", static_cast<int>(display.refreshrate / 1000.0f));
         }
+        if (engine->_tetraMode == Tetrium::TetraMode::kHeadless) {
+            ImGui::Text("Running headless, frames are rendered to off-screen images.");
+            return;
+        }
         GLFWmonitor* monitor = glfwGetWindowMonitor(engine->_window);
         if (monitor) {
             ImGui::Text("Device: %s", glfwGetMonitorName(monitor));
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "implot.h"
 
 #include "ImGuiWidget.h"
@@ -29,12 +31,53 @@ void ImGuiWidgetPerfPlot::ScrollingBuffer::Erase()
     }
 }
 
+void ImGuiWidgetPerfPlot::plotScope(
+    std::map<const char*, ScrollingBuffer>& scrollingBuffers,
+    const char* name,
+    const char* label,
+    float time,
+    float ms,
+    bool addPoint
+)
+{
+    auto it = scrollingBuffers.find(name);
+    if (it == scrollingBuffers.end()) {
+        auto res = scrollingBuffers.emplace(name, ScrollingBuffer());
+        ASSERT(res.second); // insertion success
+        it = res.first;
+    }
+    ScrollingBuffer& buf = it->second;
+    if (addPoint) {
+        buf.AddPoint(time, ms);
+    }
+    if (!buf.Empty()) {
+        ImPlot::PlotLine(
+            label, &buf.Data[0].x, &buf.Data[0].y, buf.Data.size(), 0, buf.Offset, 2 * sizeof(float)
+        );
+    }
+}
+
 void ImGuiWidgetPerfPlot::Draw(Tetrium* engine, ColorSpace colorSpace)
 {
     ImGui::Checkbox("Show Perf Plot", std::addressof(_wantShowPerfPlot));
     double deltaTimeSeconds = engine->_deltaTimer.GetDeltaTimeSeconds();
     ImGui::Text("Framerate: %f", 1 / deltaTimeSeconds);
 
+    { // trace capture
+        TraceCapture& traceCapture = engine->_traceCapture;
+        if (traceCapture.IsCapturing()) {
+            ImGui::Text("Capturing trace, %u frames left", traceCapture.GetNumFramesLeft());
+        } else if (traceCapture.IsWriting()) {
+            ImGui::Text("Writing trace to %s...", TRACE_CAPTURE_PATH);
+        } else {
+            ImGui::InputInt("Frames", std::addressof(_numTraceCaptureFrames));
+            _numTraceCaptureFrames = std::max(_numTraceCaptureFrames, 1);
+            if (ImGui::Button("Capture Trace")) {
+                traceCapture.Start(TRACE_CAPTURE_PATH, _numTraceCaptureFrames);
+            }
+        }
+    }
+
     bool showingPlot = false;
     if (_wantShowPerfPlot) {
         ImVec2 plotSize = {ImGui::GetWindowWidth(), ImGui::GetWindowHeight() / 2};
@@ -58,56 +101,107 @@ void ImGuiWidgetPerfPlot::Draw(Tetrium* engine, ColorSpace colorSpace)
         );
     }
 
-    ASSERT(engine->_lastProfilerData != nullptr);
-
     // iterate over entries, update scrolling buffers and plot
-    // also shows text for the raw numbers under the plot
-    for (Profiler::Entry& entry : *engine->_lastProfilerData) {
+    for (const Profiler::Entry& entry : engine->_lastProfilerData) {
         // ms time
         double ms = std::chrono::duration<double, std::chrono::milliseconds::period>(
                         entry.end - entry.begin
         )
                         .count();
         if (showingPlot) {
-            auto it = _scrollingBuffers.find(entry.name);
-            if (it == _scrollingBuffers.end()) {
-                auto res = _scrollingBuffers.emplace(entry.name, ScrollingBuffer());
-                ASSERT(res.second); // insertion success
-                it = res.first;
-            }
-            ScrollingBuffer& buf = it->second;
-
             // NOTE: we only update the scrolling buffer on RGB pass,
             // and present on OCV pass; no need to write the same data twice.
-            if (colorSpace == ColorSpace::RGB) {
-                buf.AddPoint(engine->_timeSinceStartSeconds, ms);
-            }
-            if (!buf.Empty()) {
-                ImPlot::PlotLine(
-                    entry.name,
-                    &buf.Data[0].x,
-                    &buf.Data[0].y,
-                    buf.Data.size(),
-                    0,
-                    buf.Offset,
-                    2 * sizeof(float)
-                );
-            }
+            plotScope(
+                _scrollingBuffers,
+                entry.name,
+                entry.name,
+                engine->_timeSinceStartSeconds,
+                ms,
+                colorSpace == ColorSpace::RGB
+            );
+        }
+    }
+    // GPU scopes are plotted alongside, prefixed to tell them apart from CPU scopes
+    if (showingPlot) {
+        for (const GpuProfiler::Entry& entry : engine->_gpuProfiler.GetLastFrame()) {
+            char label[128];
+            snprintf(label, sizeof(label), "GPU: %s", entry.name);
+            plotScope(
+                _gpuScrollingBuffers,
+                entry.name,
+                label,
+                engine->_timeSinceStartSeconds,
+                entry.endMs - entry.beginMs,
+                colorSpace == ColorSpace::RGB
+            );
         }
-        { // text section
-            int indentWidth = entry.level * 10;
-            if (indentWidth != 0) {
-                ImGui::Indent(indentWidth);
+    }
+    if (showingPlot) {
+        ImPlot::EndPlot();
+    }
+
+    // text section: last tick's entries in call hierarchy, with rolling stats of their scopes
+    const int NUM_COLUMNS = 5;
+    if (ImGui::BeginTable("Profiler Stats", NUM_COLUMNS, ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Scope");
+        ImGui::TableSetupColumn("Last (MS)");
+        ImGui::TableSetupColumn("Mean (MS)");
+        ImGui::TableSetupColumn("P99 (MS)");
+        ImGui::TableSetupColumn("Max (MS)");
+        ImGui::TableHeadersRow();
+        // entries are grouped by thread, each group headed by its thread
+        uint32_t threadIdx = UINT32_MAX;
+        for (const Profiler::Entry& entry : engine->_lastProfilerData) {
+            if (entry.threadIdx != threadIdx) {
+                threadIdx = entry.threadIdx;
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextDisabled("CPU Thread %u", threadIdx);
             }
-            // entry name
+            const Profiler::ScopeStats* stats = engine->_profiler.FindScopeStats(entry.name);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Indent(entry.level * 10 + 1);
             ImGui::Text("%s", entry.name);
-            ImGui::Text("%f MS", ms);
-            if (indentWidth != 0) {
-                ImGui::Unindent(indentWidth);
+            ImGui::Unindent(entry.level * 10 + 1);
+            ImGui::TableNextColumn();
+            ImGui::Text(
+                "%f",
+                std::chrono::duration<double, std::milli>(entry.end - entry.begin).count()
+            );
+            if (stats) {
+                ImGui::TableNextColumn();
+                ImGui::Text("%f", stats->meanMs);
+                ImGui::TableNextColumn();
+                ImGui::Text("%f", stats->p99Ms);
+                ImGui::TableNextColumn();
+                ImGui::Text("%f", stats->maxMs);
             }
         }
+        ImGui::EndTable();
     }
-    if (showingPlot) {
-        ImPlot::EndPlot();
+
+    // GPU scopes of the last frame read back, lagging a few ticks behind the CPU scopes
+    if (!engine->_gpuProfiler.IsSupported()) {
+        ImGui::Text("GPU timestamps are not supported by the graphics queue");
+        return;
+    }
+    if (ImGui::BeginTable("GPU Profiler", 3, ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("GPU Scope");
+        ImGui::TableSetupColumn("Start (MS)"); // since the frame's first timestamp
+        ImGui::TableSetupColumn("Duration (MS)");
+        ImGui::TableHeadersRow();
+        for (const GpuProfiler::Entry& entry : engine->_gpuProfiler.GetLastFrame()) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Indent(entry.level * 10 + 1);
+            ImGui::Text("%s", entry.name);
+            ImGui::Unindent(entry.level * 10 + 1);
+            ImGui::TableNextColumn();
+            ImGui::Text("%f", entry.beginMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%f", entry.endMs - entry.beginMs);
+        }
+        ImGui::EndTable();
     }
 };
@@ -27,6 +27,9 @@ const float ZFAR = 500.f;
 
 const float PROFILER_PERF_PLOT_RANGE_SECONDS = 10; // how large the plot window is
 
+// device memory for textures before evictable ones are released, see `TextureManager`
+const size_t TEXTURE_RESIDENCY_BUDGET = 1024ull * 1024 * 1024;
+
 #if !__APPLE__
 const float MAX_FPS = 144.f;
 #else
@@ -64,6 +67,9 @@ const struct
 
 const char* const ENGINE_NAME = "Tetrium Engine";
 
+// LUT correcting the projectors' response, applied to both color spaces
+const char* const DISPLAY_CORRECTION_LUT = "../assets/luts/display_correction.cube";
+
 const struct
 {
     uint32_t major = 0;
@@ -86,4 +92,8 @@ namespace DIRECTORIES
 {
 const std::string ASSETS = "../assets/";
 const std::string SHADERS = "../shaders/";
+// transcoded textures, see `TextureDiskCache`
+const std::string TEXTURE_CACHE = "./cache/textures/";
+// downscaled images, in the folder of their image, see `TextureDiskCache`
+const std::string THUMBNAIL_CACHE = ".thumbnails/";
 } // namespace DIRECTORIES
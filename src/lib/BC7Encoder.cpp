@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "BC7Encoder.h"
+
+namespace BC7Encoder
+{
+namespace
+{
+const uint32_t NUM_TEXELS = BLOCK_DIM * BLOCK_DIM;
+const uint32_t NUM_CHANNELS = 4;
+const uint32_t NUM_INDICES = 16;
+// interpolation weights of 4-bit indices, out of 64
+const std::array<int, NUM_INDICES> WEIGHTS
+    = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+using Texels = std::array<std::array<uint8_t, NUM_CHANNELS>, NUM_TEXELS>;
+using Color = std::array<float, NUM_CHANNELS>;
+
+struct BlockEncoding
+{
+    // 7-bit endpoint channels, their lowest bit is the endpoint's p-bit
+    std::array<std::array<uint8_t, NUM_CHANNELS>, 2> endpoints;
+    std::array<uint8_t, 2> pBits;
+    std::array<uint8_t, NUM_TEXELS> indices;
+    uint32_t error = UINT32_MAX;
+};
+
+// quantizes to 7 bits per channel, with the p-bit that fits the endpoint best
+void quantizeEndpoint(
+    const Color& color,
+    std::array<uint8_t, NUM_CHANNELS>& quantized,
+    uint8_t& pBit
+)
+{
+    float bestError = INFINITY;
+    for (int p = 0; p < 2; p++) {
+        std::array<uint8_t, NUM_CHANNELS> candidate;
+        float error = 0;
+        for (uint32_t c = 0; c < NUM_CHANNELS; c++) {
+            float value = std::clamp(color[c], 0.f, 255.f);
+            candidate[c] = std::clamp<int>(std::lround((value - p) / 2.f), 0, 127);
+            float diff = value - static_cast<float>((candidate[c] << 1) | p);
+            error += diff * diff;
+        }
+        if (error < bestError) {
+            bestError = error;
+            quantized = candidate;
+            pBit = p;
+        }
+    }
+}
+
+// quantizes the line between `e0` and `e1`, and picks the closest point on it for every texel
+void encodeLine(const Texels& texels, const Color& e0, const Color& e1, BlockEncoding& encoding)
+{
+    quantizeEndpoint(e0, encoding.endpoints[0], encoding.pBits[0]);
+    quantizeEndpoint(e1, encoding.endpoints[1], encoding.pBits[1]);
+
+    std::array<std::array<int, NUM_CHANNELS>, NUM_INDICES> palette;
+    for (uint32_t c = 0; c < NUM_CHANNELS; c++) {
+        int a = (encoding.endpoints[0][c] << 1) | encoding.pBits[0];
+        int b = (encoding.endpoints[1][c] << 1) | encoding.pBits[1];
+        for (uint32_t i = 0; i < NUM_INDICES; i++) {
+            palette[i][c] = ((64 - WEIGHTS[i]) * a + WEIGHTS[i] * b + 32) >> 6;
+        }
+    }
+
+    encoding.error = 0;
+    for (uint32_t t = 0; t < NUM_TEXELS; t++) {
+        uint32_t bestError = UINT32_MAX;
+        for (uint32_t i = 0; i < NUM_INDICES; i++) {
+            uint32_t error = 0;
+            for (uint32_t c = 0; c < NUM_CHANNELS; c++) {
+                int diff = texels[t][c] - palette[i][c];
+                error += diff * diff;
+            }
+            if (error < bestError) {
+                bestError = error;
+                encoding.indices[t] = i;
+            }
+        }
+        encoding.error += bestError;
+    }
+}
+
+// endpoints minimizing the squared error of the texels for their current indices; false if the
+// indices don't determine them, i.e. all texels share one index.
+bool fitEndpoints(const Texels& texels, const BlockEncoding& encoding, Color& e0, Color& e1)
+{
+    float aa = 0, ab = 0, bb = 0;
+    Color ax{}, bx{};
+    for (uint32_t t = 0; t < NUM_TEXELS; t++) {
+        float b = WEIGHTS[encoding.indices[t]] / 64.f;
+        float a = 1.f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (uint32_t c = 0; c < NUM_CHANNELS; c++) {
+            ax[c] += a * texels[t][c];
+            bx[c] += b * texels[t][c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f) {
+        return false;
+    }
+    for (uint32_t c = 0; c < NUM_CHANNELS; c++) {
+        e0[c] = (bb * ax[c] - ab * bx[c]) / det;
+        e1[c] = (aa * bx[c] - ab * ax[c]) / det;
+    }
+    return true;
+}
+
+// LSB-first bit stream
+struct BitWriter
+{
+    uint8_t* out;
+    uint32_t position = 0;
+
+    void Write(uint32_t value, uint32_t numBits)
+    {
+        for (uint32_t i = 0; i < numBits; i++, position++) {
+            out[position / 8] |= ((value >> i) & 1) << (position % 8);
+        }
+    }
+};
+
+void encodeBlock(const Texels& texels, uint8_t* out)
+{
+    // endpoints along the principal axis of the texels
+    Color mean{};
+    for (const auto& texel : texels) {
+        for (uint32_t c = 0; c < NUM_CHANNELS; c++) {
+            mean[c] += texel[c];
+        }
+    }
+    for (float& m : mean) {
+        m /= NUM_TEXELS;
+    }
+    std::array<Color, NUM_CHANNELS> covariance{};
+    for (const auto& texel : texels) {
+        for (uint32_t i = 0; i < NUM_CHANNELS; i++) {
+            for (uint32_t j = 0; j < NUM_CHANNELS; j++) {
+                covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+            }
+        }
+    }
+    // power iteration, seeded with the row of the channel varying the most
+    uint32_t seed = 0;
+    for (uint32_t c = 1; c < NUM_CHANNELS; c++) {
+        if (covariance[c][c] > covariance[seed][seed]) {
+            seed = c;
+        }
+    }
+    Color axis = covariance[seed];
+    for (int iteration = 0; iteration < 8; iteration++) {
+        Color next{};
+        float norm = 0;
+        for (uint32_t i = 0; i < NUM_CHANNELS; i++) {
+            for (uint32_t j = 0; j < NUM_CHANNELS; j++) {
+                next[i] += covariance[i][j] * axis[j];
+            }
+            norm = std::max(norm, std::abs(next[i]));
+        }
+        if (norm == 0) {
+            break;
+        }
+        for (uint32_t i = 0; i < NUM_CHANNELS; i++) {
+            axis[i] = next[i] / norm;
+        }
+    }
+    float axisLength = 0;
+    for (float a : axis) {
+        axisLength += a * a;
+    }
+    float minT = 0, maxT = 0;
+    if (axisLength > 0) {
+        minT = INFINITY;
+        maxT = -INFINITY;
+        for (const auto& texel : texels) {
+            float t = 0;
+            for (uint32_t c = 0; c < NUM_CHANNELS; c++) {
+                t += (texel[c] - mean[c]) * axis[c];
+            }
+            minT = std::min(minT, t / axisLength);
+            maxT = std::max(maxT, t / axisLength);
+        }
+    }
+    Color e0, e1;
+    for (uint32_t c = 0; c < NUM_CHANNELS; c++) {
+        e0[c] = mean[c] + axis[c] * minT;
+        e1[c] = mean[c] + axis[c] * maxT;
+    }
+
+    BlockEncoding best;
+    encodeLine(texels, e0, e1, best);
+    // one least-squares pass on the endpoints; quantization may make it worse, keep the better
+    if (best.error > 0 && fitEndpoints(texels, best, e0, e1)) {
+        BlockEncoding refined;
+        encodeLine(texels, e0, e1, refined);
+        if (refined.error < best.error) {
+            best = refined;
+        }
+    }
+
+    // the first index is stored without its MSB, flip the line if it is set
+    if (best.indices[0] >= NUM_INDICES / 2) {
+        std::swap(best.endpoints[0], best.endpoints[1]);
+        std::swap(best.pBits[0], best.pBits[1]);
+        for (uint8_t& index : best.indices) {
+            index = NUM_INDICES - 1 - index;
+        }
+    }
+
+    memset(out, 0, BLOCK_BYTES);
+    BitWriter writer{out};
+    writer.Write(1 << 6, 7); // mode 6
+    for (uint32_t c = 0; c < NUM_CHANNELS; c++) {
+        writer.Write(best.endpoints[0][c], 7);
+        writer.Write(best.endpoints[1][c], 7);
+    }
+    writer.Write(best.pBits[0], 1);
+    writer.Write(best.pBits[1], 1);
+    writer.Write(best.indices[0], 3);
+    for (uint32_t t = 1; t < NUM_TEXELS; t++) {
+        writer.Write(best.indices[t], 4);
+    }
+}
+} // namespace
+
+size_t GetEncodedSize(uint32_t width, uint32_t height)
+{
+    size_t blocksX = (width + BLOCK_DIM - 1) / BLOCK_DIM;
+    size_t blocksY = (height + BLOCK_DIM - 1) / BLOCK_DIM;
+    return blocksX * blocksY * BLOCK_BYTES;
+}
+
+void EncodeImage(const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* out)
+{
+    uint32_t blocksX = (width + BLOCK_DIM - 1) / BLOCK_DIM;
+    uint32_t blocksY = (height + BLOCK_DIM - 1) / BLOCK_DIM;
+    Texels texels;
+    for (uint32_t by = 0; by < blocksY; by++) {
+        for (uint32_t bx = 0; bx < blocksX; bx++) {
+            for (uint32_t y = 0; y < BLOCK_DIM; y++) {
+                uint32_t py = std::min(by * BLOCK_DIM + y, height - 1);
+                for (uint32_t x = 0; x < BLOCK_DIM; x++) {
+                    uint32_t px = std::min(bx * BLOCK_DIM + x, width - 1);
+                    memcpy(
+                        texels[y * BLOCK_DIM + x].data(),
+                        pixels + (static_cast<size_t>(py) * width + px) * NUM_CHANNELS,
+                        NUM_CHANNELS
+                    );
+                }
+            }
+            encodeBlock(texels, out + (static_cast<size_t>(by) * blocksX + bx) * BLOCK_BYTES);
+        }
+    }
+}
+} // namespace BC7Encoder
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CPU encoder for BC7 (`VK_FORMAT_BC7_*_BLOCK`) textures.
+//
+// Every block is encoded in mode 6: a single RGBA line with 7-bit endpoints, a p-bit per
+// endpoint and 4-bit indices. It is the most flexible mode for smooth content and, being the
+// only one tried, keeps encoding fast enough for load time; quality is below that of an encoder
+// searching all partitions, which is acceptable as BC7 is only used for textures opted into
+// lossy compression.
+namespace BC7Encoder
+{
+const uint32_t BLOCK_DIM = 4;
+const uint32_t BLOCK_BYTES = 16;
+
+// bytes of the encoding of a `width` x `height` image
+size_t GetEncodedSize(uint32_t width, uint32_t height);
+
+// Encodes tightly packed RGBA8 `pixels` into `out`, which must hold `GetEncodedSize()` bytes.
+// Blocks crossing the right or bottom edge repeat the edge texels.
+void EncodeImage(const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* out);
+} // namespace BC7Encoder
@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BRUSH_KERNELS_SSE
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define BRUSH_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+#include "BrushKernels.h"
+
+namespace BrushKernels
+{
+namespace
+{
+/* ---------- Spans ---------- */
+
+float* getRow(const Canvas& canvas, int32_t row)
+{
+    uint32_t rowLength = canvas.rowLength != 0 ? canvas.rowLength : canvas.width;
+    return canvas.pixels + static_cast<size_t>(row) * rowLength * 4;
+}
+
+// `n` pixels of `dst` = color
+void fillSpan(float* dst, uint32_t n, const std::array<float, 4>& color)
+{
+#if defined(BRUSH_KERNELS_SSE)
+    __m128 c = _mm_loadu_ps(color.data());
+    for (uint32_t i = 0; i < n; i++) {
+        _mm_storeu_ps(dst + i * 4, c);
+    }
+#elif defined(BRUSH_KERNELS_NEON)
+    float32x4_t c = vld1q_f32(color.data());
+    for (uint32_t i = 0; i < n; i++) {
+        vst1q_f32(dst + i * 4, c);
+    }
+#else
+    for (uint32_t i = 0; i < n; i++) {
+        memcpy(dst + i * 4, color.data(), sizeof(color));
+    }
+#endif
+}
+
+// `n` pixels of `dst` = dst * keep + color * (1 - keep), `keep` being `keeps` indexed by the
+// pixel's coverage; unfused like the shader's
+void blendSpan(
+    float* dst,
+    const uint16_t* coverage,
+    uint32_t n,
+    const std::array<float, 4>& color,
+    const std::vector<float>& keeps
+)
+{
+#if defined(BRUSH_KERNELS_SSE)
+    __m128 c = _mm_loadu_ps(color.data());
+    for (uint32_t i = 0; i < n; i++) {
+        float keep = keeps[coverage[i]];
+        __m128 pixel = _mm_loadu_ps(dst + i * 4);
+        __m128 add = _mm_mul_ps(c, _mm_set1_ps(1.f - keep));
+        _mm_storeu_ps(dst + i * 4, _mm_add_ps(_mm_mul_ps(pixel, _mm_set1_ps(keep)), add));
+    }
+#elif defined(BRUSH_KERNELS_NEON)
+    float32x4_t c = vld1q_f32(color.data());
+    for (uint32_t i = 0; i < n; i++) {
+        float keep = keeps[coverage[i]];
+        float32x4_t pixel = vld1q_f32(dst + i * 4);
+        float32x4_t add = vmulq_n_f32(c, 1.f - keep);
+        vst1q_f32(dst + i * 4, vaddq_f32(vmulq_n_f32(pixel, keep), add));
+    }
+#else
+    for (uint32_t i = 0; i < n; i++) {
+        float keep = keeps[coverage[i]];
+        for (uint32_t c = 0; c < 4; c++) {
+            dst[i * 4 + c] = dst[i * 4 + c] * keep + color[c] * (1.f - keep);
+        }
+    }
+#endif
+}
+
+/* ---------- Shapes ---------- */
+
+// half the width of each row of a stamp, from `-reach` to `reach`; negative if the row is empty
+template <Shape SHAPE> std::vector<int32_t> getHalfWidths(uint32_t brushSize)
+{
+    int32_t reach = GetReach(SHAPE, brushSize);
+    std::vector<int32_t> halfWidths(2 * reach + 1);
+    for (int32_t dy = -reach; dy <= reach; dy++) {
+        int32_t& halfWidth = halfWidths[dy + reach];
+        if constexpr (SHAPE == Shape::Square) {
+            halfWidth = reach;
+        } else if constexpr (SHAPE == Shape::Diamond) {
+            halfWidth = reach - std::abs(dy);
+        } else { // circles cover offsets within the radius, as compared in float
+            float radius = static_cast<float>(brushSize) / 2.f;
+            auto covers = [&](int32_t dx) {
+                return static_cast<float>(dx * dx + dy * dy) <= radius * radius;
+            };
+            halfWidth = std::min<int32_t>(
+                reach, static_cast<int32_t>(std::sqrt(std::max(0.f, radius * radius - dy * dy)))
+            );
+            // sqrt may be an ulp off either way
+            while (halfWidth < reach && covers(halfWidth + 1)) {
+                halfWidth++;
+            }
+            while (halfWidth >= 0 && !covers(halfWidth)) {
+                halfWidth--;
+            }
+        }
+    }
+    return halfWidths;
+}
+
+template <Shape SHAPE>
+void stroke(
+    const Canvas& canvas,
+    int32_t xBegin,
+    int32_t yBegin,
+    int32_t xEnd,
+    int32_t yEnd,
+    uint32_t brushSize,
+    const std::array<float, 4>& color,
+    const Stamps& stamps
+)
+{
+    int32_t reach = GetReach(SHAPE, brushSize);
+    std::vector<int32_t> halfWidths = getHalfWidths<SHAPE>(brushSize);
+
+    // Bresenham's line, stamping every `stamps.spacing` steps
+    std::vector<std::array<int32_t, 2>> centers;
+    int32_t dx = std::abs(xEnd - xBegin);
+    int32_t dy = std::abs(yEnd - yBegin);
+    int32_t sx = xBegin < xEnd ? 1 : -1;
+    int32_t sy = yBegin < yEnd ? 1 : -1;
+    int32_t err = (dx > dy ? dx : -dy) / 2;
+    int32_t x = xBegin;
+    int32_t y = yBegin;
+    for (uint32_t step = 0;; step++) {
+        if (step >= stamps.first && (step - stamps.first) % stamps.spacing == 0) {
+            centers.push_back({x, y});
+        }
+        if (x == xEnd && y == yEnd) {
+            break;
+        }
+        int32_t e2 = err;
+        if (e2 > -dx) {
+            err -= dy;
+            x += sx;
+        }
+        if (e2 < dy) {
+            err += dx;
+            y += sy;
+        }
+    }
+    if (centers.empty()) {
+        return;
+    }
+
+    // bounds of the stamps on the canvas
+    int32_t xMin = INT32_MAX;
+    int32_t yMin = INT32_MAX;
+    int32_t xMax = INT32_MIN;
+    int32_t yMax = INT32_MIN;
+    for (const auto& [cx, cy] : centers) {
+        xMin = std::min(xMin, cx - reach);
+        yMin = std::min(yMin, cy - reach);
+        xMax = std::max(xMax, cx + reach);
+        yMax = std::max(yMax, cy + reach);
+    }
+    xMin = std::max(xMin, 0);
+    yMin = std::max(yMin, 0);
+    xMax = std::min(xMax, static_cast<int32_t>(canvas.width) - 1);
+    yMax = std::min(yMax, static_cast<int32_t>(canvas.height) - 1);
+    if (xMin > xMax || yMin > yMax) {
+        return;
+    }
+
+    if constexpr (SHAPE != Shape::SoftCircle) {
+        if (stamps.spacing == 1) {
+            // The shapes are convex and the stamps step by at most a pixel monotonically, so the
+            // stamps covering a row are consecutive and their spans overlap: the union of the
+            // row's spans is one span, filled once.
+            std::vector<int32_t> rowMins(yMax - yMin + 1, INT32_MAX);
+            std::vector<int32_t> rowMaxs(yMax - yMin + 1, INT32_MIN);
+            for (const auto& [cx, cy] : centers) {
+                for (int32_t row = std::max(cy - reach, yMin); row <= std::min(cy + reach, yMax);
+                     row++) {
+                    int32_t halfWidth = halfWidths[row - cy + reach];
+                    if (halfWidth >= 0) {
+                        rowMins[row - yMin] = std::min(rowMins[row - yMin], cx - halfWidth);
+                        rowMaxs[row - yMin] = std::max(rowMaxs[row - yMin], cx + halfWidth);
+                    }
+                }
+            }
+            for (int32_t row = yMin; row <= yMax; row++) {
+                int32_t spanMin = std::max(rowMins[row - yMin], xMin);
+                int32_t spanMax = std::min(rowMaxs[row - yMin], xMax);
+                if (spanMin <= spanMax) {
+                    float* dst = getRow(canvas, row) + static_cast<size_t>(spanMin) * 4;
+                    fillSpan(dst, spanMax - spanMin + 1, color);
+                }
+            }
+            return;
+        }
+    }
+
+    // accumulate how many stamps cover each pixel, for each pixel to be painted once
+    uint32_t width = xMax - xMin + 1;
+    uint32_t height = yMax - yMin + 1;
+    std::vector<uint16_t> coverage(static_cast<size_t>(width) * height, 0);
+    std::vector<int32_t> rowMins(height, INT32_MAX);
+    std::vector<int32_t> rowMaxs(height, INT32_MIN);
+    for (const auto& [cx, cy] : centers) {
+        for (int32_t row = std::max(cy - reach, yMin); row <= std::min(cy + reach, yMax); row++) {
+            int32_t halfWidth = halfWidths[row - cy + reach];
+            int32_t spanMin = std::max(cx - halfWidth, xMin);
+            int32_t spanMax = std::min(cx + halfWidth, xMax);
+            if (spanMin > spanMax) {
+                continue;
+            }
+            uint16_t* rowCoverage = coverage.data() + static_cast<size_t>(row - yMin) * width;
+            for (int32_t i = spanMin; i <= spanMax; i++) {
+                rowCoverage[i - xMin]++;
+            }
+            rowMins[row - yMin] = std::min(rowMins[row - yMin], spanMin);
+            rowMaxs[row - yMin] = std::max(rowMaxs[row - yMin], spanMax);
+        }
+    }
+
+    // what's left of a pixel covered by `n` stamps of the soft brush is `keeps[n]`
+    std::vector<float> keeps;
+    if constexpr (SHAPE == Shape::SoftCircle) {
+        keeps.resize(centers.size() + 1);
+        keeps[0] = 1.f;
+        for (size_t n = 1; n < keeps.size(); n++) {
+            keeps[n] = keeps[n - 1] * (1.f - SOFT_CIRCLE_ALPHA);
+        }
+    }
+
+    // paint the covered runs of each row
+    for (int32_t row = yMin; row <= yMax; row++) {
+        const uint16_t* rowCoverage = coverage.data() + static_cast<size_t>(row - yMin) * width;
+        float* rowPixels = getRow(canvas, row);
+        int32_t runMin = rowMins[row - yMin];
+        while (runMin <= rowMaxs[row - yMin]) {
+            if (rowCoverage[runMin - xMin] == 0) { // spaced stamps may leave gaps at the edges
+                runMin++;
+                continue;
+            }
+            int32_t runMax = runMin;
+            while (runMax < rowMaxs[row - yMin] && rowCoverage[runMax + 1 - xMin] != 0) {
+                runMax++;
+            }
+            uint32_t n = runMax - runMin + 1;
+            if constexpr (SHAPE == Shape::SoftCircle) {
+                blendSpan(rowPixels + runMin * 4, rowCoverage + runMin - xMin, n, color, keeps);
+            } else {
+                fillSpan(rowPixels + runMin * 4, n, color);
+            }
+            runMin = runMax + 1;
+        }
+    }
+}
+} // namespace
+
+int32_t GetReach(Shape shape, uint32_t brushSize)
+{
+    if (shape == Shape::Square || shape == Shape::Diamond) {
+        return static_cast<int32_t>(brushSize);
+    }
+    return static_cast<int32_t>(static_cast<float>(brushSize) / 2.f);
+}
+
+uint32_t GetStampSpacing(Shape shape, uint32_t brushSize, float spacing)
+{
+    uint32_t diameter = 2 * GetReach(shape, brushSize) + 1;
+    return std::max(1u, static_cast<uint32_t>(diameter * spacing));
+}
+
+uint32_t GetNumSteps(int32_t xBegin, int32_t yBegin, int32_t xEnd, int32_t yEnd)
+{
+    return std::max(std::abs(xEnd - xBegin), std::abs(yEnd - yBegin));
+}
+
+Stamps GetNextStamps(const Stamps& stamps, uint32_t numSteps)
+{
+    if (stamps.first > numSteps) { // the segment had no stamp
+        return {.first = stamps.first - numSteps, .spacing = stamps.spacing};
+    }
+    // the segment's last step is the next one's first
+    uint32_t last = stamps.first + (numSteps - stamps.first) / stamps.spacing * stamps.spacing;
+    return {.first = last + stamps.spacing - numSteps, .spacing = stamps.spacing};
+}
+
+void Stamp(
+    Shape shape,
+    const Canvas& canvas,
+    int32_t x,
+    int32_t y,
+    uint32_t brushSize,
+    const std::array<float, 4>& color
+)
+{
+    Stroke(shape, canvas, x, y, x, y, brushSize, color);
+}
+
+void Stroke(
+    Shape shape,
+    const Canvas& canvas,
+    int32_t xBegin,
+    int32_t yBegin,
+    int32_t xEnd,
+    int32_t yEnd,
+    uint32_t brushSize,
+    const std::array<float, 4>& color,
+    const Stamps& stamps
+)
+{
+    ASSERT(stamps.spacing > 0);
+    switch (shape) {
+    case Shape::Circle:
+        stroke<Shape::Circle>(canvas, xBegin, yBegin, xEnd, yEnd, brushSize, color, stamps);
+        break;
+    case Shape::Square:
+        stroke<Shape::Square>(canvas, xBegin, yBegin, xEnd, yEnd, brushSize, color, stamps);
+        break;
+    case Shape::Diamond:
+        stroke<Shape::Diamond>(canvas, xBegin, yBegin, xEnd, yEnd, brushSize, color, stamps);
+        break;
+    case Shape::SoftCircle:
+        stroke<Shape::SoftCircle>(canvas, xBegin, yBegin, xEnd, yEnd, brushSize, color, stamps);
+        break;
+    default:
+        break;
+    }
+}
+} // namespace BrushKernels
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// CPU brush kernels painting into an RYGB canvas of interleaved float4 pixels, as the painter
+// keeps it in each of its tiles.
+//
+// A stroke is a series of segments, each stamping the brush along a Bresenham line, every
+// `Stamps::spacing` steps; the spacing carries over from one segment to the next so that stamps
+// are as dense however fast the stroke is drawn. Each pixel of a segment is painted once: hard
+// brushes fill it, the soft brush blends it in as many times as stamps cover it, in one go.
+//
+// Kernels are specialized on the brush shape at compile time and paint row by row: a row's
+// horizontal spans are clipped to the canvas once, then filled or blended with SIMD, one pixel
+// per 128-bit vector (SSE on x86-64, NEON on aarch64, scalar elsewhere). Covered pixels and
+// blended values are computed the same way as the GPU brush's, see `paint_strokes.comp`.
+namespace BrushKernels
+{
+// same order as `AppPainter::BrushStrokeType`
+enum class Shape : uint32_t
+{
+    Circle = 0,
+    Square,
+    Diamond,
+    SoftCircle, // circle blending the color in at `SOFT_CIRCLE_ALPHA` per stamp covering a pixel
+    ShapeCount
+};
+
+inline const float SOFT_CIRCLE_ALPHA = 0.3f;
+
+struct Canvas
+{
+    float* pixels; // `width` x `height` RYGB float4, rows top to bottom
+    uint32_t width;
+    uint32_t height;
+    uint32_t rowLength = 0; // pixels from one row to the next, `width` if 0
+};
+
+// where a segment's stamps fall along its Bresenham steps, step 0 being its beginning
+struct Stamps
+{
+    uint32_t first = 0;   // step of the first stamp
+    uint32_t spacing = 1; // steps between two stamps
+};
+
+// how far from its center a stamp reaches, along either axis
+int32_t GetReach(Shape shape, uint32_t brushSize);
+
+// steps between two stamps, `spacing` being a fraction of the brush's diameter
+uint32_t GetStampSpacing(Shape shape, uint32_t brushSize, float spacing);
+
+// steps of the Bresenham line from (xBegin, yBegin) to (xEnd, yEnd), one per pixel of its longer
+// axis
+uint32_t GetNumSteps(int32_t xBegin, int32_t yBegin, int32_t xEnd, int32_t yEnd);
+
+// the stamps of the segment continuing a segment of `numSteps` steps
+Stamps GetNextStamps(const Stamps& stamps, uint32_t numSteps);
+
+// stamps the brush once, centered on (x, y)
+void Stamp(
+    Shape shape,
+    const Canvas& canvas,
+    int32_t x,
+    int32_t y,
+    uint32_t brushSize,
+    const std::array<float, 4>& color
+);
+
+// paints the segment from (xBegin, yBegin) to (xEnd, yEnd), both included
+void Stroke(
+    Shape shape,
+    const Canvas& canvas,
+    int32_t xBegin,
+    int32_t yBegin,
+    int32_t xEnd,
+    int32_t yEnd,
+    uint32_t brushSize,
+    const std::array<float, 4>& color,
+    const Stamps& stamps = {}
+);
+} // namespace BrushKernels
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Per-frame-in-flight queue of deletion functions for resources that may still be
+ * referenced by command buffers the GPU has not finished executing.
+ *
+ * A resource released while recording frame `i` is destroyed the next time frame `i`'s
+ * `fenceInFlight` has been waited on, at which point no submitted work can reference it.
+ * Unlike `DeletionStack`, deleters run in FIFO order as they're independent of each other.
+ */
+struct DeferredDeletionQueue
+{
+    void push(std::function<void()>&& function) { _deleters[_currentFrame].push_back(function); }
+
+    /**
+     * @brief Flush deleters queued the last time `frameIdx` was recorded, and direct
+     * subsequent pushes to `frameIdx`. Call right after waiting on the frame's fence.
+     */
+    void beginFrame(uint8_t frameIdx)
+    {
+        flush(frameIdx);
+        _currentFrame = frameIdx;
+    }
+
+    /**
+     * @brief Flush deleters of all frames. The device must be idle.
+     */
+    void flushAll()
+    {
+        for (size_t i = 0; i < NUM_FRAME_IN_FLIGHT; i++) {
+            flush(i);
+        }
+    }
+
+    ~DeferredDeletionQueue()
+    {
+        for (const auto& deleters : _deleters) {
+            if (!deleters.empty()) {
+                PANIC("Deferred deletion queue not emptied. Please use "
+                      "DeferredDeletionQueue::flushAll() to empty the queue");
+            }
+        }
+    }
+
+  private:
+    void flush(size_t frameIdx)
+    {
+        std::vector<std::function<void()>>& deleters = _deleters[frameIdx];
+        for (auto& deleter : deleters) {
+            deleter();
+        }
+        deleters.clear();
+    }
+
+    uint8_t _currentFrame = 0;
+    std::array<std::vector<std::function<void()>>, NUM_FRAME_IN_FLIGHT> _deleters;
+};
@@ -0,0 +1,90 @@
+#include "MappedFile.h"
+
+#if defined(WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // WIN32
+
+#if defined(WIN32)
+std::shared_ptr<MappedFile> MappedFile::Open(const std::string& path)
+{
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->_file = CreateFileA(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (file->_file == INVALID_HANDLE_VALUE) {
+        file->_file = nullptr;
+        return nullptr;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file->_file, &size) || size.QuadPart == 0) {
+        return nullptr;
+    }
+    file->_mapping = CreateFileMappingA(file->_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!file->_mapping) {
+        return nullptr;
+    }
+    void* data = MapViewOfFile(file->_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        return nullptr;
+    }
+    file->_data = static_cast<const uint8_t*>(data);
+    file->_size = static_cast<size_t>(size.QuadPart);
+    return file;
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data) {
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping) {
+        CloseHandle(_mapping);
+    }
+    if (_file) {
+        CloseHandle(_file);
+    }
+}
+#else
+std::shared_ptr<MappedFile> MappedFile::Open(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat status;
+    // empty files can't be mapped
+    if (fstat(fd, &status) != 0 || status.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(status.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->_data = static_cast<const uint8_t*>(data);
+    file->_size = size;
+    return file;
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data) {
+        munmap(const_cast<uint8_t*>(_data), _size);
+    }
+}
+#endif // WIN32
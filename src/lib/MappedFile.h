@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Read-only memory mapping of a whole file, for files laid out to be used in place. Pages are
+// read in by the OS as they are touched and stay in the page cache across mappings.
+class MappedFile
+{
+  public:
+    // `nullptr` if the file can't be opened or mapped
+    static std::shared_ptr<MappedFile> Open(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const uint8_t* GetData() const { return _data; }
+    size_t GetSize() const { return _size; }
+
+  private:
+    MappedFile() = default;
+
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+#if defined(WIN32)
+    void* _file = nullptr;    // HANDLE
+    void* _mapping = nullptr; // HANDLE
+#endif
+};
@@ -0,0 +1,625 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define RYGB_TRANSFORM_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define RYGB_TRANSFORM_NEON
+#include <arm_neon.h>
+#endif
+
+// AVX2 kernels are compiled for their own target and picked at runtime,
+// the rest of the binary stays on the baseline instruction set.
+#if defined(RYGB_TRANSFORM_X86) && (defined(__GNUC__) || defined(__clang__))
+#define RYGB_TRANSFORM_AVX2
+#define TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#elif defined(RYGB_TRANSFORM_X86) && defined(_MSC_VER)
+// MSVC emits any intrinsic regardless of /arch, the CPU is queried with `__cpuid` instead
+#define RYGB_TRANSFORM_AVX2
+#define TARGET_AVX2
+#include <intrin.h>
+#endif
+
+#include "RYGBTransform.h"
+
+namespace RYGBTransform
+{
+namespace
+{
+constexpr uint32_t BLOCK_SIZE = 64; // pixels converted at a time, a multiple of all SIMD widths
+constexpr uint32_t NUM_COEFFS = 12; // coefficients of a 4x3 matrix
+
+using Channel = std::array<float, BLOCK_SIZE>;
+
+// a block of pixels in structure-of-arrays form
+struct Block
+{
+    alignas(32) std::array<Channel, 4> rygb;
+    alignas(32) std::array<Channel, 4> out; // 3 transformed channels, then alpha of 1
+    alignas(32) std::array<float, BLOCK_SIZE * 4> interleaved; // staging for half conversions
+};
+
+// `coeffs[c * 3 + i]` is `m[c][i]`, the weight of input channel c on output channel i
+using Coeffs = std::array<float, NUM_COEFFS>;
+
+struct Kernels
+{
+    const char* name;
+    // block.out[0..2] = transform of block.rygb, over the whole block
+    void (*transform)(const Coeffs& coeffs, Block& block);
+    // block.rygb = `n` 4-channel pixels of `src`
+    void (*deinterleave4)(const float* src, Block& block, uint32_t n);
+    // `n` `numChannels`-channel pixels of `dst` = block.out
+    void (*interleave)(const Block& block, float* dst, uint32_t numChannels, uint32_t n);
+    void (*halfToFloat)(const uint16_t* src, float* dst, size_t n);
+    void (*floatToHalf)(const float* src, uint16_t* dst, size_t n);
+};
+
+/* ---------- Scalar ---------- */
+
+[[maybe_unused]] void transformScalar(const Coeffs& c, Block& block)
+{
+    for (uint32_t n = 0; n < BLOCK_SIZE; n++) {
+        float x = block.rygb[0][n];
+        float y = block.rygb[1][n];
+        float z = block.rygb[2][n];
+        float w = block.rygb[3][n];
+        for (uint32_t i = 0; i < 3; i++) {
+            block.out[i][n]
+                = std::fma(c[9 + i], w, std::fma(c[6 + i], z, std::fma(c[3 + i], y, c[i] * x)));
+        }
+    }
+}
+
+[[maybe_unused]] void deinterleave4Scalar(const float* src, Block& block, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        for (uint32_t c = 0; c < 4; c++) {
+            block.rygb[c][i] = src[i * 4 + c];
+        }
+    }
+}
+
+void interleaveScalar(const Block& block, float* dst, uint32_t numChannels, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        for (uint32_t c = 0; c < numChannels; c++) {
+            dst[i * numChannels + c] = block.out[c][i];
+        }
+    }
+}
+
+void halfToFloatScalar(const uint16_t* src, float* dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = HalfToFloat(src[i]);
+    }
+}
+
+void floatToHalfScalar(const float* src, uint16_t* dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = FloatToHalf(src[i]);
+    }
+}
+
+/* ---------- SSE ---------- */
+#if defined(RYGB_TRANSFORM_X86)
+
+// SSE2 has no FMA, so each product is rounded before it's added: results are NOT bit-exact
+// against the fma chain of the other kernels and the GPU, and may differ in the last few ulps.
+void transformSSE(const Coeffs& c, Block& block)
+{
+    __m128 m[NUM_COEFFS];
+    for (uint32_t k = 0; k < NUM_COEFFS; k++) {
+        m[k] = _mm_set1_ps(c[k]);
+    }
+    for (uint32_t n = 0; n < BLOCK_SIZE; n += 4) {
+        __m128 x = _mm_load_ps(&block.rygb[0][n]);
+        __m128 y = _mm_load_ps(&block.rygb[1][n]);
+        __m128 z = _mm_load_ps(&block.rygb[2][n]);
+        __m128 w = _mm_load_ps(&block.rygb[3][n]);
+        for (uint32_t i = 0; i < 3; i++) {
+            __m128 r = _mm_mul_ps(m[i], x);
+            r = _mm_add_ps(r, _mm_mul_ps(m[3 + i], y));
+            r = _mm_add_ps(r, _mm_mul_ps(m[6 + i], z));
+            r = _mm_add_ps(r, _mm_mul_ps(m[9 + i], w));
+            _mm_store_ps(&block.out[i][n], r);
+        }
+    }
+}
+
+void deinterleave4SSE(const float* src, Block& block, uint32_t n)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 p0 = _mm_loadu_ps(src + i * 4);
+        __m128 p1 = _mm_loadu_ps(src + i * 4 + 4);
+        __m128 p2 = _mm_loadu_ps(src + i * 4 + 8);
+        __m128 p3 = _mm_loadu_ps(src + i * 4 + 12);
+        _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+        _mm_store_ps(&block.rygb[0][i], p0);
+        _mm_store_ps(&block.rygb[1][i], p1);
+        _mm_store_ps(&block.rygb[2][i], p2);
+        _mm_store_ps(&block.rygb[3][i], p3);
+    }
+    for (; i < n; i++) {
+        for (uint32_t c = 0; c < 4; c++) {
+            block.rygb[c][i] = src[i * 4 + c];
+        }
+    }
+}
+
+void interleaveSSE(const Block& block, float* dst, uint32_t numChannels, uint32_t n)
+{
+    if (numChannels != 4) { // 3-channel pixels straddle vectors, not worth the shuffles
+        interleaveScalar(block, dst, numChannels, n);
+        return;
+    }
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 c0 = _mm_load_ps(&block.out[0][i]);
+        __m128 c1 = _mm_load_ps(&block.out[1][i]);
+        __m128 c2 = _mm_load_ps(&block.out[2][i]);
+        __m128 c3 = _mm_load_ps(&block.out[3][i]);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        _mm_storeu_ps(dst + i * 4, c0);
+        _mm_storeu_ps(dst + i * 4 + 4, c1);
+        _mm_storeu_ps(dst + i * 4 + 8, c2);
+        _mm_storeu_ps(dst + i * 4 + 12, c3);
+    }
+    for (; i < n; i++) {
+        for (uint32_t c = 0; c < 4; c++) {
+            dst[i * 4 + c] = block.out[c][i];
+        }
+    }
+}
+
+#endif // RYGB_TRANSFORM_X86
+
+/* ---------- AVX2 ---------- */
+#if defined(RYGB_TRANSFORM_AVX2)
+
+TARGET_AVX2 void transformAVX2(const Coeffs& c, Block& block)
+{
+    __m256 m[NUM_COEFFS];
+    for (uint32_t k = 0; k < NUM_COEFFS; k++) {
+        m[k] = _mm256_set1_ps(c[k]);
+    }
+    for (uint32_t n = 0; n < BLOCK_SIZE; n += 8) {
+        __m256 x = _mm256_load_ps(&block.rygb[0][n]);
+        __m256 y = _mm256_load_ps(&block.rygb[1][n]);
+        __m256 z = _mm256_load_ps(&block.rygb[2][n]);
+        __m256 w = _mm256_load_ps(&block.rygb[3][n]);
+        for (uint32_t i = 0; i < 3; i++) {
+            __m256 r = _mm256_mul_ps(m[i], x);
+            r = _mm256_fmadd_ps(m[3 + i], y, r);
+            r = _mm256_fmadd_ps(m[6 + i], z, r);
+            r = _mm256_fmadd_ps(m[9 + i], w, r);
+            _mm256_store_ps(&block.out[i][n], r);
+        }
+    }
+}
+
+TARGET_AVX2 void halfToFloatF16C(const uint16_t* src, float* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+    }
+    halfToFloatScalar(src + i, dst + i, n - i);
+}
+
+TARGET_AVX2 void floatToHalfF16C(const float* src, uint16_t* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+    }
+    floatToHalfScalar(src + i, dst + i, n - i);
+}
+
+#endif // RYGB_TRANSFORM_AVX2
+
+/* ---------- NEON ---------- */
+#if defined(RYGB_TRANSFORM_NEON)
+
+void transformNEON(const Coeffs& c, Block& block)
+{
+    float32x4_t m[NUM_COEFFS];
+    for (uint32_t k = 0; k < NUM_COEFFS; k++) {
+        m[k] = vdupq_n_f32(c[k]);
+    }
+    for (uint32_t n = 0; n < BLOCK_SIZE; n += 4) {
+        float32x4_t x = vld1q_f32(&block.rygb[0][n]);
+        float32x4_t y = vld1q_f32(&block.rygb[1][n]);
+        float32x4_t z = vld1q_f32(&block.rygb[2][n]);
+        float32x4_t w = vld1q_f32(&block.rygb[3][n]);
+        for (uint32_t i = 0; i < 3; i++) {
+            float32x4_t r = vmulq_f32(m[i], x);
+            r = vfmaq_f32(r, m[3 + i], y); // fused r + m * y
+            r = vfmaq_f32(r, m[6 + i], z);
+            r = vfmaq_f32(r, m[9 + i], w);
+            vst1q_f32(&block.out[i][n], r);
+        }
+    }
+}
+
+void deinterleave4NEON(const float* src, Block& block, uint32_t n)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4x4_t pixels = vld4q_f32(src + i * 4);
+        for (uint32_t c = 0; c < 4; c++) {
+            vst1q_f32(&block.rygb[c][i], pixels.val[c]);
+        }
+    }
+    for (; i < n; i++) {
+        for (uint32_t c = 0; c < 4; c++) {
+            block.rygb[c][i] = src[i * 4 + c];
+        }
+    }
+}
+
+void interleaveNEON(const Block& block, float* dst, uint32_t numChannels, uint32_t n)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        if (numChannels == 4) {
+            float32x4x4_t pixels;
+            for (uint32_t c = 0; c < 4; c++) {
+                pixels.val[c] = vld1q_f32(&block.out[c][i]);
+            }
+            vst4q_f32(dst + i * 4, pixels);
+        } else {
+            float32x4x3_t pixels;
+            for (uint32_t c = 0; c < 3; c++) {
+                pixels.val[c] = vld1q_f32(&block.out[c][i]);
+            }
+            vst3q_f32(dst + i * 3, pixels);
+        }
+    }
+    for (; i < n; i++) {
+        for (uint32_t c = 0; c < numChannels; c++) {
+            dst[i * numChannels + c] = block.out[c][i];
+        }
+    }
+}
+
+void halfToFloatNEON(const uint16_t* src, float* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+    }
+    halfToFloatScalar(src + i, dst + i, n - i);
+}
+
+void floatToHalfNEON(const float* src, uint16_t* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+    }
+    floatToHalfScalar(src + i, dst + i, n - i);
+}
+
+#endif // RYGB_TRANSFORM_NEON
+
+#if defined(RYGB_TRANSFORM_AVX2)
+bool isAVX2Supported()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")
+           && __builtin_cpu_supports("f16c");
+#else
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool fma = info[2] & (1 << 12);
+    bool osxsave = info[2] & (1 << 27);
+    bool avx = info[2] & (1 << 28);
+    bool f16c = info[2] & (1 << 29);
+    // the OS must also save the YMM registers across context switches
+    if (!fma || !osxsave || !avx || !f16c || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#endif
+}
+#endif // RYGB_TRANSFORM_AVX2
+
+Kernels selectKernels()
+{
+#if defined(RYGB_TRANSFORM_AVX2)
+    if (isAVX2Supported()) {
+        return Kernels{
+            "AVX2", transformAVX2, deinterleave4SSE, interleaveSSE, halfToFloatF16C, floatToHalfF16C
+        };
+    }
+#endif
+#if defined(RYGB_TRANSFORM_X86)
+    return Kernels{
+        "SSE", transformSSE, deinterleave4SSE, interleaveSSE, halfToFloatScalar, floatToHalfScalar
+    };
+#elif defined(RYGB_TRANSFORM_NEON)
+    return Kernels{
+        "NEON", transformNEON, deinterleave4NEON, interleaveNEON, halfToFloatNEON, floatToHalfNEON
+    };
+#else
+    return Kernels{
+        "Scalar",
+        transformScalar,
+        deinterleave4Scalar,
+        interleaveScalar,
+        halfToFloatScalar,
+        floatToHalfScalar
+    };
+#endif
+}
+
+const Kernels& getKernels()
+{
+    static const Kernels kernels = selectKernels();
+    return kernels;
+}
+
+size_t getScalarSize(const ImageBuffer& buffer)
+{
+    return buffer.scalarType == ScalarType::kFloat32 ? sizeof(float) : sizeof(uint16_t);
+}
+
+// first pixel of `row` in `channel`'s plane, or in the image if interleaved
+uint8_t* getRow(
+    const ImageBuffer& buffer,
+    uint32_t width,
+    uint32_t height,
+    uint32_t row,
+    uint32_t channel
+)
+{
+    uint8_t* data = reinterpret_cast<uint8_t*>(buffer.data);
+    size_t scalarSize = getScalarSize(buffer);
+    if (buffer.layout == Layout::kInterleaved) {
+        size_t rowStride
+            = buffer.rowStride != 0 ? buffer.rowStride : width * buffer.numChannels * scalarSize;
+        return data + row * rowStride;
+    }
+    size_t rowStride = buffer.rowStride != 0 ? buffer.rowStride : width * scalarSize;
+    size_t planeStride = buffer.planeStride != 0 ? buffer.planeStride : rowStride * height;
+    return data + channel * planeStride + row * rowStride;
+}
+
+void loadBlock(
+    const Kernels& kernels,
+    const ImageBuffer& src,
+    uint32_t width,
+    uint32_t height,
+    uint32_t row,
+    uint32_t x,
+    uint32_t n,
+    Block& block
+)
+{
+    bool isHalf = src.scalarType == ScalarType::kFloat16;
+    size_t scalarSize = getScalarSize(src);
+    if (src.layout == Layout::kPlanar) {
+        for (uint32_t c = 0; c < 4; c++) {
+            const uint8_t* pSrc = getRow(src, width, height, row, c) + x * scalarSize;
+            if (isHalf) {
+                kernels.halfToFloat(
+                    reinterpret_cast<const uint16_t*>(pSrc), block.rygb[c].data(), n
+                );
+            } else {
+                memcpy(block.rygb[c].data(), pSrc, n * sizeof(float));
+            }
+        }
+        return;
+    }
+    const uint8_t* pSrc = getRow(src, width, height, row, 0) + x * 4 * scalarSize;
+    if (isHalf) {
+        kernels.halfToFloat(
+            reinterpret_cast<const uint16_t*>(pSrc), block.interleaved.data(), n * 4
+        );
+        kernels.deinterleave4(block.interleaved.data(), block, n);
+    } else {
+        kernels.deinterleave4(reinterpret_cast<const float*>(pSrc), block, n);
+    }
+}
+
+void storeBlock(
+    const Kernels& kernels,
+    const ImageBuffer& dst,
+    uint32_t width,
+    uint32_t height,
+    uint32_t row,
+    uint32_t x,
+    uint32_t n,
+    Block& block
+)
+{
+    bool isHalf = dst.scalarType == ScalarType::kFloat16;
+    size_t scalarSize = getScalarSize(dst);
+    if (dst.layout == Layout::kPlanar) {
+        for (uint32_t c = 0; c < dst.numChannels; c++) {
+            uint8_t* pDst = getRow(dst, width, height, row, c) + x * scalarSize;
+            if (isHalf) {
+                kernels.floatToHalf(block.out[c].data(), reinterpret_cast<uint16_t*>(pDst), n);
+            } else {
+                memcpy(pDst, block.out[c].data(), n * sizeof(float));
+            }
+        }
+        return;
+    }
+    uint8_t* pDst = getRow(dst, width, height, row, 0) + x * dst.numChannels * scalarSize;
+    if (isHalf) {
+        kernels.interleave(block, block.interleaved.data(), dst.numChannels, n);
+        kernels.floatToHalf(
+            block.interleaved.data(), reinterpret_cast<uint16_t*>(pDst), n * dst.numChannels
+        );
+    } else {
+        kernels.interleave(block, reinterpret_cast<float*>(pDst), dst.numChannels, n);
+    }
+}
+
+Coeffs toCoeffs(const glm::mat4x3& m)
+{
+    Coeffs coeffs;
+    for (uint32_t c = 0; c < 4; c++) {
+        for (uint32_t i = 0; i < 3; i++) {
+            coeffs[c * 3 + i] = m[c][i];
+        }
+    }
+    return coeffs;
+}
+
+} // namespace
+
+void ConvertRows(
+    const ImageBuffer& rygb,
+    const std::array<const ImageBuffer*, ColorSpace::ColorSpaceSize>& outputs,
+    uint32_t width,
+    uint32_t height,
+    uint32_t rowBegin,
+    uint32_t rowEnd,
+    const std::array<glm::mat4x3, ColorSpace::ColorSpaceSize>& transforms
+)
+{
+    ASSERT(rygb.numChannels == 4);
+    ASSERT(rowEnd <= height);
+    std::array<Coeffs, ColorSpace::ColorSpaceSize> coeffs;
+    for (int colorSpace = 0; colorSpace < ColorSpace::ColorSpaceSize; colorSpace++) {
+        const ImageBuffer* output = outputs[colorSpace];
+        ASSERT(!output || output->numChannels == 3 || output->numChannels == 4);
+        coeffs[colorSpace] = toCoeffs(transforms[colorSpace]);
+    }
+
+    const Kernels& kernels = getKernels();
+    Block block{};
+    block.out[3].fill(1.f);
+
+    for (uint32_t row = rowBegin; row < rowEnd; row++) {
+        for (uint32_t x = 0; x < width; x += BLOCK_SIZE) {
+            uint32_t n = std::min(BLOCK_SIZE, width - x);
+            loadBlock(kernels, rygb, width, height, row, x, n, block);
+            // both outputs share the loaded block
+            for (int colorSpace = 0; colorSpace < ColorSpace::ColorSpaceSize; colorSpace++) {
+                const ImageBuffer* output = outputs[colorSpace];
+                if (!output) {
+                    continue;
+                }
+                kernels.transform(coeffs[colorSpace], block);
+                storeBlock(kernels, *output, width, height, row, x, n, block);
+            }
+        }
+    }
+}
+
+void Convert(
+    const ImageBuffer& rygb,
+    const std::array<const ImageBuffer*, ColorSpace::ColorSpaceSize>& outputs,
+    uint32_t width,
+    uint32_t height,
+    uint32_t numThreads,
+    const std::array<glm::mat4x3, ColorSpace::ColorSpaceSize>& transforms
+)
+{
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numThreads = std::max(1u, std::min(numThreads, height));
+    uint32_t rowsPerThread = (height + numThreads - 1) / numThreads;
+
+    // the calling thread takes the first chunk of rows
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for (uint32_t i = 1; i < numThreads; i++) {
+        uint32_t rowBegin = std::min(height, i * rowsPerThread);
+        uint32_t rowEnd = std::min(height, rowBegin + rowsPerThread);
+        threads.emplace_back([&, rowBegin, rowEnd]() {
+            ConvertRows(rygb, outputs, width, height, rowBegin, rowEnd, transforms);
+        });
+    }
+    ConvertRows(rygb, outputs, width, height, 0, std::min(height, rowsPerThread), transforms);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+const char* GetKernelName() { return getKernels().name; }
+
+float HalfToFloat(uint16_t half)
+{
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) { // inf / nan
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent != 0) { // normal
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) { // zero
+        bits = sign;
+    } else { // subnormal, normalize it
+        exponent = 127 - 15 + 1;
+        while ((mantissa & 0x400) == 0) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t absBits = bits & 0x7fffffff;
+
+    if (absBits >= 0x7f800000) { // inf / nan, nan stays quiet
+        bool isNan = absBits != 0x7f800000;
+        return sign | 0x7c00 | (isNan ? 0x200 | ((absBits >> 13) & 0x3ff) : 0);
+    }
+    if (absBits >= 0x477ff000) { // rounds past 65504
+        return sign | 0x7c00;
+    }
+
+    uint32_t exponent = absBits >> 23;
+    if (exponent < 113) { // below the smallest normal half 2^-14, round to a subnormal
+        if (exponent < 102) { // below half of the smallest subnormal 2^-24
+            return sign;
+        }
+        uint32_t mantissa = (absBits & 0x7fffff) | 0x800000;
+        uint32_t shift = 126 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1))) {
+            half++; // may carry into the smallest normal, which is still correct
+        }
+        return sign | half;
+    }
+
+    uint32_t half = ((exponent - 127 + 15) << 10) | ((absBits >> 13) & 0x3ff);
+    uint32_t remainder = absBits & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+        half++; // may carry into the exponent, which is still correct
+    }
+    return sign | half;
+}
+
+} // namespace RYGBTransform
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "structs/ColorSpace.h"
+
+// CPU implementation of the RYGB -> RGB/OCV transform, for batch conversion of RYGB images.
+//
+// Each output channel is evaluated as the fused multiply-add chain
+// `fma(m[3][i], w, fma(m[2][i], z, fma(m[1][i], y, m[0][i] * x)))`, which is what GPU compilers
+// emit for the `mat4x3 * vec4` in the painter's shaders; the CPU results are therefore
+// bit-comparable with the GPU ones on drivers that contract the product, and within an ulp
+// elsewhere.
+//
+// Kernels are picked at runtime: AVX2+FMA (with F16C for halves) and SSE on x86-64, NEON on
+// aarch64, and a scalar fallback that computes the exact same chain with `std::fma`. SSE has no
+// FMA and rounds every product, its results are only within a few ulps of the others'.
+namespace RYGBTransform
+{
+// transformation matrices from RYGB to RGB and OCV color spaces, indexed by `ColorSpace`
+inline const std::array<glm::mat4x3, ColorSpace::ColorSpaceSize> TRANSFORMS_FROM_RYGB
+    = {// RYGB -> RGB
+       glm::mat4x3{
+           {0.00227389, 0.02027033, 0.84088907},
+           {0.09871685, 0.82513837, 0.08254044},
+           {-0.0825074, 0.09203826, -0.01052114},
+           {0.98151666, -0.02124976, -0.0095099}},
+       // RYGB -> OCV
+       glm::mat4x3{
+           {-0.03549117, 0., 0.},
+           {-0.30406722, 0., 0.},
+           {0.95542715, 0., 0.},
+           {0.06836908, 0., 0.}}};
+
+enum class ScalarType
+{
+    kFloat32,
+    kFloat16 // IEEE 754 binary16
+};
+
+enum class Layout
+{
+    kInterleaved, // channels of a pixel are adjacent, e.g. RYGBRYGB...
+    kPlanar       // each channel is a separate plane, e.g. RR...YY...GG...BB...
+};
+
+// Non-owning view of a `width` x `height` image, dimensions are given to the conversion call.
+struct ImageBuffer
+{
+    void* data = nullptr;
+    uint32_t numChannels = 4; // 4 for RYGB inputs; 3 or 4 for outputs, whose alpha is written as 1
+    ScalarType scalarType = ScalarType::kFloat32;
+    Layout layout = Layout::kInterleaved;
+    size_t rowStride = 0;   // bytes between rows (of a plane if planar), 0 for tightly packed
+    size_t planeStride = 0; // bytes between planes if planar, 0 for tightly packed
+};
+
+// Convert rows [rowBegin, rowEnd) of `rygb` into the non-null `outputs`, indexed by `ColorSpace`.
+void ConvertRows(
+    const ImageBuffer& rygb,
+    const std::array<const ImageBuffer*, ColorSpace::ColorSpaceSize>& outputs,
+    uint32_t width,
+    uint32_t height,
+    uint32_t rowBegin,
+    uint32_t rowEnd,
+    const std::array<glm::mat4x3, ColorSpace::ColorSpaceSize>& transforms = TRANSFORMS_FROM_RYGB
+);
+
+// Convert the whole image, splitting rows across `numThreads` threads including the calling
+// one; 0 uses all hardware threads.
+void Convert(
+    const ImageBuffer& rygb,
+    const std::array<const ImageBuffer*, ColorSpace::ColorSpaceSize>& outputs,
+    uint32_t width,
+    uint32_t height,
+    uint32_t numThreads = 0,
+    const std::array<glm::mat4x3, ColorSpace::ColorSpaceSize>& transforms = TRANSFORMS_FROM_RYGB
+);
+
+// name of the kernels picked for this CPU, e.g. "AVX2"
+const char* GetKernelName();
+
+// scalar IEEE 754 binary16 conversions, rounding to nearest even
+float HalfToFloat(uint16_t half);
+uint16_t FloatToHalf(float value);
+
+} // namespace RYGBTransform
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "SrgbDownsample.h"
+
+namespace SrgbDownsample
+{
+namespace
+{
+const std::array<float, 256>& srgbToLinearTable()
+{
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> table;
+        for (uint32_t i = 0; i < table.size(); i++) {
+            float s = i / 255.f;
+            table[i] = s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+        }
+        return table;
+    }();
+    return table;
+}
+
+// indexed by linear intensity in 16-bit fixed point
+const std::vector<uint8_t>& linearToSrgbTable()
+{
+    static const std::vector<uint8_t> table = [] {
+        std::vector<uint8_t> table(UINT16_MAX + 1);
+        for (uint32_t i = 0; i < table.size(); i++) {
+            float l = static_cast<float>(i) / UINT16_MAX;
+            float s = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1 / 2.4f) - 0.055f;
+            table[i] = static_cast<uint8_t>(std::lround(std::clamp(s, 0.f, 1.f) * 255));
+        }
+        return table;
+    }();
+    return table;
+}
+} // namespace
+
+void Downsample(
+    const uint8_t* src,
+    uint32_t srcWidth,
+    uint32_t srcHeight,
+    uint8_t* dst,
+    uint32_t dstWidth,
+    uint32_t dstHeight
+)
+{
+    const std::array<float, 256>& toLinear = srgbToLinearTable();
+    const std::vector<uint8_t>& toSrgb = linearToSrgbTable();
+    for (uint32_t y = 0; y < dstHeight; y++) {
+        const uint8_t* row0
+            = src + static_cast<size_t>(std::min(2 * y, srcHeight - 1)) * srcWidth * 4;
+        const uint8_t* row1
+            = src + static_cast<size_t>(std::min(2 * y + 1, srcHeight - 1)) * srcWidth * 4;
+        for (uint32_t x = 0; x < dstWidth; x++) {
+            uint32_t x0 = std::min(2 * x, srcWidth - 1) * 4;
+            uint32_t x1 = std::min(2 * x + 1, srcWidth - 1) * 4;
+            uint8_t* out = dst + (static_cast<size_t>(y) * dstWidth + x) * 4;
+            for (uint32_t c = 0; c < 3; c++) {
+                float sum = toLinear[row0[x0 + c]] + toLinear[row0[x1 + c]]
+                            + toLinear[row1[x0 + c]] + toLinear[row1[x1 + c]];
+                out[c] = toSrgb[std::lround(std::min(sum * 0.25f, 1.f) * UINT16_MAX)];
+            }
+            out[3] = (row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3] + 2) / 4;
+        }
+    }
+}
+} // namespace SrgbDownsample
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+// Halving of RGBA8 sRGB images, shared by mip chains, thumbnails and tiled pyramids so that
+// every reduced image is filtered alike.
+namespace SrgbDownsample
+{
+// 2x2 box filter of `src` into `dst`, averaging color in linear space and alpha as is. Each
+// `dst` texel covers texels [2x, 2x + 1] of `src`, clamped to its last row and column, so `dst`
+// may be either the floor or the ceiling of half the size.
+void Downsample(
+    const uint8_t* src,
+    uint32_t srcWidth,
+    uint32_t srcHeight,
+    uint8_t* dst,
+    uint32_t dstWidth,
+    uint32_t dstHeight
+);
+} // namespace SrgbDownsample
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// Quantizes linear values into 8-bit sRGB, the encoding `VK_FORMAT_R8G8B8A8_SRGB` applies to
+// the painter's output, and that the image viewer's textures decode.
+class SrgbQuantizer
+{
+  public:
+    SrgbQuantizer()
+    {
+        // value `i + 1` is the first code whose linear value is above `_thresholds[i]`
+        for (uint32_t i = 0; i < _thresholds.size(); i++) {
+            double srgb = (i + 0.5) / 255.0;
+            double linear = srgb <= 0.04045 ? srgb / 12.92 : std::pow((srgb + 0.055) / 1.055, 2.4);
+            _thresholds[i] = static_cast<float>(linear);
+        }
+    }
+
+    uint8_t operator()(float linear) const
+    {
+        if (!(linear > 0.f)) { // also catches nan
+            return 0;
+        }
+        return std::upper_bound(_thresholds.begin(), _thresholds.end(), linear)
+               - _thresholds.begin();
+    }
+
+  private:
+    std::array<float, 255> _thresholds;
+};
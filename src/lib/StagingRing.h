@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <optional>
+
+#include "VQBuffer.h"
+#include "VQDevice.h"
+
+/**
+ * @brief Persistently mapped host-visible buffer that staging data is sub-allocated from,
+ * front to back, wrapping around at the end.
+ *
+ * Positions grow monotonically; a submission records `GetHead()` once its data is written, and
+ * hands it back to `Release()` once its fence has signaled. Submissions must complete in the
+ * order they were made, i.e. go to a single queue.
+ */
+struct StagingRing
+{
+    struct Allocation
+    {
+        VkDeviceSize offset; // into `GetBuffer()`
+        void* data;
+    };
+
+    void Init(VQDevice* device, VkDeviceSize capacity)
+    {
+        _capacity = capacity;
+        device->CreateBufferInPlace(
+            capacity,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            _buffer
+        );
+    }
+
+    void Cleanup() { _buffer.Cleanup(); }
+
+    /**
+     * @brief Sub-allocate `size` bytes aligned to `alignment`; `std::nullopt` if the space is
+     * still in use by submissions that haven't been released.
+     */
+    std::optional<Allocation> Allocate(VkDeviceSize size, VkDeviceSize alignment)
+    {
+        if (size > _capacity) {
+            return std::nullopt;
+        }
+        VkDeviceSize begin = (_head + alignment - 1) / alignment * alignment;
+        // allocations are contiguous, skip the tail end of the buffer if it's too short
+        if (begin % _capacity + size > _capacity) {
+            begin = (begin / _capacity + 1) * _capacity;
+        }
+        if (begin + size - _tail > _capacity) {
+            return std::nullopt;
+        }
+        _head = begin + size;
+        VkDeviceSize offset = begin % _capacity;
+        return Allocation{offset, static_cast<char*>(_buffer.bufferAddress) + offset};
+    }
+
+    // position up to which the ring has been allocated
+    VkDeviceSize GetHead() const { return _head; }
+
+    // free everything allocated before `head`, as returned by `GetHead()`
+    void Release(VkDeviceSize head) { _tail = std::max(_tail, head); }
+
+    VkBuffer GetBuffer() const { return _buffer.buffer; }
+    VkDeviceSize GetCapacity() const { return _capacity; }
+
+  private:
+    VQBuffer _buffer;
+    VkDeviceSize _capacity = 0;
+    VkDeviceSize _head = 0; // next free position
+    VkDeviceSize _tail = 0; // oldest position still in use
+};
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+
+#include "RYGBTransform.h"
+#include "SrgbDownsample.h"
+#include "SrgbQuantizer.h"
+#include "TetraImage.h"
+
+namespace TetraImage
+{
+namespace
+{
+// bump whenever the layout of the file changes
+const uint32_t FILE_VERSION = 1;
+const std::array<char, 4> FILE_MAGIC = {'T', 'T', 'R', 'A'};
+const uint64_t PAGE_SIZE = 4096;
+const uint64_t HEADER_SIZE = PAGE_SIZE;
+
+struct __FileHeader
+{
+    std::array<char, 4> magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t numPlanes;
+    std::array<glm::mat4x3, ColorSpace::ColorSpaceSize> transformsFromRygb;
+};
+static_assert(sizeof(__FileHeader) <= HEADER_SIZE);
+
+uint64_t alignToPage(uint64_t offset) { return (offset + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE; }
+} // namespace
+
+Layout Layout::Create(uint32_t width, uint32_t height)
+{
+    Layout layout{.width = width, .height = height};
+    layout.rygbOffset = HEADER_SIZE;
+    layout.rygbSize = static_cast<uint64_t>(width) * height * 4 * sizeof(uint16_t);
+    uint64_t offset = layout.rygbOffset + layout.rygbSize;
+
+    uint32_t numLevels = std::bit_width(std::max(width, height));
+    for (std::vector<Level>& levels : layout.planes) {
+        offset = alignToPage(offset);
+        for (uint32_t i = 0; i < numLevels; i++) {
+            uint32_t levelWidth = std::max(1u, width >> i);
+            uint32_t levelHeight = std::max(1u, height >> i);
+            uint64_t size = static_cast<uint64_t>(levelWidth) * levelHeight * 4;
+            levels.push_back({offset, size, levelWidth, levelHeight});
+            offset += size;
+        }
+    }
+    layout.fileSize = offset;
+    return layout;
+}
+
+/* ---------- Reader ---------- */
+
+bool Reader::Open(const std::string& path)
+{
+    Close();
+    std::shared_ptr<const MappedFile> file = MappedFile::Open(path);
+    if (!file) {
+        ERROR("Failed to map tetra image {}", path);
+        return false;
+    }
+    __FileHeader header{};
+    if (file->GetSize() < HEADER_SIZE) {
+        ERROR("Tetra image {} is truncated", path);
+        return false;
+    }
+    memcpy(&header, file->GetData(), sizeof(header));
+    if (header.magic != FILE_MAGIC || header.version != FILE_VERSION
+        || header.numPlanes != ColorSpace::ColorSpaceSize || header.width == 0
+        || header.height == 0) {
+        ERROR("{} is not a tetra image this version can read", path);
+        return false;
+    }
+    Layout layout = Layout::Create(header.width, header.height);
+    if (file->GetSize() < layout.fileSize) {
+        ERROR("Tetra image {} is truncated", path);
+        return false;
+    }
+    _file = std::move(file);
+    _layout = std::move(layout);
+    _metadata.transformsFromRygb = header.transformsFromRygb;
+    return true;
+}
+
+void Reader::Close()
+{
+    _file.reset();
+    _layout = Layout{};
+}
+
+const uint16_t* Reader::GetRYGB() const
+{
+    ASSERT(IsOpen());
+    return reinterpret_cast<const uint16_t*>(_file->GetData() + _layout.rygbOffset);
+}
+
+const uint8_t* Reader::GetTexels(ColorSpace plane, uint32_t level) const
+{
+    ASSERT(IsOpen() && level < _layout.planes[plane].size());
+    return _file->GetData() + _layout.planes[plane][level].offset;
+}
+
+/* ---------- Writer ---------- */
+
+bool Writer::Create(
+    const std::string& path,
+    uint32_t width,
+    uint32_t height,
+    const Metadata& metadata
+)
+{
+    Close();
+    _file.open(path, std::ios::binary | std::ios::trunc);
+    _layout = Layout::Create(width, height);
+    for (int plane = 0; plane < ColorSpace::ColorSpaceSize; plane++) {
+        const std::vector<Level>& levels = _layout.planes[plane];
+        _levels[plane].clear();
+        _levels[plane].resize(levels.size());
+        for (size_t i = 0; i + 1 < levels.size(); i++) {
+            _levels[plane][i].pairRows.resize(2 * static_cast<size_t>(levels[i].width) * 4);
+            _levels[plane][i].halfRow.resize(static_cast<size_t>(levels[i + 1].width) * 4);
+        }
+    }
+    __FileHeader header{
+        .magic = FILE_MAGIC,
+        .version = FILE_VERSION,
+        .width = width,
+        .height = height,
+        .numPlanes = ColorSpace::ColorSpaceSize,
+        .transformsFromRygb = metadata.transformsFromRygb};
+    std::array<char, HEADER_SIZE> block{};
+    memcpy(block.data(), &header, sizeof(header));
+    return _file.is_open() && _file.write(block.data(), block.size());
+}
+
+bool Writer::Close()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_file.is_open()) {
+        return true;
+    }
+    _file.close();
+    bool success = !_file.fail();
+    _file.clear();
+    return success;
+}
+
+bool Writer::write(uint64_t offset, const void* data, size_t size)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _file.seekp(offset);
+    return static_cast<bool>(_file.write(static_cast<const char*>(data), size));
+}
+
+bool Writer::WriteRYGBRows(uint32_t rowBegin, uint32_t numRows, const uint16_t* rygb)
+{
+    uint64_t rowSize = static_cast<uint64_t>(_layout.width) * 4 * sizeof(uint16_t);
+    return write(_layout.rygbOffset + rowBegin * rowSize, rygb, numRows * rowSize);
+}
+
+bool Writer::AddPlaneRow(ColorSpace plane, const uint8_t* rgba) { return addRow(plane, 0, rgba); }
+
+bool Writer::addRow(ColorSpace plane, uint32_t level, const uint8_t* rgba)
+{
+    const std::vector<Level>& levels = _layout.planes[plane];
+    const Level& l = levels[level];
+    __LevelState& state = _levels[plane][level];
+    size_t rowSize = static_cast<size_t>(l.width) * 4;
+    uint32_t y = state.numRows++;
+    if (!write(l.offset + y * rowSize, rgba, rowSize)) {
+        return false;
+    }
+
+    if (level + 1 == levels.size()) {
+        return true;
+    }
+    // halving rounds down, an odd last row is left out of the next level like a mip's
+    const Level& next = levels[level + 1];
+    memcpy(state.pairRows.data() + (y % 2) * rowSize, rgba, rowSize);
+    if ((y % 2 == 1 && y / 2 < next.height) || l.height == 1) {
+        SrgbDownsample::Downsample(
+            state.pairRows.data(), l.width, y % 2 + 1, state.halfRow.data(), next.width, 1
+        );
+        return addRow(plane, level + 1, state.halfRow.data());
+    }
+    return true;
+}
+
+/* ---------- Write ---------- */
+
+bool Write(
+    const std::string& path,
+    const float* rygb,
+    uint32_t width,
+    uint32_t height,
+    const Metadata& metadata
+)
+{
+    size_t rowSize = static_cast<size_t>(width) * 4;
+    return Write(path, width, height, metadata, [rygb, rowSize](uint32_t y, float* row) {
+        memcpy(row, rygb + y * rowSize, rowSize * sizeof(float));
+    });
+}
+
+bool Write(
+    const std::string& path,
+    uint32_t width,
+    uint32_t height,
+    const Metadata& metadata,
+    const std::function<void(uint32_t, float*)>& getRow
+)
+{
+    Writer writer;
+    if (!writer.Create(path, width, height, metadata)) {
+        ERROR("Failed to open {} for writing", path);
+        return false;
+    }
+
+    const SrgbQuantizer quantizer;
+    std::vector<uint16_t> halfRow(static_cast<size_t>(width) * 4);
+    std::array<std::vector<float>, ColorSpace::ColorSpaceSize> rowBuffers;
+    std::array<RYGBTransform::ImageBuffer, ColorSpace::ColorSpaceSize> rowOutputs;
+    std::array<const RYGBTransform::ImageBuffer*, ColorSpace::ColorSpaceSize> outputs;
+    for (int plane = 0; plane < ColorSpace::ColorSpaceSize; plane++) {
+        rowBuffers[plane].resize(static_cast<size_t>(width) * 4);
+        rowOutputs[plane].data = rowBuffers[plane].data();
+        outputs[plane] = &rowOutputs[plane];
+    }
+    std::vector<uint8_t> quantizedRow(static_cast<size_t>(width) * 4);
+    std::vector<float> row(static_cast<size_t>(width) * 4);
+
+    bool success = true;
+    for (uint32_t y = 0; y < height && success; y++) {
+        getRow(y, row.data());
+        for (size_t i = 0; i < halfRow.size(); i++) {
+            halfRow[i] = RYGBTransform::FloatToHalf(row[i]);
+        }
+        success &= writer.WriteRYGBRows(y, 1, halfRow.data());
+
+        RYGBTransform::ImageBuffer rygbRow{.data = row.data()};
+        RYGBTransform::ConvertRows(
+            rygbRow, outputs, width, 1, 0, 1, metadata.transformsFromRygb
+        );
+        for (int plane = 0; plane < ColorSpace::ColorSpaceSize && success; plane++) {
+            std::transform(
+                rowBuffers[plane].begin(),
+                rowBuffers[plane].end(),
+                quantizedRow.begin(),
+                quantizer
+            );
+            success &= writer.AddPlaneRow(static_cast<ColorSpace>(plane), quantizedRow.data());
+        }
+    }
+    success &= writer.Close();
+    if (!success) { // don't leave a truncated image behind
+        ERROR("Failed to write tetra image {}", path);
+        std::error_code error;
+        std::filesystem::remove(path, error);
+    }
+    return success;
+}
+} // namespace TetraImage
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "MappedFile.h"
+#include "structs/ColorSpace.h"
+
+// Single-file tetra image, the `.tetra` format, laid out to be memory-mapped and used in place.
+//
+// A file holds the RYGB source as interleaved float16, the RGB and OCV planes transformed from
+// it, and the transforms that made them. Each plane is an RGBA8 sRGB mip chain whose levels are
+// back to back, halving and rounding down like the texture manager's mips, so that any suffix
+// of a chain is one contiguous range ready to be copied into a staging buffer as is. Sections
+// start on page boundaries, and where they are follows from the image size alone.
+namespace TetraImage
+{
+inline const char* FILE_EXTENSION = ".tetra";
+
+struct Level
+{
+    uint64_t offset; // in the file
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct Layout
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint64_t rygbOffset = 0; // 4 halves per texel, rows top to bottom
+    uint64_t rygbSize = 0;
+    // indexed by `ColorSpace`, full resolution first, down to 1x1
+    std::array<std::vector<Level>, ColorSpace::ColorSpaceSize> planes;
+    uint64_t fileSize = 0;
+
+    static Layout Create(uint32_t width, uint32_t height);
+};
+
+struct Metadata
+{
+    // indexed by `ColorSpace`, the planes are these applied to the source
+    std::array<glm::mat4x3, ColorSpace::ColorSpaceSize> transformsFromRygb;
+};
+
+// Maps a `.tetra` file; its texels stay valid for as long as the mapping is alive.
+class Reader
+{
+  public:
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return _file != nullptr; }
+
+    const Layout& GetLayout() const { return _layout; }
+    const Metadata& GetMetadata() const { return _metadata; }
+
+    const uint16_t* GetRYGB() const;
+    const uint8_t* GetTexels(ColorSpace plane, uint32_t level) const;
+
+    // for users of the texels that outlive the reader
+    const std::shared_ptr<const MappedFile>& GetMapping() const { return _file; }
+
+  private:
+    std::shared_ptr<const MappedFile> _file;
+    Layout _layout;
+    Metadata _metadata;
+};
+
+// Writes a `.tetra` file from rows of the source and of both planes.
+class Writer
+{
+  public:
+    ~Writer() { Close(); }
+
+    bool Create(
+        const std::string& path,
+        uint32_t width,
+        uint32_t height,
+        const Metadata& metadata
+    );
+    // returns false if the file failed to flush
+    bool Close();
+
+    const Layout& GetLayout() const { return _layout; }
+
+    // writes `numRows` rows of the source from `rowBegin`, in any order; thread-safe
+    bool WriteRYGBRows(uint32_t rowBegin, uint32_t numRows, const uint16_t* rygb);
+
+    // `rgba` is the next row of `plane`'s full resolution level, RGBA8 sRGB; the smaller levels
+    // are halved from the rows as they come in. Rows of one plane must be added in order and
+    // from one thread at a time, the planes may be added concurrently.
+    bool AddPlaneRow(ColorSpace plane, const uint8_t* rgba);
+
+  private:
+    struct __LevelState
+    {
+        std::vector<uint8_t> pairRows; // rows waiting to be halved into the next level
+        std::vector<uint8_t> halfRow;
+        uint32_t numRows = 0; // rows added so far
+    };
+
+    bool addRow(ColorSpace plane, uint32_t level, const uint8_t* rgba);
+    bool write(uint64_t offset, const void* data, size_t size);
+
+    std::mutex _mutex; // guards the file position
+    std::ofstream _file;
+    Layout _layout;
+    std::array<std::vector<__LevelState>, ColorSpace::ColorSpaceSize> _levels;
+};
+
+// Writes an image that is all in memory: `rygb` is `width` x `height` interleaved float32 RYGB,
+// transformed with `metadata`'s transforms.
+bool Write(
+    const std::string& path,
+    const float* rygb,
+    uint32_t width,
+    uint32_t height,
+    const Metadata& metadata
+);
+
+// Writes an image a row at a time, for images that aren't all in memory: `getRow(y, row)` fills
+// `row` with row `y` of the source, `width` interleaved float32 RYGB.
+bool Write(
+    const std::string& path,
+    uint32_t width,
+    uint32_t height,
+    const Metadata& metadata,
+    const std::function<void(uint32_t, float*)>& getRow
+);
+} // namespace TetraImage
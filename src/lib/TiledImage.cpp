@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+
+#include "SrgbDownsample.h"
+#include "TiledImage.h"
+
+namespace TiledImage
+{
+namespace
+{
+// bump whenever the layout of the file changes
+const uint32_t FILE_VERSION = 1;
+const std::array<char, 4> FILE_MAGIC = {'T', 'T', 'I', 'L'};
+// tiles start on a page boundary
+const uint64_t HEADER_SIZE = 4096;
+
+struct __FileHeader
+{
+    std::array<char, 4> magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tileSize;
+    uint32_t tileBorder;
+    uint32_t numPlanes;
+};
+static_assert(sizeof(__FileHeader) <= HEADER_SIZE);
+} // namespace
+
+Layout Layout::Create(uint32_t width, uint32_t height)
+{
+    Layout layout{.width = width, .height = height};
+    uint32_t levelWidth = width;
+    uint32_t levelHeight = height;
+    while (true) {
+        Level level{
+            .width = levelWidth,
+            .height = levelHeight,
+            .tilesX = (levelWidth + TILE_SIZE - 1) / TILE_SIZE,
+            .tilesY = (levelHeight + TILE_SIZE - 1) / TILE_SIZE,
+            .firstTile = layout.numTilesPerPlane};
+        layout.levels.push_back(level);
+        layout.numTilesPerPlane += static_cast<uint64_t>(level.tilesX) * level.tilesY;
+        if (level.tilesX == 1 && level.tilesY == 1) {
+            break;
+        }
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+    }
+    return layout;
+}
+
+uint64_t Layout::GetTileOffset(ColorSpace plane, uint32_t level, uint32_t x, uint32_t y) const
+{
+    const Level& l = levels[level];
+    uint64_t index
+        = plane * numTilesPerPlane + l.firstTile + static_cast<uint64_t>(y) * l.tilesX + x;
+    return HEADER_SIZE + index * TILE_BYTES;
+}
+
+/* ---------- Reader ---------- */
+
+bool Reader::Open(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    closeFile();
+    _file.open(path, std::ios::binary);
+    __FileHeader header{};
+    if (!_file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        ERROR("Failed to read tiled image {}", path);
+        closeFile();
+        return false;
+    }
+    if (header.magic != FILE_MAGIC || header.version != FILE_VERSION
+        || header.tileSize != TILE_SIZE || header.tileBorder != TILE_BORDER
+        || header.numPlanes != ColorSpace::ColorSpaceSize || header.width == 0
+        || header.height == 0) {
+        ERROR("{} is not a tiled image this version can read", path);
+        closeFile();
+        return false;
+    }
+    _layout = Layout::Create(header.width, header.height);
+
+    // tiles are written in any order, an interrupted writer may leave the file short
+    std::error_code error;
+    uint64_t expectedSize = HEADER_SIZE
+                            + ColorSpace::ColorSpaceSize * _layout.numTilesPerPlane * TILE_BYTES;
+    if (std::filesystem::file_size(path, error) < expectedSize || error) {
+        ERROR("Tiled image {} is truncated", path);
+        closeFile();
+        return false;
+    }
+    return true;
+}
+
+void Reader::Close()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    closeFile();
+}
+
+void Reader::closeFile()
+{
+    if (_file.is_open()) {
+        _file.close();
+    }
+    _file.clear();
+    _layout = Layout{};
+}
+
+bool Reader::ReadTile(ColorSpace plane, uint32_t level, uint32_t x, uint32_t y, uint8_t* texels)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    // tiles may be asked for by readers of the image that was open before
+    if (!_file.is_open() || level >= _layout.levels.size() || x >= _layout.levels[level].tilesX
+        || y >= _layout.levels[level].tilesY) {
+        return false;
+    }
+    _file.seekg(_layout.GetTileOffset(plane, level, x, y));
+    if (!_file.read(reinterpret_cast<char*>(texels), TILE_BYTES)) {
+        _file.clear();
+        return false;
+    }
+    return true;
+}
+
+/* ---------- Writer ---------- */
+
+bool Writer::Create(const std::string& path, uint32_t width, uint32_t height)
+{
+    Close();
+    _file.open(path, std::ios::binary | std::ios::trunc);
+    _layout = Layout::Create(width, height);
+    __FileHeader header{
+        .magic = FILE_MAGIC,
+        .version = FILE_VERSION,
+        .width = width,
+        .height = height,
+        .tileSize = TILE_SIZE,
+        .tileBorder = TILE_BORDER,
+        .numPlanes = ColorSpace::ColorSpaceSize};
+    std::array<char, HEADER_SIZE> block{};
+    memcpy(block.data(), &header, sizeof(header));
+    return _file.is_open() && _file.write(block.data(), block.size());
+}
+
+bool Writer::Close()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_file.is_open()) {
+        return true;
+    }
+    _file.close();
+    bool success = !_file.fail();
+    _file.clear();
+    return success;
+}
+
+bool Writer::WriteTile(
+    ColorSpace plane,
+    uint32_t level,
+    uint32_t x,
+    uint32_t y,
+    const uint8_t* texels
+)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _file.seekp(_layout.GetTileOffset(plane, level, x, y));
+    return static_cast<bool>(_file.write(reinterpret_cast<const char*>(texels), TILE_BYTES));
+}
+
+/* ---------- PyramidBuilder ---------- */
+
+PyramidBuilder::PyramidBuilder(Writer& writer, ColorSpace plane)
+    : _writer(writer), _plane(plane), _tile(TILE_BYTES)
+{
+    const Layout& layout = writer.GetLayout();
+    _levels.resize(layout.levels.size());
+    for (size_t i = 0; i < _levels.size(); i++) {
+        size_t rowSize = static_cast<size_t>(layout.levels[i].width) * 4;
+        _levels[i].tileRows.resize(TILE_STRIDE * rowSize);
+        if (i + 1 < _levels.size()) {
+            _levels[i].pairRows.resize(2 * rowSize);
+            _levels[i].halfRow.resize(static_cast<size_t>(layout.levels[i + 1].width) * 4);
+        }
+    }
+}
+
+bool PyramidBuilder::AddRow(const uint8_t* rgba) { return addRow(0, rgba); }
+
+bool PyramidBuilder::addRow(uint32_t level, const uint8_t* rgba)
+{
+    const Level& l = _writer.GetLayout().levels[level];
+    __LevelState& state = _levels[level];
+    size_t rowSize = static_cast<size_t>(l.width) * 4;
+    uint32_t y = state.numRows++;
+
+    // buffer row `i` is image row `tileRow * TILE_SIZE - 1 + i`
+    uint32_t bufferRow = y + 1 - state.tileRow * TILE_SIZE;
+    memcpy(state.tileRows.data() + bufferRow * rowSize, rgba, rowSize);
+    if (y == 0) { // top border repeats the first row
+        memcpy(state.tileRows.data(), rgba, rowSize);
+    }
+    // the first row of the next tile row completes the bottom border of this one
+    if (y == (state.tileRow + 1) * TILE_SIZE) {
+        if (!writeTileRow(level, TILE_STRIDE)) {
+            return false;
+        }
+        // the last row of this tile row and the first of the next one carry over
+        memmove(state.tileRows.data(), state.tileRows.data() + TILE_SIZE * rowSize, 2 * rowSize);
+        state.tileRow++;
+    }
+    if (y == l.height - 1 && !writeTileRow(level, y + 2 - state.tileRow * TILE_SIZE)) {
+        return false;
+    }
+
+    if (level + 1 == _levels.size()) {
+        return true;
+    }
+    memcpy(state.pairRows.data() + (y % 2) * rowSize, rgba, rowSize);
+    if (y % 2 == 1 || y == l.height - 1) {
+        const Level& next = _writer.GetLayout().levels[level + 1];
+        SrgbDownsample::Downsample(
+            state.pairRows.data(), l.width, y % 2 + 1, state.halfRow.data(), next.width, 1
+        );
+        return addRow(level + 1, state.halfRow.data());
+    }
+    return true;
+}
+
+// Writes the tiles of the current tile row, whose first `numBufferedRows` rows are in;
+// the rows below, past the bottom of the image, repeat the last one.
+bool PyramidBuilder::writeTileRow(uint32_t level, uint32_t numBufferedRows)
+{
+    const Level& l = _writer.GetLayout().levels[level];
+    const __LevelState& state = _levels[level];
+    size_t rowSize = static_cast<size_t>(l.width) * 4;
+    for (uint32_t tileX = 0; tileX < l.tilesX; tileX++) {
+        for (uint32_t row = 0; row < TILE_STRIDE; row++) {
+            const uint8_t* src
+                = state.tileRows.data() + std::min(row, numBufferedRows - 1) * rowSize;
+            uint8_t* dst = _tile.data() + row * TILE_STRIDE * 4;
+            for (uint32_t column = 0; column < TILE_STRIDE; column++) {
+                int64_t x = static_cast<int64_t>(tileX) * TILE_SIZE + column - TILE_BORDER;
+                x = std::clamp<int64_t>(x, 0, l.width - 1);
+                memcpy(dst + column * 4, src + x * 4, 4);
+            }
+        }
+        if (!_writer.WriteTile(_plane, level, tileX, state.tileRow, _tile.data())) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace TiledImage
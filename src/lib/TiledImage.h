@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "structs/ColorSpace.h"
+
+// Tiled mip pyramid of a tetra image, the `.ttiles` format, for images too large to be shown as
+// one texture per color space.
+//
+// A file holds both color spaces' planes. Each plane is a pyramid of levels halving the one
+// above, rounding up, down to the first level that fits in a single tile. Levels are cut into
+// `TILE_SIZE`-texel square tiles, stored with a `TILE_BORDER` of the neighboring tiles' texels
+// (or repeated edge texels) around them so that tiles can be filtered on their own without
+// seams. Tiles are RGBA8 sRGB, uncompressed and all the same size, which keeps the position of
+// any tile a function of the image size alone and makes reading one a single aligned read.
+namespace TiledImage
+{
+const uint32_t TILE_SIZE = 254;   // image texels per tile side
+const uint32_t TILE_BORDER = 1;   // texels of the neighboring tiles around each side
+const uint32_t TILE_STRIDE = TILE_SIZE + 2 * TILE_BORDER; // stored texels per tile side
+const size_t TILE_BYTES = TILE_STRIDE * TILE_STRIDE * 4;
+inline const char* FILE_EXTENSION = ".ttiles";
+
+struct Level
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t tilesX;
+    uint32_t tilesY;
+    uint64_t firstTile; // index of its top left tile in a plane
+};
+
+// where the tiles of a pyramid are, which follows from the image size alone
+struct Layout
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<Level> levels; // full resolution first
+    uint64_t numTilesPerPlane = 0;
+
+    static Layout Create(uint32_t width, uint32_t height);
+
+    // offset of tile (`x`, `y`) of `level` in the file
+    uint64_t GetTileOffset(ColorSpace plane, uint32_t level, uint32_t x, uint32_t y) const;
+};
+
+// Reads tiles of a `.ttiles` file; `ReadTile()` may be called from any thread, concurrently
+// with `Open()` and `Close()`.
+class Reader
+{
+  public:
+    ~Reader() { Close(); }
+
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return _file.is_open(); }
+
+    const Layout& GetLayout() const { return _layout; }
+
+    // reads `TILE_BYTES` into `texels`; false if the tile isn't in the image
+    bool ReadTile(ColorSpace plane, uint32_t level, uint32_t x, uint32_t y, uint8_t* texels);
+
+  private:
+    void closeFile();
+
+    std::mutex _mutex; // guards the file position
+    std::ifstream _file;
+    Layout _layout;
+};
+
+// Writes tiles of a `.ttiles` file, in any order; thread-safe.
+class Writer
+{
+  public:
+    ~Writer() { Close(); }
+
+    bool Create(const std::string& path, uint32_t width, uint32_t height);
+    // returns false if the file failed to flush
+    bool Close();
+
+    const Layout& GetLayout() const { return _layout; }
+
+    // writes `TILE_BYTES` of `texels`
+    bool WriteTile(ColorSpace plane, uint32_t level, uint32_t x, uint32_t y, const uint8_t* texels);
+
+  private:
+    std::mutex _mutex; // guards the file position
+    std::ofstream _file;
+    Layout _layout;
+};
+
+// Cuts one plane of an image, streamed top to bottom one row at a time, into the tiles of every
+// level of its pyramid. Each level keeps a tile row and two rows to halve, so memory use
+// depends on the image width alone.
+class PyramidBuilder
+{
+  public:
+    PyramidBuilder(Writer& writer, ColorSpace plane);
+
+    // `rgba` is a row of `GetLayout().width` RGBA8 sRGB texels; false if writing tiles failed
+    bool AddRow(const uint8_t* rgba);
+
+  private:
+    struct __LevelState
+    {
+        // rows of the current tile row and its borders, the first is the row above it
+        std::vector<uint8_t> tileRows;
+        std::vector<uint8_t> pairRows; // rows waiting to be halved into the next level
+        std::vector<uint8_t> halfRow;
+        uint32_t tileRow = 0;
+        uint32_t numRows = 0; // rows added so far
+    };
+
+    bool addRow(uint32_t level, const uint8_t* rgba);
+    bool writeTileRow(uint32_t level, uint32_t numBufferedRows);
+
+    Writer& _writer;
+    const ColorSpace _plane;
+    std::vector<__LevelState> _levels;
+    std::vector<uint8_t> _tile; // scratch
+};
+} // namespace TiledImage
@@ -1,5 +1,6 @@
 #pragma once
 #include <structs/Vertex.h>
+#include "VQMemoryAllocator.h"
 #include <vulkan/vulkan.h>
 #include <vulkan/vulkan_core.h>
 
@@ -10,7 +11,8 @@ struct VQBuffer
 {
     VkDevice device = VK_NULL_HANDLE;
     VkBuffer buffer = VK_NULL_HANDLE;
-    VkDeviceMemory bufferMemory = VK_NULL_HANDLE;
+    VQMemoryAllocator* allocator = nullptr;
+    VQAllocation allocation;
     VkDeviceSize size = 0;
     void* bufferAddress = nullptr;
 
@@ -18,7 +20,7 @@ struct VQBuffer
      * @brief Clean up all the resources held by this buffer.
      */
     void Cleanup() {
-        if (buffer == VK_NULL_HANDLE && bufferMemory == VK_NULL_HANDLE) {
+        if (buffer == VK_NULL_HANDLE && allocation.memory == VK_NULL_HANDLE) {
             return;
         }
         if (device == VK_NULL_HANDLE) {
@@ -27,12 +29,13 @@ struct VQBuffer
         if (buffer) {
             vkDestroyBuffer(device, buffer, nullptr);
         }
-        if (bufferMemory) {
-            if (bufferAddress != nullptr) {
-                vkUnmapMemory(device, bufferMemory);
-            }
-            vkFreeMemory(device, bufferMemory, nullptr);
+        if (allocation.memory) {
+            allocator->Free(allocation);
         }
+        // sub-allocated memory must not be freed twice through copies of a cleaned up buffer
+        buffer = VK_NULL_HANDLE;
+        allocation = VQAllocation{};
+        bufferAddress = nullptr;
     }
 };
 
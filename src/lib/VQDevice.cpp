@@ -1,6 +1,7 @@
 #include "VQDevice.h"
 #include "VQBuffer.h"
 #include "VQUtils.h"
+#include <algorithm>
 #include <cstdint>
 #include <set>
 #include <vulkan/vulkan_core.h>
@@ -8,7 +9,10 @@
 
 #include "VulkanUtils.h"
 
-void VQDevice::CreateLogicalDeviceAndQueue(const std::vector<const char*>& extensions) {
+void VQDevice::CreateLogicalDeviceAndQueue(
+    const std::vector<const char*>& extensions,
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2
+) {
     if (!this->queueFamilyIndices.isComplete()) {
         FATAL("Queue family indices incomplete! Call InitQueueFamilyIndices().");
     }
@@ -23,15 +27,32 @@ void VQDevice::CreateLogicalDeviceAndQueue(const std::vector<const char*>& exten
         }
         PANIC("device does not support all required extensions!");
     }
+    std::vector<const char*> enabledExtensions = extensions;
+    // optional, lets `GetHeapBudgets()` report the driver's estimates
+    this->memoryBudgetEnabled
+        = getMemoryProperties2
+          && std::find(
+                 supportedExtensions.begin(),
+                 supportedExtensions.end(),
+                 VK_EXT_MEMORY_BUDGET_EXTENSION_NAME
+             ) != supportedExtensions.end();
+    if (this->memoryBudgetEnabled) {
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        this->_getMemoryProperties2 = getMemoryProperties2;
+    }
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilyIndices;
     uniqueQueueFamilyIndices.insert(this->queueFamilyIndices.graphicsFamily.value());
     uniqueQueueFamilyIndices.insert(this->queueFamilyIndices.presentationFamily.value());
+    uniqueQueueFamilyIndices.insert(this->queueFamilyIndices.transferFamily.value());
 
     DEBUG("Found {} unique queue families.", uniqueQueueFamilyIndices.size());
 
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.multiDrawIndirect = true; // we enable multi-draw on everything -- 99% of desktop GPUs supports it
+    // BC formats for textures opted into lossy compression, see `TextureManager::LoadOptions`
+    deviceFeatures.textureCompressionBC = this->features.textureCompressionBC;
+    this->enabledFeatures = deviceFeatures;
     
     vk::PhysicalDeviceVulkan12Features deviceFeaturesVk12;
     deviceFeaturesVk12.timelineSemaphore = true;
@@ -52,12 +73,15 @@ void VQDevice::CreateLogicalDeviceAndQueue(const std::vector<const char*>& exten
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.pEnabledFeatures = &deviceFeatures;
     createInfo.pNext = &deviceFeaturesVk12;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
-    createInfo.ppEnabledExtensionNames = extensions.data(); // enable swapchain extension
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data(); // enable swapchain extension
     VK_CHECK_RESULT(vkCreateDevice(this->physicalDevice, &createInfo, nullptr, &this->logicalDevice));
     vkGetDeviceQueue(this->logicalDevice, queueFamilyIndices.graphicsFamily.value(), 0, &this->graphicsQueue);
     vkGetDeviceQueue(this->logicalDevice, queueFamilyIndices.presentationFamily.value(), 0, &this->presentationQueue);
     vkGetDeviceQueue(this->logicalDevice, queueFamilyIndices.computeFamily.value(), 0, &this->computeQueue);
+    vkGetDeviceQueue(this->logicalDevice, queueFamilyIndices.transferFamily.value(), 0, &this->transferQueue);
+
+    this->memoryAllocator.Init(this->physicalDevice, this->logicalDevice);
 }
 
 void VQDevice::InitQueueFamilyIndices(VkSurfaceKHR surface) {
@@ -77,7 +101,11 @@ void VQDevice::InitQueueFamilyIndices(VkSurfaceKHR surface) {
             this->queueFamilyIndices.graphicsFamily = i;
             DEBUG("Graphics family found at {}", i);
         }
-        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentationSupport);
+        if (surface == VK_NULL_HANDLE) { // headless, the "presentation" queue is never presented on
+            presentationSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        } else {
+            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentationSupport);
+        }
         if (presentationSupport) {
             this->queueFamilyIndices.presentationFamily = i;
             DEBUG("Presentation family found at {}", i);
@@ -87,6 +115,18 @@ void VQDevice::InitQueueFamilyIndices(VkSurfaceKHR surface) {
         }
         i++;
     }
+    // a transfer-only family maps to the DMA engines, letting uploads run alongside rendering
+    for (uint32_t family = 0; family < queueFamilies.size(); family++) {
+        VkQueueFlags flags = queueFamilies[family].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            this->queueFamilyIndices.transferFamily = family;
+            DEBUG("Dedicated transfer family found at {}", family);
+            break;
+        }
+    }
+    if (!this->queueFamilyIndices.transferFamily.has_value()) {
+        this->queueFamilyIndices.transferFamily = this->queueFamilyIndices.graphicsFamily;
+    }
 }
 
 void VQDevice::CreateGraphicsCommandPool() {
@@ -181,24 +221,13 @@ void VQDevice::CreateBufferInPlace(
         FATAL("Failed to create VK buffer!");
     }
 
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(this->logicalDevice, vqBuffer.buffer, &memRequirements);
+    vqBuffer.allocator = &this->memoryAllocator;
+    vqBuffer.allocation = this->memoryAllocator.AllocateBufferMemory(vqBuffer.buffer, properties);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = VQUtils::findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(this->logicalDevice, &allocInfo, nullptr, &vqBuffer.bufferMemory) != VK_SUCCESS) {
-        FATAL("Failed to allocate device memory for buffer creation!");
-    }
-
-    vkBindBufferMemory(this->logicalDevice, vqBuffer.buffer, vqBuffer.bufferMemory, 0);
-
-    // only map to the memory pointer if the creation has HOST_VISIBLE_BIT,
-    // otherwise mapping wouldn't work anyways.
+    // only expose the memory pointer if the creation has HOST_VISIBLE_BIT,
+    // host-visible blocks are mapped by the allocator.
     if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
-        VK_CHECK_RESULT(vkMapMemory(this->logicalDevice, vqBuffer.bufferMemory, 0, vqBuffer.size, 0, &vqBuffer.bufferAddress));
+        vqBuffer.bufferAddress = vqBuffer.allocation.mappedData;
     }
 }
 
@@ -208,6 +237,24 @@ VQBuffer VQDevice::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkM
     return vqBuffer;
 }
 
+std::vector<VQDevice::HeapBudget> VQDevice::GetHeapBudgets() const {
+    if (!this->memoryBudgetEnabled) {
+        return {};
+    }
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext = &budgetProperties;
+    this->_getMemoryProperties2(this->physicalDevice, &properties);
+
+    std::vector<HeapBudget> budgets(properties.memoryProperties.memoryHeapCount);
+    for (uint32_t i = 0; i < budgets.size(); i++) {
+        budgets[i] = {budgetProperties.heapBudget[i], budgetProperties.heapUsage[i]};
+    }
+    return budgets;
+}
+
 VQDevice::~VQDevice() {}
 
 void VQDevice::Cleanup() {
@@ -222,6 +269,7 @@ void VQDevice::Cleanup() {
     if (graphicsCommandPool != VK_NULL_HANDLE) {
         vkDestroyCommandPool(logicalDevice, graphicsCommandPool, nullptr);
     }
+    memoryAllocator.Cleanup();
     vkDestroyDevice(logicalDevice, nullptr);
 }
 
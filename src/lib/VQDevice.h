@@ -1,5 +1,6 @@
 #pragma once
 #include "VQBuffer.h"
+#include "VQMemoryAllocator.h"
 #include "vulkan/vulkan.h"
 #include "vulkan/vulkan.hpp"
 #include <optional>
@@ -18,6 +19,8 @@ struct QueueFamilyIndices
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentationFamily;
     std::optional<uint32_t> computeFamily;
+    // dedicated transfer family if the device has one, graphics family otherwise
+    std::optional<uint32_t> transferFamily;
 
     inline bool isComplete()
     {
@@ -35,6 +38,13 @@ struct VQDevice
         std::vector<VkPresentModeKHR> presentModes;
     };
 
+    // the driver's estimate for a memory heap, see `GetHeapBudgets()`
+    struct HeapBudget
+    {
+        VkDeviceSize budget; // how much the process can use before allocations may fail or slow
+        VkDeviceSize usage;  // used by the process, including by other APIs and devices
+    };
+
     /** @brief Physical device representation */
     VkPhysicalDevice physicalDevice;
     /** @brief Logical device representation (application's view of the device) */
@@ -64,13 +74,22 @@ struct VQDevice
 
     VkQueue computeQueue = VK_NULL_HANDLE;
 
+    VkQueue transferQueue = VK_NULL_HANDLE; // may be the graphics queue
+
     VkCommandPool graphicsCommandPool = VK_NULL_HANDLE;
 
     VkFormat depthFormat = VK_FORMAT_UNDEFINED;
 
+    /** @brief Whether VK_EXT_memory_budget is enabled, see `GetHeapBudgets()` */
+    bool memoryBudgetEnabled = false;
+
     /** @brief Contains queue family indices */
     QueueFamilyIndices queueFamilyIndices;
 
+    /** @brief Backs all buffers and images created on this device, ready once the logical device
+     * is created */
+    VQMemoryAllocator memoryAllocator;
+
     operator VkDevice() const { return logicalDevice; };
 
     explicit VQDevice(VkPhysicalDevice physicalDevice);
@@ -85,6 +104,7 @@ struct VQDevice
      * presentation.
      *
      * @param surface The surface on which the presentation queue will present to.
+     * VK_NULL_HANDLE for headless rendering, in which case a graphics queue family is used.
      */
     void InitQueueFamilyIndices(VkSurfaceKHR surface);
 
@@ -92,8 +112,14 @@ struct VQDevice
      * @brief Create a Logical Device, and create a graphics queue and a presentation queue.
      *
      * @param extensions the extensions to enable
+     * @param getMemoryProperties2 resolved from an instance with
+     * VK_KHR_get_physical_device_properties2, nullptr if it isn't enabled. VK_EXT_memory_budget
+     * is enabled on top of `extensions` if both it and the device support it.
      */
-    void CreateLogicalDeviceAndQueue(const std::vector<const char*>& extensions);
+    void CreateLogicalDeviceAndQueue(
+        const std::vector<const char*>& extensions,
+        PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr
+    );
 
     /**
      * @brief Create a Graphics Command Pool, the pool is used for allocating command buffers.
@@ -110,6 +136,9 @@ struct VQDevice
 
     SwapChainSupport GetSwapChainSupportForSurface(const VkSurfaceKHR surface);
 
+    // indexed like `memoryProperties.memoryHeaps`; empty unless `memoryBudgetEnabled`
+    std::vector<HeapBudget> GetHeapBudgets() const;
+
     vk::Device Get() { return vk::Device(this->logicalDevice); }
 
     /**
@@ -136,4 +165,7 @@ struct VQDevice
     void EndSingleTimeCommands(vk::CommandBuffer commandBuffer);
 
     void Cleanup();
+
+  private:
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR _getMemoryProperties2 = nullptr;
 };
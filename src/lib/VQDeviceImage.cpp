@@ -2,7 +2,7 @@
 #include "VulkanUtils.h"
 
 VQDeviceImage VQ::CreateDeviceImage(
-    VQDevice device,
+    VQDevice& device,
     vk::Extent2D extent,
     vk::Format format,
     vk::ImageUsageFlagBits usage
@@ -30,21 +30,9 @@ VQDeviceImage VQ::CreateDeviceImage(
     auto vkDevice = vk::Device(device.logicalDevice);
     image.image = vkDevice.createImage(imageInfo);
 
-    vk::MemoryRequirements memRequirements = vkDevice.getImageMemoryRequirements(image.image);
-
-    vk::MemoryAllocateInfo allocInfo(
-        memRequirements.size,
-        VulkanUtils::findMemoryType(
-            device.physicalDevice,
-            memRequirements.memoryTypeBits,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-        )
+    image.memory = device.memoryAllocator.AllocateImageMemory(
+        image.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
     );
 
-    image.memory = vkDevice.allocateMemory(allocInfo);
-    ASSERT(image.memory);
-
-    vkDevice.bindImageMemory(image.image, image.memory, 0);
-
     return image;
 };
@@ -8,13 +8,13 @@ struct VQDeviceImage
 {
     VkImage image = VK_NULL_HANDLE;
     VkImageView view = VK_NULL_HANDLE;
-    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VQAllocation memory;
 };
 
 namespace VQ
 {
 VQDeviceImage CreateDeviceImage(
-    VQDevice device,
+    VQDevice& device,
     vk::Extent2D extent,
     vk::Format format,
     vk::ImageUsageFlagBits usage
@@ -0,0 +1,379 @@
+#include <algorithm>
+#include <bit>
+
+#include "VQMemoryAllocator.h"
+
+namespace
+{
+const VkDeviceSize BLOCK_SIZE = 64 * 1024 * 1024; // must be a power of 2
+const VkDeviceSize MIN_BUDDY_NODE_SIZE = 256;
+// allocations at least this large get a `VkDeviceMemory` of their own; they'd otherwise waste
+// up to half of a buddy node, or most of a linear block.
+const VkDeviceSize DEDICATED_ALLOCATION_THRESHOLD = BLOCK_SIZE / 2;
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+void VQMemoryAllocator::Init(VkPhysicalDevice physicalDevice, VkDevice device)
+{
+    _device = device;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &_memoryProperties);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    _bufferImageGranularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+
+    // buddy nodes are aligned to their size, so linear and optimal resources in neighbouring
+    // nodes never share a granularity page.
+    _minBuddyNodeSize = std::bit_ceil(std::max(MIN_BUDDY_NODE_SIZE, _bufferImageGranularity));
+    _maxBuddyOrder = std::countr_zero(BLOCK_SIZE / _minBuddyNodeSize);
+}
+
+void VQMemoryAllocator::Cleanup()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (__Pool& pool : _pools) {
+        for (std::unique_ptr<__Block>& block : pool.blocks) {
+            if (block->numAllocations > 0) {
+                WARN(
+                    "{} allocations are still alive in memory block {}",
+                    block->numAllocations,
+                    block->id
+                );
+            }
+            freeDeviceMemory(block->memory, block->mappedData);
+        }
+    }
+    _pools.clear();
+    if (_numDedicatedAllocations > 0) {
+        WARN("{} dedicated allocations are still alive", _numDedicatedAllocations);
+    }
+}
+
+VQAllocation VQMemoryAllocator::AllocateImageMemory(
+    VkImage image,
+    VkMemoryPropertyFlags properties,
+    Strategy strategy
+)
+{
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(_device, image, &requirements);
+    VQAllocation allocation = Allocate(requirements, properties, strategy);
+    VK_CHECK_RESULT(vkBindImageMemory(_device, image, allocation.memory, allocation.offset));
+    return allocation;
+}
+
+VQAllocation VQMemoryAllocator::AllocateBufferMemory(
+    VkBuffer buffer,
+    VkMemoryPropertyFlags properties,
+    Strategy strategy
+)
+{
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(_device, buffer, &requirements);
+    VQAllocation allocation = Allocate(requirements, properties, strategy);
+    VK_CHECK_RESULT(vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset));
+    return allocation;
+}
+
+VQAllocation VQMemoryAllocator::Allocate(
+    const VkMemoryRequirements& requirements,
+    VkMemoryPropertyFlags properties,
+    Strategy strategy
+)
+{
+    VQAllocation allocation{};
+    allocation.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (requirements.size < DEDICATED_ALLOCATION_THRESHOLD) {
+        __Pool& pool = getPool(allocation.memoryTypeIndex, strategy);
+        for (std::unique_ptr<__Block>& block : pool.blocks) {
+            if (allocateFromBlock(*block, strategy, requirements, allocation)) {
+                return allocation;
+            }
+        }
+        std::unique_ptr<__Block> block = createBlock(pool);
+        if (block) {
+            bool allocated = allocateFromBlock(*block, strategy, requirements, allocation);
+            ASSERT(allocated);
+            pool.blocks.push_back(std::move(block));
+            return allocation;
+        }
+        // heap too small or too full for another block, the allocation may still fit
+        WARN("Failed to allocate memory block of type {}", allocation.memoryTypeIndex);
+    }
+
+    allocation.memory = allocateDeviceMemory(
+        requirements.size, allocation.memoryTypeIndex, &allocation.mappedData
+    );
+    if (allocation.memory == VK_NULL_HANDLE) {
+        FATAL("Failed to allocate {} bytes of device memory!", requirements.size);
+    }
+    allocation.size = requirements.size;
+    allocation.blockId = 0;
+    _numDedicatedAllocations++;
+    _dedicatedBytes += allocation.size;
+    return allocation;
+}
+
+void VQMemoryAllocator::Free(const VQAllocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (allocation.blockId == 0) {
+        freeDeviceMemory(allocation.memory, allocation.mappedData);
+        _numDedicatedAllocations--;
+        _dedicatedBytes -= allocation.size;
+        return;
+    }
+
+    for (__Pool& pool : _pools) {
+        if (pool.memoryTypeIndex != allocation.memoryTypeIndex) {
+            continue;
+        }
+        auto it = std::find_if(
+            pool.blocks.begin(),
+            pool.blocks.end(),
+            [&](const std::unique_ptr<__Block>& block) { return block->id == allocation.blockId; }
+        );
+        if (it == pool.blocks.end()) {
+            continue;
+        }
+        __Block& block = **it;
+        freeFromBlock(block, pool.strategy, allocation);
+        // keep one empty block around so that alternating create/destroy doesn't thrash
+        if (block.numAllocations == 0 && pool.blocks.size() > 1) {
+            freeDeviceMemory(block.memory, block.mappedData);
+            pool.blocks.erase(it);
+        }
+        return;
+    }
+    PANIC("Freeing allocation from unknown memory block {}", allocation.blockId);
+}
+
+VQMemoryAllocator::Report VQMemoryAllocator::GetReport() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Report report{
+        .numDedicatedAllocations = _numDedicatedAllocations,
+        .dedicatedBytes = _dedicatedBytes,
+        .numDeviceMemoryObjects = _numDeviceMemoryObjects
+    };
+    for (const __Pool& pool : _pools) {
+        PoolReport poolReport{
+            .memoryTypeIndex = pool.memoryTypeIndex,
+            .strategy = pool.strategy,
+            .numBlocks = static_cast<uint32_t>(pool.blocks.size()),
+        };
+        VkDeviceSize freeBytes = 0;
+        for (const std::unique_ptr<__Block>& block : pool.blocks) {
+            VkDeviceSize blockFreeBytes, blockLargestFreeRange;
+            computeFreeRanges(*block, pool.strategy, blockFreeBytes, blockLargestFreeRange);
+            freeBytes += blockFreeBytes;
+            poolReport.largestFreeRange
+                = std::max(poolReport.largestFreeRange, blockLargestFreeRange);
+            poolReport.numAllocations += block->numAllocations;
+            poolReport.usedBytes += block->usedBytes;
+            poolReport.blockBytes += BLOCK_SIZE;
+        }
+        if (freeBytes > 0) {
+            poolReport.fragmentation
+                = 1.f - static_cast<float>(poolReport.largestFreeRange) / freeBytes;
+        }
+        report.pools.push_back(poolReport);
+    }
+    return report;
+}
+
+uint32_t VQMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+    const
+{
+    for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i))
+            && (_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    PANIC("Failed to find suitable memory type!");
+}
+
+VQMemoryAllocator::__Pool& VQMemoryAllocator::getPool(uint32_t memoryTypeIndex, Strategy strategy)
+{
+    for (__Pool& pool : _pools) {
+        if (pool.memoryTypeIndex == memoryTypeIndex && pool.strategy == strategy) {
+            return pool;
+        }
+    }
+    return _pools.emplace_back(__Pool{.memoryTypeIndex = memoryTypeIndex, .strategy = strategy});
+}
+
+VkDeviceMemory VQMemoryAllocator::allocateDeviceMemory(
+    VkDeviceSize size,
+    uint32_t memoryTypeIndex,
+    void** mapped
+)
+{
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if (vkAllocateMemory(_device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        return VK_NULL_HANDLE;
+    }
+    _numDeviceMemoryObjects++;
+
+    // memory can only be mapped once, map all of it for every allocation to share
+    *mapped = nullptr;
+    if (_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags
+        & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        VK_CHECK_RESULT(vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, mapped));
+    }
+    return memory;
+}
+
+void VQMemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, void* mapped)
+{
+    if (mapped != nullptr) {
+        vkUnmapMemory(_device, memory);
+    }
+    vkFreeMemory(_device, memory, nullptr);
+    _numDeviceMemoryObjects--;
+}
+
+std::unique_ptr<VQMemoryAllocator::__Block> VQMemoryAllocator::createBlock(const __Pool& pool)
+{
+    void* mapped = nullptr;
+    VkDeviceMemory memory = allocateDeviceMemory(BLOCK_SIZE, pool.memoryTypeIndex, &mapped);
+    if (memory == VK_NULL_HANDLE) {
+        return nullptr;
+    }
+    auto block = std::make_unique<__Block>();
+    block->id = _nextBlockId++;
+    block->memory = memory;
+    block->mappedData = mapped;
+    if (pool.strategy == Strategy::kBuddy) {
+        block->freeNodes.resize(_maxBuddyOrder + 1);
+        block->freeNodes[_maxBuddyOrder].insert(0);
+    }
+    return block;
+}
+
+bool VQMemoryAllocator::allocateFromBlock(
+    __Block& block,
+    Strategy strategy,
+    const VkMemoryRequirements& requirements,
+    VQAllocation& allocation
+)
+{
+    switch (strategy) {
+    case Strategy::kBuddy: {
+        VkDeviceSize nodeSize = std::bit_ceil(
+            std::max({requirements.size, requirements.alignment, _minBuddyNodeSize})
+        );
+        uint32_t order = std::countr_zero(nodeSize / _minBuddyNodeSize);
+        // smallest free node that fits, split down to size
+        uint32_t freeOrder = order;
+        while (freeOrder <= _maxBuddyOrder && block.freeNodes[freeOrder].empty()) {
+            freeOrder++;
+        }
+        if (freeOrder > _maxBuddyOrder) {
+            return false;
+        }
+        auto node = block.freeNodes[freeOrder].begin(); // lowest offset, keeps blocks packed
+        VkDeviceSize offset = *node;
+        block.freeNodes[freeOrder].erase(node);
+        while (freeOrder > order) {
+            freeOrder--;
+            block.freeNodes[freeOrder].insert(offset + (_minBuddyNodeSize << freeOrder));
+        }
+        allocation.offset = offset;
+        allocation.size = nodeSize;
+        allocation.buddyOrder = order;
+        break;
+    }
+    case Strategy::kLinear: {
+        VkDeviceSize offset
+            = alignUp(block.head, std::max(requirements.alignment, _bufferImageGranularity));
+        if (offset + requirements.size > BLOCK_SIZE) {
+            return false;
+        }
+        block.head = offset + requirements.size;
+        allocation.offset = offset;
+        allocation.size = requirements.size;
+        break;
+    }
+    }
+
+    allocation.memory = block.memory;
+    allocation.blockId = block.id;
+    allocation.mappedData
+        = block.mappedData ? static_cast<char*>(block.mappedData) + allocation.offset : nullptr;
+    block.numAllocations++;
+    block.usedBytes += allocation.size;
+    return true;
+}
+
+void VQMemoryAllocator::freeFromBlock(
+    __Block& block,
+    Strategy strategy,
+    const VQAllocation& allocation
+)
+{
+    ASSERT(block.numAllocations > 0);
+    block.numAllocations--;
+    block.usedBytes -= allocation.size;
+
+    switch (strategy) {
+    case Strategy::kBuddy: {
+        // merge with the buddy for as long as it is free as well
+        VkDeviceSize offset = allocation.offset;
+        uint32_t order = allocation.buddyOrder;
+        while (order < _maxBuddyOrder) {
+            VkDeviceSize buddy = offset ^ (_minBuddyNodeSize << order);
+            auto it = block.freeNodes[order].find(buddy);
+            if (it == block.freeNodes[order].end()) {
+                break;
+            }
+            block.freeNodes[order].erase(it);
+            offset = std::min(offset, buddy);
+            order++;
+        }
+        block.freeNodes[order].insert(offset);
+        break;
+    }
+    case Strategy::kLinear:
+        if (block.numAllocations == 0) {
+            block.head = 0;
+        }
+        break;
+    }
+}
+
+void VQMemoryAllocator::computeFreeRanges(
+    const __Block& block,
+    Strategy strategy,
+    VkDeviceSize& freeBytes,
+    VkDeviceSize& largestFreeRange
+) const
+{
+    freeBytes = BLOCK_SIZE - block.usedBytes;
+    largestFreeRange = 0;
+    switch (strategy) {
+    case Strategy::kBuddy:
+        for (uint32_t order = 0; order <= _maxBuddyOrder; order++) {
+            if (!block.freeNodes[order].empty()) {
+                largestFreeRange = _minBuddyNodeSize << order;
+            }
+        }
+        break;
+    case Strategy::kLinear: // space behind the head is dead until the block is reset
+        largestFreeRange = BLOCK_SIZE - block.head;
+        break;
+    }
+}
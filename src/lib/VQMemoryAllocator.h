@@ -0,0 +1,144 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+/**
+ * @brief A range of device memory handed out by `VQMemoryAllocator`.
+ * Resources are bound at `offset` into `memory`, which is shared with other allocations.
+ */
+struct VQAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mappedData = nullptr; // host-visible memory stays mapped for its whole lifetime
+
+    // bookkeeping of the allocator
+    uint32_t memoryTypeIndex = 0;
+    uint32_t blockId = 0; // 0 for dedicated allocations
+    uint32_t buddyOrder = 0;
+};
+
+/**
+ * @brief Sub-allocates device memory out of large per-memory-type blocks, so that creating a
+ * resource rarely costs a `vkAllocateMemory`, and the driver's allocation count limit isn't
+ * approached.
+ *
+ * Thread-safe.
+ */
+class VQMemoryAllocator
+{
+  public:
+    enum class Strategy
+    {
+        // power-of-two blocks split and merged on demand; general purpose.
+        kBuddy,
+        // bump allocation, space is only reclaimed once every allocation of the block is freed;
+        // for resources that are created and destroyed together, e.g. frame buffers.
+        kLinear
+    };
+
+    struct PoolReport
+    {
+        uint32_t memoryTypeIndex;
+        Strategy strategy;
+        uint32_t numBlocks;
+        uint32_t numAllocations;
+        VkDeviceSize blockBytes; // `vkAllocateMemory`'d
+        VkDeviceSize usedBytes;
+        VkDeviceSize largestFreeRange; // largest allocation possible without a new block
+        // 0 when all free space is one contiguous range, approaching 1 as it is scattered
+        float fragmentation;
+    };
+
+    struct Report
+    {
+        std::vector<PoolReport> pools;
+        uint32_t numDedicatedAllocations;
+        VkDeviceSize dedicatedBytes;
+        uint32_t numDeviceMemoryObjects; // live `VkDeviceMemory`s, counted against the driver limit
+    };
+
+    void Init(VkPhysicalDevice physicalDevice, VkDevice device);
+    // frees all blocks, warning about allocations that weren't freed.
+    void Cleanup();
+
+    // allocates memory for `image` and binds it
+    VQAllocation AllocateImageMemory(
+        VkImage image,
+        VkMemoryPropertyFlags properties,
+        Strategy strategy = Strategy::kBuddy
+    );
+    // allocates memory for `buffer` and binds it
+    VQAllocation AllocateBufferMemory(
+        VkBuffer buffer,
+        VkMemoryPropertyFlags properties,
+        Strategy strategy = Strategy::kBuddy
+    );
+    VQAllocation Allocate(
+        const VkMemoryRequirements& requirements,
+        VkMemoryPropertyFlags properties,
+        Strategy strategy
+    );
+    // the memory must no longer be in use by the device
+    void Free(const VQAllocation& allocation);
+
+    Report GetReport() const;
+
+  private:
+    struct __Block
+    {
+        uint32_t id;
+        VkDeviceMemory memory;
+        void* mappedData;
+        uint32_t numAllocations = 0;
+        VkDeviceSize usedBytes = 0;
+        // kBuddy: free node offsets of each order, order 0 being `_minBuddyNodeSize`
+        std::vector<std::set<VkDeviceSize>> freeNodes;
+        // kLinear: end of the last allocation
+        VkDeviceSize head = 0;
+    };
+
+    struct __Pool
+    {
+        uint32_t memoryTypeIndex;
+        Strategy strategy;
+        std::vector<std::unique_ptr<__Block>> blocks;
+    };
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    __Pool& getPool(uint32_t memoryTypeIndex, Strategy strategy);
+    VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** mapped);
+    void freeDeviceMemory(VkDeviceMemory memory, void* mapped);
+
+    std::unique_ptr<__Block> createBlock(const __Pool& pool);
+    bool allocateFromBlock(
+        __Block& block,
+        Strategy strategy,
+        const VkMemoryRequirements& requirements,
+        VQAllocation& allocation
+    );
+    void freeFromBlock(__Block& block, Strategy strategy, const VQAllocation& allocation);
+    void computeFreeRanges(
+        const __Block& block,
+        Strategy strategy,
+        VkDeviceSize& freeBytes,
+        VkDeviceSize& largestFreeRange
+    ) const;
+
+    VkDevice _device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties _memoryProperties{};
+    VkDeviceSize _bufferImageGranularity = 1;
+    VkDeviceSize _minBuddyNodeSize = 0;
+    uint32_t _maxBuddyOrder = 0;
+
+    mutable std::mutex _mutex;
+    std::vector<__Pool> _pools;
+    uint32_t _nextBlockId = 1;
+    uint32_t _numDedicatedAllocations = 0;
+    VkDeviceSize _dedicatedBytes = 0;
+    uint32_t _numDeviceMemoryObjects = 0;
+};
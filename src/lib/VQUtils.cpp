@@ -6,82 +6,6 @@
 // utilities not exposed
 namespace CoreUtils
 {
-uint32_t findVulkanMemoryType(
-    VkPhysicalDevice physicalDevice,
-    uint32_t typeFilter,
-    VkMemoryPropertyFlags properties
-) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i))
-            && (memProperties.memoryTypes[i].propertyFlags & properties)
-                   == properties) {
-            return i;
-        }
-    }
-
-    FATAL("Failed to find suitable memory type!");
-}
-
-void createVulkanBuffer(
-    VkPhysicalDevice physicalDevice,
-    VkDevice device,
-    VkDeviceSize size,
-    VkBufferUsageFlags usage,
-    VkMemoryPropertyFlags properties,
-    VkBuffer& buffer,
-    VkDeviceMemory& bufferMemory
-) {
-    VkBufferCreateInfo bufferInfo{};
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = size;
-    bufferInfo.usage = usage;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-        FATAL("Failed to create VK buffer!");
-    }
-
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findVulkanMemoryType(
-        physicalDevice, memRequirements.memoryTypeBits, properties
-    );
-
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory)
-        != VK_SUCCESS) {
-        FATAL("Failed to allocate device memory for buffer creation!");
-    }
-
-    vkBindBufferMemory(device, buffer, bufferMemory, 0);
-}
-
-std::pair<VkBuffer, VkDeviceMemory> createVulkanStagingBuffer(
-    VkPhysicalDevice physicalDevice,
-    VkDevice device,
-    VkDeviceSize bufferSize
-) {
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createVulkanBuffer(
-        physicalDevice,
-        device,
-        bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-            | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        stagingBuffer,
-        stagingBufferMemory
-    );
-    return {stagingBuffer, stagingBufferMemory};
-}
-
 VkCommandBuffer beginSingleTimeCommands(
     VkDevice device,
     VkCommandPool commandPool
@@ -221,53 +145,36 @@ void VQUtils::createVertexBuffer(
 ) {
     VkDeviceSize vertexBufferSize = sizeof(Vertex) * vertices.size();
 
-    std::pair<VkBuffer, VkDeviceMemory> res
-        = CoreUtils::createVulkanStagingBuffer(
-            vqDevice.physicalDevice, vqDevice.logicalDevice, vertexBufferSize
-        );
-    VkBuffer stagingBuffer = res.first;
-    VkDeviceMemory stagingBufferMemory = res.second;
-    // copy over data from cpu memory to gpu memory(staging buffer)
-    void* data;
-    vkMapMemory(
-        vqDevice.logicalDevice,
-        stagingBufferMemory,
-        0,
+    VQBuffer stagingBuffer = vqDevice.CreateBuffer(
         vertexBufferSize,
-        0,
-        &data
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
     );
-    memcpy(data, vertices.data(), (size_t)vertexBufferSize); // copy the data
-    vkUnmapMemory(vqDevice.logicalDevice, stagingBufferMemory);
+    // copy over data from cpu memory to gpu memory(staging buffer)
+    memcpy(stagingBuffer.bufferAddress, vertices.data(), (size_t)vertexBufferSize);
 
     // create vertex buffer
-    CoreUtils::createVulkanBuffer(
-        vqDevice.physicalDevice,
-        vqDevice.logicalDevice,
+    vqDevice.CreateBufferInPlace(
         vertexBufferSize,
         VK_BUFFER_USAGE_TRANSFER_DST_BIT // can be used as destination in a
                                          // memory transfer operation
             | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, // local to the GPU for faster
                                              // access
-        vqBuffer.buffer,
-        vqBuffer.bufferMemory
+        vqBuffer
     );
 
     CoreUtils::copyVulkanBuffer(
         vqDevice.logicalDevice,
         vqDevice.graphicsCommandPool,
         vqDevice.graphicsQueue,
-        stagingBuffer,
+        stagingBuffer.buffer,
         vqBuffer.buffer,
         vertexBufferSize
     );
 
-    vqBuffer.size = vertexBufferSize;
-    vqBuffer.device = vqDevice.logicalDevice;
     // get rid of staging buffer, it is very much temproary
-    vkDestroyBuffer(vqDevice.logicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(vqDevice.logicalDevice, stagingBufferMemory, nullptr);
+    stagingBuffer.Cleanup();
 }
 
 void VQUtils::meshToBuffer(
@@ -8,20 +8,6 @@
 namespace CoreUtils
 {
 
-static void createVulkanBuffer(
-    VkPhysicalDevice physicalDevice,
-    VkDevice device,
-    VkDeviceSize size,
-    VkBufferUsageFlags usage,
-    VkMemoryPropertyFlags properties,
-    VkBuffer& buffer,
-    VkDeviceMemory& bufferMemory
-);
-std::pair<VkBuffer, VkDeviceMemory> createVulkanStagingBuffer(
-    VkPhysicalDevice physicalDevice,
-    VkDevice device,
-    VkDeviceSize bufferSize
-);
 void copyVulkanBuffer(
     VkDevice device,
     VkCommandPool commandPool,
@@ -57,52 +43,35 @@ void createIndexBuffer(
     DEBUG("Creating index buffer...");
     VkDeviceSize indexBufferSize = sizeof(T) * indices.size();
 
-    std::pair<VkBuffer, VkDeviceMemory> res
-        = CoreUtils::createVulkanStagingBuffer(
-            vqDevice.physicalDevice, vqDevice.logicalDevice, indexBufferSize
-        );
-    VkBuffer stagingBuffer = res.first;
-    VkDeviceMemory stagingBufferMemory = res.second;
-    // copy over data from cpu memory to gpu memory(staging buffer)
-    void* data;
-    vkMapMemory(
-        vqDevice.logicalDevice,
-        stagingBufferMemory,
-        0,
+    VQBuffer stagingBuffer = vqDevice.CreateBuffer(
         indexBufferSize,
-        0,
-        &data
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
     );
-    memcpy(data, indices.data(), (size_t)indexBufferSize); // copy the data
-    vkUnmapMemory(vqDevice.logicalDevice, stagingBufferMemory);
+    // copy over data from cpu memory to gpu memory(staging buffer)
+    memcpy(stagingBuffer.bufferAddress, indices.data(), (size_t)indexBufferSize);
 
     // create index buffer
-    CoreUtils::createVulkanBuffer(
-        vqDevice.physicalDevice,
-        vqDevice.logicalDevice,
+    vqDevice.CreateBufferInPlace(
         indexBufferSize,
         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        vqBuffer.buffer,
-        vqBuffer.bufferMemory
+        vqBuffer
     );
 
     CoreUtils::copyVulkanBuffer(
         vqDevice.logicalDevice,
         vqDevice.graphicsCommandPool,
         vqDevice.graphicsQueue,
-        stagingBuffer,
+        stagingBuffer.buffer,
         vqBuffer.buffer,
         indexBufferSize
     );
 
-    vqBuffer.size = indexBufferSize;
-    vqBuffer.device = vqDevice.logicalDevice;
     vqBuffer.indexSize = sizeof(T);
     vqBuffer.numIndices = indices.size();
 
-    vkDestroyBuffer(vqDevice.logicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(vqDevice.logicalDevice, stagingBufferMemory, nullptr);
+    stagingBuffer.Cleanup();
 }
 
 void createVertexBuffer(
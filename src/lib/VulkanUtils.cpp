@@ -138,7 +138,8 @@ VkImageView VulkanUtils::createImageView(
     VkImage& textureImage,
     VkDevice logicalDevice,
     VkFormat format,
-    VkImageAspectFlags flags
+    VkImageAspectFlags flags,
+    uint32_t mipLevels
 ) {
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -147,7 +148,7 @@ VkImageView VulkanUtils::createImageView(
     viewInfo.format = format;
     viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.levelCount = mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
     viewInfo.subresourceRange.aspectMask = flags;
@@ -168,9 +169,10 @@ void VulkanUtils::createImage(
     VkImageUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkImage& image,
-    VkDeviceMemory& imageMemory,
-    VkPhysicalDevice physicalDevice,
-    VkDevice logicalDevice
+    VQAllocation& imageMemory,
+    VQDevice& device,
+    VQMemoryAllocator::Strategy strategy,
+    uint32_t mipLevels
 ) {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -178,7 +180,7 @@ void VulkanUtils::createImage(
     imageInfo.extent.width = width;
     imageInfo.extent.height = height;
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = mipLevels;
     imageInfo.arrayLayers = 1;
     imageInfo.format = format;
     imageInfo.tiling = tiling;
@@ -187,23 +189,11 @@ void VulkanUtils::createImage(
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    if (vkCreateImage(logicalDevice, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+    if (vkCreateImage(device.logicalDevice, &imageInfo, nullptr, &image) != VK_SUCCESS) {
         throw std::runtime_error("failed to create image!");
     }
 
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(logicalDevice, image, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = VulkanUtils::findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        FATAL("Failed to allocate image memory!");
-    }
-
-    vkBindImageMemory(logicalDevice, image, imageMemory, 0);
+    imageMemory = device.memoryAllocator.AllocateImageMemory(image, properties, strategy);
 }
 
 VkFormat VulkanUtils::findDepthFormat(VkPhysicalDevice physicalDevice) {
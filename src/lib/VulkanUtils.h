@@ -86,7 +86,8 @@ VkImageView createImageView(
     VkImage& textureImage,
     VkDevice logicalDevice,
     VkFormat format = VK_FORMAT_R8G8B8A8_SRGB,
-    VkImageAspectFlags flags = VK_IMAGE_ASPECT_COLOR_BIT
+    VkImageAspectFlags flags = VK_IMAGE_ASPECT_COLOR_BIT,
+    uint32_t mipLevels = 1
 );
 
 VkFormat findBestFormat(
@@ -106,9 +107,10 @@ void createImage(
     VkImageUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkImage& image,
-    VkDeviceMemory& imageMemory,
-    VkPhysicalDevice physicalDevice,
-    VkDevice logicalDevice
+    VQAllocation& imageMemory,
+    VQDevice& device,
+    VQMemoryAllocator::Strategy strategy = VQMemoryAllocator::Strategy::kBuddy,
+    uint32_t mipLevels = 1
 );
 
 } // namespace VulkanUtils
@@ -2,10 +2,7 @@
 
 #include "Tetrium.h"
 
-#include "apps/AppScreeningTest.h"
-#include "apps/AppTetraHueSphere.h"
-#include "apps/AppImageViewer.h"
-#include "apps/AppPainter.h"
+#include "apps/DefaultApps.h"
 
 void printGreetingBanner()
 {
@@ -27,15 +24,21 @@ int main(int argc, char** argv)
     DEBUG("running in debug mode");
 #endif // !NDEBUG
 
-    std::vector<std::pair<TetriumApp::App*, const char*>> apps = {
-        {new TetriumApp::AppScreeningTest(), "Screening Test"},
-        {new TetriumApp::AppTetraHueSphere(), "Tetra Hue Sphere"},
-        {new TetriumApp::AppImageViewer(), "Image Viewer"},
-        {new TetriumApp::AppPainter(), "Painter"},
-    };
+    std::vector<std::pair<TetriumApp::App*, const char*>> apps = TetriumApp::CreateDefaultApps();
 
 
     Tetrium::InitOptions options{.tetraMode = Tetrium::TetraMode::kEvenOddSoftwareSync};
+
+    // `--headless [num ticks] [app name]` renders off-screen for a fixed number of ticks
+    if (argc > 1 && std::string(argv[1]) == "--headless") {
+        options.tetraMode = Tetrium::TetraMode::kHeadless;
+        if (argc > 2) {
+            options.headless.numTicks = std::stoul(argv[2]);
+        }
+        if (argc > 3) {
+            options.headless.primaryApp = argv[3];
+        }
+    }
     Tetrium* engine = new Tetrium();
 
     for (auto& [app, appName] : apps) {
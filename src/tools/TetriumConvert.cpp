@@ -0,0 +1,578 @@
+// Batch converter from painter canvases to image viewer tetra images: every 32-bit float RYGB
+// TIFF written by `AppPainter::saveCanvasToFile` becomes a `xxx_RGB.png` / `xxx_OCV.png` pair.
+//
+// Conversion is streamed. Scanlines are read in chunks of rows, chunks are transformed and
+// quantized on worker threads, and the two PNGs are encoded row by row on their own threads.
+// Only a fixed number of chunks are in flight, so memory use depends on the image width alone.
+//
+// With `--tiled`, canvases become a single `xxx.ttiles` tiled pyramid instead, for the image
+// viewer to stream canvases too large for textures; the encoders cut their rows into tiles.
+//
+// With `--tetra`, canvases become a single `xxx.tetra` image that keeps the RYGB source along
+// with both planes and their mips; workers write the source rows, the encoders the planes'.
+//
+// usage: TetriumConvert [--tiled | --tetra] <input directory or .tiff> [output directory]
+//        [num threads]
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <csetjmp>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "png.h"
+#include "tiffio.h"
+
+#include "lib/RYGBTransform.h"
+#include "lib/SrgbQuantizer.h"
+#include "lib/TetraImage.h"
+#include "lib/TiledImage.h"
+
+namespace
+{
+// bytes of RYGB scanlines per chunk; chunks are also capped to `MAX_ROWS_PER_CHUNK` rows
+const size_t CHUNK_SIZE = 4 << 20;
+const uint32_t MAX_ROWS_PER_CHUNK = 64;
+
+const char* COLOR_SPACE_SUFFIXES[ColorSpace::ColorSpaceSize] = {"_RGB.png", "_OCV.png"};
+
+enum class OutputFormat
+{
+    kPngPair, // `xxx_RGB.png` and `xxx_OCV.png`
+    kTiled,   // `xxx.ttiles`, see `TiledImage`
+    kTetra    // `xxx.tetra`, see `TetraImage`
+};
+
+const SrgbQuantizer QUANTIZER;
+
+// libpng reports errors by longjmp-ing into the last `setjmp`, so the `png*()` functions keep
+// objects with destructors out of the frames it may jump across.
+void onPngError(png_structp png, png_const_charp message)
+{
+    ERROR("libpng: {}", message);
+    png_longjmp(png, 1);
+}
+
+void onPngWarning(png_structp, png_const_charp message) { WARN("libpng: {}", message); }
+
+bool pngWriteHeader(png_structp png, png_infop info, FILE* file, uint32_t width, uint32_t height)
+{
+    if (setjmp(png_jmpbuf(png))) {
+        return false;
+    }
+    png_init_io(png, file);
+    png_set_IHDR(
+        png,
+        info,
+        width,
+        height,
+        8,
+        PNG_COLOR_TYPE_RGB,
+        PNG_INTERLACE_NONE,
+        PNG_COMPRESSION_TYPE_DEFAULT,
+        PNG_FILTER_TYPE_DEFAULT
+    );
+    png_set_sRGB(png, info, PNG_sRGB_INTENT_PERCEPTUAL);
+    png_write_info(png, info);
+    return true;
+}
+
+bool pngWriteRows(png_structp png, png_bytepp rows, uint32_t numRows)
+{
+    if (setjmp(png_jmpbuf(png))) {
+        return false;
+    }
+    png_write_rows(png, rows, numRows);
+    return true;
+}
+
+bool pngWriteEnd(png_structp png, png_infop info)
+{
+    if (setjmp(png_jmpbuf(png))) {
+        return false;
+    }
+    png_write_end(png, info);
+    return true;
+}
+
+// Streams a single canvas through the read -> convert -> encode pipeline.
+class Converter
+{
+  public:
+    Converter(uint32_t numWorkers, OutputFormat format)
+        : _numWorkers(numWorkers), _format(format),
+          _numOutputChannels(format == OutputFormat::kPngPair ? 3 : 4) // textures are RGBA
+    {
+    }
+
+    // `outputs` are the two PNGs, or the tiled or tetra image
+    bool Convert(
+        const std::filesystem::path& input,
+        const std::vector<std::filesystem::path>& outputs
+    )
+    {
+        TIFF* tiff = TIFFOpen(input.string().c_str(), "r");
+        if (!tiff) {
+            ERROR("Failed to open {}", input.string());
+            return false;
+        }
+        _openedOutputs.clear();
+        bool success = openCanvas(tiff, input) && openOutputs(outputs);
+        if (success) {
+            run(tiff);
+            success = !_failed;
+        }
+        TIFFClose(tiff);
+        success &= closeOutputs();
+        if (!success) { // don't leave truncated images for the viewer to pick up
+            for (const std::filesystem::path& output : _openedOutputs) {
+                std::error_code error;
+                std::filesystem::remove(output, error);
+            }
+        }
+        return success;
+    }
+
+  private:
+    struct Chunk
+    {
+        enum class State
+        {
+            kFree,
+            kRead,       // scanlines are in, waiting for a worker
+            kConverting, // owned by a worker
+            kConverted   // waiting for the encoders
+        };
+
+        State state = State::kFree;
+        uint32_t index = 0;
+        uint32_t rowBegin = 0;
+        uint32_t numRows = 0;
+        uint32_t numEncoded = 0; // encoders done with the chunk
+        std::vector<float> rygb;
+        std::array<std::vector<uint8_t>, ColorSpace::ColorSpaceSize> pixels;
+    };
+
+    bool openCanvas(TIFF* tiff, const std::filesystem::path& input)
+    {
+        uint16_t samplesPerPixel = 0, bitsPerSample = 0, planarConfig = 0, sampleFormat = 0;
+        TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &_width);
+        TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &_height);
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLESPERPIXEL, &samplesPerPixel);
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_BITSPERSAMPLE, &bitsPerSample);
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_PLANARCONFIG, &planarConfig);
+        // the painter doesn't tag its floats, only reject canvases tagged otherwise
+        bool isFloat = !TIFFGetField(tiff, TIFFTAG_SAMPLEFORMAT, &sampleFormat)
+                       || sampleFormat == SAMPLEFORMAT_IEEEFP;
+
+        if (samplesPerPixel != 4 || bitsPerSample != 32 || !isFloat
+            || planarConfig != PLANARCONFIG_CONTIG || TIFFIsTiled(tiff)) {
+            ERROR("{} is not a 32-bit float RYGB canvas in strips", input.string());
+            return false;
+        }
+        if (_width == 0 || _height == 0) {
+            ERROR("{} is empty", input.string());
+            return false;
+        }
+        ASSERT(static_cast<size_t>(TIFFScanlineSize(tiff)) == _width * 4 * sizeof(float));
+
+        size_t rowSize = _width * 4 * sizeof(float);
+        _rowsPerChunk = std::clamp<uint32_t>(CHUNK_SIZE / rowSize, 1, MAX_ROWS_PER_CHUNK);
+        _numChunks = (_height + _rowsPerChunk - 1) / _rowsPerChunk;
+        // enough chunks for every worker, one being read and one being encoded
+        _chunks.resize(_numWorkers + 2);
+        for (Chunk& chunk : _chunks) {
+            chunk.state = Chunk::State::kFree;
+            chunk.rygb.resize(_rowsPerChunk * _width * 4);
+            for (std::vector<uint8_t>& pixels : chunk.pixels) {
+                pixels.resize(_rowsPerChunk * _width * _numOutputChannels);
+            }
+        }
+        _failed = false;
+        _readDone = false;
+        return true;
+    }
+
+    // Records `output` as written by this run if `opened`, or if a failed open left a file that
+    // wasn't there before it. Files that existed are never removed unless they were opened.
+    void recordOpenedOutput(const std::filesystem::path& output, bool existed, bool opened)
+    {
+        if (opened || (!existed && std::filesystem::exists(output))) {
+            _openedOutputs.push_back(output);
+        }
+    }
+
+    bool openOutputs(const std::vector<std::filesystem::path>& outputs)
+    {
+        if (_format == OutputFormat::kTiled) {
+            bool existed = std::filesystem::exists(outputs[0]);
+            bool opened = _tiles.Create(outputs[0].string(), _width, _height);
+            recordOpenedOutput(outputs[0], existed, opened);
+            if (!opened) {
+                ERROR("Failed to open {} for writing", outputs[0].string());
+                return false;
+            }
+            for (int colorSpace = 0; colorSpace < ColorSpace::ColorSpaceSize; colorSpace++) {
+                _pyramids[colorSpace] = std::make_unique<TiledImage::PyramidBuilder>(
+                    _tiles, static_cast<ColorSpace>(colorSpace)
+                );
+            }
+            return true;
+        }
+        if (_format == OutputFormat::kTetra) {
+            TetraImage::Metadata metadata{
+                .transformsFromRygb = RYGBTransform::TRANSFORMS_FROM_RYGB};
+            bool existed = std::filesystem::exists(outputs[0]);
+            bool opened = _tetra.Create(outputs[0].string(), _width, _height, metadata);
+            recordOpenedOutput(outputs[0], existed, opened);
+            if (!opened) {
+                ERROR("Failed to open {} for writing", outputs[0].string());
+                return false;
+            }
+            return true;
+        }
+        for (int colorSpace = 0; colorSpace < ColorSpace::ColorSpaceSize; colorSpace++) {
+            Output& output = _outputs[colorSpace];
+            output.file = fopen(outputs[colorSpace].string().c_str(), "wb");
+            if (!output.file) {
+                ERROR("Failed to open {} for writing", outputs[colorSpace].string());
+                return false;
+            }
+            _openedOutputs.push_back(outputs[colorSpace]);
+            output.png = png_create_write_struct(
+                PNG_LIBPNG_VER_STRING, nullptr, onPngError, onPngWarning
+            );
+            output.info = output.png ? png_create_info_struct(output.png) : nullptr;
+            if (!output.info
+                || !pngWriteHeader(output.png, output.info, output.file, _width, _height)) {
+                ERROR("Failed to start PNG {}", outputs[colorSpace].string());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // returns false if an output failed to flush
+    bool closeOutputs()
+    {
+        bool success = true;
+        for (Output& output : _outputs) {
+            if (output.png) {
+                png_destroy_write_struct(&output.png, output.info ? &output.info : nullptr);
+            }
+            if (output.file) {
+                success &= fclose(output.file) == 0;
+            }
+            output = Output{};
+        }
+        for (std::unique_ptr<TiledImage::PyramidBuilder>& pyramid : _pyramids) {
+            pyramid.reset();
+        }
+        success &= _tiles.Close();
+        success &= _tetra.Close();
+        return success;
+    }
+
+    void run(TIFF* tiff)
+    {
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < _numWorkers; i++) {
+            threads.emplace_back(&Converter::workerLoop, this);
+        }
+        for (int colorSpace = 0; colorSpace < ColorSpace::ColorSpaceSize; colorSpace++) {
+            ColorSpace encoded = static_cast<ColorSpace>(colorSpace);
+            threads.emplace_back(&Converter::encoderLoop, this, encoded);
+        }
+        readerLoop(tiff);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    void fail()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _failed = true;
+        _cv.notify_all();
+    }
+
+    // reads chunks in order into the ring of chunks, scanlines must be read sequentially
+    // for compressed strips.
+    void readerLoop(TIFF* tiff)
+    {
+        for (uint32_t i = 0; i < _numChunks; i++) {
+            Chunk& chunk = _chunks[i % _chunks.size()];
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv.wait(lock, [&] { return chunk.state == Chunk::State::kFree || _failed; });
+                if (_failed) {
+                    break;
+                }
+            }
+            chunk.index = i;
+            chunk.rowBegin = i * _rowsPerChunk;
+            chunk.numRows = std::min(_rowsPerChunk, _height - chunk.rowBegin);
+            chunk.numEncoded = 0;
+            for (uint32_t row = 0; row < chunk.numRows; row++) {
+                float* scanline = chunk.rygb.data() + row * _width * 4;
+                if (TIFFReadScanline(tiff, scanline, chunk.rowBegin + row, 0) < 0) {
+                    ERROR("Failed to read scanline {}", chunk.rowBegin + row);
+                    fail();
+                    return;
+                }
+            }
+            std::lock_guard<std::mutex> lock(_mutex);
+            chunk.state = Chunk::State::kRead;
+            _cv.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        _readDone = true;
+        _cv.notify_all();
+    }
+
+    void workerLoop()
+    {
+        // one row of transformed, unquantized pixels for each color space
+        std::array<std::vector<float>, ColorSpace::ColorSpaceSize> rowBuffers;
+        std::array<RYGBTransform::ImageBuffer, ColorSpace::ColorSpaceSize> rowOutputs;
+        std::array<const RYGBTransform::ImageBuffer*, ColorSpace::ColorSpaceSize> outputs;
+        for (int colorSpace = 0; colorSpace < ColorSpace::ColorSpaceSize; colorSpace++) {
+            rowBuffers[colorSpace].resize(_width * _numOutputChannels);
+            rowOutputs[colorSpace].data = rowBuffers[colorSpace].data();
+            rowOutputs[colorSpace].numChannels = _numOutputChannels;
+            outputs[colorSpace] = &rowOutputs[colorSpace];
+        }
+        std::vector<uint16_t> rygbHalves; // of a chunk, for tetra images
+        if (_format == OutputFormat::kTetra) {
+            rygbHalves.resize(_rowsPerChunk * _width * 4);
+        }
+
+        while (true) {
+            Chunk* chunk = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                auto findReadChunk = [this]() -> Chunk* {
+                    for (Chunk& chunk : _chunks) {
+                        if (chunk.state == Chunk::State::kRead) {
+                            return &chunk;
+                        }
+                    }
+                    return nullptr;
+                };
+                _cv.wait(lock, [&] {
+                    chunk = findReadChunk();
+                    return chunk || _readDone || _failed;
+                });
+                if (!chunk) {
+                    return;
+                }
+                chunk->state = Chunk::State::kConverting;
+            }
+
+            for (uint32_t row = 0; row < chunk->numRows; row++) {
+                RYGBTransform::ImageBuffer rygb{.data = chunk->rygb.data() + row * _width * 4};
+                RYGBTransform::ConvertRows(rygb, outputs, _width, 1, 0, 1);
+                for (int colorSpace = 0; colorSpace < ColorSpace::ColorSpaceSize; colorSpace++) {
+                    const std::vector<float>& src = rowBuffers[colorSpace];
+                    uint8_t* dst = chunk->pixels[colorSpace].data()
+                                   + row * _width * _numOutputChannels;
+                    for (size_t i = 0; i < src.size(); i++) {
+                        dst[i] = QUANTIZER(src[i]);
+                    }
+                }
+            }
+            if (_format == OutputFormat::kTetra) {
+                size_t numValues = chunk->numRows * _width * 4;
+                for (size_t i = 0; i < numValues; i++) {
+                    rygbHalves[i] = RYGBTransform::FloatToHalf(chunk->rygb[i]);
+                }
+                if (!_tetra.WriteRYGBRows(chunk->rowBegin, chunk->numRows, rygbHalves.data())) {
+                    ERROR("Failed to write RYGB rows");
+                    fail();
+                    return;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            chunk->state = Chunk::State::kConverted;
+            _cv.notify_all();
+        }
+    }
+
+    bool writeRows(ColorSpace colorSpace, const Chunk& chunk)
+    {
+        size_t rowSize = _width * _numOutputChannels;
+        if (_format == OutputFormat::kTiled) {
+            const uint8_t* pixels = chunk.pixels[colorSpace].data();
+            for (uint32_t row = 0; row < chunk.numRows; row++) {
+                if (!_pyramids[colorSpace]->AddRow(pixels + row * rowSize)) {
+                    ERROR("Failed to write tiles");
+                    return false;
+                }
+            }
+            return true;
+        }
+        if (_format == OutputFormat::kTetra) {
+            const uint8_t* pixels = chunk.pixels[colorSpace].data();
+            for (uint32_t row = 0; row < chunk.numRows; row++) {
+                if (!_tetra.AddPlaneRow(colorSpace, pixels + row * rowSize)) {
+                    ERROR("Failed to write plane rows");
+                    return false;
+                }
+            }
+            return true;
+        }
+        std::array<png_bytep, MAX_ROWS_PER_CHUNK> rows;
+        for (uint32_t row = 0; row < chunk.numRows; row++) {
+            rows[row] = const_cast<png_bytep>(chunk.pixels[colorSpace].data() + row * rowSize);
+        }
+        return pngWriteRows(_outputs[colorSpace].png, rows.data(), chunk.numRows);
+    }
+
+    // encodes chunks of `colorSpace` in order, row by row
+    void encoderLoop(ColorSpace colorSpace)
+    {
+        Output& output = _outputs[colorSpace];
+        for (uint32_t i = 0; i < _numChunks; i++) {
+            Chunk& chunk = _chunks[i % _chunks.size()];
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv.wait(lock, [&] {
+                    return (chunk.state == Chunk::State::kConverted && chunk.index == i) || _failed;
+                });
+                if (_failed) {
+                    return;
+                }
+            }
+
+            if (!writeRows(colorSpace, chunk)) {
+                fail();
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (++chunk.numEncoded == ColorSpace::ColorSpaceSize) {
+                chunk.state = Chunk::State::kFree;
+                _cv.notify_all();
+            }
+        }
+        if (_format == OutputFormat::kPngPair && !pngWriteEnd(output.png, output.info)) {
+            fail();
+        }
+    }
+
+    struct Output
+    {
+        FILE* file = nullptr;
+        png_structp png = nullptr;
+        png_infop info = nullptr;
+    };
+
+    const uint32_t _numWorkers;
+    const OutputFormat _format;
+    const uint32_t _numOutputChannels;
+
+    uint32_t _width = 0;
+    uint32_t _height = 0;
+    uint32_t _rowsPerChunk = 0;
+    uint32_t _numChunks = 0;
+
+    std::vector<Chunk> _chunks; // ring of chunks, chunk `i` goes into `_chunks[i % size]`
+    std::array<Output, ColorSpace::ColorSpaceSize> _outputs;
+    TiledImage::Writer _tiles;
+    // each keeps a tile row of every level, i.e. ~2 * `TILE_STRIDE` rows of the canvas
+    std::array<std::unique_ptr<TiledImage::PyramidBuilder>, ColorSpace::ColorSpaceSize> _pyramids;
+    TetraImage::Writer _tetra;
+    std::vector<std::filesystem::path> _openedOutputs; // removed if the conversion fails
+
+    std::mutex _mutex; // guards chunk states and the flags below
+    std::condition_variable _cv;
+    bool _readDone = false;
+    bool _failed = false;
+};
+
+bool isCanvas(const std::filesystem::path& path)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".tif" || extension == ".tiff";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    INIT_LOGS();
+    // painter canvases don't declare their 4th channel as an extra sample, which libtiff warns
+    // about on every file
+    TIFFSetWarningHandler(nullptr);
+
+    OutputFormat format = OutputFormat::kPngPair;
+    if (argc > 1 && std::string(argv[1]) == "--tiled") {
+        format = OutputFormat::kTiled;
+        argc--;
+        argv++;
+    } else if (argc > 1 && std::string(argv[1]) == "--tetra") {
+        format = OutputFormat::kTetra;
+        argc--;
+        argv++;
+    }
+    if (argc < 2) {
+        ERROR("usage: TetriumConvert [--tiled | --tetra] <input directory or .tiff> "
+              "[output directory] [num threads]");
+        return 1;
+    }
+    std::filesystem::path input = argv[1];
+    std::filesystem::path outputDir = argc > 2 ? argv[2]
+                                      : std::filesystem::is_directory(input) ? input
+                                                                             : input.parent_path();
+    uint32_t numThreads = argc > 3 ? std::stoul(argv[3]) : std::thread::hardware_concurrency();
+
+    std::vector<std::filesystem::path> canvases;
+    if (std::filesystem::is_directory(input)) {
+        for (const auto& entry : std::filesystem::directory_iterator(input)) {
+            if (entry.is_regular_file() && isCanvas(entry.path())) {
+                canvases.push_back(entry.path());
+            }
+        }
+        std::sort(canvases.begin(), canvases.end());
+    } else if (std::filesystem::is_regular_file(input)) {
+        canvases.push_back(input);
+    } else {
+        ERROR("{} does not exist", input.string());
+        return 1;
+    }
+    if (!outputDir.empty()) {
+        std::filesystem::create_directories(outputDir);
+    }
+
+    INFO("Converting {} canvases with {} kernels", canvases.size(), RYGBTransform::GetKernelName());
+    auto begin = std::chrono::steady_clock::now();
+
+    Converter converter(std::max(1u, numThreads), format);
+    uint32_t numConverted = 0;
+    for (const std::filesystem::path& canvas : canvases) {
+        std::vector<std::filesystem::path> outputs;
+        if (format == OutputFormat::kTiled) {
+            outputs.push_back(outputDir / (canvas.stem().string() + TiledImage::FILE_EXTENSION));
+        } else if (format == OutputFormat::kTetra) {
+            outputs.push_back(outputDir / (canvas.stem().string() + TetraImage::FILE_EXTENSION));
+        } else {
+            for (const char* suffix : COLOR_SPACE_SUFFIXES) {
+                outputs.push_back(outputDir / (canvas.stem().string() + suffix));
+            }
+        }
+        if (converter.Convert(canvas, outputs)) {
+            numConverted++;
+            DEBUG("Converted {}", canvas.string());
+        } else {
+            ERROR("Failed to convert {}", canvas.string());
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    INFO("Converted {}/{} canvases in {:.2f}s", numConverted, canvases.size(), elapsed.count());
+    return numConverted == canvases.size() ? 0 : 1;
+}